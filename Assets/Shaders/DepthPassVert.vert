@@ -1,14 +1,18 @@
-#version 400 core
+#version 430 core
 
-uniform mat4 modelMatrix 	= mat4(1.0f);
-uniform mat4 viewMatrix 	= mat4(1.0f);
-uniform mat4 projMatrix 	= mat4(1.0f);
+#include "Shared/ComputeBindings.h"
+#include "Shared/UniformBindings.h"
+#include "Shared/IndirectDrawDefinitions.h"
+#include "Shared/FrameDefinitions.h"
+
+// The model matrix comes from objects[], indexed the same way as in GameTechVert.vert
+layout(std430, binding = COMPUTE_BINDING_OBJECT_BUFFER) readonly buffer objectSSBO {
+	ObjectData objects[];
+};
 
 layout(location = 0) in vec3 position;
-layout(location = 1) in vec4 colour;
 layout(location = 2) in vec2 texCoord;
-layout(location = 3) in vec3 normal;
-layout(location = 4) in vec4 tangent;
+layout(location = VERTEX_ATTRIBUTE_OBJECT_INDEX) in uint objectIndex;
 
 out Vertex
 {
@@ -17,8 +21,7 @@ out Vertex
 
 void main(void)
 {
-	mat4 mvp 		  = (projMatrix * viewMatrix * modelMatrix);
-	vec4 result_pos = mvp * vec4(position.xyz , 1.0);
+	mat4 mvp 		  = (frame.projMatrix * frame.viewMatrix * objects[objectIndex + gl_InstanceID].modelMatrix);
 	OUT.texCoord = texCoord;
-	gl_Position = result_pos;
-}
\ No newline at end of file
+	gl_Position = mvp * vec4(position.xyz , 1.0);
+}
@@ -1,6 +1,8 @@
 #version 430 core
 
 #include "Shared/TextureBindings.h"
+#include "Shared/UniformBindings.h"
+#include "Shared/FrameDefinitions.h"
 #include "lighting.frag"
 
 layout(binding = TEXTURE_BINDING_DIFFUSE) uniform sampler2D 	mainTex;
@@ -12,10 +14,6 @@ layout(std430, binding = 0) readonly buffer lightSSBO {
 	PointLight pointLights[];
 };
 
-uniform int noOfLights;
-
-uniform vec3	cameraPos;
-
 uniform bool hasTexture;
 uniform bool hasBump;
 uniform bool hasSpec;
@@ -68,10 +66,10 @@ void main(void)
 
 	fragColor.rgb = albedo.rgb * 0.1f; //ambient
 
-	vec3 viewDir = normalize(cameraPos - IN.worldPos);
+	vec3 viewDir = normalize(frame.cameraPos - IN.worldPos);
 	vec3 diffuseLight = vec3(0);
 	vec3 specularLight = vec3(0);
-	for (int i = 0; i < noOfLights; i++) {
+	for (int i = 0; i < frame.noOfLights; i++) {
 		PointLight light = pointLights[i];
 		calculateLighting(light, IN.worldPos, viewDir, normal, specSample, diffuseLight, specularLight);
 	}
@@ -1,6 +1,14 @@
-#version 400 core
+#version 430 core
 
-uniform mat4 mvpMatrix 		= mat4(1.0f);
+#include "Shared/ComputeBindings.h"
+#include "Shared/IndirectDrawDefinitions.h"
+
+// The model matrix comes from objects[], indexed the same way as in GameTechVert.vert
+layout(std430, binding = COMPUTE_BINDING_OBJECT_BUFFER) readonly buffer objectSSBO {
+	ObjectData objects[];
+};
+
+uniform mat4 viewProjMatrix = mat4(1.0f);
 
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec4 colour;
@@ -8,6 +16,7 @@ layout(location = 2) in vec2 texCoord;
 
 layout(location = 5) in vec4   jointWeights;
 layout(location = 6) in  vec4  jointIndices;
+layout(location = VERTEX_ATTRIBUTE_OBJECT_INDEX) in uint objectIndex;
 
 uniform bool hasJoints = false;
 
@@ -15,6 +24,7 @@ uniform mat4 joints[128];
 
 void main(void)
 {
+	mat4 mvpMatrix = viewProjMatrix * objects[objectIndex + gl_InstanceID].modelMatrix;
     if (hasJoints) {
 	  vec4  localPos   = vec4(position , 1.0f);
 	  vec4  skelPos    = vec4 (0,0,0,0);
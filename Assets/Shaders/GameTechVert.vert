@@ -1,9 +1,16 @@
-#version 400 core
+#version 430 core
 
-uniform mat4 modelMatrix 	= mat4(1.0f);
-uniform mat4 viewMatrix 	= mat4(1.0f);
-uniform mat4 projMatrix 	= mat4(1.0f);
-//uniform mat4 shadowMatrix 	= mat4(1.0f);
+#include "Shared/ComputeBindings.h"
+#include "Shared/UniformBindings.h"
+#include "Shared/IndirectDrawDefinitions.h"
+#include "Shared/FrameDefinitions.h"
+
+// Per object values come from objects[], for draws from the mesh arena the object index is an instanced
+// attribute and for direct draws it's set with glVertexAttribI1ui. Direct draws of several instances read
+// consecutive objects from there, arena commands always draw one instance.
+layout(std430, binding = COMPUTE_BINDING_OBJECT_BUFFER) readonly buffer objectSSBO {
+	ObjectData objects[];
+};
 
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec4 colour;
@@ -11,11 +18,7 @@ layout(location = 2) in vec2 texCoord;
 layout(location = 3) in vec3 normal;
 layout(location = 4) in vec4 tangent;
 layout(location = 5) in vec4 bitangent;
-
-
-uniform vec4 		objectColour = vec4(1,1,1,1);
-
-uniform bool hasVertexColours = false;
+layout(location = VERTEX_ATTRIBUTE_OBJECT_INDEX) in uint objectIndex;
 
 out Vertex
 {
@@ -31,7 +34,10 @@ out Vertex
 
 void main(void)
 {
-	mat4 mvp 		  = (projMatrix * viewMatrix * modelMatrix);
+	ObjectData object = objects[objectIndex + gl_InstanceID];
+	mat4 modelMatrix  = object.modelMatrix;
+
+	mat4 mvp 		  = (frame.projMatrix * frame.viewMatrix * modelMatrix);
 	mat3 normalMatrix = transpose ( inverse ( mat3 ( modelMatrix )));
 
 	vec3 wNormal    = normalize ( normalMatrix * normalize ( normal ));
@@ -44,14 +50,14 @@ void main(void)
 	//OUT.binormal    = cross(wTangent, wNormal) * tangent.w;
 	OUT.binormal = bitangent.xyz * -1;
 	OUT.texCoord	= texCoord;
-	OUT.colour		= objectColour;
+	OUT.colour		= object.colour;
 
-	if(hasVertexColours) {
-		OUT.colour		= objectColour * colour;
+	if((object.flags & OBJECT_FLAG_VERTEX_COLOURS) != 0) {
+		OUT.colour		= object.colour * colour;
 	}
 
 	vec4 result_pos = mvp * vec4(position.xyz , 1.0);
 	OUT.depth = result_pos.z / result_pos.w;
 
 	gl_Position = result_pos;
-}
\ No newline at end of file
+}
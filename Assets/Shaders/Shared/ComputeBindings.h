@@ -5,5 +5,20 @@
 #define COMPUTE_BINDING_LIGHT_INDEX_BUFFER 2
 #define COMPUTE_BINDING_ACTIVE_CLUSTERS_BUFFER 3
 #define COMPUTE_BINDING_TEST4 4
-#define COMPUTE_BINDING_TEST5 5
-#define COMPUTE_BINDING_TEST6 6
\ No newline at end of file
+#define COMPUTE_BINDING_ACTIVE_CLUSTER_LIST 5
+#define COMPUTE_BINDING_ACTIVE_CLUSTER_DISPATCH 6
+#define COMPUTE_BINDING_LIGHT_GRID_BUFFER 7
+#define COMPUTE_BINDING_LIGHT_INDEX_COUNTER 8
+#define COMPUTE_BINDING_LIGHT_BVH_NODES 9
+#define COMPUTE_BINDING_LIGHT_BVH_ORDER 10
+#define COMPUTE_BINDING_SCAN_INPUT 11
+#define COMPUTE_BINDING_SCAN_OUTPUT 12
+#define COMPUTE_BINDING_SCAN_BLOCK_SUMS 13
+#define COMPUTE_BINDING_COMPACT_OUTPUT 14
+#define COMPUTE_BINDING_COMPACT_DISPATCH 15
+#define COMPUTE_BINDING_OBJECT_BUFFER 16
+#define COMPUTE_BINDING_OCCLUSION_COMMANDS 17
+#define COMPUTE_BINDING_OCCLUSION_CULLED_COMMANDS 18
+#define COMPUTE_BINDING_OBJECT_VISIBILITY 19
+#define COMPUTE_BINDING_POINT_SHADOW_SLOTS 20
+#define COMPUTE_BINDING_POINT_SHADOWS 21
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+
+// Hierarchical depth built from the depth prepass by depthPyramid.comp, one level per dispatch.
+// Level 0 is half resolution, and level n has the usual mip size, each texel covering 2^(n+1) x 2^(n+1) pixels.
+// When a level halves unevenly its last row and column also cover the pixels left over, so every texel is conservative.
+// Each texel holds:
+//   x - nearest depth
+//   y - farthest depth of anything drawn, 0 when nothing was
+//   z - farthest depth including cleared pixels, for occlusion tests
+#define DEPTH_PYRAMID_GROUP_SIZE 16
+
+// Level whose texels match the 16x16 forward+ tiles
+#define DEPTH_PYRAMID_TILE_LEVEL 3
+// Level activeClusters.comp flags clusters from, 4x4 pixels per texel
+#define DEPTH_PYRAMID_ACTIVE_CLUSTER_LEVEL 1
+
+// Image unit depthPyramid.comp writes the level being built through
+#define IMAGE_BINDING_DEPTH_PYRAMID 0
@@ -0,0 +1,24 @@
+#pragma once
+
+#ifdef __cplusplus
+#include "GLSLTypeAliases.h"
+namespace NCL::GLSL {
+#endif
+
+// Set once a frame for every scene shader, read with std140 layout, where a vec3 followed by a scalar packs the
+// same as it does in C++
+struct FrameData {
+	mat4 viewMatrix;
+	mat4 projMatrix;
+	vec3 cameraPos;
+	int noOfLights;
+};
+
+#ifdef __cplusplus
+} // namespace
+#else
+// Needs UniformBindings.h included first
+layout(std140, binding = UNIFORM_BINDING_FRAME) uniform frameUBO {
+	FrameData frame;
+};
+#endif
@@ -0,0 +1,22 @@
+#pragma once
+
+// Octahedral normal encoding for the compact G-buffer layouts. Maps a unit vector onto the octahedron, folds the
+// lower half over the upper, and stores the result in [0, 1] so it fits a unorm RG16 target.
+vec2 octWrap(vec2 v) {
+	return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 encodeOctahedral(vec3 n) {
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	vec2 p = n.z >= 0.0 ? n.xy : octWrap(n.xy);
+	return p * 0.5 + 0.5;
+}
+
+vec3 decodeOctahedral(vec2 encoded) {
+	vec2 p = encoded * 2.0 - 1.0;
+	vec3 n = vec3(p, 1.0 - abs(p.x) - abs(p.y));
+	float t = clamp(-n.z, 0.0, 1.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#ifdef __cplusplus
+#include "GLSLTypeAliases.h"
+namespace NCL::GLSL {
+#endif
+
+// Per-vertex attribute holding the object index, read with a divisor of 1 so each
+// draw's baseInstance picks its ObjectData without needing gl_DrawID
+#define VERTEX_ATTRIBUTE_OBJECT_INDEX 8
+
+// ObjectData::flags
+#define OBJECT_FLAG_VERTEX_COLOURS 1
+
+// Matches the layout glMultiDrawElementsIndirect reads from GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand {
+	uint count;
+	uint instanceCount;
+	uint firstIndex;
+	int baseVertex;
+	uint baseInstance;
+};
+
+// One per object drawn through the mesh arena, read by the indirect vertex shaders with std430 layout
+struct ObjectData {
+	mat4 modelMatrix;
+	vec4 colour;
+	// World space box around the object, xyz only, for occlusionCull.comp
+	vec4 boundsCentre;
+	vec4 boundsHalfSize;
+	uint flags;
+	uint padding[3];
+};
+
+#ifdef __cplusplus
+} // namespace
+#endif
@@ -0,0 +1,37 @@
+#pragma once
+
+#ifdef __cplusplus
+#include "GLSLTypeAliases.h"
+namespace NCL::GLSL {
+#endif
+
+// Motion models, combined as flags in LightAnimationParams::models
+// Falls at fallSpeed, wrapping from the bottom of the bounds back to the top
+#define LIGHT_ANIMATION_FALL 1
+// Circles the vertical axis through orbitCentre at orbitSpeed radians per second
+#define LIGHT_ANIMATION_ORBIT 2
+// Scales intensity (colour.a) by a wave at flickerRate cycles per second, with each light at its own phase
+#define LIGHT_ANIMATION_FLICKER 4
+
+#define LIGHT_ANIMATION_GROUP_SIZE 256
+
+// Laid out to match std140, updateLights.comp reads it from a uniform buffer
+struct LightAnimationParams {
+	vec4 minBounds;
+	vec4 maxBounds;
+	vec4 orbitCentre;
+	float dt;
+	// Seconds since the animation started, for the flicker wave
+	float time;
+	float fallSpeed;
+	float orbitSpeed;
+	float flickerRate;
+	// How far below full intensity a flicker dips, 0 to 1
+	float flickerAmount;
+	uint models;
+	uint lightCount;
+};
+
+#ifdef __cplusplus
+} // namespace
+#endif
@@ -0,0 +1,30 @@
+#pragma once
+
+#ifdef __cplusplus
+#include "GLSLTypeAliases.h"
+namespace NCL::GLSL {
+#endif
+
+// Lights per leaf node, and leaf nodes per top level node.
+#define LIGHT_BVH_LEAF_SIZE 32
+#define LIGHT_BVH_BRANCH_SIZE 32
+
+// Node counts at the renderer's MAX_LIGHTS (98304).
+#define LIGHT_BVH_MAX_LEAVES 3072
+#define LIGHT_BVH_MAX_TOP_NODES 96
+
+// Node of the two level hierarchy built by LightBVH. Bounds are world space and include each light's radius.
+// Nodes are stored top level first. A top level node's first/count is a range of leaf nodes,
+// a leaf node's first/count is a range of the Morton sorted light order.
+struct LightBVHNode {
+	vec4 boundsMin;
+	vec4 boundsMax;
+	uint first;
+	uint count;
+	uint pad0;
+	uint pad1;
+};
+
+#ifdef __cplusplus
+} // namespace
+#endif
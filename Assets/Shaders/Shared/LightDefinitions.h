@@ -6,6 +6,7 @@ namespace NCL::GLSL {
 #endif
 
 struct PointLight {
+	// rgb is the colour, a scales it as the light's intensity
 	vec4 colour;
 	vec4 pos;
 	vec4 radius;
@@ -5,6 +5,9 @@
 namespace NCL::GLSL {
 #endif
 
+// Pixels along each side of a deferredLighting.comp work group
+#define DEFERRED_LIGHTING_GROUP_SIZE 16
+
 // Unused. AABBs are constructed in the culling shader. Might change at some point.
 struct TileAABB {
 	vec4 min;
@@ -26,11 +29,19 @@ struct ClusterFrustum {
 	vec4 nearFar;
 };
 
-// Unused
-//struct LightGrid {
-//	uint count;
-//	uint lightIndices[MAX_LIGHTS_PER_TILE];
-//};
+// Range of a tile or cluster's lights in the packed light index list.
+struct LightGrid {
+	uint offset;
+	uint count;
+};
+
+// Layout glDispatchComputeIndirect reads. GpuCompact writes one work group per active cluster,
+// so numGroupsX is also the number of active clusters.
+struct DispatchIndirectCommand {
+	uint numGroupsX;
+	uint numGroupsY;
+	uint numGroupsZ;
+};
 
 #ifdef __cplusplus
 } // namespace
@@ -0,0 +1,6 @@
+#pragma once
+
+#define OCCLUSION_GROUP_SIZE 64
+
+// Boxes with a corner at or behind this clip space w can't be projected, and are kept
+#define OCCLUSION_MIN_W 0.0001
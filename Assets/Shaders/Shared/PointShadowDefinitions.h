@@ -0,0 +1,22 @@
+#pragma once
+
+#ifdef __cplusplus
+#include "GLSLTypeAliases.h"
+namespace NCL::GLSL {
+#endif
+
+#define POINT_SHADOW_FACE_COUNT 6
+// A light's entry in the slot table when it isn't shadowed this frame
+#define POINT_SHADOW_NO_SLOT 0xFFFFFFFFu
+
+// One light's cube shadow in the atlas, read with std430 layout
+struct PointShadow {
+	// World space to atlas [0, 1] space after the divide by w, one per face in the order +X, -X, +Y, -Y, +Z, -Z
+	mat4 faceMatrices[POINT_SHADOW_FACE_COUNT];
+	// Where the light was when the faces were drawn, which can be behind where it is now. w is unused.
+	vec4 lightPos;
+};
+
+#ifdef __cplusplus
+} // namespace
+#endif
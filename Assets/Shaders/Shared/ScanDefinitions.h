@@ -0,0 +1,5 @@
+#pragma once
+
+// Elements scanned by each work group of scanBlocks.comp, and the work group size of the other scan and compact shaders.
+// Must be a power of two.
+#define SCAN_BLOCK_SIZE 256
\ No newline at end of file
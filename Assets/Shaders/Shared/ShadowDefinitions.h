@@ -0,0 +1,34 @@
+#pragma once
+
+#ifdef __cplusplus
+#include "GLSLTypeAliases.h"
+namespace NCL::GLSL {
+#endif
+
+#define SHADOW_CASCADE_COUNT 4
+
+// The directional light and its cascades, set once a frame and read with std140 layout
+struct ShadowData {
+	// World space to [0, 1] shadow map space, one per cascade
+	mat4 cascadeMatrices[SHADOW_CASCADE_COUNT];
+	// The view space distance each cascade ends at
+	vec4 cascadeSplits;
+	// World size of a texel in each cascade, the normal offset is scaled by it
+	vec4 cascadeTexelSizes;
+	// xyz is the direction the light travels, w is 1 if the light is on
+	vec4 sunDirection;
+	// rgb is the colour, a the intensity
+	vec4 sunColour;
+	// x is 1 if clustered shading reads the point light shadow atlas, y the world size of an atlas texel per unit of
+	// distance from its light
+	vec4 pointShadowParams;
+};
+
+#ifdef __cplusplus
+} // namespace
+#else
+// Needs UniformBindings.h included first
+layout(std140, binding = UNIFORM_BINDING_SHADOW) uniform shadowUBO {
+	ShadowData shadow;
+};
+#endif
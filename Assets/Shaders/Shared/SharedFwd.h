@@ -10,6 +10,15 @@ namespace NCL::GLSL {
 	struct Plane;
 	struct Frustum;
 	struct ClusterFrustum;
+	struct LightGrid;
+	struct LightBVHNode;
+	struct DispatchIndirectCommand;
+	struct LightAnimationParams;
+	struct DrawElementsIndirectCommand;
+	struct ObjectData;
+	struct FrameData;
+	struct ShadowData;
+	struct PointShadow;
 
 #ifdef __cplusplus
 } // namespace
@@ -17,5 +26,14 @@ using PointLight = NCL::GLSL::PointLight;
 using TilePlane = NCL::GLSL::Plane;
 using TileFrustum = NCL::GLSL::Frustum;
 using ClusterFrustum = NCL::GLSL::ClusterFrustum;
+using LightGrid = NCL::GLSL::LightGrid;
+using LightBVHNode = NCL::GLSL::LightBVHNode;
+using DispatchIndirectCommand = NCL::GLSL::DispatchIndirectCommand;
+using LightAnimationParams = NCL::GLSL::LightAnimationParams;
+using DrawElementsIndirectCommand = NCL::GLSL::DrawElementsIndirectCommand;
+using ObjectData = NCL::GLSL::ObjectData;
+using FrameData = NCL::GLSL::FrameData;
+using ShadowData = NCL::GLSL::ShadowData;
+using PointShadow = NCL::GLSL::PointShadow;
 
 #endif
\ No newline at end of file
@@ -2,4 +2,6 @@
 
 #define TEXTURE_BINDING_DIFFUSE 0
 #define TEXTURE_BINDING_NORMAL 1
-#define TEXTURE_BINDING_SPECULAR 2
\ No newline at end of file
+#define TEXTURE_BINDING_SPECULAR 2
+#define TEXTURE_BINDING_SHADOW_CASCADES 3
+#define TEXTURE_BINDING_POINT_SHADOW_ATLAS 4
\ No newline at end of file
@@ -0,0 +1,5 @@
+#pragma once
+
+#define UNIFORM_BINDING_FRAME 0
+#define UNIFORM_BINDING_LIGHT_ANIMATION 1
+#define UNIFORM_BINDING_SHADOW 2
\ No newline at end of file
@@ -1,17 +1,19 @@
 #version 430 core
 
+#include "Shared/GBufferEncoding.h"
+
 layout(binding = 0) uniform sampler2D mainTex; // Diffuse texture map
 layout(binding = 1) uniform sampler2D bumpTex; // Bump map
 layout(binding = 2) uniform sampler2D specTex;
 //uniform sampler2DShadow shadowTex;
 
-uniform vec3	cameraPos;
-
 uniform bool hasTexture;
 uniform bool hasBump;
 uniform bool hasSpec;
 
 uniform float isDepth;
+// Octahedral normals, with the specular intensity read from the albedo's alpha rather than the normal's
+uniform bool compactGBuffer;
 
 in Vertex {
 	vec4 colour;
@@ -38,7 +40,6 @@ void main ( void ) {
 	if (fragColour[0].a < 0.1) {
 		discard;
 	}
-	fragColour[0].a = 1;
 	
 	mat3 TBN = mat3 (normalize (IN.tangent), normalize (IN.binormal), normalize (IN.normal));
 	// float shadow = 1.0;
@@ -57,6 +58,13 @@ void main ( void ) {
 	   specVal = texture2D(specTex, IN.texCoord).r;
 	}
 	
-	fragColour [1] = vec4 (normal.xyz * 0.5 + 0.5 , 1);
+	// Both layouts keep the specular intensity in albedo's alpha, only the RGBA8 lighting reads the normal's
+	fragColour[0].a = specVal;
+	if (compactGBuffer) {
+		fragColour[1] = vec4(encodeOctahedral(normalize(normal)), 0, 0);
+	}
+	else {
+		fragColour[1] = vec4(normal.xyz * 0.5 + 0.5, specVal);
+	}
 	//fragColour[1] = vec4(IN.binormal, 1);
 }
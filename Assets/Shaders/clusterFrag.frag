@@ -1,30 +1,30 @@
 #version 430 core
 
-#define MAX_LIGHTS_PER_TILE 2048
-
 #include "Shared/Debug.h"
 #include "Shared/TextureBindings.h"
+#include "Shared/ComputeBindings.h"
+#include "Shared/UniformBindings.h"
+#include "Shared/FrameDefinitions.h"
+#include "Shared/LightGridDefinitions.h"
 #include "lighting.frag"
+#include "shadows.frag"
+#include "pointShadows.frag"
 
 layout(binding = TEXTURE_BINDING_DIFFUSE) uniform sampler2D 	mainTex;
 layout(binding = TEXTURE_BINDING_NORMAL) uniform sampler2D   bumpTex;
 layout(binding = TEXTURE_BINDING_SPECULAR) uniform sampler2D   specTex;
 //uniform sampler2DShadow shadowTex;
 
-uniform mat4 projMatrix;
-
- struct LightGrid {
-	 uint count;
-	 uint lightIndices[MAX_LIGHTS_PER_TILE];
- };
-
-
-layout(std430, binding = 0) readonly buffer lightSSBO {
+layout(std430, binding = COMPUTE_BINDING_LIGHT_BUFFER) readonly buffer lightSSBO {
 	PointLight pointLights[];
 };
 
-layout(std430, binding = 2) buffer lightGridSSBO {
-	int lightIndices[];
+layout(std430, binding = COMPUTE_BINDING_LIGHT_INDEX_BUFFER) readonly buffer lightIndexSSBO {
+	uint lightIndices[];
+};
+
+layout(std430, binding = COMPUTE_BINDING_LIGHT_GRID_BUFFER) readonly buffer lightGridSSBO {
+	LightGrid lightGrid[];
 };
 
 layout(std430, binding = 3) buffer activeClusterSSBO {
@@ -35,13 +35,10 @@ layout(std430, binding = 4) buffer globalIndexCountSSBO {
 	float testDepth[];
 };
 
-uniform int noOfLights;
 uniform int numTilesX;
 uniform int tilePxX;
 uniform int tilePxY;
 
-uniform vec3	cameraPos;
-
 uniform bool hasTexture;
 uniform bool hasBump;
 uniform bool hasSpec;
@@ -68,7 +65,7 @@ out vec4 fragColor;
 
 float linearDepth(float depthSample){
     float depthRange = depthSample * 2.0 - 1.0;
-	float lin = projMatrix[3][2] / (projMatrix[2][2] + depthRange);
+	float lin = frame.projMatrix[3][2] / (frame.projMatrix[2][2] + depthRange);
     return lin;
 }
 
@@ -87,8 +84,8 @@ void main(void)
 	uvec3 tiles = uvec3(uvec2(gl_FragCoord.x / tilePxX, gl_FragCoord.y / tilePxY), zTile);
 	uint tileIndex = tiles.x + (gridDims.x * (tiles.y + gridDims.y * tiles.z));
 	
-	uint lightCount = 0;
-	uint lightIndexOffset = tileIndex * MAX_LIGHTS_PER_TILE;
+	LightGrid cell = lightGrid[tileIndex];
+	uint lightCount = cell.count;
 
 	mat3 TBN = mat3(normalize(IN.tangent), normalize(IN.binormal), normalize(IN.normal));
 
@@ -118,17 +115,16 @@ void main(void)
 
 	fragColor.rgb = albedo.rgb * 0.1f; //ambient
 
-	vec3 viewDir = normalize(cameraPos - IN.worldPos);
+	vec3 viewDir = normalize(frame.cameraPos - IN.worldPos);
 	vec3 diffuseLight = vec3(0);
 	vec3 specularLight = vec3(0);
-//	for (uint i = 0; i < lightCount; i++) {
-	for (int i = 0; i < MAX_LIGHTS_PER_TILE && lightIndices[lightIndexOffset + i] != -1; i++) {
-		lightCount++;
-	//	uint lightIndex = globalLightIndexList[lightIndexOffset + i];
-		uint lightIndex = lightIndices[lightIndexOffset + i];
+	for (uint i = 0; i < cell.count; i++) {
+		uint lightIndex = lightIndices[cell.offset + i];
 		PointLight light = pointLights[lightIndex];
+		light.colour.a *= samplePointShadow(lightIndex, IN.worldPos, normal);
 		calculateLighting(light, IN.worldPos, viewDir, normal, specSample, diffuseLight, specularLight);
 	}
+	calculateSunLighting(IN.worldPos, viewDir, normal, specSample, linearDepth(gl_FragCoord.z), diffuseLight, specularLight);
 	
 	//fragColor.rgb = pow(fragColor.rgb, vec3(1.0 / 2.2f));
 	fragColor.rgb += albedo.rgb * diffuseLight;
@@ -2,6 +2,8 @@
 layout(binding = 0) uniform sampler2D diffuseTex;
 layout(binding = 1) uniform sampler2D diffuseLight;
 layout(binding = 2) uniform sampler2D specularLight;
+// diffuseLight already holds diffuse * albedo + specular, and specularLight isn't bound
+uniform bool compactGBuffer;
 
 //uniform sampler2D skyboxTex;
 //uniform sampler2D scene_depth;
@@ -15,11 +17,16 @@ out vec4 fragColour;
 void main (void) {
 	vec3 diffuse = texture(diffuseTex, IN.texCoord).xyz;
 	vec3 light = texture(diffuseLight, IN.texCoord).xyz;
-	vec3 specular = texture(specularLight, IN.texCoord).xyz;
 
 	fragColour.xyz = diffuse * 0.1; // ambient
-	fragColour.xyz += diffuse * light; // lambert
-	fragColour.xyz += specular; // Specular
+	if (compactGBuffer) {
+		fragColour.xyz += light; // lambert and specular
+	}
+	else {
+		vec3 specular = texture(specularLight, IN.texCoord).xyz;
+		fragColour.xyz += diffuse * light; // lambert
+		fragColour.xyz += specular; // Specular
+	}
 	fragColour.a = 1.0;
 
 	//vec3 depth_tex = texture(scene_depth, IN.texCoord).xyz;
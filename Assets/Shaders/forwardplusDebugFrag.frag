@@ -3,6 +3,8 @@
 #define TILE_SIZE 16
 #define MAX_LIGHTS_PER_TILE 16
 #include "Shared/LightDefinitions.h"
+#include "Shared/UniformBindings.h"
+#include "Shared/FrameDefinitions.h"
 
  struct LightGrid {
 	 uint count;
@@ -31,12 +33,9 @@ layout(std430, binding = 2) buffer lightGridSSBO {
 //	float testDepth[];
 //};
 
-uniform int noOfLights;
 uniform int numTilesX;
 uniform int tilePxX;
 
-uniform vec3	cameraPos;
-
 in Vertex
 {
 	vec4 colour;
@@ -22,7 +22,8 @@ void calculateLighting(PointLight light, vec3 fragPos, vec3 viewDir, vec3 normal
 		float rFactor = clamp(dot(halfDir, normal), 0.0, 1.0);
 		float sFactor = calculateSpecular(rFactor) * specSample;
 
-		vec3 attenuated = light.colour.rgb * attenuation;
+		// colour.a is the light's intensity, animated by updateLights.comp when flickering
+		vec3 attenuated = light.colour.rgb * light.colour.a * attenuation;
 		//fragColor.rgb += albedo.rgb * attenuated * lambert; //diffuse light
 		//fragColor.rgb += albedo.rgb * attenuated * lambert;
 		//fragColor.rgb += light.colour.rgb * attenuated * sFactor * 0.33;
@@ -0,0 +1,51 @@
+// Needs ComputeBindings.h and TextureBindings.h included first, and shadows.frag for the shadow block
+#include "Shared/PointShadowDefinitions.h"
+
+layout(binding = TEXTURE_BINDING_POINT_SHADOW_ATLAS) uniform sampler2DShadow pointShadowAtlas;
+
+// The atlas slot of every light, POINT_SHADOW_NO_SLOT for lights that aren't shadowed this frame
+layout(std430, binding = COMPUTE_BINDING_POINT_SHADOW_SLOTS) readonly buffer pointShadowSlotSSBO {
+	uint pointShadowSlots[];
+};
+
+layout(std430, binding = COMPUTE_BINDING_POINT_SHADOWS) readonly buffer pointShadowSSBO {
+	PointShadow pointShadows[];
+};
+
+// How far along the normal to move the sample point, in texels at its distance from the light
+const float POINT_SHADOW_NORMAL_OFFSET = 1.5;
+
+// 1 where the light reaches worldPos, 0 in its shadow, filtered by the hardware compare. Lights without a slot
+// are never shadowed.
+// The faces are drawn from the CPU's copy of the lights, which can be a frame or two behind the one lightPos comes
+// from, so the face and offset are worked out from where they were drawn to match their matrices.
+float samplePointShadow(uint lightIndex, vec3 worldPos, vec3 normal) {
+	if (shadow.pointShadowParams.x == 0.0) {
+		return 1.0;
+	}
+	uint slot = pointShadowSlots[lightIndex];
+	if (slot == POINT_SHADOW_NO_SLOT) {
+		return 1.0;
+	}
+
+	vec3 lightPos = pointShadows[slot].lightPos.xyz;
+	float texelSize = length(worldPos - lightPos) * shadow.pointShadowParams.y;
+	vec3 offsetPos = worldPos + normal * texelSize * POINT_SHADOW_NORMAL_OFFSET;
+
+	// The face the light sees the point through, in the order PointShadowAtlas draws them
+	vec3 fromLight = offsetPos - lightPos;
+	vec3 axisDist = abs(fromLight);
+	int face;
+	if (axisDist.x >= axisDist.y && axisDist.x >= axisDist.z) {
+		face = fromLight.x >= 0.0 ? 0 : 1;
+	}
+	else if (axisDist.y >= axisDist.z) {
+		face = fromLight.y >= 0.0 ? 2 : 3;
+	}
+	else {
+		face = fromLight.z >= 0.0 ? 4 : 5;
+	}
+
+	vec4 shadowPos = pointShadows[slot].faceMatrices[face] * vec4(offsetPos, 1.0);
+	return texture(pointShadowAtlas, shadowPos.xyz / shadowPos.w);
+}
@@ -1,20 +1,23 @@
 #version 430 core
 
+#include "Shared/GBufferEncoding.h"
 #include "lighting.frag"
 
 layout(binding = 0) uniform sampler2D depthTex;
 layout(binding = 1) uniform sampler2D normTex;
-layout(binding = 2) uniform sampler2D specTex;
+layout(binding = 2) uniform sampler2D albedoTex;
 //uniform sampler2D shadowTex;
 
 uniform vec3 cameraPos;
 uniform vec2 pixelSize; // reciprocal of resolution
+// Octahedral normals, and diffuse * albedo + specular written to diffuseOutput alone
+uniform bool compactGBuffer;
 
 layout(std430, binding = 0) readonly buffer lightSSBO {
 	PointLight pointLights[];
 };
 
-uniform int lightIndex;
+flat in int lightIndex;
 uniform mat4 inverseProjView;
 
 out vec4 diffuseOutput;
@@ -28,9 +31,20 @@ void main (void) {
 	vec3 worldPos = invClipPos . xyz / invClipPos.w;
 	
 	vec4 normalAndSpec = texture(normTex, texCoord.xy);
-	float specSample = normalAndSpec.a;
-	//vec3 normal = normalize ( texture ( normTex , texCoord.xy ).xyz *2.0 -1.0);
-	vec3 normal = normalize(normalAndSpec.xyz * 2.0 - 1.0);
+	vec3 normal;
+	float specSample;
+	vec3 albedo;
+	if (compactGBuffer) {
+		vec4 albedoAndSpec = texture(albedoTex, texCoord.xy);
+		albedo = albedoAndSpec.rgb;
+		specSample = albedoAndSpec.a;
+		normal = decodeOctahedral(normalAndSpec.xy);
+	}
+	else {
+		specSample = normalAndSpec.a;
+		//vec3 normal = normalize ( texture ( normTex , texCoord.xy ).xyz *2.0 -1.0);
+		normal = normalize(normalAndSpec.xyz * 2.0 - 1.0);
+	}
 	vec3 viewDir = normalize ( cameraPos - worldPos );
 
 	PointLight light = pointLights[lightIndex];
@@ -39,8 +53,13 @@ void main (void) {
 	calculateLighting(light, worldPos, viewDir, normal, specSample, diffuse, specular);
 	
 //	float shadow = texture(shadowTex, texCoord.xy).r * 2.0 - 1.0;
-	diffuseOutput = vec4 ( diffuse, 1.0);
-	specularOutput = vec4 ( specular , 1.0);
+	if (compactGBuffer) {
+		diffuseOutput = vec4(diffuse * albedo + specular, 1.0);
+	}
+	else {
+		diffuseOutput = vec4 ( diffuse, 1.0);
+		specularOutput = vec4 ( specular , 1.0);
+	}
 
 //	diffuseOutput = vec4 ( attenuated * lambert * shadow , 1.0);
 	//specularOutput = vec4 ( attenuated * specFactor * shadow * 0.33 , 1.0);
@@ -11,9 +11,11 @@ layout(std430, binding = 0) readonly buffer lightSSBO {
 	PointLight pointLights[];
 };
 
-uniform int lightIndex;
+// One instance per light
+flat out int lightIndex;
 
 void main (void) {
+	lightIndex = gl_InstanceID;
     PointLight light = pointLights[lightIndex];
 	vec3 scale = vec3(light.radius.x);
 	vec3 worldPos = (position * scale) + light.pos.xyz;
@@ -0,0 +1,54 @@
+// Needs UniformBindings.h and TextureBindings.h included first, and lighting.frag for calculateSpecular
+#include "Shared/ShadowDefinitions.h"
+
+layout(binding = TEXTURE_BINDING_SHADOW_CASCADES) uniform sampler2DArrayShadow shadowCascades;
+
+// How far along the normal to move the sample point, in texels of its cascade, to keep surfaces from shadowing themselves
+const float SHADOW_NORMAL_OFFSET = 1.5;
+const float SHADOW_DEPTH_BIAS = 0.0005;
+
+// 1 where the sun reaches worldPos, 0 in shadow, 3x3 PCF in between. viewDepth is the positive view space distance.
+float sampleSunShadow(vec3 worldPos, vec3 normal, float viewDepth) {
+	if (viewDepth >= shadow.cascadeSplits[SHADOW_CASCADE_COUNT - 1]) {
+		return 1.0;
+	}
+
+	int cascade = 0;
+	while (cascade < SHADOW_CASCADE_COUNT - 1 && viewDepth >= shadow.cascadeSplits[cascade]) {
+		cascade++;
+	}
+
+	vec3 offsetPos = worldPos + normal * shadow.cascadeTexelSizes[cascade] * SHADOW_NORMAL_OFFSET;
+	vec4 shadowPos = shadow.cascadeMatrices[cascade] * vec4(offsetPos, 1.0);
+	// Orthographic, so no divide by w
+	float compareDepth = shadowPos.z - SHADOW_DEPTH_BIAS;
+
+	vec2 texelSize = 1.0 / vec2(textureSize(shadowCascades, 0).xy);
+	float lit = 0.0;
+	for (int y = -1; y <= 1; ++y) {
+		for (int x = -1; x <= 1; ++x) {
+			lit += texture(shadowCascades, vec4(shadowPos.xy + vec2(x, y) * texelSize, cascade, compareDepth));
+		}
+	}
+	return lit / 9.0;
+}
+
+// Adds the sun's Blinn-Phong lighting, scaled by its shadow, to the same outputs calculateLighting writes
+void calculateSunLighting(vec3 worldPos, vec3 viewDir, vec3 normal, float specSample, float viewDepth, inout vec3 diffuseOut, inout vec3 specularOut) {
+	if (shadow.sunDirection.w == 0.0) {
+		return;
+	}
+
+	vec3 incident = -shadow.sunDirection.xyz;
+	float lambert = clamp(dot(incident, normal), 0.0, 1.0);
+	if (lambert <= 0.0) {
+		return;
+	}
+
+	float lit = sampleSunShadow(worldPos, normal, viewDepth);
+	vec3 halfDir = normalize(incident + viewDir);
+	float rFactor = clamp(dot(halfDir, normal), 0.0, 1.0);
+	vec3 colour = shadow.sunColour.rgb * shadow.sunColour.a * lit;
+	diffuseOut += colour * lambert;
+	specularOut += colour * calculateSpecular(rFactor) * specSample * 0.33;
+}
@@ -0,0 +1,193 @@
+#include "Benchmark.h"
+#include "BenchmarkScene.h"
+#include "Common/Graphics/ActiveClusterList.h"
+#include "Common/Graphics/ClusterCuller.h"
+#include "Common/Graphics/DepthPyramid.h"
+#include "Assets/Shaders/Shared/DepthPyramidDefinitions.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace NCL;
+using namespace Maths;
+using namespace Rendering;
+using namespace Benchmarks;
+
+using GLSL::PointLight;
+
+namespace {
+	/*
+	* Stand-in for the depth prepass: the camera is inside the light bounds, which are treated as a room
+	* with an open top, so the walls and floor cover most of the screen and the sky writes no depth.
+	*/
+	std::vector<float> TraceSceneDepth(int width, int height, const Matrix4& viewMatrix, const Matrix4& projMatrix) {
+		const Matrix4 invProj = projMatrix.Inverse();
+		const Matrix4 invView = viewMatrix.Inverse();
+
+		std::vector<float> depth(width * height, 1.0f);
+		for (int y = 0; y < height; ++y) {
+			for (int x = 0; x < width; ++x) {
+				const Vector4 clip(((x + 0.5f) / width) * 2.0f - 1.0f, ((y + 0.5f) / height) * 2.0f - 1.0f, 1.0f, 1.0f);
+				Vector4 farPoint = invProj * clip;
+				const Vector3 viewDir = (Vector3(farPoint) / farPoint.w).Normalised();
+				const Vector3 worldDir = Vector3(invView * Vector4(viewDir, 0.0f));
+
+				// Distance to whichever wall the ray leaves the room through
+				float t = FLT_MAX;
+				int exitAxis = -1;
+				bool exitMax = false;
+				for (int axis = 0; axis < 3; ++axis) {
+					if (worldDir[axis] == 0.0f) {
+						continue;
+					}
+					const bool towardsMax = worldDir[axis] > 0.0f;
+					const float bound = towardsMax ? LIGHT_MAX_BOUNDS[axis] : LIGHT_MIN_BOUNDS[axis];
+					const float axisT = (bound - CAMERA_POSITION[axis]) / worldDir[axis];
+					if (axisT < t) {
+						t = axisT;
+						exitAxis = axis;
+						exitMax = towardsMax;
+					}
+				}
+				if (exitAxis == 1 && exitMax) {
+					continue;
+				}
+
+				const Vector4 hitClip = projMatrix * Vector4(viewDir * t, 1.0f);
+				const float ndcZ = hitClip.z / hitClip.w;
+				if (ndcZ < 1.0f) {
+					depth[y * width + x] = ndcZ * 0.5f + 0.5f;
+				}
+			}
+		}
+		return depth;
+	}
+
+	// Every active cluster should have the same lights as the full grid, and every other cluster none.
+	bool MatchesFullGrid(const ClusterCuller& full, const ClusterCuller& active, const ActiveClusterList& list) {
+		std::vector<uint> lightsA;
+		std::vector<uint> lightsB;
+		for (uint cluster = 0; cluster < full.GetDesc().ClusterCount(); ++cluster) {
+			if (!list.IsActive(cluster)) {
+				if (active.GetLightCount(cluster) != 0) {
+					return false;
+				}
+				continue;
+			}
+			const std::span<const uint> spanA = full.GetClusterLights(cluster);
+			const std::span<const uint> spanB = active.GetClusterLights(cluster);
+			lightsA.assign(spanA.begin(), spanA.end());
+			lightsB.assign(spanB.begin(), spanB.end());
+			std::sort(lightsA.begin(), lightsA.end());
+			std::sort(lightsB.begin(), lightsB.end());
+			if (lightsA != lightsB) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Flagging from the pyramid is conservative, so it must keep every cluster flagging per pixel does
+	bool ContainsAll(const ActiveClusterList& superset, const ActiveClusterList& subset) {
+		for (uint cluster : subset.GetActiveClusters()) {
+			if (!superset.IsActive(cluster)) {
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+/*
+* Times the prepass clustered path on the CPU: flagging and compacting the clusters the depth buffer touches,
+* then culling only those, against culling the full grid. Mirrors GpuDepthPyramid, activeClusters.comp, GpuCompact
+* and the indirect clusterActiveCull.comp dispatch. Flagging per pixel, as activeClusters.comp used to, is timed
+* alongside flagging from the pyramid to show how many extra clusters the coarser bounds cost.
+*/
+int NCL::Benchmarks::ActiveClusterBenchmark(int argc, char** argv) {
+	const uint maxLights = argc > 0 ? (uint)std::atoi(argv[0]) : 98304;
+	const int iterations = argc > 1 ? std::atoi(argv[1]) : 10;
+
+	const Matrix4 viewMatrix = SceneViewMatrix();
+	const Matrix4 projMatrix = SceneProjMatrix();
+	const Matrix4 invProj = projMatrix.Inverse();
+
+	const ClusterGridDesc desc;
+	ClusterCuller fullGrid(desc);
+	ClusterCuller activeOnly(desc);
+	ActiveClusterList perPixelList(desc);
+	ActiveClusterList activeList(desc);
+	DepthPyramid pyramid;
+
+	const int width = (int)SCREEN_WIDTH;
+	const int height = (int)SCREEN_HEIGHT;
+	const int clusterPxX = (int)std::ceil(SCREEN_WIDTH / desc.gridX);
+	const int clusterPxY = (int)std::ceil(SCREEN_HEIGHT / desc.gridY);
+	fullGrid.BuildGrid(invProj, SCREEN_WIDTH, SCREEN_HEIGHT, clusterPxX, clusterPxY, NEAR_PLANE, FAR_PLANE);
+	activeOnly.BuildGrid(invProj, SCREEN_WIDTH, SCREEN_HEIGHT, clusterPxX, clusterPxY, NEAR_PLANE, FAR_PLANE);
+
+	// Same depth slice mapping as GameTechRenderer::InitClustered
+	const float sliceScale = (float)desc.gridZ / std::log2(FAR_PLANE / NEAR_PLANE);
+	const float sliceBias = -((float)desc.gridZ * std::log2(NEAR_PLANE) / std::log2(FAR_PLANE / NEAR_PLANE));
+
+	const std::vector<float> depth = TraceSceneDepth(width, height, viewMatrix, projMatrix);
+
+	GLSL::DispatchIndirectCommand perPixelDispatch{};
+	const BenchmarkResult perPixel = TimeIterations([&] {
+		perPixelList.Reset();
+		perPixelList.MarkFromDepth(depth, width, height, clusterPxX, clusterPxY, projMatrix, sliceScale, sliceBias);
+		perPixelDispatch = perPixelList.Compact();
+	}, iterations);
+
+	const BenchmarkResult buildPyramid = TimeIterations([&] { pyramid.Build(depth, width, height); }, iterations);
+
+	GLSL::DispatchIndirectCommand dispatch{};
+	const BenchmarkResult compact = TimeIterations([&] {
+		activeList.Reset();
+		activeList.MarkFromPyramid(pyramid, DEPTH_PYRAMID_ACTIVE_CLUSTER_LEVEL, width, height, clusterPxX, clusterPxY,
+			projMatrix, sliceScale, sliceBias);
+		dispatch = activeList.Compact();
+	}, iterations);
+
+	const bool conservative = ContainsAll(activeList, perPixelList);
+	std::printf("%u of %u clusters active (%u flagging per pixel), %d iterations, times are min (mean) ms\n",
+		dispatch.numGroupsX, desc.ClusterCount(), perPixelDispatch.numGroupsX, iterations);
+	std::printf("per pixel mark + compact %.3f (%.3f)\n", perPixel.minMs, perPixel.meanMs);
+	std::printf("pyramid build %.3f (%.3f), mark + compact %.3f (%.3f), %s\n", buildPyramid.minMs, buildPyramid.meanMs,
+		compact.minMs, compact.meanMs, conservative ? "conservative" : "MISSED CLUSTERS");
+	if (!conservative) {
+		return 1;
+	}
+
+	std::printf("%8s %18s %18s %10s %8s\n", "lights", "full grid", "active only", "speedup", "match");
+
+	// Doubling from 1024, always finishing on maxLights
+	std::vector<uint> lightCounts;
+	for (uint count = 1024; count < maxLights; count *= 2) {
+		lightCounts.push_back(count);
+	}
+	lightCounts.push_back(maxLights);
+
+	for (uint numLights : lightCounts) {
+		const std::vector<PointLight> lights = GenerateLights(numLights, 1234);
+
+		const BenchmarkResult full = TimeIterations([&] { fullGrid.CullLights(lights, viewMatrix, invProj); }, iterations);
+		const BenchmarkResult active = TimeIterations([&] { activeOnly.CullLights(lights, viewMatrix, invProj, activeList.GetActiveClusters()); }, iterations);
+
+		// The prepass path flags and compacts clusters either way, so only the culling is compared
+		const double speedup = full.minMs / active.minMs;
+		const bool match = MatchesFullGrid(fullGrid, activeOnly, activeList);
+
+		std::printf("%8u %9.3f (%6.3f) %9.3f (%6.3f) %9.2fx %8s\n", numLights,
+			full.minMs, full.meanMs, active.minMs, active.meanMs, speedup, match ? "yes" : "NO");
+
+		if (!match) {
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "Common/Core/GameTimer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string_view>
+
+namespace NCL::Benchmarks {
+	struct BenchmarkResult {
+		double minMs = 0.0;
+		double meanMs = 0.0;
+	};
+
+	// Runs func warmup times untimed, then iterations times. Min is usually the more stable number to compare.
+	template <typename Func>
+	BenchmarkResult TimeIterations(Func&& func, int iterations = 10, int warmup = 2) {
+		for (int i = 0; i < warmup; ++i) {
+			func();
+		}
+
+		BenchmarkResult result;
+		result.minMs = 1e30;
+		double total = 0.0;
+		for (int i = 0; i < iterations; ++i) {
+			const Timepoint start = Clock::now();
+			func();
+			const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+			result.minMs = std::min(result.minMs, ms);
+			total += ms;
+		}
+		result.meanMs = total / iterations;
+		return result;
+	}
+
+	// Entry points, selected by name from the command line in Main.cpp. Arguments exclude the benchmark name.
+	int LightCullBenchmark(int argc, char** argv);
+	int LightListBenchmark(int argc, char** argv);
+	int ActiveClusterBenchmark(int argc, char** argv);
+	int ScanBenchmark(int argc, char** argv);
+	int LightAnimationBenchmark(int argc, char** argv);
+	int FrustumCullBenchmark(int argc, char** argv);
+	int OcclusionBenchmark(int argc, char** argv);
+	int SortKeyBenchmark(int argc, char** argv);
+	int PointShadowBenchmark(int argc, char** argv);
+	int BroadphaseBenchmark(int argc, char** argv);
+	int OctreeBenchmark(int argc, char** argv);
+	int JobSystemBenchmark(int argc, char** argv);
+	int ContactSolverBenchmark(int argc, char** argv);
+	int RigidBodyBenchmark(int argc, char** argv);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "Common/Math/Matrix4.h"
+#include "Common/Math/Vector3.h"
+#include "Common/Math/Vector4.h"
+#include "Common/NCLAliases.h"
+#include "Assets/Shaders/Shared/LightDefinitions.h"
+
+#include <random>
+#include <vector>
+
+namespace NCL::Benchmarks {
+	// Scene and camera values from GameTechRenderer and TutorialGame::InitCamera
+	inline const Maths::Vector3 LIGHT_MIN_BOUNDS(-560.0f, 0.0f, -230.0f);
+	inline const Maths::Vector3 LIGHT_MAX_BOUNDS(510.0f, 400.0f, 220.0f);
+	inline const Maths::Vector3 CAMERA_POSITION(-530.0f, 71.0f, -12.0f);
+	constexpr float LIGHT_RADIUS = 40.0f;
+	constexpr float SCREEN_WIDTH = 1920.0f;
+	constexpr float SCREEN_HEIGHT = 1080.0f;
+	constexpr float NEAR_PLANE = 2.0f;
+	constexpr float FAR_PLANE = 1150.0f;
+
+	inline std::vector<GLSL::PointLight> GenerateLights(uint count, uint seed) {
+		std::mt19937 gen(seed);
+		std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+		std::vector<GLSL::PointLight> lights(count);
+		for (GLSL::PointLight& light : lights) {
+			Maths::Vector3 pos;
+			for (int i = 0; i < 3; ++i) {
+				pos[i] = dist(gen) * (LIGHT_MAX_BOUNDS[i] - LIGHT_MIN_BOUNDS[i]) + LIGHT_MIN_BOUNDS[i];
+			}
+			light.pos = Maths::Vector4(pos, 1.0f);
+			light.colour = Maths::Vector4(dist(gen), dist(gen), dist(gen), 1.0f);
+			light.radius = Maths::Vector4(LIGHT_RADIUS, 0.0f, 0.0f, 0.0f);
+		}
+		return lights;
+	}
+
+	// The default camera, looking down the length of the scene
+	inline Maths::Matrix4 SceneViewMatrix() {
+		return Maths::Matrix4::Rotation(5.5f, Maths::Vector3(1, 0, 0)) *
+			Maths::Matrix4::Rotation(-270.0f, Maths::Vector3(0, 1, 0)) *
+			Maths::Matrix4::Translation(-CAMERA_POSITION);
+	}
+
+	inline Maths::Matrix4 SceneProjMatrix() {
+		return Maths::Matrix4::Perspective(NEAR_PLANE, FAR_PLANE, SCREEN_WIDTH / SCREEN_HEIGHT, 45.0f);
+	}
+}
@@ -0,0 +1,311 @@
+#include "Benchmark.h"
+#include "Common/Physics/Broadphase.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <random>
+#include <set>
+#include <unordered_set>
+#include <vector>
+
+using namespace NCL;
+using namespace Maths;
+using namespace Physics;
+using namespace Benchmarks;
+
+namespace {
+	const float DT = 1.0f / 120.0f;
+	const float MAX_SPEED = 5.0f;
+	const float WORLD_HEIGHT = 20.0f;
+
+	struct Body {
+		Vector3 pos;
+		Vector3 halfSize;
+		Vector3 velocity;
+	};
+
+	// Crate and ball sized bodies over a flat level, about as crowded at every count
+	std::vector<Body> GenerateBodies(uint count, float movingFraction, unsigned int seed, float& worldSize) {
+		std::mt19937 gen(seed);
+		std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+		worldSize = 4.0f * std::sqrt((float)count);
+		std::vector<Body> bodies(count);
+		for (Body& body : bodies) {
+			body.pos = Vector3((dis(gen) - 0.5f) * worldSize, dis(gen) * WORLD_HEIGHT, (dis(gen) - 0.5f) * worldSize);
+			const float size = 0.5f + dis(gen);
+			body.halfSize = Vector3(size, size, size);
+			if (dis(gen) < movingFraction) {
+				body.velocity = Vector3(dis(gen) - 0.5f, dis(gen) - 0.5f, dis(gen) - 0.5f) * (2.0f * MAX_SPEED);
+			}
+			else {
+				body.velocity = Vector3(0, 0, 0);
+			}
+		}
+		return bodies;
+	}
+
+	// Moves every moving body, bouncing off the edges of the level
+	void Step(std::vector<Body>& bodies, float worldSize) {
+		const Vector3 lo(-0.5f * worldSize, 0.0f, -0.5f * worldSize);
+		const Vector3 hi(0.5f * worldSize, WORLD_HEIGHT, 0.5f * worldSize);
+		for (Body& body : bodies) {
+			body.pos += body.velocity * DT;
+			for (int i = 0; i < 3; ++i) {
+				if ((body.pos[i] < lo[i] && body.velocity[i] < 0.0f) || (body.pos[i] > hi[i] && body.velocity[i] > 0.0f)) {
+					body.velocity[i] = -body.velocity[i];
+				}
+			}
+		}
+	}
+
+	AABB BoxOf(const Body& body) {
+		return { body.pos - body.halfSize, body.pos + body.halfSize };
+	}
+
+	uint64_t Key(uint a, uint b) {
+		return ((uint64_t)std::min(a, b) << 32) | std::max(a, b);
+	}
+
+	/*
+	* What PhysicsSystem::BroadPhase did before: a 2D QuadTree cleared and refilled every step, std::list leaves,
+	* a body copied into every leaf it touches, and pairs deduplicated through a std::set. Kept here as the
+	* QuadTree it used is gone.
+	*/
+	class QuadTreeRebuild {
+	public:
+		QuadTreeRebuild(float worldSize, int maxDepth = 7, int maxSize = 6) : maxDepth(maxDepth), maxSize(maxSize) {
+			root.halfSize = worldSize * 0.5f;
+		}
+
+		const std::set<uint64_t>& Update(const std::vector<Body>& bodies) {
+			root.Clear();
+			for (uint i = 0; i < (uint)bodies.size(); ++i) {
+				Insert(root, { i, bodies[i].pos, bodies[i].halfSize }, maxDepth);
+			}
+			pairs.clear();
+			GatherPairs(root);
+			return pairs;
+		}
+
+	protected:
+		struct Entry {
+			uint body;
+			Vector3 pos;
+			Vector3 halfSize;
+		};
+
+		struct Node {
+			float x = 0.0f;
+			float z = 0.0f;
+			float halfSize = 0.0f;
+			std::list<Entry> contents;
+			Node* children = nullptr;
+
+			~Node() {
+				delete[] children;
+			}
+
+			void Clear() {
+				delete[] children;
+				children = nullptr;
+				contents.clear();
+			}
+		};
+
+		void Insert(Node& node, const Entry& entry, int depthLeft) {
+			if (std::abs(entry.pos.x - node.x) > entry.halfSize.x + node.halfSize ||
+				std::abs(entry.pos.z - node.z) > entry.halfSize.z + node.halfSize) {
+				return;
+			}
+			if (node.children) {
+				for (int i = 0; i < 4; ++i) {
+					Insert(node.children[i], entry, depthLeft - 1);
+				}
+				return;
+			}
+			node.contents.push_back(entry);
+			if ((int)node.contents.size() > maxSize && depthLeft > 0) {
+				const float half = node.halfSize * 0.5f;
+				node.children = new Node[4];
+				for (int i = 0; i < 4; ++i) {
+					node.children[i].x = node.x + ((i & 1) ? half : -half);
+					node.children[i].z = node.z + ((i & 2) ? half : -half);
+					node.children[i].halfSize = half;
+				}
+				for (const Entry& e : node.contents) {
+					for (int i = 0; i < 4; ++i) {
+						Insert(node.children[i], e, depthLeft - 1);
+					}
+				}
+				node.contents.clear();
+			}
+		}
+
+		void GatherPairs(const Node& node) {
+			if (node.children) {
+				for (int i = 0; i < 4; ++i) {
+					GatherPairs(node.children[i]);
+				}
+				return;
+			}
+			for (auto i = node.contents.begin(); i != node.contents.end(); ++i) {
+				for (auto j = std::next(i); j != node.contents.end(); ++j) {
+					pairs.insert(Key(i->body, j->body));
+				}
+			}
+		}
+
+		Node root;
+		int maxDepth;
+		int maxSize;
+		std::set<uint64_t> pairs;
+	};
+
+	// Every pair of bodies whose boxes overlap, by sweeping along x
+	void OverlappingPairs(const std::vector<Body>& bodies, std::vector<uint64_t>& pairs) {
+		std::vector<uint> order(bodies.size());
+		for (uint i = 0; i < (uint)order.size(); ++i) {
+			order[i] = i;
+		}
+		std::sort(order.begin(), order.end(), [&](uint a, uint b) {
+			return bodies[a].pos.x - bodies[a].halfSize.x < bodies[b].pos.x - bodies[b].halfSize.x;
+		});
+		pairs.clear();
+		for (size_t i = 0; i < order.size(); ++i) {
+			const AABB a = BoxOf(bodies[order[i]]);
+			for (size_t j = i + 1; j < order.size(); ++j) {
+				const AABB b = BoxOf(bodies[order[j]]);
+				if (b.min.x > a.max.x) {
+					break;
+				}
+				if (a.Overlaps(b)) {
+					pairs.push_back(Key(order[i], order[j]));
+				}
+			}
+		}
+	}
+
+	// Checks the broadphase's pairs hold every overlapping pair once, and only pairs whose fat boxes overlap.
+	// Returns false on a mismatch.
+	bool CheckPairs(const Broadphase& broadphase, const std::vector<uint>& proxyBodies,
+		const std::vector<Body>& bodies, int step) {
+		if (!broadphase.GetTree().Validate()) {
+			std::printf("Step %d: the tree is malformed\n", step);
+			return false;
+		}
+
+		std::unordered_set<uint64_t> found;
+		for (const BroadphasePair& pair : broadphase.GetPairs()) {
+			if (pair.proxyA >= pair.proxyB) {
+				std::printf("Step %d: pair %d, %d is out of order\n", step, pair.proxyA, pair.proxyB);
+				return false;
+			}
+			if (!broadphase.GetTree().GetFatAABB(pair.proxyA).Overlaps(broadphase.GetTree().GetFatAABB(pair.proxyB))) {
+				std::printf("Step %d: pair %d, %d doesn't overlap\n", step, pair.proxyA, pair.proxyB);
+				return false;
+			}
+			if (!found.insert(Key(proxyBodies[pair.proxyA], proxyBodies[pair.proxyB])).second) {
+				std::printf("Step %d: pair %d, %d is in the list twice\n", step, pair.proxyA, pair.proxyB);
+				return false;
+			}
+		}
+
+		std::vector<uint64_t> expected;
+		OverlappingPairs(bodies, expected);
+		for (uint64_t key : expected) {
+			if (!found.contains(key)) {
+				std::printf("Step %d: bodies %u and %u overlap but aren't paired\n", step, (uint)(key >> 32), (uint)key);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	double MsSince(const Timepoint& start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+}
+
+/*
+* Moves bodies over a level for a number of steps, updating the incremental Broadphase with every body each step as
+* PhysicsSystem does, against refilling the QuadTree it replaced. Checks the pairs against every overlapping pair
+* every 10 steps, with some bodies removed and added back part way through.
+*/
+int NCL::Benchmarks::BroadphaseBenchmark(int argc, char** argv) {
+	const uint maxBodies = argc > 0 ? (uint)std::atoi(argv[0]) : 100000;
+	const int steps = argc > 1 ? std::atoi(argv[1]) : 60;
+
+	std::printf("%d steps of %.4fs, times are min (mean) ms per step\n", steps, DT);
+	std::printf("%8s %7s %18s %18s %10s %10s %14s\n", "bodies", "moving", "incremental", "quadtree rebuild", "pairs", "quad pairs", "reinserted");
+
+	for (uint count = 1000; count <= maxBodies; count *= 10) {
+		for (float movingFraction : { 0.1f, 1.0f }) {
+			float worldSize;
+			std::vector<Body> bodies = GenerateBodies(count, movingFraction, 1234, worldSize);
+
+			Broadphase broadphase;
+			std::vector<int> proxies(count);
+			std::vector<uint> proxyBodies;
+			auto addBody = [&](uint body) {
+				proxies[body] = broadphase.AddProxy(BoxOf(bodies[body]));
+				if ((size_t)proxies[body] >= proxyBodies.size()) {
+					proxyBodies.resize(proxies[body] + 1);
+				}
+				proxyBodies[proxies[body]] = body;
+			};
+			for (uint i = 0; i < count; ++i) {
+				addBody(i);
+			}
+			broadphase.UpdatePairs();
+
+			QuadTreeRebuild quadTree(worldSize);
+
+			double incrementalMin = 1e30, incrementalTotal = 0.0;
+			double rebuildMin = 1e30, rebuildTotal = 0.0;
+			size_t reinserted = 0;
+			size_t quadPairs = 0;
+			for (int step = 0; step < steps; ++step) {
+				Step(bodies, worldSize);
+
+				// Objects leave and join the world now and then
+				if (step == steps / 2) {
+					for (uint i = 0; i < count; i += 97) {
+						broadphase.RemoveProxy(proxies[i]);
+					}
+					for (uint i = 0; i < count; i += 97) {
+						addBody(i);
+					}
+				}
+
+				Timepoint start = Clock::now();
+				for (uint i = 0; i < count; ++i) {
+					broadphase.MoveProxy(proxies[i], BoxOf(bodies[i]), bodies[i].velocity * DT);
+				}
+				reinserted += broadphase.GetMovedCount();
+				broadphase.UpdatePairs();
+				const double incrementalMs = MsSince(start);
+
+				start = Clock::now();
+				quadPairs = quadTree.Update(bodies).size();
+				const double rebuildMs = MsSince(start);
+
+				incrementalMin = std::min(incrementalMin, incrementalMs);
+				incrementalTotal += incrementalMs;
+				rebuildMin = std::min(rebuildMin, rebuildMs);
+				rebuildTotal += rebuildMs;
+
+				if ((step % 10 == 0 || step == steps - 1) && !CheckPairs(broadphase, proxyBodies, bodies, step)) {
+					std::printf("%u bodies, %.0f%% moving\n", count, movingFraction * 100.0f);
+					return 1;
+				}
+			}
+
+			std::printf("%8u %6.0f%% %9.3f (%6.3f) %9.3f (%6.3f) %10zu %10zu %14.1f\n", count, movingFraction * 100.0f,
+				incrementalMin, incrementalTotal / steps, rebuildMin, rebuildTotal / steps,
+				broadphase.GetPairs().size(), quadPairs, (double)reinserted / steps);
+		}
+	}
+	return 0;
+}
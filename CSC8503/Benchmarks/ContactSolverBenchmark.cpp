@@ -0,0 +1,197 @@
+#include "Benchmark.h"
+#include "Common/Physics/ContactSolver.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace NCL;
+using namespace Maths;
+using namespace Physics;
+using namespace Benchmarks;
+
+namespace {
+	const float DT = 1.0f / 120.0f;
+	const float RADIUS = 0.5f;
+	const Vector3 GRAVITY(0.0f, -9.8f, 0.0f);
+	// Slower than this everywhere counts as settled
+	const float SETTLED_SPEED = 0.05f;
+
+	/*
+	* Columns of spheres resting on the ground, stepped the way PhysicsSystem steps contacts: each touching pair
+	* keeps its manifold in a ContactCache, and is solved by ContactSolver with or without warm starting.
+	* Body 0 is the ground, which never moves.
+	*/
+	class StackWorld {
+	public:
+		StackWorld(uint columns, uint height, bool warmStart) : columns(columns), height(height) {
+			ContactSolver::Settings settings;
+			settings.warmStart = warmStart;
+			solver.SetSettings(settings);
+
+			positions.resize(1 + columns * height);
+			bodies.resize(1 + columns * height);
+			bodies[0] = { Vector3(), Vector3(), Matrix3::Scale(Vector3(0, 0, 0)), 0.0f };
+			// Solid spheres of density 1
+			const float mass = 4.0f / 3.0f * 3.14159265f * RADIUS * RADIUS * RADIUS;
+			const float inertia = 0.4f * mass * RADIUS * RADIUS;
+			for (uint c = 0; c < columns; ++c) {
+				for (uint h = 0; h < height; ++h) {
+					const uint index = BodyIndex(c, h);
+					// Just touching, so every contact is there from the first step
+					positions[index] = Vector3(c * 4.0f * RADIUS, RADIUS + h * 2.0f * RADIUS - 0.001f * (h + 1), 0.0f);
+					bodies[index] = { Vector3(), Vector3(), Matrix3::Scale(Vector3(1, 1, 1) / inertia), 1.0f / mass };
+				}
+			}
+		}
+
+		void Step(int iterations) {
+			++step;
+			for (size_t i = 1; i < bodies.size(); ++i) {
+				bodies[i].linearVelocity += GRAVITY * DT;
+			}
+
+			solver.Clear();
+			for (uint c = 0; c < columns; ++c) {
+				for (uint h = 0; h < height; ++h) {
+					const uint below = h == 0 ? 0 : BodyIndex(c, h - 1);
+					FindContact(below, BodyIndex(c, h));
+				}
+			}
+			cache.RemoveStale(step);
+
+			solver.Prepare(bodies, 0, solver.GetContactCount(), DT);
+			solver.WarmStart(bodies, 0, solver.GetContactCount());
+			for (int i = 0; i < iterations; ++i) {
+				solver.Solve(bodies, 0, solver.GetContactCount());
+			}
+			solver.StoreImpulses(0, solver.GetContactCount());
+
+			for (size_t i = 1; i < bodies.size(); ++i) {
+				positions[i] += bodies[i].linearVelocity * DT;
+			}
+		}
+
+		float MaxSpeed() const {
+			float speed = 0.0f;
+			for (const SolverBody& body : bodies) {
+				speed = std::max(speed, body.linearVelocity.Length());
+			}
+			return speed;
+		}
+
+		// How far the top of the lowest column has sunk below where it would rest with no overlap
+		float MaxSag() const {
+			float sag = 0.0f;
+			for (uint c = 0; c < columns; ++c) {
+				const float rest = RADIUS + (height - 1) * 2.0f * RADIUS;
+				sag = std::max(sag, rest - positions[BodyIndex(c, height - 1)].y);
+			}
+			return sag;
+		}
+
+	protected:
+		uint BodyIndex(uint column, uint level) const {
+			return 1 + column * height + level;
+		}
+
+		// The ground for body 0, otherwise sphere against sphere, with CollisionDetection's conventions
+		void FindContact(uint a, uint b) {
+			Vector3 normal;
+			float penetration;
+			Vector3 relativeA;
+			Vector3 relativeB;
+			if (a == 0) {
+				normal = Vector3(0, 1, 0);
+				penetration = RADIUS - positions[b].y;
+				relativeB = -normal * RADIUS;
+				relativeA = positions[b] + relativeB + normal * penetration;
+			}
+			else {
+				const Vector3 delta = positions[b] - positions[a];
+				const float distance = delta.Length();
+				normal = delta / distance;
+				penetration = 2.0f * RADIUS - distance;
+				relativeA = normal * RADIUS;
+				relativeB = -normal * RADIUS;
+			}
+			if (penetration <= 0.0f) {
+				return;
+			}
+			ContactManifold& manifold = cache.Find(ContactCache::PairKey(a, b), step);
+			const Quaternion identity;
+			manifold.Refresh(positions[a], identity, positions[b], identity);
+			manifold.AddPoint(relativeA, relativeB, normal, penetration, identity, identity);
+			solver.AddManifold(manifold, a, b, 0.5f, 0.0f);
+		}
+
+		uint columns;
+		uint height;
+		uint step = 0;
+		std::vector<Vector3> positions;
+		std::vector<SolverBody> bodies;
+		ContactCache cache;
+		ContactSolver solver;
+	};
+
+	struct StackResult {
+		// -1 if it never settled
+		int settledStep;
+		float sag;
+		double msPerStep;
+	};
+
+	StackResult RunStack(uint columns, uint height, int steps, int iterations, bool warmStart) {
+		StackWorld world(columns, height, warmStart);
+		StackResult result = { -1, 0.0f, 0.0 };
+		const Timepoint start = Clock::now();
+		for (int step = 0; step < steps; ++step) {
+			world.Step(iterations);
+			if (world.MaxSpeed() >= SETTLED_SPEED) {
+				result.settledStep = -1;
+			}
+			else if (result.settledStep < 0) {
+				result.settledStep = step + 1;
+			}
+		}
+		result.msPerStep = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / steps;
+		result.sag = world.MaxSag();
+		return result;
+	}
+}
+
+/*
+* Steps columns of resting spheres with warm started and cold sequential impulses, at a few iteration counts,
+* reporting the step after which everything stayed still and how far the columns sank.
+* Warm starting at the physics system's default iteration count has to settle, and sink less than solving cold.
+*/
+int NCL::Benchmarks::ContactSolverBenchmark(int argc, char** argv) {
+	const uint height = argc > 0 ? (uint)std::atoi(argv[0]) : 10;
+	const int steps = argc > 1 ? std::atoi(argv[1]) : 600;
+	const uint columns = argc > 2 ? (uint)std::atoi(argv[2]) : 100;
+	const int defaultIterations = 4;
+
+	std::printf("%u columns of %u spheres, %d steps of %.4fs, settled is every sphere under %.2f m/s\n",
+		columns, height, steps, DT, SETTLED_SPEED);
+	std::printf("%10s %6s %12s %10s %12s\n", "iterations", "warm", "settled at", "sag mm", "ms/step");
+
+	bool passed = true;
+	for (int iterations = 1; iterations <= 32; iterations *= 2) {
+		const StackResult cold = RunStack(columns, height, steps, iterations, false);
+		const StackResult warm = RunStack(columns, height, steps, iterations, true);
+		for (const StackResult* result : { &cold, &warm }) {
+			char settled[16] = "never";
+			if (result->settledStep >= 0) {
+				std::snprintf(settled, sizeof(settled), "%d", result->settledStep);
+			}
+			std::printf("%10d %6s %12s %10.2f %12.4f\n", iterations, result == &warm ? "yes" : "no",
+				settled, result->sag * 1000.0f, result->msPerStep);
+		}
+		if (iterations == defaultIterations && (warm.settledStep < 0 || warm.sag >= cold.sag)) {
+			std::printf("Warm starting at %d iterations didn't settle, or sank as far as solving cold\n", iterations);
+			passed = false;
+		}
+	}
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+#include "Benchmark.h"
+#include "Common/Graphics/FrustumCuller.h"
+#include "Common/Math/Frustum.h"
+#include "Common/Math/Matrix4.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace NCL;
+using namespace Maths;
+using namespace Rendering;
+using namespace Benchmarks;
+
+namespace {
+	// Roughly the extent of sponza, before WORLD_SCALE
+	const Vector3 MIN_BOUNDS = Vector3(-1500.0f, -100.0f, -700.0f);
+	const Vector3 MAX_BOUNDS = Vector3(1500.0f, 1200.0f, 700.0f);
+
+	struct SceneObject {
+		Matrix4 transform;
+		Vector3 position;
+		float radius;
+	};
+
+	// Half spheres and half rotated, scaled unit boxes, as BuildObjectList sees them
+	std::vector<SceneObject> GenerateObjects(uint count, unsigned int seed) {
+		std::mt19937 gen(seed);
+		std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+		std::vector<SceneObject> objects(count);
+		for (SceneObject& object : objects) {
+			for (int i = 0; i < 3; ++i) {
+				object.position[i] = dis(gen) * (MAX_BOUNDS[i] - MIN_BOUNDS[i]) + MIN_BOUNDS[i];
+			}
+			object.radius = 5.0f + dis(gen) * 45.0f;
+			object.transform = Matrix4::Translation(object.position) *
+				Matrix4::Rotation(dis(gen) * 360.0f, Vector3(dis(gen), 1.0f, dis(gen)).Normalised()) *
+				Matrix4::Scale(Vector3(object.radius, object.radius * 0.5f, object.radius));
+		}
+		return objects;
+	}
+}
+
+/*
+* Times building the culler's bounds and culling them against a camera frustum inside the scene, at 10k, 100k and
+* 1M objects by default: one sphere at a time with Frustum::IsInsideFrustum (spheres only), FrustumCuller's
+* scalar path and its SIMD path. Checks both FrustumCuller paths keep the same objects.
+*/
+int NCL::Benchmarks::FrustumCullBenchmark(int argc, char** argv) {
+	const uint maxObjects = argc > 0 ? (uint)std::atoi(argv[0]) : 1000000;
+	const int iterations = argc > 1 ? std::atoi(argv[1]) : 10;
+
+	const Matrix4 view = Matrix4::BuildViewMatrix(Vector3(-1200.0f, 200.0f, 0.0f), Vector3(0.0f, 150.0f, 0.0f), Vector3(0.0f, 1.0f, 0.0f));
+	const Matrix4 proj = Matrix4::Perspective(1.0f, 5000.0f, 16.0f / 9.0f, 45.0f);
+	Frustum frustum;
+	frustum.FromMatrix(proj * view);
+
+	std::printf("%d iterations, times are min (mean) ms\n", iterations);
+	std::printf("%8s %18s %18s %18s %18s %9s\n", "objects", "build", "sphere loop", "scalar", "simd", "visible");
+
+	for (uint count = 10000; ; count = std::min(count * 10, maxObjects)) {
+		const std::vector<SceneObject> objects = GenerateObjects(count, 1234);
+
+		FrustumCuller culler;
+		culler.Reserve(count);
+		const BenchmarkResult buildTime = TimeIterations([&] {
+			culler.Clear();
+			for (uint i = 0; i < count; ++i) {
+				if (i & 1) {
+					culler.AddBox(objects[i].transform, Vector3(0.0f, 0.0f, 0.0f), Vector3(1.0f, 1.0f, 1.0f));
+				}
+				else {
+					culler.AddSphere(objects[i].position, objects[i].radius);
+				}
+			}
+		}, iterations);
+
+		std::vector<uint> sphereVisible;
+		const BenchmarkResult sphereTime = TimeIterations([&] {
+			sphereVisible.clear();
+			for (uint i = 0; i < count; ++i) {
+				if (frustum.IsInsideFrustum(objects[i].position, objects[i].radius)) {
+					sphereVisible.push_back(i);
+				}
+			}
+		}, iterations);
+
+		std::vector<uint> scalarVisible;
+		const BenchmarkResult scalarTime = TimeIterations([&] {
+			culler.CullScalar(frustum, scalarVisible);
+		}, iterations);
+
+		std::vector<uint> simdVisible;
+		const BenchmarkResult simdTime = TimeIterations([&] {
+			culler.Cull(frustum, simdVisible);
+		}, iterations);
+
+		std::printf("%8u %9.3f (%6.3f) %9.3f (%6.3f) %9.3f (%6.3f) %9.3f (%6.3f) %9zu\n", count,
+			buildTime.minMs, buildTime.meanMs, sphereTime.minMs, sphereTime.meanMs,
+			scalarTime.minMs, scalarTime.meanMs, simdTime.minMs, simdTime.meanMs, simdVisible.size());
+
+		if (scalarVisible != simdVisible) {
+			std::printf("SIMD culling kept %zu objects, scalar kept %zu\n", simdVisible.size(), scalarVisible.size());
+			return 1;
+		}
+		if (count == maxObjects) {
+			break;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,151 @@
+#include "Benchmark.h"
+#include "CSC8503Common/AABBVolume.h"
+#include "CSC8503Common/GameObject.h"
+#include "CSC8503Common/GameWorld.h"
+#include "CSC8503Common/PhysicsObject.h"
+#include "CSC8503Common/PhysicsSystem.h"
+#include "CSC8503Common/SphereVolume.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace NCL;
+using namespace Maths;
+using namespace CSC8503;
+using namespace Benchmarks;
+
+namespace {
+	const float DT = 1.0f / 120.0f;
+	const float WORLD_HEIGHT = 20.0f;
+
+	struct BodyState {
+		Vector3 position;
+		Quaternion orientation;
+		Vector3 linearVelocity;
+		Vector3 angularVelocity;
+	};
+
+	/*
+	* Spheres dropped onto a floor, some of which never move and are shared between islands, built the way
+	* TutorialGame adds its objects but without anything to render, and stepped by a real PhysicsSystem.
+	*/
+	class SphereScene {
+	public:
+		SphereScene(uint count, unsigned int seed) : physics(world) {
+			std::mt19937 gen(seed);
+			std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+			const float worldSize = 1.2f * std::sqrt((float)count);
+
+			GameObject* floor = new GameObject("floor");
+			const Vector3 floorSize(0.5f * worldSize, 2.0f, 0.5f * worldSize);
+			floor->SetBoundingVolume((CollisionVolume*)new AABBVolume(floorSize));
+			floor->GetTransform().SetScale(floorSize * 2).SetPosition(Vector3(0, -2.0f, 0));
+			floor->SetPhysicsObject(new PhysicsObject(&floor->GetTransform(), floor->GetBoundingVolume()));
+			floor->GetPhysicsObject()->SetInverseMass(0);
+			floor->GetPhysicsObject()->InitCubeInertia();
+			floor->GetPhysicsObject()->SetIsStatic(true);
+			world.AddGameObject(floor);
+
+			for (uint i = 0; i < count; ++i) {
+				const float radius = 0.5f + 0.5f * dis(gen);
+				GameObject* sphere = new GameObject("sphere");
+				SphereVolume* volume = new SphereVolume(radius);
+				sphere->SetBoundingVolume((CollisionVolume*)volume);
+				volume->SetObject(sphere);
+				sphere->GetTransform()
+					.SetScale(Vector3(radius, radius, radius))
+					.SetPosition(Vector3((dis(gen) - 0.5f) * worldSize, dis(gen) * WORLD_HEIGHT, (dis(gen) - 0.5f) * worldSize));
+				sphere->SetPhysicsObject(new PhysicsObject(&sphere->GetTransform(), sphere->GetBoundingVolume()));
+
+				PhysicsObject* object = sphere->GetPhysicsObject();
+				object->SetInverseMass(dis(gen) < 0.1f ? 0.0f : 1.0f / (radius * radius * radius));
+				object->InitSphereInertia();
+				object->SetElasticity(0.8f);
+				object->SetLinearVelocity(Vector3(dis(gen) - 0.5f, dis(gen) - 0.5f, dis(gen) - 0.5f) * 4.0f);
+				world.AddGameObject(sphere);
+				spheres.push_back(sphere);
+			}
+
+			physics.UseGravity(true);
+			// Every thread count has to take the same steps
+			physics.UseAdaptiveRate(false);
+		}
+		~SphereScene() {
+			world.ClearAndErase();
+		}
+
+		PhysicsSystem& GetPhysics() {
+			return physics;
+		}
+
+		std::vector<BodyState> GetState() const {
+			std::vector<BodyState> state(spheres.size());
+			for (size_t i = 0; i < spheres.size(); ++i) {
+				const Transform& transform = spheres[i]->GetTransform();
+				const PhysicsObject* object = spheres[i]->GetPhysicsObject();
+				state[i] = { transform.GetPosition(), transform.GetOrientation(),
+					object->GetLinearVelocity(), object->GetAngularVelocity() };
+			}
+			return state;
+		}
+
+	protected:
+		GameWorld world;
+		PhysicsSystem physics;
+		std::vector<GameObject*> spheres;
+	};
+
+	double MsSince(const Timepoint& start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+}
+
+/*
+* Steps a world of spheres with PhysicsSystem, at 1 thread up to one per hardware thread (at least 4).
+* Every thread count has to end with exactly the same bodies as 1 thread, or the benchmark fails.
+*/
+int NCL::Benchmarks::JobSystemBenchmark(int argc, char** argv) {
+	const uint maxBodies = argc > 0 ? (uint)std::atoi(argv[0]) : 10000;
+	const int steps = argc > 1 ? std::atoi(argv[1]) : 60;
+	const uint maxThreads = std::max(4u, std::thread::hardware_concurrency());
+
+	std::printf("%d steps of %.4fs, %u hardware threads, times are min (mean) ms per step\n", steps, DT, std::thread::hardware_concurrency());
+	std::printf("%8s %8s %18s %9s\n", "bodies", "threads", "step", "speedup");
+
+	for (uint count = 1000; count <= maxBodies; count *= 10) {
+		std::vector<BodyState> reference;
+		double singleMin = 0.0;
+		for (uint threads = 1; threads <= maxThreads; threads *= 2) {
+			SphereScene scene(count, 1234);
+			PhysicsSystem& physics = scene.GetPhysics();
+			physics.SetThreadCount(threads);
+
+			double minMs = 1e30, totalMs = 0.0;
+			for (int step = 0; step < steps; ++step) {
+				const Timepoint start = Clock::now();
+				physics.Update(DT);
+				const double ms = MsSince(start);
+				minMs = std::min(minMs, ms);
+				totalMs += ms;
+			}
+
+			const std::vector<BodyState> state = scene.GetState();
+			if (threads == 1) {
+				reference = state;
+				singleMin = minMs;
+			}
+			else if (std::memcmp(reference.data(), state.data(), reference.size() * sizeof(BodyState)) != 0) {
+				std::printf("%u bodies on %u threads came out different to 1 thread\n", count, threads);
+				return 1;
+			}
+
+			std::printf("%8u %8u %9.3f (%6.3f) %8.2fx\n", count, threads, minMs, totalMs / steps, singleMin / minMs);
+		}
+	}
+	return 0;
+}
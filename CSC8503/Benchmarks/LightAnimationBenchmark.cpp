@@ -0,0 +1,108 @@
+#include "Benchmark.h"
+#include "Common/Graphics/LightAnimator.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace NCL;
+using namespace Maths;
+using namespace Rendering;
+using namespace Benchmarks;
+
+using GLSL::LightAnimationParams;
+using GLSL::PointLight;
+
+namespace {
+	// The renderer's light bounds, before WORLD_SCALE
+	const Vector3 MIN_BOUNDS = Vector3(-560.0f, 0.0f, -230.0f);
+	const Vector3 MAX_BOUNDS = Vector3(510.0f, 400.0f, 220.0f);
+
+	std::vector<PointLight> GenerateLights(uint count, unsigned int seed) {
+		std::mt19937 gen(seed);
+		std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+		std::vector<PointLight> lights(count);
+		for (PointLight& light : lights) {
+			for (int i = 0; i < 3; ++i) {
+				light.pos[i] = dis(gen) * (MAX_BOUNDS[i] - MIN_BOUNDS[i]) + MIN_BOUNDS[i];
+			}
+			light.pos.w = 1.0f;
+			light.colour = Vector4(dis(gen), dis(gen), dis(gen), 1.0f);
+			light.radius = Vector4(40.0f, 0.0f, 0.0f, 0.0f);
+		}
+		return lights;
+	}
+
+	float MaxDifference(const std::vector<PointLight>& a, const std::vector<PointLight>& b) {
+		float difference = 0.0f;
+		for (size_t i = 0; i < a.size(); ++i) {
+			for (int j = 0; j < 4; ++j) {
+				difference = std::max(difference, std::abs(a[i].pos[j] - b[i].pos[j]));
+				difference = std::max(difference, std::abs(a[i].colour[j] - b[i].colour[j]));
+			}
+		}
+		return difference;
+	}
+}
+
+/*
+* Times LightAnimator, the CPU version of updateLights.comp, with every motion model on: scalar, SIMD on one
+* thread and SIMD across all threads. The SIMD paths round differently to the scalar one, so they're checked to
+* stay within 1e-3 of it rather than match exactly.
+* The GPU side is timed by RenderBench's LightUpdate pass, with and without --cpu-lights.
+*/
+int NCL::Benchmarks::LightAnimationBenchmark(int argc, char** argv) {
+	const uint maxLights = argc > 0 ? (uint)std::atoi(argv[0]) : 98304;
+	const int iterations = argc > 1 ? std::atoi(argv[1]) : 10;
+
+	LightAnimationParams params{};
+	params.minBounds = Vector4(MIN_BOUNDS, 0.0f);
+	params.maxBounds = Vector4(MAX_BOUNDS, 0.0f);
+	params.orbitCentre = Vector4((MIN_BOUNDS + MAX_BOUNDS) * 0.5f, 0.0f);
+	params.dt = 1.0f / 60.0f;
+	params.time = 10.0f;
+	params.fallSpeed = 8.0f;
+	params.orbitSpeed = 0.5f;
+	params.flickerRate = 2.0f;
+	params.flickerAmount = 0.5f;
+	params.models = LIGHT_ANIMATION_FALL | LIGHT_ANIMATION_ORBIT | LIGHT_ANIMATION_FLICKER;
+
+	LightAnimator animator(JobSystem::Get());
+
+	std::printf("%u threads, %d iterations, times are min (mean) ms\n", animator.GetThreadCount(), iterations);
+	std::printf("%7s %18s %18s %18s %12s\n", "lights", "scalar", "simd", "threaded", "max diff");
+
+	for (uint count = 1024; ; count = std::min(count * 2, maxLights)) {
+		const std::vector<PointLight> start = GenerateLights(count, 1234);
+		std::vector<PointLight> scalar = start;
+		std::vector<PointLight> simd = start;
+		std::vector<PointLight> threaded = start;
+
+		// Each run moves the lights on, so every version animates the same number of steps
+		const BenchmarkResult scalarTime = TimeIterations([&] {
+			LightAnimator::AnimateScalar(scalar, 0, params);
+		}, iterations);
+		const BenchmarkResult simdTime = TimeIterations([&] {
+			LightAnimator::AnimateRange(simd, 0, params);
+		}, iterations);
+		const BenchmarkResult threadedTime = TimeIterations([&] {
+			animator.Animate(threaded, params);
+		}, iterations);
+
+		const float difference = std::max(MaxDifference(scalar, simd), MaxDifference(scalar, threaded));
+
+		std::printf("%7u %9.3f (%6.3f) %9.3f (%6.3f) %9.3f (%6.3f) %12g\n", count,
+			scalarTime.minMs, scalarTime.meanMs, simdTime.minMs, simdTime.meanMs,
+			threadedTime.minMs, threadedTime.meanMs, difference);
+
+		if (difference > 1e-3f) {
+			return 1;
+		}
+		if (count == maxLights) {
+			break;
+		}
+	}
+	return 0;
+}
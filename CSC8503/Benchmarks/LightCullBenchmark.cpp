@@ -0,0 +1,101 @@
+#include "Benchmark.h"
+#include "BenchmarkScene.h"
+#include "Common/Graphics/ClusterCuller.h"
+#include "Common/Graphics/LightBVH.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace NCL;
+using namespace Maths;
+using namespace Rendering;
+using namespace Benchmarks;
+
+using GLSL::PointLight;
+
+namespace {
+	size_t TotalReferences(const ClusterCuller& culler) {
+		return culler.GetLightList().GetTotalCount();
+	}
+
+	// Both paths should find the same lights per cluster, in a different order.
+	// Clusters over the cap keep their lowest indexed lights on both paths, so they have to match too.
+	bool SameClusters(const ClusterCuller& a, const ClusterCuller& b) {
+		std::vector<uint> lightsA;
+		std::vector<uint> lightsB;
+		for (uint cluster = 0; cluster < a.GetDesc().ClusterCount(); ++cluster) {
+			const std::span<const uint> spanA = a.GetClusterLights(cluster);
+			const std::span<const uint> spanB = b.GetClusterLights(cluster);
+			lightsA.assign(spanA.begin(), spanA.end());
+			lightsB.assign(spanB.begin(), spanB.end());
+			std::sort(lightsA.begin(), lightsA.end());
+			std::sort(lightsB.begin(), lightsB.end());
+			if (lightsA != lightsB) {
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+/*
+* Times ClusterCuller over the full cluster grid for increasing light counts, once testing every light
+* against every cluster and once traversing a LightBVH rebuilt from scratch each iteration.
+* Clusters that see more than maxLightsPerCluster lights are counted, as the shaders would drop some of their lights.
+*/
+int NCL::Benchmarks::LightCullBenchmark(int argc, char** argv) {
+	const uint maxLights = argc > 0 ? (uint)std::atoi(argv[0]) : 98304;
+	const int iterations = argc > 1 ? std::atoi(argv[1]) : 10;
+
+	const Matrix4 viewMatrix = SceneViewMatrix();
+	const Matrix4 projMatrix = SceneProjMatrix();
+	const Matrix4 invProj = projMatrix.Inverse();
+
+	const ClusterGridDesc desc;
+	ClusterCuller bruteForce(desc);
+	ClusterCuller hierarchical(desc);
+	const int clusterPxX = (int)std::ceil(SCREEN_WIDTH / desc.gridX);
+	const int clusterPxY = (int)std::ceil(SCREEN_HEIGHT / desc.gridY);
+	bruteForce.BuildGrid(invProj, SCREEN_WIDTH, SCREEN_HEIGHT, clusterPxX, clusterPxY, NEAR_PLANE, FAR_PLANE);
+	hierarchical.BuildGrid(invProj, SCREEN_WIDTH, SCREEN_HEIGHT, clusterPxX, clusterPxY, NEAR_PLANE, FAR_PLANE);
+
+	LightBVH bvh;
+
+	std::printf("%u clusters, %d iterations, times are min (mean) ms\n", desc.ClusterCount(), iterations);
+	std::printf("%8s %18s %18s %18s %10s %12s %8s %8s %8s\n", "lights", "brute force", "bvh build", "bvh cull", "speedup",
+		"references", "largest", "capped", "match");
+
+	// Doubling from 1024, always finishing on maxLights
+	std::vector<uint> lightCounts;
+	for (uint count = 1024; count < maxLights; count *= 2) {
+		lightCounts.push_back(count);
+	}
+	lightCounts.push_back(maxLights);
+
+	for (uint numLights : lightCounts) {
+		const std::vector<PointLight> lights = GenerateLights(numLights, 1234);
+
+		const BenchmarkResult brute = TimeIterations([&] { bruteForce.CullLights(lights, viewMatrix, invProj); }, iterations);
+		const BenchmarkResult build = TimeIterations([&] { bvh.Build(lights); }, iterations);
+		const BenchmarkResult cull = TimeIterations([&] { hierarchical.CullLights(lights, viewMatrix, invProj, bvh); }, iterations);
+
+		const double speedup = brute.minMs / (build.minMs + cull.minMs);
+		const bool match = SameClusters(bruteForce, hierarchical);
+
+		uint largest = 0;
+		for (uint cluster = 0; cluster < desc.ClusterCount(); ++cluster) {
+			largest = std::max(largest, bruteForce.GetVisibleCount(cluster));
+		}
+
+		std::printf("%8u %9.3f (%6.3f) %9.3f (%6.3f) %9.3f (%6.3f) %9.2fx %12zu %8u %8u %8s\n", numLights,
+			brute.minMs, brute.meanMs, build.minMs, build.meanMs, cull.minMs, cull.meanMs, speedup,
+			TotalReferences(bruteForce), largest, bruteForce.GetCappedClusterCount(), match ? "yes" : "NO");
+
+		if (!match) {
+			return 1;
+		}
+	}
+	return 0;
+}
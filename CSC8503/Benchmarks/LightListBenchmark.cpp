@@ -0,0 +1,121 @@
+#include "Benchmark.h"
+#include "Common/Graphics/LightListBuilder.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace NCL;
+using namespace Rendering;
+using namespace Benchmarks;
+
+namespace {
+	// What a cell should end up with, and the index written into each of its slots
+	struct ExpectedCell {
+		uint offset;
+		uint count;
+	};
+
+	uint CellIndex(uint cell, uint slot) {
+		return cell * 1000 + slot;
+	}
+
+	// Runs all three passes over counts, writing CellIndex into every slot
+	void Build(LightListBuilder& builder, const std::vector<uint>& counts, uint capacity) {
+		builder.Reset((uint)counts.size(), capacity);
+		for (uint cell = 0; cell < (uint)counts.size(); ++cell) {
+			builder.SetCount(cell, counts[cell]);
+		}
+		builder.PrefixSum();
+		for (uint cell = 0; cell < (uint)counts.size(); ++cell) {
+			std::span<uint> indices = builder.GetCellIndices(cell);
+			for (uint slot = 0; slot < (uint)indices.size(); ++slot) {
+				indices[slot] = CellIndex(cell, slot);
+			}
+		}
+	}
+
+	// Checks the grid against expected cell by cell, and the index list against the cells' indices back to back
+	bool Matches(const LightListBuilder& builder, const std::vector<ExpectedCell>& expected, uint expectedTotal) {
+		if (builder.GetCellCount() != expected.size() || builder.GetTotalCount() != expectedTotal
+			|| builder.GetIndices().size() != expectedTotal) {
+			return false;
+		}
+		std::vector<uint> expectedIndices;
+		for (uint cell = 0; cell < (uint)expected.size(); ++cell) {
+			const GLSL::LightGrid& grid = builder.GetGrid()[cell];
+			if (grid.offset != expected[cell].offset || grid.count != expected[cell].count
+				|| builder.GetCellLights(cell).size() != expected[cell].count) {
+				return false;
+			}
+			for (uint slot = 0; slot < expected[cell].count; ++slot) {
+				expectedIndices.push_back(CellIndex(cell, slot));
+			}
+		}
+		return builder.GetIndices() == expectedIndices;
+	}
+
+	bool Check(const char* name, bool passed) {
+		std::printf("%-40s %s\n", name, passed ? "ok" : "FAILED");
+		return passed;
+	}
+}
+
+/*
+* Checks LightListBuilder directly against layouts worked out by hand: empty cells, the prefix sum offsets and
+* the per-cell capacity clamp. Then times the three passes over cluster grids filled with random counts, which
+* ClusterCuller and the lightcull benchmark otherwise only exercise along with the culling.
+*/
+int NCL::Benchmarks::LightListBenchmark(int argc, char** argv) {
+	const uint maxCells = argc > 0 ? (uint)std::atoi(argv[0]) : 3072 * 16;
+	const int iterations = argc > 1 ? std::atoi(argv[1]) : 10;
+
+	LightListBuilder builder;
+	bool passed = true;
+
+	// Empty cells take no room, so each one's offset is where the next non-empty cell starts
+	Build(builder, { 3, 0, 2, 0, 0, 4, 0 }, UINT_MAX);
+	passed &= Check("empty cells and prefix sum offsets", Matches(builder, {
+		{ 0, 3 }, { 3, 0 }, { 3, 2 }, { 5, 0 }, { 5, 0 }, { 5, 4 }, { 9, 0 } }, 9));
+
+	Build(builder, { 0, 0, 0 }, UINT_MAX);
+	passed &= Check("all cells empty", Matches(builder, { { 0, 0 }, { 0, 0 }, { 0, 0 } }, 0));
+
+	// Over capacity is clamped, at and under are kept as they are
+	Build(builder, { 10, 4, 1, 0, 7 }, 4);
+	passed &= Check("capacity clamp on overflow", Matches(builder, {
+		{ 0, 4 }, { 4, 4 }, { 8, 1 }, { 9, 0 }, { 9, 4 } }, 13) && builder.SetCount(0, 5) == 4);
+
+	// A smaller frame after a bigger one mustn't keep any of the old counts or indices
+	Build(builder, { 2, 1 }, UINT_MAX);
+	passed &= Check("reset between frames", Matches(builder, { { 0, 2 }, { 2, 1 } }, 3));
+
+	if (!passed) {
+		return 1;
+	}
+
+	std::printf("\n%d iterations, times are min (mean) ms\n", iterations);
+	std::printf("%8s %10s %18s\n", "cells", "indices", "count+sum+scatter");
+
+	for (uint cells = 3072; ; cells = std::min(cells * 4, maxCells)) {
+		std::mt19937 gen(1234);
+		// Mostly empty or light clusters with the odd crowded one, like a real frame
+		std::geometric_distribution<uint> lightsPerCell(0.1);
+		std::vector<uint> counts(cells);
+		for (uint& count : counts) {
+			count = lightsPerCell(gen);
+		}
+
+		const BenchmarkResult result = TimeIterations([&] {
+			Build(builder, counts, 2048);
+		}, iterations);
+
+		std::printf("%8u %10u %9.3f (%6.3f)\n", cells, builder.GetTotalCount(), result.minMs, result.meanMs);
+
+		if (cells == maxCells) {
+			break;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,56 @@
+#include "Benchmark.h"
+
+#include <cstdio>
+#include <string_view>
+
+using namespace NCL;
+using namespace Benchmarks;
+
+namespace {
+	struct BenchmarkEntry {
+		std::string_view name;
+		std::string_view description;
+		int (*run)(int argc, char** argv);
+	};
+
+	constexpr BenchmarkEntry benchmarks[] = {
+		{ "lightcull", "CPU cluster light culling, brute force vs LightBVH. Args: [maxLights] [iterations]", LightCullBenchmark },
+		{ "lightlist", "LightListBuilder checked against hand built layouts, then timed over cluster grids. Args: [maxCells] [iterations]", LightListBenchmark },
+		{ "activecull", "CPU cluster light culling, full grid vs compacted active clusters. Args: [maxLights] [iterations]", ActiveClusterBenchmark },
+		{ "scan", "CPU twin of GpuScan/GpuCompact vs sequential scan and compaction. Args: [maxCount] [iterations]", ScanBenchmark },
+		{ "lightanim", "CPU light animation, scalar vs SIMD vs threaded SIMD. Args: [maxLights] [iterations]", LightAnimationBenchmark },
+		{ "frustumcull", "CPU object frustum culling, per sphere vs batched scalar vs SIMD. Args: [maxObjects] [iterations]", FrustumCullBenchmark },
+		{ "occlusion", "CPU software occlusion culling at a few depth buffer sizes. Args: [boxes] [iterations]", OcclusionBenchmark },
+		{ "sortkeys", "Draw list sorting, camera distance vs state sort keys with std::sort and RadixSort. Args: [maxObjects] [iterations]", SortKeyBenchmark },
+		{ "pointshadows", "Point shadow atlas slot allocation over a camera path, checked and timed. Args: [maxLights] [iterations]", PointShadowBenchmark },
+		{ "broadphase", "Incremental dynamic AABB tree broadphase vs the QuadTree rebuild it replaced, checked and timed. Args: [maxBodies] [steps]", BroadphaseBenchmark },
+		{ "octree", "Point shadow caster lookup, linear octree vs culling every object per light, checked and timed. Args: [maxObjects] [iterations]", OctreeBenchmark },
+		{ "jobs", "Physics step shape on the job system at 1 to N threads, checked identical and timed. Args: [maxBodies] [steps]", JobSystemBenchmark },
+		{ "contacts", "Resting sphere columns, warm started vs cold sequential impulses at 1 to 32 iterations, checked. Args: [height] [steps] [columns]", ContactSolverBenchmark },
+		{ "rigidbodies", "Body integration, GameObject loops vs RigidBodyStore scalar and SIMD, checked and timed. Args: [maxBodies] [iterations]", RigidBodyBenchmark },
+	};
+
+	void PrintUsage(const char* exe) {
+		std::printf("Usage: %s <benchmark> [args...]\n", exe);
+		for (const BenchmarkEntry& entry : benchmarks) {
+			std::printf("  %-12.*s %.*s\n", (int)entry.name.size(), entry.name.data(), (int)entry.description.size(), entry.description.data());
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		PrintUsage(argv[0]);
+		return 1;
+	}
+
+	for (const BenchmarkEntry& entry : benchmarks) {
+		if (entry.name == argv[1]) {
+			return entry.run(argc - 2, argv + 2);
+		}
+	}
+
+	std::printf("Unknown benchmark %s\n", argv[1]);
+	PrintUsage(argv[0]);
+	return 1;
+}
@@ -0,0 +1,191 @@
+#include "Benchmark.h"
+#include "Common/Graphics/FrustumCuller.h"
+#include "Common/Graphics/OcclusionRasterizer.h"
+#include "Common/Math/Frustum.h"
+#include "Common/Math/Matrix4.h"
+#include "Common/Math/Vector4.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace NCL;
+using namespace Maths;
+using namespace Rendering;
+using namespace Benchmarks;
+
+namespace {
+	// Same scene extent and camera as FrustumCullBenchmark
+	const Vector3 MIN_BOUNDS = Vector3(-1500.0f, -100.0f, -700.0f);
+	const Vector3 MAX_BOUNDS = Vector3(1500.0f, 1200.0f, 700.0f);
+
+	// A row of walls across the view with gaps between them, everything past them is a candidate for culling
+	const float WALL_X = -600.0f;
+	const float WALL_HALF_THICKNESS = 10.0f;
+	const float WALL_SPACING = 300.0f;
+	const Vector3 WALL_HALF_SIZE = Vector3(WALL_HALF_THICKNESS, 700.0f, 110.0f);
+
+	const std::vector<Vector3> BOX_POSITIONS = {
+		Vector3(-1, -1, -1), Vector3(1, -1, -1), Vector3(1, 1, -1), Vector3(-1, 1, -1),
+		Vector3(-1, -1, 1), Vector3(1, -1, 1), Vector3(1, 1, 1), Vector3(-1, 1, 1)
+	};
+	const std::vector<unsigned int> BOX_INDICES = {
+		0, 2, 1, 0, 3, 2, 4, 5, 6, 4, 6, 7, 0, 1, 5, 0, 5, 4,
+		3, 6, 2, 3, 7, 6, 0, 4, 7, 0, 7, 3, 1, 2, 6, 1, 6, 5
+	};
+
+	struct SceneBox {
+		Vector3 centre;
+		Vector3 halfSize;
+	};
+
+	// Whether the segment from start to end passes through the box, by slabs
+	bool SegmentHitsBox(const Vector3& start, const Vector3& end, const Vector3& centre, const Vector3& halfSize) {
+		float enter = 0.0f;
+		float exit = 1.0f;
+		for (int axis = 0; axis < 3; ++axis) {
+			const float delta = end[axis] - start[axis];
+			const float lo = centre[axis] - halfSize[axis] - start[axis];
+			const float hi = centre[axis] + halfSize[axis] - start[axis];
+			if (delta == 0.0f) {
+				if (lo > 0.0f || hi < 0.0f) {
+					return false;
+				}
+				continue;
+			}
+			const float t0 = lo / delta;
+			const float t1 = hi / delta;
+			enter = std::max(enter, std::min(t0, t1));
+			exit = std::min(exit, std::max(t0, t1));
+		}
+		return enter <= exit;
+	}
+
+	// True if every point of a grid over the box's faces that's on screen is behind a wall, as seen from the camera
+	bool HiddenByWalls(const SceneBox& box, const Vector3& camera, const Matrix4& viewProj, const std::vector<SceneBox>& walls) {
+		const int samples = 5;
+		for (int face = 0; face < 6; ++face) {
+			const int axis = face / 2;
+			for (int i = 0; i < samples; ++i) {
+				for (int j = 0; j < samples; ++j) {
+					Vector3 offset;
+					offset[axis] = (face & 1) ? 1.0f : -1.0f;
+					offset[(axis + 1) % 3] = i / (samples - 1.0f) * 2.0f - 1.0f;
+					offset[(axis + 2) % 3] = j / (samples - 1.0f) * 2.0f - 1.0f;
+					const Vector3 point = box.centre + offset * box.halfSize;
+					const Vector4 clip = viewProj * Vector4(point, 1.0f);
+					if (clip.w <= 0.0f || std::abs(clip.x) > clip.w || std::abs(clip.y) > clip.w) {
+						continue;
+					}
+					bool hidden = false;
+					for (const SceneBox& wall : walls) {
+						if (SegmentHitsBox(camera, point, wall.centre, wall.halfSize)) {
+							hidden = true;
+							break;
+						}
+					}
+					if (!hidden) {
+						return false;
+					}
+				}
+			}
+		}
+		return true;
+	}
+
+	std::vector<SceneBox> GenerateBoxes(uint count, unsigned int seed) {
+		std::mt19937 gen(seed);
+		std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+		std::vector<SceneBox> boxes(count);
+		for (SceneBox& box : boxes) {
+			for (int i = 0; i < 3; ++i) {
+				box.centre[i] = dis(gen) * (MAX_BOUNDS[i] - MIN_BOUNDS[i]) + MIN_BOUNDS[i];
+			}
+			const float size = 5.0f + dis(gen) * 45.0f;
+			box.halfSize = Vector3(size, size * 0.5f, size);
+		}
+		return boxes;
+	}
+}
+
+/*
+* Times OcclusionRasterizer at a few depth buffer sizes: rasterizing a row of walls, building the pyramid and
+* testing every box inside the camera's frustum. Each culled box is checked by casting rays from the camera to points
+* all over its on screen part, and if any of them gets past the walls it's counted as wrong and fails the run.
+*/
+int NCL::Benchmarks::OcclusionBenchmark(int argc, char** argv) {
+	const uint boxCount = argc > 0 ? (uint)std::atoi(argv[0]) : 100000;
+	const int iterations = argc > 1 ? std::atoi(argv[1]) : 10;
+
+	const Vector3 camera(-1200.0f, 200.0f, 0.0f);
+	const Matrix4 view = Matrix4::BuildViewMatrix(camera, Vector3(0.0f, 150.0f, 0.0f), Vector3(0.0f, 1.0f, 0.0f));
+	const Matrix4 proj = Matrix4::Perspective(1.0f, 5000.0f, 16.0f / 9.0f, 45.0f);
+	const Matrix4 viewProj = proj * view;
+	Frustum frustum;
+	frustum.FromMatrix(viewProj);
+
+	std::vector<Matrix4> walls;
+	std::vector<SceneBox> wallBoxes;
+	for (float z = MIN_BOUNDS.z; z <= MAX_BOUNDS.z; z += WALL_SPACING) {
+		const Vector3 centre(WALL_X, WALL_HALF_SIZE.y - 100.0f, z);
+		walls.push_back(Matrix4::Translation(centre) * Matrix4::Scale(WALL_HALF_SIZE));
+		wallBoxes.push_back({ centre, WALL_HALF_SIZE });
+	}
+
+	const std::vector<SceneBox> boxes = GenerateBoxes(boxCount, 1234);
+	FrustumCuller culler;
+	culler.Reserve(boxCount);
+	for (const SceneBox& box : boxes) {
+		culler.AddBox(box.centre, box.halfSize);
+	}
+	std::vector<uint> inFrustum;
+	culler.Cull(frustum, inFrustum);
+
+	std::printf("%u boxes, %zu in the frustum, %zu walls, %d iterations, times are min (mean) ms\n",
+		boxCount, inFrustum.size(), walls.size(), iterations);
+	std::printf("%10s %18s %18s %18s %9s %9s\n", "resolution", "rasterize", "pyramid", "test", "occluded", "wrong");
+
+	const int resolutions[][2] = { { 160, 90 }, { 320, 180 }, { 640, 360 } };
+	for (const auto& resolution : resolutions) {
+		OcclusionRasterizer rasterizer(resolution[0], resolution[1]);
+
+		const BenchmarkResult rasterTime = TimeIterations([&] {
+			rasterizer.Begin(viewProj);
+			for (const Matrix4& wall : walls) {
+				rasterizer.RasterizeTriangles(wall, BOX_POSITIONS, BOX_INDICES);
+			}
+		}, iterations);
+
+		const BenchmarkResult pyramidTime = TimeIterations([&] {
+			rasterizer.Finish();
+		}, iterations);
+
+		uint occluded = 0;
+		const BenchmarkResult testTime = TimeIterations([&] {
+			occluded = 0;
+			for (uint i : inFrustum) {
+				occluded += rasterizer.IsVisible(boxes[i].centre, boxes[i].halfSize) ? 0 : 1;
+			}
+		}, iterations);
+
+		uint wrong = 0;
+		for (uint i : inFrustum) {
+			if (!rasterizer.IsVisible(boxes[i].centre, boxes[i].halfSize) && !HiddenByWalls(boxes[i], camera, viewProj, wallBoxes)) {
+				wrong++;
+			}
+		}
+
+		std::printf("%4dx%-5d %9.3f (%6.3f) %9.3f (%6.3f) %9.3f (%6.3f) %9u %9u\n", resolution[0], resolution[1],
+			rasterTime.minMs, rasterTime.meanMs, pyramidTime.minMs, pyramidTime.meanMs,
+			testTime.minMs, testTime.meanMs, occluded, wrong);
+
+		if (wrong > 0) {
+			std::printf("%u boxes that can be seen past the walls were culled\n", wrong);
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,241 @@
+#include "Benchmark.h"
+#include "Common/Graphics/FrustumCuller.h"
+#include "Common/Math/Matrix4.h"
+#include "Common/Math/Octree.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace NCL;
+using namespace Maths;
+using namespace Rendering;
+using namespace Benchmarks;
+
+namespace {
+	const float WORLD_HEIGHT = 40.0f;
+
+	struct Object {
+		Vector3 centre;
+		Vector3 halfSize;
+	};
+
+	struct Ray {
+		Vector3 position;
+		Vector3 direction;
+
+		Vector3 GetPosition() const { return position; }
+		Vector3 GetDirection() const { return direction; }
+	};
+
+	// Mostly small props with a few large ones, spread over a level about as crowded at every count
+	std::vector<Object> GenerateObjects(uint count, unsigned int seed, float& worldSize) {
+		std::mt19937 gen(seed);
+		std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+		worldSize = 4.0f * std::sqrt((float)count);
+		std::vector<Object> objects(count);
+		for (Object& object : objects) {
+			object.centre = Vector3((dis(gen) - 0.5f) * worldSize, dis(gen) * WORLD_HEIGHT, (dis(gen) - 0.5f) * worldSize);
+			const float size = dis(gen) < 0.02f ? 5.0f + 20.0f * dis(gen) : 0.2f + dis(gen);
+			object.halfSize = Vector3(size * (0.5f + dis(gen)), size * (0.5f + dis(gen)), size * (0.5f + dis(gen)));
+		}
+		return objects;
+	}
+
+	bool Overlaps(const Object& object, const Vector3& boxMin, const Vector3& boxMax) {
+		for (int i = 0; i < 3; ++i) {
+			if (object.centre[i] + object.halfSize[i] < boxMin[i] || object.centre[i] - object.halfSize[i] > boxMax[i]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool RayHits(const Object& object, const Ray& ray) {
+		float tMin = 0.0f;
+		float tMax = FLT_MAX;
+		for (int i = 0; i < 3; ++i) {
+			const float invDir = ray.direction[i] != 0.0f ? 1.0f / ray.direction[i] : FLT_MAX;
+			float t0 = (object.centre[i] - object.halfSize[i] - ray.position[i]) * invDir;
+			float t1 = (object.centre[i] + object.halfSize[i] - ray.position[i]) * invDir;
+			if (t0 > t1) {
+				std::swap(t0, t1);
+			}
+			tMin = std::max(tMin, t0);
+			tMax = std::min(tMax, t1);
+		}
+		return tMin <= tMax;
+	}
+
+	// Checks every query against testing each object. Returns false on a mismatch.
+	bool CheckQueries(Octree<uint>& octree, const std::vector<Object>& objects, const std::vector<Vector3>& lights,
+		float lightRadius, const std::vector<Ray>& rays) {
+		std::vector<uint> found;
+		std::vector<uint> expected;
+		const Vector3 extent(lightRadius, lightRadius, lightRadius);
+		for (size_t l = 0; l < lights.size(); ++l) {
+			found.clear();
+			octree.QueryBox(lights[l] - extent, lights[l] + extent, [&](uint i) {
+				found.push_back(i);
+			});
+			std::sort(found.begin(), found.end());
+			expected.clear();
+			for (uint i = 0; i < (uint)objects.size(); ++i) {
+				if (Overlaps(objects[i], lights[l] - extent, lights[l] + extent)) {
+					expected.push_back(i);
+				}
+			}
+			if (found != expected) {
+				std::printf("Box query %zu found %zu objects, expected %zu\n", l, found.size(), expected.size());
+				return false;
+			}
+		}
+
+		for (size_t r = 0; r < rays.size(); ++r) {
+			found = octree.BuildRayCollisonList(rays[r]);
+			std::sort(found.begin(), found.end());
+			expected.clear();
+			for (uint i = 0; i < (uint)objects.size(); ++i) {
+				if (RayHits(objects[i], rays[r])) {
+					expected.push_back(i);
+				}
+			}
+			if (found != expected) {
+				std::printf("Ray %zu hit %zu objects, expected %zu\n", r, found.size(), expected.size());
+				return false;
+			}
+		}
+
+		uint contained = 0;
+		octree.OperateOnContents([&](const OctreeContents<uint>& contents) {
+			contained += contents.count;
+		});
+		if (contained != (uint)objects.size()) {
+			std::printf("The octree's nodes hold %u objects, expected %zu\n", contained, objects.size());
+			return false;
+		}
+		return true;
+	}
+}
+
+/*
+* The point shadow passes' caster lookup: the objects in the box around each of a number of lights, from a FrustumCuller
+* culling every object against each light's box as before, and from an Octree over the same objects. Building the
+* octree costs about as much as the culling, so it only pays when it's kept while nothing in it moves: "rebuilt" times
+* a build every frame, "unmoved" the check for movement the renderer makes instead, plus the queries.
+* Each count is checked against testing every object, with rays as well, before it's timed.
+*/
+int NCL::Benchmarks::OctreeBenchmark(int argc, char** argv) {
+	const uint maxObjects = argc > 0 ? (uint)std::atoi(argv[0]) : 100000;
+	const int iterations = argc > 1 ? std::atoi(argv[1]) : 10;
+	const uint lightCount = 64;
+	const float lightRadius = 10.0f;
+
+	std::printf("%d iterations of %u lights, times are min (mean) ms\n", iterations, lightCount);
+	std::printf("%8s %18s %18s %18s %18s %18s %8s %10s\n", "objects", "octree build", "octree queries", "rebuilt total",
+		"unmoved total", "culler queries", "nodes", "casters");
+
+	for (uint count = 1000; count <= maxObjects; count *= 10) {
+		float worldSize;
+		const std::vector<Object> objects = GenerateObjects(count, 1234, worldSize);
+
+		FrustumCuller culler;
+		culler.Reserve(count);
+		for (const Object& object : objects) {
+			culler.AddBox(object.centre, object.halfSize);
+		}
+
+		std::mt19937 gen(5678);
+		std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+		std::vector<Vector3> lights(lightCount);
+		for (Vector3& light : lights) {
+			light = Vector3((dis(gen) - 0.5f) * worldSize, dis(gen) * WORLD_HEIGHT, (dis(gen) - 0.5f) * worldSize);
+		}
+		std::vector<Ray> rays(32);
+		for (Ray& ray : rays) {
+			ray.position = Vector3((dis(gen) - 0.5f) * worldSize, dis(gen) * WORLD_HEIGHT, (dis(gen) - 0.5f) * worldSize);
+			ray.direction = Vector3(dis(gen) - 0.5f, (dis(gen) - 0.5f) * 0.2f, dis(gen) - 0.5f);
+		}
+		// Straight along an axis, through the world's edge
+		rays[0].direction = Vector3(1, 0, 0);
+		rays[1].position = Vector3(-worldSize, WORLD_HEIGHT * 0.5f, 0);
+		rays[1].direction = Vector3(0, 0, -1);
+
+		Octree<uint> octree;
+		auto build = [&] {
+			Vector3 boundsMin, boundsMax;
+			culler.GetBounds(boundsMin, boundsMax);
+			octree.Reset(boundsMin, boundsMax);
+			for (uint i = 0; i < culler.GetObjectCount(); ++i) {
+				Vector3 centre, halfSize;
+				culler.GetBox(i, centre, halfSize);
+				octree.Insert(i, centre, halfSize);
+			}
+			// Queries build the nodes, an empty one does just that
+			octree.QueryBox(Vector3(1, 1, 1), Vector3(0, 0, 0), [](uint) {});
+		};
+		build();
+		if (!CheckQueries(octree, objects, lights, lightRadius, rays)) {
+			std::printf("%u objects\n", count);
+			return 1;
+		}
+
+		const Vector3 extent(lightRadius, lightRadius, lightRadius);
+		std::vector<uint> casters;
+		size_t totalCasters = 0;
+		auto octreeQueries = [&] {
+			totalCasters = 0;
+			for (const Vector3& light : lights) {
+				casters.clear();
+				octree.QueryBox(light - extent, light + extent, [&](uint i) {
+					casters.push_back(i);
+				});
+				std::sort(casters.begin(), casters.end());
+				totalCasters += casters.size();
+			}
+		};
+		auto cullerQueries = [&] {
+			for (const Vector3& light : lights) {
+				Frustum lightBox;
+				lightBox.FromMatrix(Matrix4::Orthographic(-lightRadius, lightRadius, lightRadius, -lightRadius, lightRadius, -lightRadius) *
+					Matrix4::Translation(-light));
+				culler.Cull(lightBox, casters);
+			}
+		};
+
+		// As GameTechRenderer::RenderPointShadows checks whether anything in the octree has moved since it was built
+		uint64_t version = 0;
+		auto hashBounds = [&] {
+			version = 14695981039346656037ull;
+			for (uint i = 0; i < culler.GetObjectCount(); ++i) {
+				Vector3 centre, halfSize;
+				culler.GetBox(i, centre, halfSize);
+				version = (version ^ i) * 1099511628211ull;
+				for (float f : { centre.x, centre.y, centre.z, halfSize.x, halfSize.y, halfSize.z }) {
+					version = (version ^ std::bit_cast<uint32_t>(f)) * 1099511628211ull;
+				}
+			}
+		};
+
+		const BenchmarkResult buildTime = TimeIterations(build, iterations);
+		const BenchmarkResult queryTime = TimeIterations(octreeQueries, iterations);
+		const BenchmarkResult totalTime = TimeIterations([&] {
+			build();
+			octreeQueries();
+		}, iterations);
+		const BenchmarkResult unmovedTime = TimeIterations([&] {
+			hashBounds();
+			octreeQueries();
+		}, iterations);
+		const BenchmarkResult cullerTime = TimeIterations(cullerQueries, iterations);
+
+		std::printf("%8u %9.3f (%6.3f) %9.3f (%6.3f) %9.3f (%6.3f) %9.3f (%6.3f) %9.3f (%6.3f) %8u %10zu\n", count,
+			buildTime.minMs, buildTime.meanMs, queryTime.minMs, queryTime.meanMs, totalTime.minMs, totalTime.meanMs,
+			unmovedTime.minMs, unmovedTime.meanMs, cullerTime.minMs, cullerTime.meanMs, octree.GetNodeCount(), totalCasters);
+	}
+	return 0;
+}
@@ -0,0 +1,179 @@
+#include "Benchmark.h"
+#include "Common/Graphics/PointShadowAtlas.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using namespace NCL;
+using namespace Maths;
+using namespace Rendering;
+using namespace Benchmarks;
+
+namespace {
+	// Sponza sized, the same bounds GameTechRenderer scatters its lights in
+	const Vector3 SCENE_MIN(-560.0f, 0.0f, -230.0f);
+	const Vector3 SCENE_MAX(510.0f, 400.0f, 220.0f);
+	const float LIGHT_RADIUS = 40.0f;
+	const float TAN_HALF_FOV = 0.41421356f;
+	// Lights that move each frame, and so need redrawing whenever they're shadowed
+	const float MOVING_FRACTION = 0.25f;
+	const int FRAMES = 600;
+
+	struct TestLight {
+		Vector3 pos;
+		float intensity;
+		bool moving;
+	};
+
+	std::vector<TestLight> GenerateLights(uint count, unsigned int seed) {
+		std::mt19937 gen(seed);
+		std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+		std::vector<TestLight> lights(count);
+		for (TestLight& light : lights) {
+			light.pos = SCENE_MIN + (SCENE_MAX - SCENE_MIN) * Vector3(dis(gen), dis(gen), dis(gen));
+			light.intensity = 0.25f + dis(gen);
+			light.moving = dis(gen) < MOVING_FRACTION;
+		}
+		return lights;
+	}
+
+	// Along the length of the scene and back, at head height
+	Vector3 CameraAt(int frame) {
+		const float t = 0.5f - 0.5f * std::cos(frame * 6.2831853f / FRAMES);
+		return Vector3(SCENE_MIN.x + (SCENE_MAX.x - SCENE_MIN.x) * t, 20.0f, 0.0f);
+	}
+
+	void BuildRequests(const std::vector<TestLight>& lights, const Vector3& camera, std::vector<PointShadowRequest>& requests) {
+		requests.clear();
+		for (uint i = 0; i < (uint)lights.size(); ++i) {
+			requests.push_back({ i, PointShadowAtlas::Importance(lights[i].pos, LIGHT_RADIUS, lights[i].intensity, camera, TAN_HALF_FOV) });
+		}
+	}
+
+	// Checks one Allocate against the atlas's own bookkeeping and against a copy of the per light slot table the
+	// renderer keeps on the GPU, updated only from the activated and deactivated lists. Returns false on a mismatch.
+	bool CheckFrame(const PointShadowAtlas& atlas, const std::vector<PointShadowAssignment>& lastAssignments,
+		std::unordered_map<uint, uint>& slotTable, size_t requestCount, int frame) {
+		const std::vector<PointShadowAssignment>& assignments = atlas.GetAssignments();
+		const size_t expected = std::min({ requestCount, (size_t)atlas.GetSettings().maxShadowedLights, (size_t)atlas.GetSlotCount() });
+		if (assignments.size() != expected) {
+			std::printf("Frame %d: %zu lights shadowed, expected %zu\n", frame, assignments.size(), expected);
+			return false;
+		}
+
+		std::vector<bool> slotUsed(atlas.GetSlotCount());
+		for (const PointShadowAssignment& a : assignments) {
+			if (slotUsed[a.slot]) {
+				std::printf("Frame %d: slot %u given to two lights\n", frame, a.slot);
+				return false;
+			}
+			slotUsed[a.slot] = true;
+			if (atlas.GetActiveSlot(a.lightIndex) != a.slot) {
+				std::printf("Frame %d: light %u is in slot %u but GetActiveSlot says %u\n", frame, a.lightIndex, a.slot, atlas.GetActiveSlot(a.lightIndex));
+				return false;
+			}
+		}
+
+		for (const PointShadowAssignment& last : lastAssignments) {
+			const uint slot = atlas.GetActiveSlot(last.lightIndex);
+			if (slot != POINT_SHADOW_NO_SLOT && slot != last.slot) {
+				std::printf("Frame %d: light %u moved from slot %u to %u while shadowed\n", frame, last.lightIndex, last.slot, slot);
+				return false;
+			}
+		}
+
+		for (uint light : atlas.GetDeactivated()) {
+			slotTable.erase(light);
+		}
+		for (const PointShadowAssignment& a : atlas.GetActivated()) {
+			slotTable[a.lightIndex] = a.slot;
+		}
+		if (slotTable.size() != assignments.size()) {
+			std::printf("Frame %d: slot table has %zu lights, %zu are shadowed\n", frame, slotTable.size(), assignments.size());
+			return false;
+		}
+		for (const PointShadowAssignment& a : assignments) {
+			const auto found = slotTable.find(a.lightIndex);
+			if (found == slotTable.end() || found->second != a.slot) {
+				std::printf("Frame %d: slot table is wrong for light %u\n", frame, a.lightIndex);
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+/*
+* Flies a camera through lights scattered over sponza's bounds, shadowing the most important each frame with
+* PointShadowAtlas, and counts the cube faces drawn against drawing every shadowed light every frame. Checks the
+* allocation every frame: no slot shared, no light moved while shadowed, and the activated/deactivated lists keep a
+* slot table in step. Also times Allocate over every light.
+*/
+int NCL::Benchmarks::PointShadowBenchmark(int argc, char** argv) {
+	const uint maxLights = argc > 0 ? (uint)std::atoi(argv[0]) : 65536;
+	const int iterations = argc > 1 ? std::atoi(argv[1]) : 10;
+
+	std::printf("%d frames of camera path, %d iterations of Allocate, times are min (mean) ms\n", FRAMES, iterations);
+	std::printf("%8s %6s %18s %14s %14s %12s\n", "lights", "slots", "allocate", "faces drawn", "every frame", "slot churn");
+
+	std::vector<PointShadowRequest> requests;
+	for (uint count = 256; count <= maxLights; count *= 4) {
+		std::vector<TestLight> lights = GenerateLights(count, 1234);
+		PointShadowAtlas atlas;
+
+		std::unordered_map<uint, uint> slotTable;
+		std::vector<PointShadowAssignment> lastAssignments;
+		uint64_t facesDrawn = 0;
+		uint64_t facesEveryFrame = 0;
+		uint64_t activations = 0;
+		for (int frame = 0; frame < FRAMES; ++frame) {
+			for (TestLight& light : lights) {
+				if (light.moving) {
+					light.pos.y = SCENE_MIN.y + std::fmod(light.pos.y + 0.5f - SCENE_MIN.y, SCENE_MAX.y - SCENE_MIN.y);
+				}
+			}
+			BuildRequests(lights, CameraAt(frame), requests);
+			atlas.Allocate(requests);
+			if (!CheckFrame(atlas, lastAssignments, slotTable, requests.size(), frame)) {
+				return 1;
+			}
+			lastAssignments = atlas.GetAssignments();
+			activations += atlas.GetActivated().size();
+
+			for (const PointShadowAssignment& a : atlas.GetAssignments()) {
+				// What the renderer does: a moving light gets a new version every frame, a still one keeps its own
+				const uint64_t version = lights[a.lightIndex].moving ? (uint64_t)frame + 1 : 0;
+				if (atlas.NeedsRender(a.slot, version)) {
+					atlas.MarkRendered(a.slot, version);
+					facesDrawn += POINT_SHADOW_FACE_COUNT;
+				}
+				facesEveryFrame += POINT_SHADOW_FACE_COUNT;
+			}
+		}
+
+		// Nothing changes, so nothing should be activated, deactivated or drawn
+		atlas.Allocate(requests);
+		if (!atlas.GetActivated().empty() || !atlas.GetDeactivated().empty()) {
+			std::printf("%u lights: the same requests twice changed the shadowed lights\n", count);
+			return 1;
+		}
+		for (const PointShadowAssignment& a : atlas.GetAssignments()) {
+			if (!lights[a.lightIndex].moving && atlas.NeedsRender(a.slot, 0)) {
+				std::printf("%u lights: still light %u needs drawing again with nothing changed\n", count, a.lightIndex);
+				return 1;
+			}
+		}
+
+		const BenchmarkResult allocateTime = TimeIterations([&] {
+			atlas.Allocate(requests);
+		}, iterations);
+
+		std::printf("%8u %6u %9.3f (%6.3f) %14llu %14llu %12.2f\n", count, atlas.GetSlotCount(), allocateTime.minMs, allocateTime.meanMs,
+			(unsigned long long)facesDrawn, (unsigned long long)facesEveryFrame, (double)activations / FRAMES);
+	}
+	return 0;
+}
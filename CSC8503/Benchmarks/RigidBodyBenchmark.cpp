@@ -0,0 +1,315 @@
+#include "Benchmark.h"
+#include "Common/Math/Matrix4.h"
+#include "Common/Physics/RigidBodyStore.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace NCL;
+using namespace Maths;
+using namespace Physics;
+using namespace Benchmarks;
+
+namespace {
+	const float DT = 1.0f / 120.0f;
+	const Vector3 GRAVITY(0.0f, -9.8f, 0.0f);
+
+	/*
+	* Stand ins for Transform, PhysicsObject and GameObject, laid out the same way, as CSC8503Common can't be
+	* linked here. Each is its own allocation, made in a shuffled order between allocations of other sizes,
+	* so following the pointers wanders around the heap the way it does in a game that's been running a while.
+	*/
+	struct ObjectTransform {
+		Matrix4 matrix;
+		Quaternion orientation;
+		Vector3 position;
+		Vector3 scale = Vector3(1, 1, 1);
+
+		void UpdateMatrix() {
+			matrix = Matrix4::Translation(position) * Matrix4(orientation) * Matrix4::Scale(scale);
+		}
+		void SetPosition(const Vector3& p) {
+			position = p;
+			UpdateMatrix();
+		}
+		void SetOrientation(const Quaternion& q) {
+			orientation = q;
+			UpdateMatrix();
+		}
+	};
+
+	struct ObjectPhysics {
+		void* volume;
+		ObjectTransform* transform;
+		float inverseMass;
+		float elasticity;
+		float friction;
+		float stiffness;
+		float linearDamping;
+		float angularDamping;
+		bool isStatic;
+		Vector3 linearVelocity;
+		Vector3 force;
+		float rwaMotion;
+		Vector3 angularVelocity;
+		Vector3 torque;
+		Vector3 inverseInertia;
+		Matrix3 inverseInertiaTensor;
+
+		void UpdateInertiaTensor() {
+			const Quaternion q = transform->orientation;
+			inverseInertiaTensor = Matrix3(q) * Matrix3::Scale(inverseInertia) * Matrix3(q.Conjugate());
+		}
+	};
+
+	struct Object {
+		void* vtable;
+		ObjectTransform transform;
+		ObjectPhysics* physics;
+		bool asleep;
+	};
+
+	class ObjectWorld {
+	public:
+		ObjectWorld(uint count, unsigned int seed) {
+			std::mt19937 gen(seed);
+			std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+			std::vector<uint> order(count);
+			for (uint i = 0; i < count; ++i) {
+				order[i] = i;
+			}
+			std::shuffle(order.begin(), order.end(), gen);
+
+			objects.resize(count);
+			physics.resize(count);
+			for (uint i : order) {
+				objects[i] = std::make_unique<Object>();
+				padding.push_back(std::make_unique<char[]>(16 + (size_t)(dis(gen) * 400.0f)));
+				physics[i] = std::make_unique<ObjectPhysics>();
+				padding.push_back(std::make_unique<char[]>(16 + (size_t)(dis(gen) * 400.0f)));
+			}
+
+			auto random = [&](float scale) {
+				return Vector3(dis(gen) - 0.5f, dis(gen) - 0.5f, dis(gen) - 0.5f) * scale;
+			};
+			for (uint i = 0; i < count; ++i) {
+				Object& o = *objects[i];
+				ObjectPhysics& p = *physics[i];
+				o.physics = &p;
+				o.asleep = dis(gen) < 0.1f;
+				o.transform.position = random(200.0f);
+				Quaternion q(dis(gen) - 0.5f, dis(gen) - 0.5f, dis(gen) - 0.5f, dis(gen) - 0.5f);
+				q.Normalise();
+				o.transform.orientation = q;
+				o.transform.UpdateMatrix();
+
+				p = {};
+				p.transform = &o.transform;
+				p.inverseMass = dis(gen) < 0.1f ? 0.0f : 0.5f + dis(gen);
+				p.linearDamping = 0.4f;
+				p.angularDamping = 0.4f;
+				p.linearVelocity = random(10.0f);
+				p.angularVelocity = random(2.0f);
+				p.force = random(20.0f);
+				p.torque = random(5.0f);
+				p.inverseInertia = Vector3(dis(gen), dis(gen), dis(gen)) * 6.0f * p.inverseMass;
+			}
+		}
+
+		// PhysicsSystem::IntegrateAccel and IntegrateVelocity as they were, walking the objects
+		void Step() {
+			for (const std::unique_ptr<Object>& i : objects) {
+				ObjectPhysics* object = i->physics;
+				if (object == nullptr || i->asleep) {
+					continue;
+				}
+				float inverseMass = object->inverseMass;
+				Vector3 linearVel = object->linearVelocity;
+				Vector3 accel = object->force * inverseMass;
+				if (inverseMass > 0) {
+					accel += GRAVITY;
+				}
+				linearVel += accel * DT;
+				object->linearVelocity = linearVel;
+
+				Vector3 angVel = object->angularVelocity;
+				object->UpdateInertiaTensor();
+				Vector3 angAccel = object->inverseInertiaTensor * object->torque;
+				angVel += angAccel * DT;
+				object->angularVelocity = angVel;
+			}
+
+			for (const std::unique_ptr<Object>& i : objects) {
+				ObjectPhysics* object = i->physics;
+				if (object == nullptr || i->asleep) {
+					continue;
+				}
+				float frameLinearDamping = 1.0f - (object->linearDamping * DT);
+				ObjectTransform& transform = i->transform;
+				Vector3 position = transform.position;
+				Vector3 linearVel = object->linearVelocity;
+				position += linearVel * DT;
+				transform.SetPosition(position);
+				linearVel = linearVel * frameLinearDamping;
+				object->linearVelocity = linearVel;
+
+				Quaternion orientation = transform.orientation;
+				Vector3 angVel = object->angularVelocity;
+				orientation = orientation + (Quaternion(angVel * DT * 0.5f, 0.0f) * orientation);
+				orientation.Normalise();
+				transform.SetOrientation(orientation);
+
+				float frameAngularDamping = 1.0f - (object->angularDamping * DT);
+				angVel = angVel * frameAngularDamping;
+				object->angularVelocity = angVel;
+			}
+		}
+
+		// As PhysicsSystem::LoadRigidBodies
+		void Load(RigidBodyStore& store) const {
+			store.Resize((uint)objects.size());
+			for (uint i = 0; i < (uint)objects.size(); ++i) {
+				const Object& o = *objects[i];
+				const ObjectPhysics& p = *o.physics;
+				RigidBody body = {};
+				body.position = o.transform.position;
+				body.orientation = o.transform.orientation;
+				body.linearVelocity = p.linearVelocity;
+				body.angularVelocity = p.angularVelocity;
+				body.force = p.force;
+				body.torque = p.torque;
+				body.inverseInertia = p.inverseInertia;
+				body.inverseMass = p.inverseMass;
+				body.linearDamping = p.linearDamping;
+				body.angularDamping = p.angularDamping;
+				body.active = !o.asleep;
+				store.SetBody(i, body);
+			}
+		}
+
+		// As PhysicsSystem::IntegrateVelocity writes the moved bodies out after each substep
+		void WriteTransforms(const RigidBodyStore& store) {
+			for (uint i = 0; i < (uint)objects.size(); ++i) {
+				if (store.IsActive(i)) {
+					objects[i]->transform.SetPosition(store.GetPosition(i));
+					objects[i]->transform.SetOrientation(store.GetOrientation(i));
+				}
+			}
+		}
+
+		const Object& GetObject(uint i) const {
+			return *objects[i];
+		}
+
+	protected:
+		std::vector<std::unique_ptr<Object>> objects;
+		std::vector<std::unique_ptr<ObjectPhysics>> physics;
+		std::vector<std::unique_ptr<char[]>> padding;
+	};
+
+	float Difference(const Vector3& a, const Vector3& b) {
+		return (a - b).Length() / std::max(1.0f, a.Length());
+	}
+
+	// The largest relative difference between the objects and the store's bodies
+	float MaxDifference(const ObjectWorld& world, const RigidBodyStore& store) {
+		float difference = 0.0f;
+		for (uint i = 0; i < store.GetBodyCount(); ++i) {
+			const Object& o = world.GetObject(i);
+			const Quaternion q = store.GetOrientation(i);
+			const Quaternion d = q - o.transform.orientation;
+			difference = std::max({ difference,
+				Difference(o.transform.position, store.GetPosition(i)),
+				Difference(o.physics->linearVelocity, store.GetLinearVelocity(i)),
+				Difference(o.physics->angularVelocity, store.GetAngularVelocity(i)),
+				std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z + d.w * d.w) });
+		}
+		return difference;
+	}
+
+	bool SameBodies(const RigidBodyStore& a, const RigidBodyStore& b) {
+		for (uint i = 0; i < a.GetBodyCount(); ++i) {
+			const Quaternion qa = a.GetOrientation(i);
+			const Quaternion qb = b.GetOrientation(i);
+			if (a.GetPosition(i) != b.GetPosition(i) || qa != qb ||
+				a.GetLinearVelocity(i) != b.GetLinearVelocity(i) || a.GetAngularVelocity(i) != b.GetAngularVelocity(i)) {
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+/*
+* Integrates bodies with the loops PhysicsSystem used to run over its GameObjects, and with RigidBodyStore's
+* scalar and SIMD integrators, with and without writing the transforms back out as PhysicsSystem does.
+* The SIMD integrators have to match the scalar ones bit for bit, and both have to stay within rounding of the
+* old loops, or the benchmark fails.
+*/
+int NCL::Benchmarks::RigidBodyBenchmark(int argc, char** argv) {
+	const uint maxBodies = argc > 0 ? (uint)std::atoi(argv[0]) : 100000;
+	const int iterations = argc > 1 ? std::atoi(argv[1]) : 20;
+	const float tolerance = 1e-4f;
+
+	// The speedup is against store+transforms, as that's what PhysicsSystem does each substep; the kernels alone
+	// leave out the transform writes, which are most of the work left.
+	std::printf("One substep of IntegrateAccel and IntegrateVelocity, times are min (mean) ms\n");
+	std::printf("Speedup is objects over store+transforms, SIMD gain is store scalar over store SIMD\n");
+	std::printf("%8s %18s %18s %18s %18s %9s %9s\n", "bodies", "objects", "store+transforms", "store scalar", "store SIMD",
+		"speedup", "SIMD gain");
+
+	for (uint count = 1000; count <= maxBodies; count *= 10) {
+		ObjectWorld world(count, 1234);
+		RigidBodyStore simd;
+		RigidBodyStore scalar;
+		world.Load(simd);
+		world.Load(scalar);
+
+		// Checked over the first few steps, before any timing moves them on
+		for (int step = 0; step < 10; ++step) {
+			world.Step();
+			simd.IntegrateAccel(DT, GRAVITY, 0, count);
+			simd.IntegrateVelocity(DT, 0, count);
+			scalar.IntegrateAccelScalar(DT, GRAVITY, 0, count);
+			scalar.IntegrateVelocityScalar(DT, 0, count);
+		}
+		if (!SameBodies(simd, scalar)) {
+			std::printf("%u bodies: SIMD integration came out different to scalar\n", count);
+			return 1;
+		}
+		const float difference = MaxDifference(world, simd);
+		if (difference > tolerance) {
+			std::printf("%u bodies: the store drifted %g from the object loops\n", count, difference);
+			return 1;
+		}
+
+		const BenchmarkResult objects = TimeIterations([&] {
+			world.Step();
+		}, iterations);
+		const BenchmarkResult withTransforms = TimeIterations([&] {
+			simd.IntegrateAccel(DT, GRAVITY, 0, count);
+			simd.IntegrateVelocity(DT, 0, count);
+			world.WriteTransforms(simd);
+		}, iterations);
+		const BenchmarkResult scalarOnly = TimeIterations([&] {
+			scalar.IntegrateAccelScalar(DT, GRAVITY, 0, count);
+			scalar.IntegrateVelocityScalar(DT, 0, count);
+		}, iterations);
+		const BenchmarkResult simdOnly = TimeIterations([&] {
+			simd.IntegrateAccel(DT, GRAVITY, 0, count);
+			simd.IntegrateVelocity(DT, 0, count);
+		}, iterations);
+
+		std::printf("%8u %9.3f (%6.3f) %9.3f (%6.3f) %9.3f (%6.3f) %9.3f (%6.3f) %8.2fx %8.2fx\n", count,
+			objects.minMs, objects.meanMs, withTransforms.minMs, withTransforms.meanMs,
+			scalarOnly.minMs, scalarOnly.meanMs, simdOnly.minMs, simdOnly.meanMs,
+			objects.minMs / withTransforms.minMs, scalarOnly.minMs / simdOnly.minMs);
+	}
+	std::printf("Store and objects agree to within %g after 10 steps, SIMD matches scalar exactly\n", tolerance);
+	return 0;
+}
@@ -0,0 +1,89 @@
+#include "Benchmark.h"
+#include "Common/Graphics/StreamCompaction.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <vector>
+
+using namespace NCL;
+using namespace Rendering;
+using namespace Benchmarks;
+
+namespace {
+	// Roughly the share of clusters the depth prepass leaves active in the benchmark scene
+	constexpr float KEEP_CHANCE = 0.1f;
+
+	std::vector<uint> GenerateFlags(uint count, unsigned int seed) {
+		std::mt19937 gen(seed);
+		std::bernoulli_distribution keep(KEEP_CHANCE);
+		std::vector<uint> flags(count);
+		for (uint& flag : flags) {
+			flag = keep(gen) ? 1 : 0;
+		}
+		return flags;
+	}
+}
+
+/*
+* Times the block-structured scan and compaction GpuScan and GpuCompact are validated against, next to a plain
+* sequential scan and compaction, and checks they give the same results. The block version does the extra
+* passes the GPU needs, so the interesting number is how little it costs on top of the sequential one.
+*/
+int NCL::Benchmarks::ScanBenchmark(int argc, char** argv) {
+	const uint maxCount = argc > 0 ? (uint)std::atoi(argv[0]) : 1u << 22;
+	const int iterations = argc > 1 ? std::atoi(argv[1]) : 10;
+
+	std::printf("%d iterations, times are min (mean) ms\n", iterations);
+	std::printf("%9s %8s %18s %18s %18s %18s %8s\n", "count", "kept", "exclusive_scan", "scan blocks", "compact loop", "compact blocks", "match");
+
+	// From the cluster grid size, quadrupling, always finishing on maxCount
+	std::vector<uint> counts;
+	for (uint count = 3072; count < maxCount; count *= 4) {
+		counts.push_back(count);
+	}
+	counts.push_back(maxCount);
+
+	for (uint count : counts) {
+		const std::vector<uint> flags = GenerateFlags(count, 1234);
+		std::vector<uint> reference(count);
+		std::vector<uint> blocked(count);
+		std::vector<uint> referenceList;
+		std::vector<uint> blockedList;
+		referenceList.reserve(count);
+		blockedList.reserve(count);
+
+		const BenchmarkResult sequentialScan = TimeIterations([&] {
+			std::exclusive_scan(flags.begin(), flags.end(), reference.begin(), 0u);
+		}, iterations);
+		const BenchmarkResult blockScan = TimeIterations([&] {
+			ExclusiveScanBlocks(flags, blocked);
+		}, iterations);
+
+		const BenchmarkResult sequentialCompact = TimeIterations([&] {
+			referenceList.clear();
+			for (uint i = 0; i < count; ++i) {
+				if (flags[i]) {
+					referenceList.push_back(i);
+				}
+			}
+		}, iterations);
+		GLSL::DispatchIndirectCommand dispatch{};
+		const BenchmarkResult blockCompact = TimeIterations([&] {
+			dispatch = CompactIndices(flags, blockedList);
+		}, iterations);
+
+		const bool match = reference == blocked && referenceList == blockedList
+			&& dispatch.numGroupsX == referenceList.size() && dispatch.numGroupsY == 1 && dispatch.numGroupsZ == 1;
+
+		std::printf("%9u %8u %9.3f (%6.3f) %9.3f (%6.3f) %9.3f (%6.3f) %9.3f (%6.3f) %8s\n", count, dispatch.numGroupsX,
+			sequentialScan.minMs, sequentialScan.meanMs, blockScan.minMs, blockScan.meanMs,
+			sequentialCompact.minMs, sequentialCompact.meanMs, blockCompact.minMs, blockCompact.meanMs, match ? "yes" : "NO");
+
+		if (!match) {
+			return 1;
+		}
+	}
+	return 0;
+}
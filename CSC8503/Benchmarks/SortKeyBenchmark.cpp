@@ -0,0 +1,145 @@
+#include "Benchmark.h"
+#include "Common/Graphics/RadixSort.h"
+#include "Common/Graphics/RenderSortKey.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <vector>
+
+using namespace NCL;
+using namespace Rendering;
+using namespace Benchmarks;
+
+namespace {
+	// Roughly sponza's mix: a handful of shaders, a few hundred textures and meshes, a few masked and blended objects
+	const uint SHADER_COUNT = 4;
+	const uint MATERIAL_COUNT = 200;
+	const uint MESH_COUNT = 100;
+	const float MASKED_FRACTION = 0.1f;
+	const float TRANSPARENT_FRACTION = 0.05f;
+	const float MAX_DISTANCE = 1500.0f;
+
+	struct SortObject {
+		uint shader;
+		uint material;
+		uint mesh;
+		SortBlend blend;
+		float distance;
+	};
+
+	std::vector<SortObject> GenerateObjects(uint count, unsigned int seed) {
+		std::mt19937 gen(seed);
+		std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+		std::vector<SortObject> objects(count);
+		for (SortObject& obj : objects) {
+			obj.shader = 1 + (uint)(dis(gen) * SHADER_COUNT) % SHADER_COUNT;
+			obj.material = 1 + (uint)(dis(gen) * MATERIAL_COUNT) % MATERIAL_COUNT;
+			obj.mesh = 1 + (uint)(dis(gen) * MESH_COUNT) % MESH_COUNT;
+			const float blend = dis(gen);
+			obj.blend = blend < TRANSPARENT_FRACTION ? SortBlend::Transparent : blend < TRANSPARENT_FRACTION + MASKED_FRACTION ? SortBlend::Masked : SortBlend::Opaque;
+			const float distance = dis(gen) * MAX_DISTANCE;
+			obj.distance = distance * distance;
+		}
+		return objects;
+	}
+
+	// Shader, material and mesh changes between neighbouring draws, the binds a renderer skipping redundant ones would make
+	uint CountStateChanges(const std::vector<SortObject>& objects, const std::vector<uint>& order) {
+		uint changes = 0;
+		for (size_t i = 0; i < order.size(); ++i) {
+			const SortObject& obj = objects[order[i]];
+			if (i == 0) {
+				changes += 3;
+				continue;
+			}
+			const SortObject& last = objects[order[i - 1]];
+			changes += (obj.shader != last.shader) + (obj.material != last.material) + (obj.mesh != last.mesh);
+		}
+		return changes;
+	}
+
+	// Transparent draws must be far to near whatever state they share, the key's one ordering guarantee beyond grouping
+	bool TransparentBackToFront(const std::vector<SortObject>& objects, const std::vector<uint>& order) {
+		float lastDistance = -1.0f;
+		for (uint i : order) {
+			if (objects[i].blend != SortBlend::Transparent) {
+				continue;
+			}
+			if (lastDistance >= 0.0f && SortKey::QuantiseDepth(objects[i].distance) > SortKey::QuantiseDepth(lastDistance)) {
+				return false;
+			}
+			lastDistance = objects[i].distance;
+		}
+		return true;
+	}
+}
+
+/*
+* Compares sorting the draw list by camera distance alone against sorting 64 bit state keys, with std::sort and with
+* RadixSort. Reports the state changes each order would cost, and checks RadixSort against std::stable_sort.
+*/
+int NCL::Benchmarks::SortKeyBenchmark(int argc, char** argv) {
+	const uint maxObjects = argc > 0 ? (uint)std::atoi(argv[0]) : 100000;
+	const int iterations = argc > 1 ? std::atoi(argv[1]) : 10;
+
+	std::printf("%d iterations, times are min (mean) ms\n", iterations);
+	std::printf("%8s %18s %18s %18s %14s %14s\n", "objects", "distance sort", "key std::sort", "key radix", "distance state", "key state");
+
+	for (uint count = 1000; count <= maxObjects; count *= 10) {
+		const std::vector<SortObject> objects = GenerateObjects(count, 1234);
+
+		std::vector<uint64_t> baseKeys(count);
+		for (uint i = 0; i < count; ++i) {
+			const SortObject& obj = objects[i];
+			baseKeys[i] = SortKey::Make(0, obj.blend, obj.shader, obj.material, obj.mesh, obj.distance);
+		}
+		std::vector<uint> baseOrder(count);
+		std::iota(baseOrder.begin(), baseOrder.end(), 0);
+
+		std::vector<uint> distanceOrder;
+		const BenchmarkResult distanceTime = TimeIterations([&] {
+			distanceOrder = baseOrder;
+			std::sort(distanceOrder.begin(), distanceOrder.end(), [&](uint a, uint b) {
+				return objects[a].distance < objects[b].distance;
+			});
+		}, iterations);
+
+		std::vector<uint> keyOrder;
+		const BenchmarkResult keySortTime = TimeIterations([&] {
+			keyOrder = baseOrder;
+			std::sort(keyOrder.begin(), keyOrder.end(), [&](uint a, uint b) {
+				return baseKeys[a] < baseKeys[b];
+			});
+		}, iterations);
+
+		std::vector<uint64_t> radixKeys;
+		std::vector<uint> radixOrder;
+		std::vector<uint64_t> keyScratch;
+		std::vector<uint> orderScratch;
+		const BenchmarkResult radixTime = TimeIterations([&] {
+			radixKeys = baseKeys;
+			radixOrder = baseOrder;
+			RadixSort(radixKeys, radixOrder, keyScratch, orderScratch);
+		}, iterations);
+
+		std::vector<uint> stableOrder = baseOrder;
+		std::stable_sort(stableOrder.begin(), stableOrder.end(), [&](uint a, uint b) {
+			return baseKeys[a] < baseKeys[b];
+		});
+		if (radixOrder != stableOrder) {
+			std::printf("%u objects: RadixSort order differs from std::stable_sort\n", count);
+			return 1;
+		}
+		if (!TransparentBackToFront(objects, radixOrder)) {
+			std::printf("%u objects: transparent objects aren't back to front\n", count);
+			return 1;
+		}
+
+		std::printf("%8u %9.3f (%6.3f) %9.3f (%6.3f) %9.3f (%6.3f) %14u %14u\n", count,
+			distanceTime.minMs, distanceTime.meanMs, keySortTime.minMs, keySortTime.meanMs, radixTime.minMs, radixTime.meanMs,
+			CountStateChanges(objects, distanceOrder), CountStateChanges(objects, radixOrder));
+	}
+	return 0;
+}
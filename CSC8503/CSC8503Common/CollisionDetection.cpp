@@ -492,7 +492,11 @@ bool CollisionDetection::AABBIntersection(const AABBVolume& volumeA, const Trans
 				bestAxis = faces[i];
 			}
 		}
-		collisionInfo.AddContactPoint(Vector3(), Vector3(),
+		// The middle of the overlap, pushed out to each box's face, so the point can be tracked from step to step
+		Vector3 overlapCentre = (Maths::Clamp(minA, minB, maxB) + Maths::Clamp(maxA, minB, maxB)) * 0.5f;
+		Vector3 localA = overlapCentre + bestAxis * (penetration * 0.5f) - boxAPos;
+		Vector3 localB = overlapCentre - bestAxis * (penetration * 0.5f) - boxBPos;
+		collisionInfo.AddContactPoint(localA, localB,
 			bestAxis, penetration);
 		return true;
 	}
@@ -536,7 +540,7 @@ bool CollisionDetection::AABBSphereIntersection(const AABBVolume& volumeA, const
 		Vector3 collisionNormal = localPoint.Normalised();
 		float penetration = (volumeB.GetRadius() - distance);
 		
-		Vector3 localA = Vector3();
+		Vector3 localA = closestPointOnBox;
 		Vector3 localB = -collisionNormal * volumeB.GetRadius();
 		collisionInfo.AddContactPoint(localA, localB, collisionNormal, penetration);
 		return true;
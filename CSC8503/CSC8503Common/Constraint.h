@@ -2,12 +2,17 @@
 
 namespace NCL {
 	namespace CSC8503 {
+		class GameObject;
+
 		class Constraint	{
 		public:
 			Constraint() {}
 			virtual ~Constraint() {}
 
 			virtual void UpdateConstraint(float dt) = 0;
+
+			// The objects it moves, so the PhysicsSystem can solve it alongside the contacts on them
+			virtual void GetObjects(GameObject*& a, GameObject*& b) const = 0;
 		};
 	}
 }
\ No newline at end of file
@@ -20,6 +20,8 @@ template <typename T> string tostr(const T& t) {
 GameObject::GameObject(string objectName)	{
 	name			= objectName;
 	worldID			= -1;
+	broadphaseProxy	= -1;
+	solverIndex		= -1;
 	isActive		= true;
 	isAsleep = false;
 	isTrigger = false;
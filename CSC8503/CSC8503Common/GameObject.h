@@ -140,6 +140,24 @@ namespace NCL {
 				return worldID;
 			}
 
+			// The object's proxy in the PhysicsSystem's broadphase, -1 until it first steps
+			void SetBroadphaseProxy(int proxy) {
+				broadphaseProxy = proxy;
+			}
+
+			int GetBroadphaseProxy() const {
+				return broadphaseProxy;
+			}
+
+			// The object's index in the PhysicsSystem's last step, for grouping it into islands
+			void SetSolverIndex(int index) {
+				solverIndex = index;
+			}
+
+			int GetSolverIndex() const {
+				return solverIndex;
+			}
+
 			void SetLayerMask(int layerMask) {
 				layer = layerMask;
 			}
@@ -164,6 +182,8 @@ namespace NCL {
 			bool    isSpring;
 			bool    toDelete = false;
 			int		worldID;
+			int		broadphaseProxy;
+			int		solverIndex;
 			int layer;
 			string	name;
 			TriggerFunc triggerFunc;
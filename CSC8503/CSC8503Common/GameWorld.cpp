@@ -11,6 +11,7 @@ using namespace NCL::CSC8503;
 
 GameWorld::GameWorld() {
 	mainCamera = new Camera();
+	physics = nullptr;
 	shuffleConstraints = false;
 	shuffleObjects = false;
 	worldIDCounter = 0;
@@ -37,11 +38,18 @@ GameWorld::~GameWorld()	{
 }
 
 void GameWorld::Clear() {
+	if (physics) {
+		physics->ClearBroadphase();
+	}
 	gameObjects.clear();
 	constraints.clear();
 }
 
 void GameWorld::ClearAndErase() {
+	// Before the objects go, the broadphase resets their proxies
+	if (physics) {
+		physics->ClearBroadphase();
+	}
 	for (auto& i : gameObjects) {
 		delete i;
 	}
@@ -63,6 +71,9 @@ void GameWorld::AddGameObject(GameObject* o) {
 }
 
 void GameWorld::RemoveGameObject(GameObject* o, bool andDelete) {
+	if (physics) {
+		physics->RemoveFromBroadphase(o);
+	}
 	gameObjects.erase(std::remove(gameObjects.begin(), gameObjects.end(), o), gameObjects.end());
 	if (andDelete) {
 		delete o;
@@ -107,7 +118,7 @@ bool GameWorld::Raycast(Ray& r, RayCollision& closestCollision, bool closestObje
 	//The simplest raycast just goes through each object and sees if there's a collision
 	RayCollision collision;
 	
-	vector<GameObject*> objects = physics->GetQuadTree()->BuildRayCollisonList(r);
+	vector<GameObject*> objects = physics->BuildRayCollisionList(r);
 	for (auto& i : objects) {
 		if (!i->GetBoundingVolume()) {
 			continue;
@@ -15,6 +15,14 @@ PhysicsObject::PhysicsObject(Transform* parentTransform, const CollisionVolume*
 	linearDamping = 0.4f;
 	angularDamping = 0.4f;
 	isStatic = false;
+	rwaMotion = 0.0f;
+
+	// Vector3 doesn't initialise itself, so without these an object starts with whatever its memory held before
+	linearVelocity	= Vector3(0, 0, 0);
+	force			= Vector3(0, 0, 0);
+	angularVelocity	= Vector3(0, 0, 0);
+	torque			= Vector3(0, 0, 0);
+	inverseInertia	= Vector3(0, 0, 0);
 }
 
 PhysicsObject::~PhysicsObject()	{
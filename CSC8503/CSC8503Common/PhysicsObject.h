@@ -132,6 +132,11 @@ namespace NCL {
 
 			void UpdateInertiaTensor();
 
+			// The diagonal of the inverse inertia tensor, in the object's own space
+			Vector3 GetInverseInertia() const {
+				return inverseInertia;
+			}
+
 			Matrix3 GetInertiaTensor() const {
 				return inverseInteriaTensor;
 			}
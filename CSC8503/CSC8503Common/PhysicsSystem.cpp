@@ -8,10 +8,15 @@
 
 #include "Debug.h"
 
+#include <cfloat>
 #include <functional>
 using namespace NCL;
 using namespace CSC8503;
 
+//This is the fixed timestep we'd LIKE to have
+const int   idealHZ = 120;
+const float idealDT = 1.0f / idealHZ;
+
 /*
 
 These two variables help define the relationship between positions
@@ -19,16 +24,14 @@ and the forces that are added to objects to change those positions
 
 */
 
-PhysicsSystem::PhysicsSystem(GameWorld& g) : gameWorld(g)	{
+PhysicsSystem::PhysicsSystem(GameWorld& g, JobSystem& j) : gameWorld(g), jobs(j)	{
 	applyGravity	= false;
 	useBroadPhase	= true;	
 	useSleep = false;
 	usingPenalty = true;
-	if (useBroadPhase) {
-		tree = new QuadTree<GameObject*>(Vector2(1024, 1024), 7, 6);
-
-	}
 	dTOffset		= 0.0f;
+	realHZ			= idealHZ;
+	realDT			= idealDT;
 	globalDamping	= 0.995f;
 	SetGravity(Vector3(0.0f, -9.8f, 0.0f));
 	linearDamping = 0.4f;
@@ -55,46 +58,45 @@ any collisions they are in.
 */
 void PhysicsSystem::Clear() {
 	allCollisions.clear();
+	ClearBroadphase();
 }
 
-/*
-
-This is the core of the physics engine update
+void PhysicsSystem::ClearBroadphase() {
+	for (GameObject* o : proxyObjects) {
+		if (o) {
+			o->SetBroadphaseProxy(-1);
+		}
+	}
+	proxyObjects.clear();
+	broadphase.Clear();
+	broadphaseCollisions.clear();
+	contactCache.Clear();
+}
 
-*/
-int constraintIterationCount = 10;
+void PhysicsSystem::RemoveFromBroadphase(GameObject* o) {
+	const int proxy = o->GetBroadphaseProxy();
+	if (proxy < 0) {
+		return;
+	}
+	broadphase.RemoveProxy(proxy);
+	proxyObjects[proxy] = nullptr;
+	o->SetBroadphaseProxy(-1);
+}
 
-//This is the fixed timestep we'd LIKE to have
-const int   idealHZ = 120;
-const float idealDT = 1.0f / idealHZ;
+vector<GameObject*> PhysicsSystem::BuildRayCollisionList(const Ray& r) const {
+	vector<GameObject*> objects;
+	broadphase.GetTree().RayCast(r.GetPosition(), r.GetDirection(), FLT_MAX, [&](int proxy) {
+		objects.push_back(proxyObjects[proxy]);
+	});
+	return objects;
+}
 
 /*
-This is the fixed update we actually have...
-If physics takes too long it starts to kill the framerate, it'll drop the 
-iteration count down until the FPS stabilises, even if that ends up
-being at a low rate. 
-*/
-int realHZ		= idealHZ;
-float realDT	= idealDT;
 
-void PhysicsSystem::Update(float dt) {	
-	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::B)) {
-		useBroadPhase = !useBroadPhase;
-		std::cout << "Setting broadphase to " << useBroadPhase << std::endl;
-	}
-	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::I)) {
-		constraintIterationCount--;
-		std::cout << "Setting constraint iterations to " << constraintIterationCount << std::endl;
-	}
-	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::O)) {
-		constraintIterationCount++;
-		std::cout << "Setting constraint iterations to " << constraintIterationCount << std::endl;
-	}
-	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::P)) {
-		useSleep = !useSleep;
-		std::cout << "Setting sleeping to " << useSleep << std::endl;
-	}
+This is the core of the physics engine update
 
+*/
+void PhysicsSystem::Update(float dt) {	
 	dTOffset += dt; //We accumulate time delta here - there might be remainders from previous frame!
 
 	GameTimer t;
@@ -104,6 +106,10 @@ void PhysicsSystem::Update(float dt) {
 		UpdateObjectAABBs();
 	}
 
+	const bool stepping = dTOffset >= realDT;
+	if (stepping) {
+		LoadRigidBodies();
+	}
 	while(dTOffset >= realDT) {
 		IntegrateAccel(realDT); //Update accelerations from external forces
 		if (useBroadPhase) {
@@ -113,6 +119,8 @@ void PhysicsSystem::Update(float dt) {
 		else {
 			BasicCollisionDetection();
 		}
+		BuildIslands();
+		ResolveContacts(realDT);
 		if (usingPenalty) {
 			IntegrateAccel(realDT, true);
 		}
@@ -120,14 +128,15 @@ void PhysicsSystem::Update(float dt) {
 		//we just run things multiple times, slowly moving things forward
 		//and then rechecking that the constraints have been met		
 		float constraintDt = realDT /  (float)constraintIterationCount;
-		for (int i = 0; i < constraintIterationCount; ++i) {
-			UpdateConstraints(constraintDt);	
-		}
+		UpdateConstraints(constraintDt, constraintIterationCount);
 		
 		IntegrateVelocity(realDT); //update positions from new velocity changes
 
 		dTOffset -= realDT;
 	}
+	if (stepping) {
+		StoreRigidBodies();
+	}
 	if (useSleep) {
 		UpdateSleepingObjects();
 	}
@@ -139,6 +148,9 @@ void PhysicsSystem::Update(float dt) {
 	t.Tick();
 	float updateTime = t.GetTimeDeltaSeconds();
 
+	if (!adaptiveRate) {
+		return;
+	}
 	//Uh oh, physics is taking too long...
 	if (updateTime > realDT) {
 		realHZ /= 2;
@@ -256,6 +268,7 @@ a particular pair will only be added once, so objects colliding for
 multiple frames won't flood the set with duplicates.
 */
 void PhysicsSystem::BasicCollisionDetection() {
+	contacts.clear();
 	std::vector < GameObject* >::const_iterator first;
 	std::vector < GameObject* >::const_iterator last;
 	gameWorld.GetObjectIterators(first, last);
@@ -271,113 +284,28 @@ void PhysicsSystem::BasicCollisionDetection() {
 			if (CollisionDetection::ObjectIntersection(*i, *j, info)) {
 				std::cout << " Collision between " << (*i)->GetName()
 					<< " and " << (*j)->GetName() << std::endl;
-				if ((*i)->IsSpring() || (*j)->IsSpring()) {
-					PenaltyResolveCollision(*info.a, *info.b, info.point);
-				}
-				ImpulseResolveCollision(*info.a, *info.b, info.point);
 				info.framesLeft = numCollisionFrames;
+				contacts.push_back(info);
 				allCollisions.insert(info);
 				
 			}
 		}
 	}
+	UpdateManifolds();
 }
 
 /*
 
-In tutorial 5, we start determining the correct response to a collision,
-so that objects separate back out. 
+Contacts with springy objects push them apart with a force, rather than an impulse,
+which the second IntegrateAccel of the substep turns into velocity.
 
 */
-void PhysicsSystem::ImpulseResolveCollision(GameObject& a, GameObject& b, CollisionDetection::ContactPoint& p) const {
-	PhysicsObject * physA = a.GetPhysicsObject();
-	PhysicsObject * physB = b.GetPhysicsObject();
-
+void PhysicsSystem::PenaltyResolveCollision(GameObject& a, GameObject& b, CollisionDetection::ContactPoint& p) {
+	PhysicsObject* physA = a.GetPhysicsObject();
+	PhysicsObject* physB = b.GetPhysicsObject();
 	if (physA == nullptr || physB == nullptr) {
 		return;
 	}
-	
-	Transform & transformA = a.GetTransform();
-	Transform & transformB = b.GetTransform();
-	
-	float totalMass = physA->GetInverseMass() + physB->GetInverseMass();
-	
-	if (totalMass == 0) {
-		return; //two static objects ??
-	}
-
-	const float allowedPenetration = 0.1f;
-
-	const float biasFactor = 0.1f;
-	float bias = biasFactor * (std::max)(0.0f, p.penetration - allowedPenetration);
-
-	// Separate them out using projection
-	transformA.SetPosition(transformA.GetPosition() -
-			(p.normal * p.penetration * (physA->GetInverseMass() / totalMass)));
-	transformB.SetPosition(transformB.GetPosition() +
-			(p.normal * p.penetration * (physB->GetInverseMass() / totalMass)));
-
-	Vector3 relativeA = p.localA;
-	Vector3 relativeB = p.localB;
-	
-	Vector3 angVelocityA = Vector3::Cross(physA->GetAngularVelocity(), relativeA);
-	Vector3 angVelocityB = Vector3::Cross(physB->GetAngularVelocity(), relativeB);
-	
-	Vector3 fullVelocityA = physA->GetLinearVelocity() + angVelocityA;
-	Vector3 fullVelocityB = physB->GetLinearVelocity() + angVelocityB;
-
-
-	Vector3 contactVelocity = fullVelocityB - fullVelocityA;
-
-	float impulseForce = Vector3::Dot(contactVelocity, p.normal);
-	
-	if (-impulseForce < -0.01f) {
-		return;
-	}
-
-	//now to work out the effect of inertia ....
-	Vector3 inertiaA = Vector3::Cross(physA->GetInertiaTensor() * Vector3::Cross(relativeA, p.normal), relativeA);
-	Vector3 inertiaB = Vector3::Cross(physB->GetInertiaTensor() * Vector3::Cross(relativeB, p.normal), relativeB);
-	float angularEffect = Vector3::Dot(inertiaA + inertiaB, p.normal);
-	float cRestitution = (physA->GetElasticity() + physB->GetElasticity()) / 2; // disperse some kinectic energy
-	//float cFriction = physA->GetFriction() * physB->GetFriction();
-	float cFriction = (physA->GetFriction() + physB->GetFriction()) / 2;
-
-	//float massNormal = 1.0f / (totalMass + angularEffect);
-	//float dPn = massNormal * (-impulseForce + bias);
-	//dPn = max(dPn, 0.0f);
-	float j = ((-(1.0f + cRestitution) * impulseForce)) / (totalMass + angularEffect);
-	//j = max(j, 0.0f);
-	//j = j + (p.penetration * 1.5);
-
-	Vector3 tangent = (contactVelocity - (p.normal * impulseForce)).Normalised();
-	float frictionForce = Vector3::Dot(contactVelocity, tangent);
-	
-	Vector3 frictionInertiaA = Vector3::Cross(physA->GetInertiaTensor() * Vector3::Cross(relativeA, tangent), relativeA);
-	Vector3 frictionInertiaB = Vector3::Cross(physB->GetInertiaTensor() * Vector3::Cross(relativeB, tangent), relativeB);
-	float frictionAngularEffect = Vector3::Dot(frictionInertiaA + frictionInertiaB, tangent);
-
-	float jt = (-cFriction * frictionForce) / (totalMass + frictionAngularEffect);
-	float maxJt = cFriction * j;
-	jt = Maths::Clamp(jt, -maxJt, maxJt);  // Friction is proportional to impulse
-	
-	Vector3 frictionImpulse = tangent * jt;
-	Vector3 fullImpulse = (p.normal * j);
-	fullImpulse += frictionImpulse;
-
-	physA->ApplyLinearImpulse(-fullImpulse);
-	physB->ApplyLinearImpulse(fullImpulse);
-	physA->ApplyAngularImpulse(Vector3::Cross(relativeA, -fullImpulse));
-	physB->ApplyAngularImpulse(Vector3::Cross(relativeB, fullImpulse));
-}
-
-
-void PhysicsSystem::PenaltyResolveCollision(GameObject& a, GameObject& b, CollisionDetection::ContactPoint& p) const {
-	PhysicsObject* physA = a.GetPhysicsObject();
-	PhysicsObject* physB = b.GetPhysicsObject();
-
-	Transform& transformA = a.GetTransform();
-	Transform& transformB = b.GetTransform();
 
 	Vector3 springPosA = p.localA;
 	Vector3 springPosB = p.localB;
@@ -390,8 +318,14 @@ void PhysicsSystem::PenaltyResolveCollision(GameObject& a, GameObject& b, Collis
 
 	Vector3 fullforce = hookeX * -k;
 
-	physA->AddForceAtLocalPosition(fullforce, springPosA);
-	physB->AddForceAtLocalPosition(-fullforce, springPosB);
+	const int indexA = RigidBodyIndex(&a);
+	const int indexB = RigidBodyIndex(&b);
+	if (indexA >= 0 && rigidBodies.GetInverseMass(indexA) > 0.0f) {
+		rigidBodies.AddForceAtLocalPosition(indexA, fullforce, springPosA);
+	}
+	if (indexB >= 0 && rigidBodies.GetInverseMass(indexB) > 0.0f) {
+		rigidBodies.AddForceAtLocalPosition(indexB, -fullforce, springPosB);
+	}
 }
 
 /*
@@ -404,9 +338,6 @@ compare the collisions that we absolutely need to.
 */
 
 void PhysicsSystem::BroadPhase() {
-	broadphaseCollisions.clear();
-	tree->Clear();
-//	QuadTree <GameObject*> tree(Vector2(1024, 1024), 7, 6);
 	std::vector <GameObject*>::const_iterator first;
 	std::vector <GameObject*>::const_iterator last;
 	gameWorld.GetObjectIterators(first, last);
@@ -415,101 +346,358 @@ void PhysicsSystem::BroadPhase() {
 		if (!(*i)->GetBroadphaseAABB(halfSizes)) {
 			continue;
 		}
-		/*if ((*i)->GetPhysicsObject()) {
-			if ((*i)->GetPhysicsObject()->IsStatic()) { // Possible move IsStatic to GameObject
-				continue;
-			}
-		}*/
 		Vector3 pos = (*i)->GetTransform().GetPosition();
-		tree->Insert(*i, pos, halfSizes, (*i)->IsAsleep());
-	}
-	//tree.DebugDraw();
-	if (useSleep) {
-		bool a = true;
-	}
-	tree->OperateOnContents(
-		[&](std::list <QuadTreeEntry <GameObject*>>& data) {
-			CollisionDetection::CollisionInfo info;
-			for (auto i = data.begin(); i != data.end(); ++i) {
-				for (auto j = std::next(i); j != data.end(); ++j) {
-					//is this pair of items already in the collision set -
-					//if the same pair is in another quadtree node together etc
-					info.a = (std::min)((*i).object, (*j).object);
-					info.b = (std::max)((*i).object, (*j).object);
-					int layerMask = (*i).object->GetLayerMask() & (*j).object->GetLayerMask();
-					if (layerMask == 0) {
-						continue;
-					}
-					broadphaseCollisions.insert(info);
-				}
+		Physics::AABB box = { pos - halfSizes, pos + halfSizes };
+
+		int proxy = (*i)->GetBroadphaseProxy();
+		if (proxy < 0) {
+			proxy = broadphase.AddProxy(box);
+			(*i)->SetBroadphaseProxy(proxy);
+			if (proxy >= (int)proxyObjects.size()) {
+				proxyObjects.resize(proxy + 1);
 			}
-	});
-
-	// Static Objects
-	/*std::vector <GameObject*>::const_iterator first2;
-	std::vector <GameObject*>::const_iterator last2;
-	gameWorld.GetObjectIterators(first2, last2, true);
-	for (auto i = first2; i != last2; ++i) {
-		QuadTreeNode<GameObject*>* nodePointer = tree->GetNodeToInsert((*i));
-
-		//QuadTreeNode<GameObject*> node = nodePointer;
-		/*if (nodePointer != nullptr) {
-			nodePointer->OperateOnContents(
-				[&](std::list <QuadTreeEntry <GameObject*>>& data) {
-					CollisionDetection::CollisionInfo info;
-					for (auto j = data.begin(); j != data.end(); ++j) {
-						info.a = min((*i), (*j).object);
-						info.b = max((*i), (*j).object);
-						int layerMask = (*i)->GetLayerMask() & (*j).object->GetLayerMask();
-						if (layerMask == 0) {
-							continue;
-						}
-						broadphaseCollisions.insert(info);
-					}
-				
-			});
+			proxyObjects[proxy] = *i;
+			continue;
+		}
+		// Only reinserted in the tree if it's left its fat box
+		Vector3 displacement = rigidBodies.GetLinearVelocity((uint)(i - first)) * realDT;
+		broadphase.MoveProxy(proxy, box, displacement);
+	}
+	broadphase.UpdatePairs();
 
+	broadphaseCollisions.clear();
+	for (const Physics::BroadphasePair& pair : broadphase.GetPairs()) {
+		GameObject* a = proxyObjects[pair.proxyA];
+		GameObject* b = proxyObjects[pair.proxyB];
+		if ((a->GetLayerMask() & b->GetLayerMask()) == 0) {
+			continue;
 		}
-		if (nodePointer != nullptr) {
-			std::list< QuadTreeEntry<GameObject*>> objects = nodePointer->GetContents();
-			CollisionDetection::CollisionInfo info;
-			for (auto j = objects.begin(); j != objects.end(); ++j) {
-				info.a = min((*i), (*j).object);
-				info.b = max((*i), (*j).object);
-				int layerMask = (*i)->GetLayerMask() & (*j).object->GetLayerMask();
-				if (layerMask == 0) {
-					continue;
-				}
-				broadphaseCollisions.insert(info);
-			}
+		// Nothing to do until one of them wakes
+		if (a->IsAsleep() && b->IsAsleep()) {
+			continue;
 		}
-	}*/
-	
+		// Ordered by world ID rather than address, so each pair's normal points the same way every run
+		if (a->GetWorldID() > b->GetWorldID()) {
+			std::swap(a, b);
+		}
+		CollisionDetection::CollisionInfo info;
+		info.a = a;
+		info.b = b;
+		broadphaseCollisions.push_back(info);
+	}
 }
 
 /*
 
 The broadphase will now only give us likely collisions, so we can now go through them,
-and work out if they are truly colliding, and if so, add them into the main collision list
+and work out if they are truly colliding, and if so, add them into the main collision list.
+Every pair is tested against where things were at the start of the substep, spread over
+the job system, and each writes only to its own slot so the contacts come out in the same
+order however many threads there are. They're resolved afterwards, in ResolveContacts.
 */
 void PhysicsSystem::NarrowPhase() {
-	for (std::set <CollisionDetection::CollisionInfo >::iterator
-		i = broadphaseCollisions.begin();
-		i != broadphaseCollisions.end(); ++i) {
+	narrowphaseHits.resize(broadphaseCollisions.size());
+	jobs.ParallelFor((uint)broadphaseCollisions.size(), 64, [&](uint begin, uint end) {
+		for (uint i = begin; i < end; ++i) {
+			CollisionDetection::CollisionInfo& info = broadphaseCollisions[i];
+			narrowphaseHits[i] = CollisionDetection::ObjectIntersection(info.a, info.b, info);
+		}
+	});
 
-		CollisionDetection::CollisionInfo info = *i;
-		if (CollisionDetection::ObjectIntersection(info.a, info.b, info)) {
+	contacts.clear();
+	for (size_t i = 0; i < broadphaseCollisions.size(); ++i) {
+		if (narrowphaseHits[i]) {
+			CollisionDetection::CollisionInfo& info = broadphaseCollisions[i];
 			info.framesLeft = numCollisionFrames;
-			if (info.a->IsSpring() || info.b->IsSpring()) {
-				PenaltyResolveCollision(*info.a, *info.b, info.point);
+			contacts.push_back(info);
+			allCollisions.insert(info); // insert into our main set
+		}
+	}
+	UpdateManifolds();
+}
+
+void PhysicsSystem::UpdateManifolds() {
+	// Each pair's points from earlier steps are moved along with the objects, and this step's point added to them
+	++contactStep;
+	contactManifolds.resize(contacts.size());
+	for (size_t i = 0; i < contacts.size(); ++i) {
+		const uint64_t key = Physics::ContactCache::PairKey(contacts[i].a->GetWorldID(), contacts[i].b->GetWorldID());
+		contactManifolds[i] = &contactCache.Find(key, contactStep);
+	}
+	contactCache.RemoveStale(contactStep);
+
+	jobs.ParallelFor((uint)contacts.size(), 64, [&](uint begin, uint end) {
+		for (uint i = begin; i < end; ++i) {
+			const CollisionDetection::CollisionInfo& info = contacts[i];
+			const Transform& transformA = info.a->GetTransform();
+			const Transform& transformB = info.b->GetTransform();
+			Physics::ContactManifold& manifold = *contactManifolds[i];
+			manifold.Refresh(transformA.GetPosition(), transformA.GetOrientation(), transformB.GetPosition(), transformB.GetOrientation());
+			manifold.AddPoint(info.point.localA, info.point.localB, info.point.normal, info.point.penetration,
+				transformA.GetOrientation(), transformB.GetOrientation());
+		}
+	});
+}
+
+int PhysicsSystem::FindIsland(int object) {
+	while (islandParents[object] != object) {
+		islandParents[object] = islandParents[islandParents[object]];
+		object = islandParents[object];
+	}
+	return object;
+}
+
+/*
+Contacts and constraints only push apart objects that can move, so two of them
+are only connected if they share one of those. Each group of connected objects
+(an island) can be solved without touching any other, so islands are solved
+in parallel. Within an island, contacts and constraints keep the order they'd
+have had solved one after another, so the results don't depend on the thread count.
+*/
+void PhysicsSystem::BuildIslands() {
+	std::vector<GameObject*>::const_iterator first;
+	std::vector<GameObject*>::const_iterator last;
+	gameWorld.GetObjectIterators(first, last);
+	const int objectCount = (int)(last - first);
+
+	islandParents.resize(objectCount);
+	for (int i = 0; i < objectCount; ++i) {
+		islandParents[i] = i;
+	}
+
+	// -1 for objects nothing can move, or that have left the world
+	auto movableIndex = [&](GameObject* o) {
+		const int index = RigidBodyIndex(o);
+		return index >= 0 && rigidBodies.GetInverseMass(index) > 0.0f ? index : -1;
+	};
+	// Joins a and b's islands, returning an object in them, the lower root wins so it's the same every time
+	auto join = [&](GameObject* a, GameObject* b) {
+		const int indexA = movableIndex(a);
+		const int indexB = movableIndex(b);
+		if (indexA < 0 || indexB < 0) {
+			return indexA < 0 ? indexB : indexA;
+		}
+		const int rootA = FindIsland(indexA);
+		const int rootB = FindIsland(indexB);
+		islandParents[std::max(rootA, rootB)] = std::min(rootA, rootB);
+		return indexA;
+	};
+
+	std::vector<Constraint*>::const_iterator firstConstraint;
+	std::vector<Constraint*>::const_iterator lastConstraint;
+	gameWorld.GetConstraintIterators(firstConstraint, lastConstraint);
+	const uint constraintCount = (uint)(lastConstraint - firstConstraint);
+
+	contactIslands.resize(contacts.size());
+	for (size_t i = 0; i < contacts.size(); ++i) {
+		contactIslands[i] = join(contacts[i].a, contacts[i].b);
+	}
+	constraintIslands.resize(constraintCount);
+	for (uint i = 0; i < constraintCount; ++i) {
+		GameObject* a;
+		GameObject* b;
+		firstConstraint[i]->GetObjects(a, b);
+		constraintIslands[i] = join(a, b);
+	}
+
+	// Islands are numbered by their first contact or constraint
+	islandIndices.assign(objectCount, -1);
+	islandCount = 0;
+	auto number = [&](int& island) {
+		if (island < 0) {
+			return;
+		}
+		int& index = islandIndices[FindIsland(island)];
+		if (index < 0) {
+			index = (int)islandCount++;
+		}
+		island = index;
+	};
+	for (int& island : contactIslands) {
+		number(island);
+	}
+	for (int& island : constraintIslands) {
+		number(island);
+	}
+
+	// Counting sort by island, keeping each island's contacts and constraints in order
+	auto group = [&](const std::vector<int>& islands, std::vector<uint>& starts, auto&& add) {
+		starts.assign(islandCount + 1, 0);
+		for (int island : islands) {
+			if (island >= 0) {
+				++starts[island + 1];
 			}
-			else {
-				ImpulseResolveCollision(*info.a, *info.b, info.point);
+		}
+		for (uint i = 0; i < islandCount; ++i) {
+			starts[i + 1] += starts[i];
+		}
+		std::vector<uint> next(starts.begin(), starts.end() - 1);
+		for (uint i = 0; i < (uint)islands.size(); ++i) {
+			if (islands[i] >= 0) {
+				add(next[islands[i]]++, i);
 			}
-			allCollisions.insert(info); // insert into our main set
-			
+		}
+	};
+	islandContacts.resize(contactIslands.size());
+	group(contactIslands, islandContactStarts, [&](uint slot, uint contact) {
+		islandContacts[slot] = contact;
+	});
+	islandConstraints.resize(constraintIslands.size());
+	group(constraintIslands, islandConstraintStarts, [&](uint slot, uint constraint) {
+		islandConstraints[slot] = firstConstraint[constraint];
+	});
+}
+
+/*
+Contacts are solved with sequential impulses over every point of each pair's manifold.
+Each point starts from the impulse it ended last substep with, so resting objects are
+already held up before the first iteration, and a few iterations are enough to settle
+a stack that would take many more starting from nothing. Objects' velocities are copied
+out of rigidBodies into solverBodies first and back afterwards, so each island only
+touches its own.
+*/
+void PhysicsSystem::ResolveContacts(float dt) {
+	std::vector<GameObject*>::const_iterator first;
+	std::vector<GameObject*>::const_iterator last;
+	gameWorld.GetObjectIterators(first, last);
+	const uint objectCount = (uint)(last - first);
+
+	solverBodies.resize(objectCount + 1);
+	jobs.ParallelFor(objectCount + 1, 256, [&](uint begin, uint end) {
+		for (uint i = begin; i < end; ++i) {
+			Physics::SolverBody& body = solverBodies[i];
+			if (i == objectCount || rigidBodies.GetInverseMass(i) == 0.0f) {
+				body.linearVelocity = i < objectCount ? rigidBodies.GetLinearVelocity(i) : Vector3();
+				body.angularVelocity = i < objectCount ? rigidBodies.GetAngularVelocity(i) : Vector3();
+				body.inverseInertia = Matrix3::Scale(Vector3(0, 0, 0));
+				body.inverseMass = 0.0f;
+				continue;
+			}
+			body.linearVelocity = rigidBodies.GetLinearVelocity(i);
+			body.angularVelocity = rigidBodies.GetAngularVelocity(i);
+			body.inverseMass = rigidBodies.GetInverseMass(i);
+			body.inverseInertia = rigidBodies.GetInverseInertiaTensor(i);
+		}
+	});
+
+	auto bodyIndex = [&](GameObject* o) {
+		const int index = RigidBodyIndex(o);
+		return index >= 0 ? (uint)index : objectCount;
+	};
+
+	// Laid out island by island, in the order the islands' contacts were found
+	contactSolver.Clear();
+	islandSolverStarts.resize(islandCount + 1);
+	for (uint island = 0; island < islandCount; ++island) {
+		islandSolverStarts[island] = contactSolver.GetContactCount();
+		for (uint i = islandContactStarts[island]; i < islandContactStarts[island + 1]; ++i) {
+			const uint contact = islandContacts[i];
+			const CollisionDetection::CollisionInfo& info = contacts[contact];
+			PhysicsObject* physA = info.a->GetPhysicsObject();
+			PhysicsObject* physB = info.b->GetPhysicsObject();
+			if (info.a->IsSpring() || info.b->IsSpring() || physA == nullptr || physB == nullptr) {
+				continue;
+			}
+			const float friction = (physA->GetFriction() + physB->GetFriction()) / 2;
+			const float restitution = (physA->GetElasticity() + physB->GetElasticity()) / 2;
+			contactSolver.AddManifold(*contactManifolds[contact], bodyIndex(info.a), bodyIndex(info.b), friction, restitution);
 		}
 	}
+	islandSolverStarts[islandCount] = contactSolver.GetContactCount();
+
+	jobs.ParallelFor(islandCount, 8, [&](uint begin, uint end) {
+		for (uint island = begin; island < end; ++island) {
+			for (uint i = islandContactStarts[island]; i < islandContactStarts[island + 1]; ++i) {
+				CollisionDetection::CollisionInfo& info = contacts[islandContacts[i]];
+				if (info.a->IsSpring() || info.b->IsSpring()) {
+					PenaltyResolveCollision(*info.a, *info.b, info.point);
+				}
+			}
+			const uint solverFirst = islandSolverStarts[island];
+			const uint solverLast = islandSolverStarts[island + 1];
+			contactSolver.Prepare(solverBodies, solverFirst, solverLast, dt);
+			contactSolver.WarmStart(solverBodies, solverFirst, solverLast);
+			for (int iteration = 0; iteration < contactIterationCount; ++iteration) {
+				contactSolver.Solve(solverBodies, solverFirst, solverLast);
+			}
+			contactSolver.StoreImpulses(solverFirst, solverLast);
+		}
+	});
+
+	jobs.ParallelFor(objectCount, 256, [&](uint begin, uint end) {
+		for (uint i = begin; i < end; ++i) {
+			if (rigidBodies.GetInverseMass(i) > 0.0f) {
+				rigidBodies.SetLinearVelocity(i, solverBodies[i].linearVelocity);
+				rigidBodies.SetAngularVelocity(i, solverBodies[i].angularVelocity);
+			}
+		}
+	});
+}
+
+/*
+Each substep integrates, collides and solves over rigidBodies, which keeps every
+object's state in flat arrays rather than behind its GameObject, so objects are
+only visited once at each end of an update. Positions are still written out to the
+transforms after every substep, as collision detection reads them from there.
+*/
+void PhysicsSystem::LoadRigidBodies() {
+	std::vector<GameObject*>::const_iterator first;
+	std::vector<GameObject*>::const_iterator last;
+	gameWorld.GetObjectIterators(first, last);
+	const uint objectCount = (uint)(last - first);
+
+	rigidBodies.Resize(objectCount);
+	jobs.ParallelFor(objectCount, 256, [&](uint begin, uint end) {
+		for (uint i = begin; i < end; ++i) {
+			GameObject* o = first[i];
+			o->SetSolverIndex(i);
+			const Transform& transform = o->GetTransform();
+
+			Physics::RigidBody body = {};
+			body.position = transform.GetPosition();
+			body.orientation = transform.GetOrientation();
+			PhysicsObject* object = o->GetPhysicsObject();
+			if (object) {
+				body.linearVelocity = object->GetLinearVelocity();
+				body.angularVelocity = object->GetAngularVelocity();
+				body.force = object->GetForce();
+				body.torque = object->GetTorque();
+				body.inverseMass = object->GetInverseMass();
+				body.linearDamping = object->GetLinearDamping();
+				body.angularDamping = object->GetAngularDamping();
+				// An AABB's collision volume can't turn, so nothing should spin it
+				const CollisionVolume* volume = o->GetBoundingVolume();
+				body.inverseInertia = volume && volume->type == VolumeType::AABB ? Vector3(0, 0, 0) : object->GetInverseInertia();
+				body.active = !o->IsAsleep();
+			}
+			rigidBodies.SetBody(i, body);
+		}
+	});
+}
+
+void PhysicsSystem::StoreRigidBodies() {
+	std::vector<GameObject*>::const_iterator first;
+	std::vector<GameObject*>::const_iterator last;
+	gameWorld.GetObjectIterators(first, last);
+
+	jobs.ParallelFor(rigidBodies.GetBodyCount(), 256, [&](uint begin, uint end) {
+		for (uint i = begin; i < end; ++i) {
+			PhysicsObject* object = first[i]->GetPhysicsObject();
+			if (object) {
+				object->SetLinearVelocity(rigidBodies.GetLinearVelocity(i));
+				object->SetAngularVelocity(rigidBodies.GetAngularVelocity(i));
+				object->UpdateInertiaTensor();
+			}
+		}
+	});
+}
+
+int PhysicsSystem::RigidBodyIndex(const GameObject* o) const {
+	std::vector<GameObject*>::const_iterator first;
+	std::vector<GameObject*>::const_iterator last;
+	gameWorld.GetObjectIterators(first, last);
+	const int index = o->GetSolverIndex();
+	return index >= 0 && index < (int)(last - first) && first[index] == o ? index : -1;
 }
 
 /*
@@ -522,42 +710,10 @@ based on any forces that have been accumulated in the objects during
 the course of the previous game frame.
 */
 void PhysicsSystem::IntegrateAccel(float dt, bool penalty) {
-	std::vector < GameObject* >::const_iterator first;
-	std::vector < GameObject* >::const_iterator last;
-	gameWorld.GetObjectIterators(first, last);
-	
-	for (auto i = first; i != last; ++i) {
-		/*if (penalty && !(*i)->IsSpring()) {
-			continue;
-		}*/
-		PhysicsObject * object = (*i)->GetPhysicsObject();
-		if (object == nullptr || (*i)->IsAsleep()) {
-			continue; 
-		}
-		float inverseMass = object->GetInverseMass();
-		
-	    Vector3 linearVel = object->GetLinearVelocity();
-		Vector3 force = object->GetForce();
-		Vector3 accel = force * inverseMass;
-		
-		if (applyGravity && inverseMass > 0 && !(*i)->IsAsleep()) {
-			accel += gravity; // don't move infinitely heavy things
-			
-		}
-		
-		linearVel += accel * dt; // integrate accel !
-		object->SetLinearVelocity(linearVel);
-
-		Vector3 torque = object->GetTorque();
-		Vector3 angVel = object->GetAngularVelocity();
-		
-		object->UpdateInertiaTensor(); // update tensor vs orientation
-		
-		Vector3 angAccel = object->GetInertiaTensor() * torque;
-	
-		angVel += angAccel * dt; // integrate angular accel !
-		object->SetAngularVelocity(angVel);
-	}
+	const Vector3 accel = applyGravity ? gravity : Vector3(0, 0, 0);
+	jobs.ParallelFor(rigidBodies.GetBodyCount(), 256, [&](uint begin, uint end) {
+		rigidBodies.IntegrateAccel(dt, accel, begin, end);
+	});
 }
 /*
 This function integrates linear and angular velocity into
@@ -569,42 +725,18 @@ void PhysicsSystem::IntegrateVelocity(float dt) {
 	std::vector < GameObject* >::const_iterator first;
 	std::vector < GameObject* >::const_iterator last;
 	gameWorld.GetObjectIterators(first, last);
-	
-	for (auto i = first; i != last; ++i) {
-		PhysicsObject * object = (*i)->GetPhysicsObject();
-		if (object == nullptr || (*i)->IsAsleep()) {
-			continue;
-		}
-		float frameLinearDamping = 1.0f - (object->GetLinearDamping() * dt);
-
-		Transform & transform = (*i)->GetTransform();
-		// Position Stuff
-		Vector3 position = transform.GetPosition();
-		Vector3 linearVel = object->GetLinearVelocity();
-		position += linearVel * dt;
-		transform.SetPosition(position);
-		// Linear Damping
-		linearVel = linearVel * frameLinearDamping;
-		object->SetLinearVelocity(linearVel);
-		
-		Quaternion orientation = transform.GetOrientation();
-		Vector3 angVel = object->GetAngularVelocity();
 
-		if (angVel.x > 0 || angVel.y > 0 || angVel.z > 0) {
-			//std::cout << "Hello";
+	jobs.ParallelFor(rigidBodies.GetBodyCount(), 256, [&](uint begin, uint end) {
+		rigidBodies.IntegrateVelocity(dt, begin, end);
+		// Collision detection, constraints and rendering all read positions from the transforms
+		for (uint i = begin; i < end; ++i) {
+			if (rigidBodies.IsActive(i)) {
+				Transform& transform = first[i]->GetTransform();
+				transform.SetPosition(rigidBodies.GetPosition(i));
+				transform.SetOrientation(rigidBodies.GetOrientation(i));
+			}
 		}
-		
-		orientation = orientation + 
-			(Quaternion(angVel * dt * 0.5f, 0.0f) * orientation);
-		orientation.Normalise();
-		
-		transform.SetOrientation(orientation);
-		
-		// Damp the angular velocity too
-		float frameAngularDamping = 1.0f - (object->GetAngularDamping() * dt);
-		angVel = angVel * frameAngularDamping;
-		object->SetAngularVelocity(angVel);
-	}
+	});
 }
 
 /*
@@ -629,14 +761,51 @@ void PhysicsSystem::ClearForces() {
 As part of the final physics tutorials, we add in the ability
 to constrain objects based on some extra calculation, allowing
 us to model springs and ropes etc. 
+Each island runs all its iterations in one go, as no other island's
+constraints can change anything it reads. Constraints work on the objects
+themselves, so the island's objects are synced with rigidBodies either side.
 
 */
-void PhysicsSystem::UpdateConstraints(float dt) {
-	std::vector<Constraint*>::const_iterator first;
-	std::vector<Constraint*>::const_iterator last;
-	gameWorld.GetConstraintIterators(first, last);
-
-	for (auto i = first; i != last; ++i) {
-		(*i)->UpdateConstraint(dt);
-	}
+void PhysicsSystem::UpdateConstraints(float dt, int iterations) {
+	jobs.ParallelFor(islandCount, 8, [&](uint begin, uint end) {
+		for (uint island = begin; island < end; ++island) {
+			const uint firstConstraint = islandConstraintStarts[island];
+			const uint lastConstraint = islandConstraintStarts[island + 1];
+			if (firstConstraint == lastConstraint) {
+				continue;
+			}
+			// Only the objects that can move are in the island, and only they are written to
+			auto sync = [&](bool toObjects) {
+				for (uint i = firstConstraint; i < lastConstraint; ++i) {
+					GameObject* objects[2];
+					islandConstraints[i]->GetObjects(objects[0], objects[1]);
+					for (GameObject* o : objects) {
+						const int index = RigidBodyIndex(o);
+						if (index < 0 || rigidBodies.GetInverseMass(index) == 0.0f) {
+							continue;
+						}
+						PhysicsObject* object = o->GetPhysicsObject();
+						if (toObjects) {
+							object->SetLinearVelocity(rigidBodies.GetLinearVelocity(index));
+							object->SetAngularVelocity(rigidBodies.GetAngularVelocity(index));
+							object->UpdateInertiaTensor();
+						}
+						else {
+							rigidBodies.SetLinearVelocity(index, object->GetLinearVelocity());
+							rigidBodies.SetAngularVelocity(index, object->GetAngularVelocity());
+							rigidBodies.SetPosition(index, o->GetTransform().GetPosition());
+							rigidBodies.SetOrientation(index, o->GetTransform().GetOrientation());
+						}
+					}
+				}
+			};
+			sync(true);
+			for (int iteration = 0; iteration < iterations; ++iteration) {
+				for (uint i = firstConstraint; i < lastConstraint; ++i) {
+					islandConstraints[i]->UpdateConstraint(dt);
+				}
+			}
+			sync(false);
+		}
+	});
 }
\ No newline at end of file
@@ -1,14 +1,18 @@
 #pragma once
 #include "../CSC8503Common/GameWorld.h"
 #include "CollisionDetection.h"
-#include "QuadTree.h"
+#include "Core/Jobs/JobSystem.h"
+#include "Physics/Broadphase.h"
+#include "Physics/ContactSolver.h"
+#include "Physics/RigidBodyStore.h"
 #include <set>
+#include <vector>
 
 namespace NCL {
 	namespace CSC8503 {
 		class PhysicsSystem	{
 		public:
-			PhysicsSystem(GameWorld& g);
+			PhysicsSystem(GameWorld& g, JobSystem& jobs = JobSystem::Get());
 			~PhysicsSystem();
 
 			void Clear();
@@ -19,6 +23,26 @@ namespace NCL {
 				applyGravity = state;
 			}
 
+			void UseBroadPhase(bool state) {
+				useBroadPhase = state;
+			}
+			bool IsUsingBroadPhase() const {
+				return useBroadPhase;
+			}
+
+			void UseSleep(bool state) {
+				useSleep = state;
+			}
+			bool IsUsingSleep() const {
+				return useSleep;
+			}
+
+			// On by default, halving the step rate while steps take longer than they simulate and raising it back
+			// after. Off, Update always steps at 120Hz, so the same inputs step the same however long they take.
+			void UseAdaptiveRate(bool state) {
+				adaptiveRate = state;
+			}
+
 			void SetGlobalDamping(float d) {
 				globalDamping = d;
 			}
@@ -27,8 +51,37 @@ namespace NCL {
 			void SetLinearDamping(float d) { linearDamping = d; }
 
 			void SetGravity(const Vector3& g);
-			QuadTree<GameObject*>* GetQuadTree() {
-				return tree;
+
+			// Objects whose broadphase boxes the ray passes through, as of the last step
+			vector<GameObject*> BuildRayCollisionList(const Ray& r) const;
+
+			// GameWorld calls these as objects leave it, objects join the broadphase on their first step
+			void RemoveFromBroadphase(GameObject* o);
+			void ClearBroadphase();
+
+			const Physics::Broadphase& GetBroadphase() const {
+				return broadphase;
+			}
+
+			// 0 is one per hardware thread. A step comes out the same at any count. Restarts the shared JobSystem,
+			// so everything else on it gets the same count.
+			void SetThreadCount(uint count) {
+				jobs.SetThreadCount(count);
+			}
+
+			// Solver passes over each island's contacts per substep, which start from last substep's impulses
+			void SetContactIterations(int iterations) {
+				contactIterationCount = iterations;
+			}
+			int GetContactIterations() const {
+				return contactIterationCount;
+			}
+
+			void SetConstraintIterations(int iterations) {
+				constraintIterationCount = iterations;
+			}
+			int GetConstraintIterations() const {
+				return constraintIterationCount;
 			}
 		
 		protected:
@@ -38,18 +91,30 @@ namespace NCL {
 
 			void ClearForces();
 
+			// Copies every object's state into rigidBodies before the substeps, and its velocities back after
+			void LoadRigidBodies();
+			void StoreRigidBodies();
+			// The object's index in rigidBodies, -1 if it's not in the world
+			int RigidBodyIndex(const GameObject* o) const;
+
 			void IntegrateAccel(float dt, bool penalty = false);
 			void IntegrateVelocity(float dt);
 
-			void UpdateConstraints(float dt);
+			// Groups the objects that contacts and constraints tie together into islands, that can be solved at once
+			void BuildIslands();
+			void ResolveContacts(float dt);
+			void UpdateConstraints(float dt, int iterations);
+			// Adds this substep's contacts to their pairs' manifolds
+			void UpdateManifolds();
 
 			void UpdateCollisionList();
 			void UpdateObjectAABBs();
 			void UpdateSleepingObjects();
 			void BuildStaticList();
 
-			void ImpulseResolveCollision(GameObject& a , GameObject&b, CollisionDetection::ContactPoint& p) const;
-			void PenaltyResolveCollision(GameObject& a, GameObject& b, CollisionDetection::ContactPoint& p) const;
+			int FindIsland(int object);
+
+			void PenaltyResolveCollision(GameObject& a, GameObject& b, CollisionDetection::ContactPoint& p);
 
 			GameWorld& gameWorld;
 
@@ -58,18 +123,65 @@ namespace NCL {
 			Vector3 gravity;
 			float sleepEpsilon;
 			float	dTOffset;
+			/*
+			This is the fixed update we actually have...
+			If physics takes too long it starts to kill the framerate, it'll drop the 
+			iteration count down until the FPS stabilises, even if that ends up
+			being at a low rate. 
+			*/
+			int		realHZ;
+			float	realDT;
+			bool	adaptiveRate = true;
 			float	globalDamping;
 			float linearDamping;
 			bool usingPenalty;
 
 			std::set<CollisionDetection::CollisionInfo> allCollisions;
-			std::set<CollisionDetection::CollisionInfo> broadphaseCollisions;
+			std::vector<CollisionDetection::CollisionInfo> broadphaseCollisions;
+			// Per broadphase collision, whether NarrowPhase found it touching
+			std::vector<char> narrowphaseHits;
+			// This substep's contacts, in broadphase order
+			std::vector<CollisionDetection::CollisionInfo> contacts;
+			// Per contact, its pair's manifold in contactCache
+			std::vector<Physics::ContactManifold*> contactManifolds;
+			Physics::ContactCache contactCache;
+			uint contactStep = 0;
+
+			Physics::ContactSolver contactSolver;
+			// Per object in the world, by solver index, with a last one standing in for anything outside it
+			std::vector<Physics::SolverBody> solverBodies;
+			// Each island's range of contactSolver's contacts, island i's from its start to island i + 1's
+			std::vector<uint> islandSolverStarts;
 			std::vector<GameObject*> staticObjects;
-			QuadTree <GameObject*>* tree;
+
+			Physics::Broadphase broadphase;
+			// The object each broadphase proxy id belongs to
+			std::vector<GameObject*> proxyObjects;
+
+			JobSystem& jobs;
+
+			// Every object in the world, by solver index. Objects' velocities and forces are only read at the
+			// start of Update, and written back at the end, this is what the substeps between integrate.
+			Physics::RigidBodyStore rigidBodies;
+
+			// Per object, its parent in the island union-find
+			std::vector<int> islandParents;
+			std::vector<int> islandIndices;
+			// Per contact and constraint, the island it's solved in, -1 if neither object can move
+			std::vector<int> contactIslands;
+			std::vector<int> constraintIslands;
+			// Each island's contacts and constraints, island i's from its start to island i + 1's
+			std::vector<uint> islandContactStarts;
+			std::vector<uint> islandContacts;
+			std::vector<uint> islandConstraintStarts;
+			std::vector<Constraint*> islandConstraints;
+			uint islandCount = 0;
 
 
 			bool useBroadPhase		= true;
 			int numCollisionFrames	= 5;
+			int contactIterationCount = 4;
+			int constraintIterationCount = 10;
 		};
 	}
 }
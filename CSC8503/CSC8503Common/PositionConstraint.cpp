@@ -33,8 +33,13 @@ void NCL::CSC8503::PositionConstraint::UpdateConstraint(float dt){
 			Vector3 aImpulse = offsetDir * lambda;
 			Vector3 bImpulse = -offsetDir * lambda;
 			
-			physA->ApplyLinearImpulse(aImpulse);// multiplied by mass here
-			physB->ApplyLinearImpulse(bImpulse);// multiplied by mass here
+			// Immovable objects can be shared by constraints solved on other threads, so they're left alone
+			if (physA->GetInverseMass() > 0.0f) {
+				physA->ApplyLinearImpulse(aImpulse);// multiplied by mass here
+			}
+			if (physB->GetInverseMass() > 0.0f) {
+				physB->ApplyLinearImpulse(bImpulse);// multiplied by mass here
+			}
 			
 		}
 	}
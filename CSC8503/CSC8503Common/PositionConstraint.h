@@ -15,6 +15,11 @@ namespace NCL {
 				~PositionConstraint() {}
 				
 				void UpdateConstraint(float dt) override;
+
+				void GetObjects(GameObject*& a, GameObject*& b) const override {
+					a = objectA;
+					b = objectB;
+				}
 				
 			protected:
 				GameObject * objectA;
@@ -1,3 +0,0 @@
-#include "QuadTree.h"
-#include "Common/Math/Vector3.h"
-using namespace NCL;
@@ -3,6 +3,8 @@
 #include "Common/Graphics/MeshGeometry.h"
 #include "../CSC8503Common/Transform.h"
 
+#include <algorithm>
+
 using namespace NCL::CSC8503;
 using namespace NCL;
 
@@ -15,6 +17,7 @@ RenderObject::RenderObject(Transform* parentTransform, MeshGeometry* mesh, Textu
 	textures.emplace_back(tex);
 	this->shader = shader;
 	this->colour = colour;
+	InitBoundingBox();
 }
 
 RenderObject::RenderObject(Transform* parentTransform, MeshGeometry* mesh, vector<TextureBase*> textures, ShaderBase* shader, Vector4 colour) {
@@ -24,6 +27,7 @@ RenderObject::RenderObject(Transform* parentTransform, MeshGeometry* mesh, vecto
 	this->texture = textures[0];
 	this->shader = shader;
 	this->colour = colour;
+	InitBoundingBox();
 }
 
 RenderObject::RenderObject(Transform* parentTransform, MeshGeometry* mesh, string material, ShaderBase* shader, Vector4 colour) {
@@ -37,12 +41,28 @@ RenderObject::RenderObject(Transform* parentTransform, MeshGeometry* mesh, strin
 	this->texture = textures[0];
 	this->shader = shader;
 	this->colour = colour;
+	InitBoundingBox();
 }
 
 RenderObject::~RenderObject() {
 
 }
 
+void RenderObject::InitBoundingBox() {
+	if (!mesh || mesh->GetPositionData().empty()) {
+		return;
+	}
+	Vector3 minBounds = mesh->GetPositionData()[0];
+	Vector3 maxBounds = minBounds;
+	for (const Vector3& position : mesh->GetPositionData()) {
+		for (int i = 0; i < 3; ++i) {
+			minBounds[i] = std::min(minBounds[i], position[i]);
+			maxBounds[i] = std::max(maxBounds[i], position[i]);
+		}
+	}
+	SetBoundingBox((minBounds + maxBounds) * 0.5f, (maxBounds - minBounds) * 0.5f);
+}
+
 void RenderObject::Update(float dt) {
 	/*if (parent) {
 		transform = Transform(parent->GetTransform()->GetMatrix() * localTransform->GetMatrix());
@@ -46,7 +46,7 @@ namespace NCL {
 				return nullptr;
 			}
 
-			vector<TextureBase*> GetTextures() const {
+			const vector<TextureBase*>& GetTextures() const {
 				return textures;
 			}
 
@@ -54,7 +54,7 @@ namespace NCL {
 				specularTextures = texes;
 			}
 
-			vector<TextureBase*> GetSpecTextures() const {
+			const vector<TextureBase*>& GetSpecTextures() const {
 				return specularTextures;
 			}
 
@@ -118,6 +118,17 @@ namespace NCL {
 			float GetBoundingRadius() const { return boundingRadius; }
 			void SetBoundingRadius(float f) { boundingRadius = f; }
 
+			// Local space box around the mesh, set from its positions when constructed. Frustum culling uses it
+			// instead of the bounding radius when there is one.
+			bool HasBoundingBox() const { return hasBoundingBox; }
+			const Maths::Vector3& GetBoundingBoxCentre() const { return boundingBoxCentre; }
+			const Maths::Vector3& GetBoundingBoxHalfSize() const { return boundingBoxHalfSize; }
+			void SetBoundingBox(const Maths::Vector3& centre, const Maths::Vector3& halfSize) {
+				boundingBoxCentre = centre;
+				boundingBoxHalfSize = halfSize;
+				hasBoundingBox = true;
+			}
+
 			float GetCameraDistance() const { return distanceFromCamera; }
 			void SetCameraDistance(float f) { distanceFromCamera = f; }
 
@@ -144,11 +155,13 @@ namespace NCL {
 				hasMask = val;
 			}
 
-			bool HasMask() {
+			bool HasMask() const {
 				return hasMask;
 			}
 
 		protected:
+			void InitBoundingBox();
+
 			MeshGeometry* mesh;
 			TextureBase* texture;
 			vector<TextureBase*> textures;
@@ -173,6 +186,9 @@ namespace NCL {
 
 			float distanceFromCamera;
 			float boundingRadius = 200;
+			Maths::Vector3 boundingBoxCentre;
+			Maths::Vector3 boundingBoxHalfSize;
+			bool hasBoundingBox = false;
 
 			static ResourceManager* manager;
 			float frameTime;
@@ -1,20 +1,36 @@
 #include "GameTechRenderer.h"
 
 #include "CSC8503Common/GameObject.h"
+#include "CSC8503Common/PhysicsObject.h"
 #include "Common/Math/Maths.h"
 #include "Common/Graphics/Camera.h"
 #include "Common/Graphics/TextureLoader.h"
+#include "Common/Graphics/StreamCompaction.h"
 #include "Common/Resources/Assets.h"
 #include "Core/Misc/Image.h"
+#include <algorithm>
+#include <bit>
 #include <cstddef>
+#include <cstring>
+#include <numeric>
+#include <span>
+#include <tuple>
 
 #include "Common/stb/stb_image.h"
 #include <random>
 
 #include "Assets/Shaders/Shared/ComputeBindings.h"
+#include "Assets/Shaders/Shared/DepthPyramidDefinitions.h"
+#include "Assets/Shaders/Shared/FrameDefinitions.h"
+#include "Assets/Shaders/Shared/IndirectDrawDefinitions.h"
 #include "Assets/Shaders/Shared/TextureBindings.h"
+#include "Assets/Shaders/Shared/UniformBindings.h"
 #include "Assets/Shaders/Shared/LightDefinitions.h"
+#include "Assets/Shaders/Shared/LightAnimationDefinitions.h"
 #include "Assets/Shaders/Shared/LightGridDefinitions.h"
+#include "Assets/Shaders/Shared/OcclusionDefinitions.h"
+#include "Assets/Shaders/Shared/PointShadowDefinitions.h"
+#include "Assets/Shaders/Shared/ShadowDefinitions.h"
 
 using namespace NCL;
 using namespace Rendering;
@@ -24,12 +40,65 @@ using namespace CSC8503;
 
 //const unsigned int MAX_LIGHTS = 49152;
 constexpr unsigned int MAX_LIGHTS = 98304;
+static_assert(MAX_LIGHTS <= LIGHT_BVH_MAX_LEAVES * LIGHT_BVH_LEAF_SIZE, "The light BVH buffers are sized for LIGHT_BVH_MAX_LEAVES");
+// While the lights move, the GPU path's LightBVH is re-sorted this often. Its bounds are refit on the GPU in between.
+constexpr unsigned int LIGHT_BVH_REBUILD_FRAMES = 16;
 
 constexpr Vector3 GameTechRenderer::LIGHT_MIN_BOUNDS;
 constexpr Vector3 GameTechRenderer::LIGHT_MAX_BOUNDS;
 
 Matrix4 biasMatrix = Matrix4::Translation(Vector3(0.5, 0.5, 0.5)) * Matrix4::Scale(Vector3(0.5, 0.5, 0.5));
 
+// Objects whose bounds cover less of the screen than this aren't worth rasterizing as CPU occluders
+constexpr float OCCLUDER_MIN_COVERAGE = 0.02f;
+// Most triangles rasterized as CPU occluders a frame, the largest occluders go first
+constexpr size_t OCCLUDER_TRIANGLE_BUDGET = 16384;
+
+namespace {
+	GLsizeiptr AlignUp(GLsizeiptr size, GLsizeiptr alignment) {
+		return (size + alignment - 1) / alignment * alignment;
+	}
+
+	// The same bounds BuildObjectList frustum culls with, as a world space box
+	void GetWorldBounds(const RenderObject& obj, Vector3& centre, Vector3& halfSize) {
+		const Transform* transform = obj.GetTransform();
+		if (obj.HasBoundingBox()) {
+			FrustumCuller::TransformBox(transform->GetMatrix(), obj.GetBoundingBoxCentre(), obj.GetBoundingBoxHalfSize(), centre, halfSize);
+		}
+		else {
+			const float radius = obj.GetBoundingRadius();
+			centre = transform->GetPosition();
+			halfSize = Vector3(radius, radius, radius);
+		}
+	}
+
+	// Changes whenever the view, or any occluder or where it is, changes, so the occlusion depth is redrawn
+	uint64_t OccluderVersion(uint64_t hash, std::span<const float> values) {
+		for (float f : values) {
+			hash = (hash ^ std::bit_cast<uint32_t>(f)) * 1099511628211ull;
+		}
+		return hash;
+	}
+
+	// Changes whenever the light moves or changes size, so its cached cube shadow is redrawn
+	uint64_t PointShadowVersion(const PointLight& light) {
+		uint64_t hash = 14695981039346656037ull;
+		for (float f : { light.pos.x, light.pos.y, light.pos.z, light.radius.x }) {
+			hash = (hash ^ std::bit_cast<uint32_t>(f)) * 1099511628211ull;
+		}
+		return hash;
+	}
+
+	// Everything but the bounds, which only the indirect draws' occlusion culling reads
+	ObjectData MakeObjectData(const RenderObject& obj) {
+		ObjectData object = {};
+		object.modelMatrix = obj.GetTransform()->GetMatrix();
+		object.colour = obj.GetColour();
+		object.flags = obj.GetMesh()->GetColourData().empty() ? 0 : OBJECT_FLAG_VERTEX_COLOURS;
+		return object;
+	}
+}
+
 GameTechRenderer::GameTechRenderer(GameWorld& w, ResourceManager* rm, int type, bool prepass)
 	: OGLRenderer(*Window::GetWindow()), gameWorld(w), renderMode(type), usingPrepass(prepass) {
 	//	glEnable(GL_DEPTH_TEST);
@@ -42,7 +111,8 @@ GameTechRenderer::GameTechRenderer(GameWorld& w, ResourceManager* rm, int type,
 	shadowShader = new OGLShader("GameTechShadowVert.vert", "GameTechShadowFrag.frag");
 	printShader = new OGLShader("PrinterVertex.vert", "PrinterFragment.frag");
 
-	//GenerateShadowBuffer(shadowFBO);
+	GenerateShadowMaps();
+	GeneratePointShadowAtlas();
 
 	glClearColor(1, 1, 1, 1);
 
@@ -59,6 +129,8 @@ GameTechRenderer::GameTechRenderer(GameWorld& w, ResourceManager* rm, int type,
 	aspect = (float)currentWidth / (float)currentHeight;
 	viewMat = gameWorld.GetMainCamera()->BuildViewMatrix();
 	projMat = gameWorld.GetMainCamera()->BuildProjectionMatrix(aspect);
+	// UploadFrameData replaces it with a bigger one if a frame needs more
+	uniformStream = std::make_unique<StreamingBuffer>(1 << 20);
 
 	InitLights(false);
 	//glEnable(GL_MULTISAMPLE);
@@ -92,6 +164,10 @@ void NCL::CSC8503::GameTechRenderer::InitLights(const bool addDebugLights /*fals
 	glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightSSBO);
 	glBufferData(GL_SHADER_STORAGE_BUFFER, MAX_LIGHTS * sizeof(PointLight), 0, GL_DYNAMIC_DRAW);
 
+	// A segment fits every light, so a full upload or CPU animated frame is one allocation
+	lightStream = std::make_unique<StreamingBuffer>(MAX_LIGHTS * sizeof(PointLight));
+	cpuLights.reserve(MAX_LIGHTS);
+
 	if (addDebugLights) {
 		Vector4 debugRadius = Vector4(40.0f, 0.0f, 0.0f, 0.0f);
 		std::vector<PointLight> debugLights = {
@@ -107,6 +183,16 @@ void NCL::CSC8503::GameTechRenderer::InitLights(const bool addDebugLights /*fals
 	glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
 	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 	sceneBuffers.push_back(lightSSBO);
+
+	lightAnimation = {};
+	lightAnimation.minBounds = Vector4(LIGHT_MIN_BOUNDS, 0.0f);
+	lightAnimation.maxBounds = Vector4(LIGHT_MAX_BOUNDS, 0.0f);
+	lightAnimation.orbitCentre = Vector4((LIGHT_MIN_BOUNDS + LIGHT_MAX_BOUNDS) * 0.5f, 0.0f);
+	lightAnimation.fallSpeed = 8.0f;
+	lightAnimation.orbitSpeed = 0.5f;
+	lightAnimation.flickerRate = 2.0f;
+	lightAnimation.flickerAmount = 0.5f;
+	lightAnimation.models = LIGHT_ANIMATION_FALL;
 }
 
 void GameTechRenderer::InitForward(bool withPrepass) {
@@ -115,6 +201,7 @@ void GameTechRenderer::InitForward(bool withPrepass) {
 	if (withPrepass) {
 		GenPrePassFBO();
 		depthPrepassShader = (OGLShader*)resourceManager->LoadShader("DepthPassVert.vert", "DepthPassFrag.frag");
+		InitIndirectDraws("");
 	}
 }
 
@@ -130,11 +217,6 @@ void GameTechRenderer::InitDeferred() {
 	sceneBuffers.push_back(bufferFBO);
 	sceneBuffers.push_back(pointLightFBO);
 
-	GLenum buffers[2] = {
-		GL_COLOR_ATTACHMENT0 ,
-		GL_COLOR_ATTACHMENT1
-	};
-
 	GLenum buffers2[3] = {
 		GL_COLOR_ATTACHMENT0 ,
 		GL_COLOR_ATTACHMENT1,
@@ -144,13 +226,14 @@ void GameTechRenderer::InitDeferred() {
 	//LoadPrinter();
 	//LoadStartImage();
 
-	GenerateScreenTexture(bufferDepthTex, true);
-	GenerateScreenTexture(bufferColourTex);
-	GenerateScreenTexture(bufferNormalTex);
+	const GBufferFormats& formats = GetGBufferFormats(gBufferLayout);
+	GenerateScreenTexture(bufferDepthTex, formats.depth.internalFormat);
+	GenerateScreenTexture(bufferColourTex, formats.albedo.internalFormat);
+	GenerateScreenTexture(bufferNormalTex, formats.normal.internalFormat);
 	//GenerateScreenTexture(bufferSpecTex);
 	//GenerateScreenTexture(bufferShadowTex);
-	GenerateScreenTexture(lightDiffuseTex);
-	GenerateScreenTexture(lightSpecularTex);
+	GenerateScreenTexture(lightDiffuseTex, formats.lightDiffuse.internalFormat);
+	GenerateScreenTexture(lightSpecularTex, formats.lightSpecular.internalFormat);
 
 	// And now attach them to our FBOs
 	// Binding our attachment textures to their respective FBO's, firstly the first FBO 
@@ -167,18 +250,15 @@ void GameTechRenderer::InitDeferred() {
 	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)  return;
 
 	// Setting up second FBO attachments
-	glBindFramebuffer(GL_FRAMEBUFFER, pointLightFBO);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, lightDiffuseTex, 0);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, lightSpecularTex, 0);
-	glDrawBuffers(2, buffers);
-
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) return;
-
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	AllocateGBuffer();
 	glEnable(GL_DEPTH_TEST);
 	glEnable(GL_CULL_FACE);
 	glEnable(GL_BLEND);
 
+	// Bins the lights into the same clusters as clustered shading, for DeferredLighting to read
+	deferredLightingShader = (OGLShader*)resourceManager->LoadShader("deferredLighting.comp");
+	InitClusterCulling();
+
 	loading = true;
 }
 
@@ -191,23 +271,15 @@ void GameTechRenderer::InitForwardPlus() {
 	forwardPlusCullShader = usingPrepass ? (OGLShader*)resourceManager->LoadShader("forwardplusCullAABB.comp") : (OGLShader*)resourceManager->LoadShader("forwardplusCull.comp");
 	depthPrepassShader = (OGLShader*)resourceManager->LoadShader("DepthPassVert.vert", "DepthPassFrag.frag");
 	debugShader = (OGLShader*)resourceManager->LoadShader("GameTechVert.vert", "forwardPlusDebugFrag.frag");
+	depthPyramid = std::make_unique<GpuDepthPyramid>(currentWidth, currentHeight);
+	InitIndirectDraws("forwardPlusFrag.frag");
 
 	tilesX = (currentWidth + (currentWidth % TILE_SIZE)) / TILE_SIZE;
 	tilesY = (currentHeight + (currentHeight % TILE_SIZE)) / TILE_SIZE;
 	//int sizeX = (unsigned int)std::ceilf(1920 / (float)TILE_SIZE);
 	//int sizey = (unsigned int)std::ceilf(1080/ (float)TILE_SIZE);
 	size_t numTiles = tilesX * tilesY;
-	glGenBuffers(1, &lightGridSSBO);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightGridSSBO);
-	//glBufferData(GL_SHADER_STORAGE_BUFFER, numTiles * 2 * sizeof(unsigned int), 0, GL_STATIC_COPY);
-	//glBufferData(GL_SHADER_STORAGE_BUFFER, numTiles * 2 * sizeof(unsigned int), 0, GL_STATIC_COPY);
-	//glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(LightGrid) * numTiles, NULL, GL_STATIC_COPY);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, numTiles * sizeof(int) * MAX_LIGHTS_PER_TILE, NULL, GL_STATIC_COPY);
-
-
-	//glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
-	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, lightGridSSBO);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	GenLightListBuffers(numTiles);
 
 
 	glGenBuffers(1, &aabbGridSSBO);
@@ -252,30 +324,38 @@ void GameTechRenderer::InitClustered(bool withPrepass) {
 		glGenBuffers(1, &activeClusterSSBO);
 		glBindBuffer(GL_SHADER_STORAGE_BUFFER, activeClusterSSBO);
 		glBufferData(GL_SHADER_STORAGE_BUFFER, numClusters * sizeof(unsigned int), NULL, GL_STATIC_COPY);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMPUTE_BINDING_TEST5, activeClusterSSBO);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMPUTE_BINDING_ACTIVE_CLUSTER_LIST, activeClusterSSBO);
 		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
-		glGenBuffers(1, &activeCountSSBO);
-		glBindBuffer(GL_SHADER_STORAGE_BUFFER, activeCountSSBO);
-		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int), NULL, GL_STATIC_COPY);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMPUTE_BINDING_TEST6, activeCountSSBO);
+		glGenBuffers(1, &activeClusterDispatchSSBO);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, activeClusterDispatchSSBO);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(DispatchIndirectCommand), NULL, GL_DYNAMIC_COPY);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMPUTE_BINDING_ACTIVE_CLUSTER_DISPATCH, activeClusterDispatchSSBO);
 		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		clusterCompact = std::make_unique<GpuCompact>();
+		depthPyramid = std::make_unique<GpuDepthPyramid>(currentWidth, currentHeight);
 		forwardPlusCullShader = (OGLShader*)resourceManager->LoadShader("clusterActiveCull.comp");
-	}
-	else {
-		forwardPlusCullShader = (OGLShader*)resourceManager->LoadShader("clusterCull.comp");
+		activeClusterCulling = true;
 	}
 
 	forwardPlusShader = (OGLShader*)resourceManager->LoadShader("GameTechVert.vert", "clusterFrag.frag");
-	forwardPlusGridShader = (OGLShader*)resourceManager->LoadShader("clusterGrid.comp");
+	InitIndirectDraws("clusterFrag.frag");
+	InitClusterCulling();
+}
 
-	glGenBuffers(1, &lightGridSSBO);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightGridSSBO);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, numClusters * sizeof(int) * MAX_LIGHTS_PER_TILE, NULL, GL_STATIC_COPY);
+void GameTechRenderer::InitClusterCulling() {
+	if (!activeClusterCulling) {
+		forwardPlusCullShader = (OGLShader*)resourceManager->LoadShader("clusterCull.comp");
+		useCPUCulling = !GLAD_GL_KHR_shader_subgroup;
+		CLOG_WARN(useCPUCulling, "GL_KHR_shader_subgroup not supported, culling clustered lights on the CPU");
+		lightBVHCullShader = (OGLShader*)resourceManager->LoadShader("clusterCullBVH.comp");
+		lightBVHRefitShader = (OGLShader*)resourceManager->LoadShader("lightBVHRefit.comp");
+		GenLightBVHBuffers();
+	}
 
+	forwardPlusGridShader = (OGLShader*)resourceManager->LoadShader("clusterGrid.comp");
 
-	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, lightGridSSBO);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	GenLightListBuffers(numClusters);
 
 
 	glGenBuffers(1, &aabbGridSSBO);
@@ -290,7 +370,7 @@ void GameTechRenderer::InitClustered(bool withPrepass) {
 
 	glBufferData(GL_SHADER_STORAGE_BUFFER, numClusters * sizeof(int), NULL, GL_STATIC_COPY);
 	//glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(LightGrid) * numTiles, NULL, GL_STATIC_COPY);
-	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, globalListSSBO);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMPUTE_BINDING_ACTIVE_CLUSTERS_BUFFER, globalListSSBO);
 	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
 	glGenBuffers(1, &globalCountSSBO);
@@ -321,40 +401,97 @@ void GameTechRenderer::InitClustered(bool withPrepass) {
 	clusterY = (unsigned int)std::ceilf(currentHeight / (float)CLUSTER_GRID_Y);
 
 	ComputeClusterGrid();
+
+	if (useCPUCulling) {
+		cpuCuller.BuildGrid(projMat.Inverse(), (float)currentWidth, (float)currentHeight, clusterX, clusterY, zNear, zFar);
+	}
 	//	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, aabbGridSSBO);
 }
 
 void GameTechRenderer::UpdateLights(float dt) {
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightSSBO);
-	PointLight* pointLights = (PointLight*) glMapBuffer(GL_SHADER_STORAGE_BUFFER, GL_READ_WRITE);
-
-	for (uint i = 0; i < numLights; i++) {
-		PointLight& light = pointLights[i];
-		//light.position.x = fmod((light.position.y + (-4.5f * lightDt) - min + max), max) + min;
-		//light.position.x = light.position.x;
-		float min = LIGHT_MIN_BOUNDS[1];
-		float max = LIGHT_MAX_BOUNDS[1];
+	NCL_GPU_SCOPE(profiler, "LightUpdate");
+	LightAnimationParams params = NextLightAnimation(dt);
+	if (numLights == 0) {
+		return;
+	}
 
-		light.pos.y = fmod((light.pos.y + (-8.0f * dt) - min + max), max) + min;
+	// Animates the CPU copy and streams it over lightSSBO. GetCPULights can be a couple of frames behind lights the
+	// GPU animated, so switching over from UpdateLightsGPU waits for the GPU once rather than moving them back.
+	if (cpuLightsStale) {
+		glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightSSBO);
+		glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, numLights * sizeof(PointLight), cpuLights.data());
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		cpuLightsStale = false;
 	}
+	lightAnimator.Animate(cpuLights, params);
+	++lightVersion;
 
-	glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	const StreamingBuffer::Allocation staging = lightStream->Allocate(numLights * sizeof(PointLight));
+	if (staging.data) {
+		std::memcpy(staging.data, cpuLights.data(), staging.size);
+		lightStream->CopyTo(lightSSBO, 0, staging);
+	}
+	else {
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightSSBO);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, numLights * sizeof(PointLight), cpuLights.data());
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
 }
 
 void GameTechRenderer::UpdateLightsGPU(float dt) {
+	NCL_GPU_SCOPE(profiler, "LightUpdate");
+	LightAnimationParams params = NextLightAnimation(dt);
+	if (numLights == 0) {
+		return;
+	}
+
+	const StreamingBuffer::Allocation paramBlock = lightStream->Allocate(sizeof(LightAnimationParams));
+	if (!paramBlock.data) {
+		return;
+	}
+	std::memcpy(paramBlock.data, &params, sizeof(LightAnimationParams));
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMPUTE_BINDING_LIGHT_BUFFER, lightSSBO);
+	lightStream->BindRange(GL_UNIFORM_BUFFER, UNIFORM_BINDING_LIGHT_ANIMATION, paramBlock);
 	BindShader(lightUpdateShader);
 
-	OGLShader* shader = lightUpdateShader;
+	glDispatchCompute((numLights + LIGHT_ANIMATION_GROUP_SIZE - 1) / LIGHT_ANIMATION_GROUP_SIZE, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	cpuLightsStale = true;
+	++lightVersion;
+
+	// Only copied out while something on the CPU reads the lights, GetCPULights picks it up a frame or two later
+	if (cpuLightsWanted) {
+		if (!lightReadback) {
+			lightReadback = std::make_unique<ReadbackBuffer>(MAX_LIGHTS * sizeof(PointLight));
+		}
+		lightReadback->Enqueue(lightSSBO, 0, numLights * sizeof(PointLight));
+		cpuLightsWanted = false;
+	}
+}
 
-	OGLShader::SetUniforms(shader,
-		"noOfLights", numLights,
-		"minBounds", LIGHT_MIN_BOUNDS,
-		"maxBounds", LIGHT_MAX_BOUNDS,
-		"dt", dt);
+void GameTechRenderer::SetLightAnimation(uint models) {
+	if ((lightAnimation.models & LIGHT_ANIMATION_FLICKER) && !(models & LIGHT_ANIMATION_FLICKER)) {
+		resetLightIntensity = true;
+	}
+	lightAnimation.models = models;
+}
 
-	glDispatchCompute(1, 1, 1);
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+LightAnimationParams GameTechRenderer::NextLightAnimation(float dt) {
+	lightAnimationTime += dt;
+
+	LightAnimationParams params = lightAnimation;
+	params.dt = dt;
+	params.time = lightAnimationTime;
+	params.lightCount = numLights;
+	if (resetLightIntensity) {
+		// A flicker with no dip sets every light's intensity back to 1
+		params.models |= LIGHT_ANIMATION_FLICKER;
+		params.flickerAmount = 0.0f;
+		resetLightIntensity = false;
+	}
+	return params;
 }
 
 bool GameTechRenderer::AddLights(uint n) {
@@ -398,6 +535,10 @@ GameTechRenderer::~GameTechRenderer() {
 	for (GLuint tex : sceneTextures) {
 		glDeleteTextures(1, &tex);
 	}
+	glDeleteBuffers(1, &culledCommandBuffer);
+	glDeleteBuffers(1, &objectVisibilityBuffer);
+	glDeleteBuffers(1, &pointShadowSlotSSBO);
+	glDeleteBuffers(1, &pointShadowSSBO);
 }
 
 void GameTechRenderer::ComputeTileGrid() {
@@ -416,15 +557,8 @@ void GameTechRenderer::ComputeTileGrid() {
 	glUniform1i(glGetUniformLocation(forwardPlusGridShader->GetProgramID(), "tilePxX"), sizeX);
 //	glUniform1f(glGetUniformLocation(forwardPlusGridShader->GetProgramID(), "near"), current->GetNearPlane());
 //	glUniform1f(glGetUniformLocation(forwardPlusGridShader->GetProgramID(), "far"), current->GetFarPlane());
-	/*unsigned int query;
-	GLuint64 timer;
-	glGenQueries(1, &query);
-	glBeginQuery(GL_TIME_ELAPSED, query);*/
+	NCL_GPU_SCOPE(profiler, "TileGrid");
 	glDispatchCompute(tilesX, tilesY, 1);
-	/*glEndQuery(GL_TIME_ELAPSED);
-	glGetQueryObjectui64v(query, GL_QUERY_RESULT, &timer);
-	float time = timer / 1000000.0;
-	std::printf("Time spent on the GPU: %f ms\n", time);*/
 
 	//glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 }
@@ -444,27 +578,23 @@ void GameTechRenderer::ComputeClusterGrid() {
 	glUniform1i(glGetUniformLocation(forwardPlusGridShader->GetProgramID(), "tilePxY"), clusterY);
 	glUniform1f(glGetUniformLocation(forwardPlusGridShader->GetProgramID(), "near"), current->GetNearPlane());
 	glUniform1f(glGetUniformLocation(forwardPlusGridShader->GetProgramID(), "far"), current->GetFarPlane());
-	unsigned int query;
-	GLuint64 timer;
-	glGenQueries(1, &query);
-	glBeginQuery(GL_TIME_ELAPSED, query);
+	NCL_GPU_SCOPE(profiler, "ClusterGrid");
 	glDispatchCompute(CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z);
-	glEndQuery(GL_TIME_ELAPSED);
-	glGetQueryObjectui64v(query, GL_QUERY_RESULT, &timer);
-	std::printf("Time spent on the GPU: %f ms\n", timer / 1000000.0);
 }
 
 void GameTechRenderer::ComputeActiveClusters() {
+	NCL_GPU_SCOPE(profiler, "ActiveClusters");
+	// activeClusters.comp only ever sets flags
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, globalListSSBO);
+	glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
 	OGLShader* activeShader = (OGLShader*) resourceManager->LoadShader("activeClusters.comp");
 	BindShader(activeShader);
 
-	glUniform1i(glGetUniformLocation(activeShader->GetProgramID(), "depthTex"), 0);
-	Cmds::BindTexture(0, bufferDepthTex);
-	//glActiveTexture(GL_TEXTURE1);
-	//glBindTexture(GL_TEXTURE_2D, 0);
-
-	// TODO: Support 2f etc in SetUniforms...
-	glUniform2f(glGetUniformLocation(activeShader->GetProgramID(), "pixelSize"), 1.0f / currentWidth, 1.0f / currentHeight);
+	glUniform1i(glGetUniformLocation(activeShader->GetProgramID(), "depthPyramid"), 0);
+	Cmds::BindTexture(0, depthPyramid->GetTexture());
+	glUniform2i(glGetUniformLocation(activeShader->GetProgramID(), "screenSize"), currentWidth, currentHeight);
 
 	OGLShader::SetUniforms(activeShader,
 		"projMatrix", projMat,
@@ -473,20 +603,60 @@ void GameTechRenderer::ComputeActiveClusters() {
 		"scale", clusterParams.scaleFactor,
 		"bias", clusterParams.biasFactor);
 
-	glDispatchCompute(currentWidth, currentHeight, 1);
-	//glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	// One thread per pyramid texel, each covering a block of pixels
+	const int levelWidth = depthPyramid->GetLevelWidth(DEPTH_PYRAMID_ACTIVE_CLUSTER_LEVEL);
+	const int levelHeight = depthPyramid->GetLevelHeight(DEPTH_PYRAMID_ACTIVE_CLUSTER_LEVEL);
+	glDispatchCompute((levelWidth + DEPTH_PYRAMID_GROUP_SIZE - 1) / DEPTH_PYRAMID_GROUP_SIZE,
+		(levelHeight + DEPTH_PYRAMID_GROUP_SIZE - 1) / DEPTH_PYRAMID_GROUP_SIZE, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 }
 
 void GameTechRenderer::CompactClusterList() {
-	OGLShader* activeShader = (OGLShader*)resourceManager->LoadShader("compactClusters.comp");	
-	BindShader(activeShader);
+	{
+		NCL_GPU_SCOPE(profiler, "Compaction");
+		// Scans the flags for each active cluster's slot, so the list comes out in cluster order every frame,
+		// and writes the culling dispatch's group count alongside it
+		clusterCompact->Compact(globalListSSBO, activeClusterSSBO, activeClusterDispatchSSBO, numClusters);
+	}
 
-	glDispatchCompute(CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z);
-	//glDispatchCompute(1, 1, 6);
-	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	if (checkCompaction) {
+		checkCompaction = false;
+		CheckCompaction();
+	}
+}
+
+void GameTechRenderer::CheckCompaction() {
+	std::vector<unsigned int> flags(numClusters);
+	std::vector<unsigned int> gpuList(numClusters);
+	DispatchIndirectCommand gpuDispatch;
+
+	// Stalls until the GPU catches up, this is a debugging aid only
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, globalListSSBO);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, numClusters * sizeof(unsigned int), flags.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, activeClusterSSBO);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, numClusters * sizeof(unsigned int), gpuList.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, activeClusterDispatchSSBO);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(DispatchIndirectCommand), &gpuDispatch);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	std::vector<unsigned int> cpuList;
+	const DispatchIndirectCommand cpuDispatch = CompactIndices(flags, cpuList);
+
+	if (gpuDispatch.numGroupsX != cpuDispatch.numGroupsX) {
+		LOG_WARN("{} GPU compacted {} active clusters, CPU compacted {}", __FUNCTION__, gpuDispatch.numGroupsX, cpuDispatch.numGroupsX);
+		return;
+	}
+	for (unsigned int i = 0; i < cpuDispatch.numGroupsX; ++i) {
+		if (gpuList[i] != cpuList[i]) {
+			LOG_WARN("{} Active cluster list differs at {}, GPU has {}, CPU has {}", __FUNCTION__, i, gpuList[i], cpuList[i]);
+			return;
+		}
+	}
+	LOG_INFO("{} GPU and CPU active cluster lists match, {} of {} clusters active", __FUNCTION__, cpuDispatch.numGroupsX, numClusters);
 }
 
 void GameTechRenderer::DepthPrePass() {
+	NCL_GPU_SCOPE(profiler, "DepthPrepass");
 	glBindFramebuffer(GL_FRAMEBUFFER, bufferFBO);
 	glDepthMask(GL_TRUE);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -495,52 +665,204 @@ void GameTechRenderer::DepthPrePass() {
 	glEnable(GL_DEPTH_TEST);
 	BindShader(depthPrepassShader);
 
-	int projLocation = 0;
-	int viewLocation = 0;
-	int modelLocation = 0;
-
 	OGLShader* shader = depthPrepassShader;
 
-	projLocation = glGetUniformLocation(shader->GetProgramID(), "projMatrix");
-	viewLocation = glGetUniformLocation(shader->GetProgramID(), "viewMatrix");
-	modelLocation = glGetUniformLocation(shader->GetProgramID(), "modelMatrix");
+	const GLint hasMaskLocation = shader->GetUniformLocation("hasMask"_u);
+	// directObjects is in sort key order, so runs of objects share a mesh and mask texture
+	MeshGeometry* lastMesh = nullptr;
+	const TextureBase* lastMask = nullptr;
+	int lastHasMask = -1;
 
-	glUniformMatrix4fv(projLocation, 1, false, (float*)&projMat);
-	glUniformMatrix4fv(viewLocation, 1, false, (float*)&viewMat);
-
-	for (const auto& i : activeObjects) {
-
-		Matrix4 modelMatrix = (*i).GetTransform()->GetMatrix();
-		glUniformMatrix4fv(modelLocation, 1, false, (float*)&modelMatrix);
+	UploadDrawObjects(directObjects);
+	for (size_t first = 0; first < directObjects.size();) {
+		RenderObject* i = directObjects[first];
+		const GLuint instances = CountInstances(directObjects, first, InstanceMatch::Depth);
+		SetDrawObject((GLuint)first);
 
 		//glUniform1i(hasTexLocation, (OGLTexture*)(*i).GetDefaultTexture() ? 1 : 0);
 		bool hasDiff = (OGLTexture*)(*i).GetDefaultTexture() ? true : false;
 		bool hasMask = (*i).HasMask();
 		int layerCount = (*i).GetMesh()->GetSubMeshCount();
 
-		glUniform1i(glGetUniformLocation(shader->GetProgramID(), "hasMask"), hasMask);
+		if ((int)hasMask != lastHasMask) {
+			glUniform1i(hasMaskLocation, hasMask);
+			lastHasMask = hasMask;
+		}
 
-		BindMesh((*i).GetMesh());
+		if ((*i).GetMesh() != lastMesh) {
+			BindMesh((*i).GetMesh());
+			lastMesh = (*i).GetMesh();
+		}
 
-		if (hasDiff && hasMask) {
+		if (hasDiff && hasMask && (*i).GetDefaultTexture() != lastMask) {
 			BindTextureToShader((OGLTexture*)(*i).GetDefaultTexture(), "mainTex", 0);
+			lastMask = (*i).GetDefaultTexture();
 		}
 
 		for (int i = 0; i < layerCount; ++i) {
-			DrawBoundMesh(i);
+			DrawBoundMesh(i, instances);
 		}
+		first += instances;
+	}
+
+	if (!prepassBatches.empty()) {
+		BindShader(depthPrepassIndirectShader);
+		DrawIndirectBatches(prepassBatches, drawStream->GetID(), prepassCommandOffset, true);
 	}
 	
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
+void GameTechRenderer::BuildDepthPyramid() {
+	NCL_GPU_SCOPE(profiler, "DepthPyramid");
+	depthPyramid->Build(bufferDepthTex);
+}
+
+void GameTechRenderer::OcclusionCullGPU() {
+	shadingCommandsCulled = false;
+	if (occlusionCulling != OcclusionCulling::GPU || !occlusionCullShader || shadingBatches.empty()) {
+		return;
+	}
+
+	const GLuint commandCount = (GLuint)indirectDraws.size();
+	const GLuint objectCount = (GLuint)indirectObjects.size();
+	// Only grows, the buffers are sized for the busiest frame so far
+	if (commandCount > culledCommandCapacity) {
+		culledCommandCapacity = std::max(commandCount, culledCommandCapacity * 2);
+		glDeleteBuffers(1, &culledCommandBuffer);
+		glGenBuffers(1, &culledCommandBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, culledCommandBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, culledCommandCapacity * sizeof(DrawElementsIndirectCommand), NULL, GL_DYNAMIC_COPY);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+	if (objectCount > objectVisibilityCapacity) {
+		objectVisibilityCapacity = std::max(objectCount, objectVisibilityCapacity * 2);
+		glDeleteBuffers(1, &objectVisibilityBuffer);
+		glGenBuffers(1, &objectVisibilityBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, objectVisibilityBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, objectVisibilityCapacity * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+
+	{
+		NCL_GPU_SCOPE(profiler, "OcclusionCull");
+		BindShader(occlusionCullShader);
+
+		glUniform1i(glGetUniformLocation(occlusionCullShader->GetProgramID(), "depthPyramid"), 0);
+		Cmds::BindTexture(0, depthPyramid->GetTexture());
+		glUniform2i(glGetUniformLocation(occlusionCullShader->GetProgramID(), "screenSize"), currentWidth, currentHeight);
+		glUniform1ui(glGetUniformLocation(occlusionCullShader->GetProgramID(), "commandCount"), commandCount);
+
+		OGLShader::SetUniforms(occlusionCullShader,
+			"viewProjMatrix", projMat * viewMat,
+			"pyramidLevels", depthPyramid->GetLevelCount());
+
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, COMPUTE_BINDING_OBJECT_BUFFER, drawStream->GetID(), frameDraws.offset, frameObjectBytes);
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, COMPUTE_BINDING_OCCLUSION_COMMANDS, drawStream->GetID(),
+			shadingCommandOffset, commandCount * sizeof(DrawElementsIndirectCommand));
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMPUTE_BINDING_OCCLUSION_CULLED_COMMANDS, culledCommandBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMPUTE_BINDING_OBJECT_VISIBILITY, objectVisibilityBuffer);
+
+		glDispatchCompute((commandCount + OCCLUSION_GROUP_SIZE - 1) / OCCLUSION_GROUP_SIZE, 1, 1);
+		glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+	shadingCommandsCulled = true;
+
+	if (checkOcclusion) {
+		checkOcclusion = false;
+		CheckOcclusion();
+	}
+}
+
+void GameTechRenderer::CheckOcclusion() {
+	std::vector<GLuint> visibility(indirectObjects.size());
+
+	// Stalls until the GPU catches up, this is a debugging aid only
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, objectVisibilityBuffer);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, visibility.size() * sizeof(GLuint), visibility.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	const size_t visible = std::count(visibility.begin(), visibility.end(), 1u);
+	LOG_INFO("{} {} of {} indirect objects visible, {} occluded, {} drawn one by one without testing", __FUNCTION__,
+		visible, visibility.size(), visibility.size() - visible, directObjects.size());
+}
+
+void GameTechRenderer::OcclusionCullCPU(Camera* currentCamera) {
+	NCL_GPU_SCOPE(profiler, "OcclusionCull");
+	const Matrix4 viewProj = currentCamera->BuildProjectionMatrix((float)currentWidth / (float)currentHeight) * currentCamera->BuildViewMatrix();
+	occlusionRasterizer.SetViewProjection(viewProj);
+
+	occlusionCentres.resize(activeObjects.size());
+	occlusionHalfSizes.resize(activeObjects.size());
+	occluderCandidates.clear();
+	for (size_t i = 0; i < activeObjects.size(); ++i) {
+		const RenderObject* obj = activeObjects[i];
+		GetWorldBounds(*obj, occlusionCentres[i], occlusionHalfSizes[i]);
+
+		// Skinned meshes aren't in their bind pose, so only static ones occlude
+		const MeshGeometry* mesh = obj->GetMesh();
+		if (!mesh || obj->GetAnimation() || mesh->GetPrimitiveType() != GeometryPrimitive::Triangles || mesh->GetIndexData().empty()) {
+			continue;
+		}
+		const float coverage = occlusionRasterizer.GetScreenCoverage(occlusionCentres[i], occlusionHalfSizes[i]);
+		if (coverage >= OCCLUDER_MIN_COVERAGE) {
+			occluderCandidates.push_back({ coverage, (uint)i });
+		}
+	}
+	std::sort(occluderCandidates.begin(), occluderCandidates.end(), [](const OccluderCandidate& a, const OccluderCandidate& b) {
+		return a.coverage > b.coverage || (a.coverage == b.coverage && a.index < b.index);
+	});
+
+	// The largest occluders hide the most, so the smaller ones are dropped once the budget's spent
+	size_t occluderCount = 0;
+	size_t triangles = 0;
+	uint64_t version = OccluderVersion(14695981039346656037ull, std::span<const float>(viewProj.array));
+	for (const OccluderCandidate& candidate : occluderCandidates) {
+		const RenderObject* obj = activeObjects[candidate.index];
+		const size_t meshTriangles = obj->GetMesh()->GetIndexData().size() / 3;
+		if (triangles > 0 && triangles + meshTriangles > OCCLUDER_TRIANGLE_BUDGET) {
+			break;
+		}
+		triangles += meshTriangles;
+		const Matrix4 modelMatrix = obj->GetTransform()->GetMatrix();
+		const uint64_t mesh = (uint64_t)(uintptr_t)obj->GetMesh();
+		version = OccluderVersion(version ^ mesh, std::span<const float>(modelMatrix.array));
+		occluderCount++;
+	}
+
+	// Nothing has moved since the depth was last drawn, so it's still right
+	if (version != occluderVersion) {
+		occluderVersion = version;
+		occlusionRasterizer.Begin(viewProj);
+		for (size_t i = 0; i < occluderCount; ++i) {
+			const RenderObject* obj = activeObjects[occluderCandidates[i].index];
+			const MeshGeometry* mesh = obj->GetMesh();
+			occlusionRasterizer.RasterizeTriangles(obj->GetTransform()->GetMatrix(), mesh->GetPositionData(), mesh->GetIndexData());
+		}
+		occlusionRasterizer.Finish();
+	}
+
+	// An occluder's box is in front of its own triangles, so it never hides itself
+	size_t kept = 0;
+	for (size_t i = 0; i < activeObjects.size(); ++i) {
+		if (occlusionRasterizer.IsVisible(occlusionCentres[i], occlusionHalfSizes[i])) {
+			activeObjects[kept++] = activeObjects[i];
+		}
+	}
+	occludedObjects = (uint)(activeObjects.size() - kept);
+	activeObjects.resize(kept);
+}
+
 void GameTechRenderer::ForwardPlusCullLights() {
+	NCL_GPU_SCOPE(profiler, "LightCull");
 	//glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, lightSSBO);
+	PrepareLightIndexList();
 
 	BindShader(forwardPlusCullShader);
 
-	glUniform1i(glGetUniformLocation(forwardPlusCullShader->GetProgramID(), "depthTex"), 0);
-	Cmds::BindTexture(0, bufferDepthTex);
+	glUniform1i(glGetUniformLocation(forwardPlusCullShader->GetProgramID(), "depthPyramid"), 0);
+	Cmds::BindTexture(0, depthPyramid->GetTexture());
 
 	glActiveTexture(GL_TEXTURE1);
 	glBindTexture(GL_TEXTURE_2D, 0);
@@ -553,6 +875,7 @@ void GameTechRenderer::ForwardPlusCullLights() {
 
 	glUniform1i(glGetUniformLocation(forwardPlusCullShader->GetProgramID(), "noOfLights"), numLights);
 	glUniform1ui(glGetUniformLocation(forwardPlusCullShader->GetProgramID(), "totalNumLights"), totalNumLights);
+	glUniform1ui(glGetUniformLocation(forwardPlusCullShader->GetProgramID(), "lightIndexCapacity"), lightIndexCapacity);
 	glUniform2iv(glGetUniformLocation(forwardPlusCullShader->GetProgramID(), "screenSize"), 1, (int*)&dimensions);
 	glUniform2f(glGetUniformLocation(forwardPlusCullShader->GetProgramID(), "pixelSize"), 1.0f / currentWidth, 1.0f / currentHeight);
 
@@ -561,8 +884,19 @@ void GameTechRenderer::ForwardPlusCullLights() {
 }
 
 void GameTechRenderer::ClusteredCullLights() {
+	NCL_GPU_SCOPE(profiler, "LightCull");
 	//glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, lightSSBO);
+	if (useCPUCulling) {
+		ClusteredCullLightsCPU();
+		return;
+	}
+
+	if (useLightBVH && !activeClusterCulling) {
+		ClusteredCullLightsBVH();
+		return;
+	}
 
+	PrepareLightIndexList();
 	BindShader(forwardPlusCullShader);
 
 	Matrix4 invProj = (projMat).Inverse();
@@ -573,21 +907,176 @@ void GameTechRenderer::ClusteredCullLights() {
 
 	glUniform1i(glGetUniformLocation(forwardPlusCullShader->GetProgramID(), "noOfLights"), numLights);
 	glUniform1ui(glGetUniformLocation(forwardPlusCullShader->GetProgramID(), "totalNumLights"), totalNumLights);
+	glUniform1ui(glGetUniformLocation(forwardPlusCullShader->GetProgramID(), "lightIndexCapacity"), lightIndexCapacity);
 	glUniform2iv(glGetUniformLocation(forwardPlusCullShader->GetProgramID(), "screenSize"), 1, (int*)&dimensions);
 	glUniform2f(glGetUniformLocation(forwardPlusCullShader->GetProgramID(), "pixelSize"), 1.0f / currentWidth, 1.0f / currentHeight);
 	glUniform1f(glGetUniformLocation(forwardPlusCullShader->GetProgramID(), "near"), gameWorld.GetMainCamera()->GetNearPlane());
 	glUniform1f(glGetUniformLocation(forwardPlusCullShader->GetProgramID(), "far"), gameWorld.GetMainCamera()->GetFarPlane());
 
 
-	if (usingPrepass) {
-		//glDispatchComputeIndirect();
-		glDispatchCompute(CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z);
+	if (activeClusterCulling) {
+		// Only active clusters are culled, so clear everyone else's range rather than leave last frame's behind
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightGridSSBO);
+		glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_RG32UI, GL_RG_INTEGER, GL_UNSIGNED_INT, nullptr);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+		// One work group per entry in the compacted list, as counted by CompactClusterList
+		glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, activeClusterDispatchSSBO);
+		glDispatchComputeIndirect(0);
+		glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
 	}
 	else {
 		glDispatchCompute(CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z);
-	    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void GameTechRenderer::ClusteredCullLightsCPU() {
+	const std::span<const PointLight> lights = GetCPULights();
+	if (useLightBVH) {
+		lightBVH.Build(lights);
+		cpuCuller.CullLights(lights, viewMat, projMat.Inverse(), lightBVH);
+		// Not what's in the GPU's buffers any more
+		lightBVHUploaded = false;
+	}
+	else {
+		cpuCuller.CullLights(lights, viewMat, projMat.Inverse());
+	}
+
+	const LightListBuilder& lightList = cpuCuller.GetLightList();
+	GrowLightIndexList(lightList.GetTotalCount());
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightGridSSBO);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, lightList.GetCellCount() * sizeof(LightGrid), lightList.GetGrid().data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightIndexSSBO);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, lightList.GetTotalCount() * sizeof(GLuint), lightList.GetIndices().data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void GameTechRenderer::ClusteredCullLightsBVH() {
+	BuildLightBVH();
+	PrepareLightIndexList();
+	BindShader(lightBVHCullShader);
+
+	const GLuint program = lightBVHCullShader->GetProgramID();
+	Matrix4 invProj = (projMat).Inverse();
+	glUniformMatrix4fv(glGetUniformLocation(program, "viewMatrix"), 1, false, (float*)&viewMat);
+	glUniformMatrix4fv(glGetUniformLocation(program, "invProj"), 1, false, (float*)&invProj);
+	glUniform1ui(glGetUniformLocation(program, "lightIndexCapacity"), lightIndexCapacity);
+	glUniform1ui(glGetUniformLocation(program, "numTopLevelNodes"), lightBVH.GetTopLevelCount());
 
+	glDispatchCompute(CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void GameTechRenderer::BuildLightBVH() {
+	++lightBVHAge;
+	const bool moved = lightBVHVersion != lightVersion;
+	if (!lightBVHUploaded || lightBVH.GetLightCount() != numLights || (moved && lightBVHAge >= LIGHT_BVH_REBUILD_FRAMES)) {
+		// The sort only decides how tight the nodes are, the refit below makes them correct, so lights animated on
+		// the GPU can come from GetCPULights a frame or two late
+		lightBVH.Build(GetCPULights());
+
+		// Both buffers were made big enough for MAX_LIGHTS, so they're only ever written to
+		const std::span<const LightBVHNode> nodes = lightBVH.GetNodes();
+		const std::span<const uint> lightOrder = lightBVH.GetLightOrder();
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightBVHNodeSSBO);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, nodes.size_bytes(), nodes.data());
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightBVHOrderSSBO);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, lightOrder.size_bytes(), lightOrder.data());
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+		lightBVHUploaded = true;
+		lightBVHAge = 0;
+	}
+	else if (!moved) {
+		return;
+	}
+	lightBVHVersion = lightVersion;
+
+	if (lightBVH.GetLeafCount() == 0) {
+		return;
+	}
+	BindShader(lightBVHRefitShader);
+	const GLint firstNodeLocation = lightBVHRefitShader->GetUniformLocation("firstNode"_u);
+	const GLint nodeCountLocation = lightBVHRefitShader->GetUniformLocation("nodeCount"_u);
+	const GLint refitLeavesLocation = lightBVHRefitShader->GetUniformLocation("refitLeaves"_u);
+	const GLuint groupSize = 64;
+
+	// Leaves from the lights, then the top level from the leaves
+	glUniform1ui(firstNodeLocation, lightBVH.GetTopLevelCount());
+	glUniform1ui(nodeCountLocation, lightBVH.GetLeafCount());
+	glUniform1i(refitLeavesLocation, 1);
+	glDispatchCompute((lightBVH.GetLeafCount() + groupSize - 1) / groupSize, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	glUniform1ui(firstNodeLocation, 0);
+	glUniform1ui(nodeCountLocation, lightBVH.GetTopLevelCount());
+	glUniform1i(refitLeavesLocation, 0);
+	glDispatchCompute((lightBVH.GetTopLevelCount() + groupSize - 1) / groupSize, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void GameTechRenderer::GenLightBVHBuffers() {
+	glGenBuffers(1, &lightBVHNodeSSBO);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightBVHNodeSSBO);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, (LIGHT_BVH_MAX_TOP_NODES + LIGHT_BVH_MAX_LEAVES) * sizeof(LightBVHNode), NULL, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMPUTE_BINDING_LIGHT_BVH_NODES, lightBVHNodeSSBO);
+
+	glGenBuffers(1, &lightBVHOrderSSBO);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightBVHOrderSSBO);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, MAX_LIGHTS * sizeof(GLuint), NULL, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMPUTE_BINDING_LIGHT_BVH_ORDER, lightBVHOrderSSBO);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void GameTechRenderer::GenLightListBuffers(size_t numCells) {
+	glGenBuffers(1, &lightGridSSBO);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightGridSSBO);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, numCells * sizeof(LightGrid), NULL, GL_DYNAMIC_COPY);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMPUTE_BINDING_LIGHT_GRID_BUFFER, lightGridSSBO);
+
+	lightIndexCapacity = (GLuint)numCells * INITIAL_LIGHTS_PER_CELL;
+	glGenBuffers(1, &lightIndexSSBO);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightIndexSSBO);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, lightIndexCapacity * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMPUTE_BINDING_LIGHT_INDEX_BUFFER, lightIndexSSBO);
+
+	const GLuint zero = 0;
+	glGenBuffers(1, &lightIndexCounterSSBO);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightIndexCounterSSBO);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), &zero, GL_DYNAMIC_COPY);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMPUTE_BINDING_LIGHT_INDEX_COUNTER, lightIndexCounterSSBO);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	lightIndexCountReadback = std::make_unique<ReadbackBuffer>(sizeof(GLuint));
+}
+
+void GameTechRenderer::PrepareLightIndexList() {
+	// The cull shaders keep counting past the end of the list, so the counter holds the size the last cull needed.
+	// It's copied out and read once the GPU is done with it, normally a frame or two later, so an overflow
+	// drops lights for a couple of frames rather than every frame waiting on the GPU.
+	const ReadbackBuffer::Result required = lightIndexCountReadback->Latest();
+	if (required.data) {
+		GrowLightIndexList(*(const GLuint*)required.data);
 	}
+	lightIndexCountReadback->Enqueue(lightIndexCounterSSBO, 0, sizeof(GLuint));
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightIndexCounterSSBO);
+	glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void GameTechRenderer::GrowLightIndexList(GLuint required) {
+	if (required <= lightIndexCapacity) {
+		return;
+	}
+	// Headroom so lights drifting between cells don't cause a reallocation every frame
+	lightIndexCapacity = required + required / 2;
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightIndexSSBO);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, lightIndexCapacity * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	LOG_INFO("{} light index list grown to {} indices", __FUNCTION__, lightIndexCapacity);
 }
 
 void GameTechRenderer::LoadPrinter() {
@@ -678,7 +1167,7 @@ void GameTechRenderer::LoadSkybox() {
 	sceneBuffers.push_back(skyboxFBO);*/
 }
 
-void GameTechRenderer::GenerateScreenTexture(GLuint& into, bool depth) {
+void GameTechRenderer::GenerateScreenTexture(GLuint& into, GLenum internalFormat) {
 	glGenTextures(1, &into);
 	glBindTexture(GL_TEXTURE_2D, into);
 
@@ -687,87 +1176,476 @@ void GameTechRenderer::GenerateScreenTexture(GLuint& into, bool depth) {
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 
-	GLuint format = depth ? GL_DEPTH_COMPONENT24 : GL_RGBA8;
-	GLuint type = depth ? GL_DEPTH_COMPONENT : GL_RGBA;
+	AllocateScreenTexture(into, internalFormat);
 
+	sceneTextures.push_back(into);
+	screenTextures.push_back({ into, internalFormat });
+}
 
-	glTexImage2D(GL_TEXTURE_2D, 0, format, currentWidth, currentHeight, 0, type, GL_UNSIGNED_BYTE, NULL);
-	glTexImage2D(GL_TEXTURE_2D, 0, format, currentWidth, currentHeight, 0, type, GL_UNSIGNED_BYTE, NULL);
+void GameTechRenderer::SetScreenTextureFormat(GLuint texture, GLenum internalFormat) {
+	for (ScreenTexture& screenTexture : screenTextures) {
+		if (screenTexture.texture == texture && screenTexture.internalFormat != internalFormat) {
+			screenTexture.internalFormat = internalFormat;
+			AllocateScreenTexture(texture, internalFormat);
+		}
+	}
+}
 
+void GameTechRenderer::AllocateScreenTexture(GLuint texture, GLenum internalFormat) {
+	glBindTexture(GL_TEXTURE_2D, texture);
+	if (internalFormat == GL_NONE) {
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	}
+	else {
+		const ScreenTextureFormat format = GetScreenTextureFormat(internalFormat);
+		glTexImage2D(GL_TEXTURE_2D, 0, format.internalFormat, currentWidth, currentHeight, 0, format.format, format.type, NULL);
+	}
 	glBindTexture(GL_TEXTURE_2D, 0);
-	sceneTextures.push_back(into);
-	screenTextures.push_back(into);
 }
 
-void GameTechRenderer::GenerateShadowBuffer(GLuint& into) {
-	glGenTextures(1, &shadowTex);
-	glBindTexture(GL_TEXTURE_2D, shadowTex);
-	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+void GameTechRenderer::AllocateGBuffer() {
+	const GBufferFormats& formats = GetGBufferFormats(gBufferLayout);
+	SetScreenTextureFormat(bufferColourTex, formats.albedo.internalFormat);
+	SetScreenTextureFormat(bufferNormalTex, formats.normal.internalFormat);
+	SetScreenTextureFormat(lightDiffuseTex, formats.lightDiffuse.internalFormat);
+	SetScreenTextureFormat(lightSpecularTex, formats.lightSpecular.internalFormat);
 
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT,
-		SHADOWSIZE, SHADOWSIZE, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	// Compact layouts light into diffuse alone
+	const GLenum buffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glBindFramebuffer(GL_FRAMEBUFFER, pointLightFBO);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, lightDiffuseTex, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, formats.compact ? 0 : lightSpecularTex, 0);
+	glDrawBuffers(formats.compact ? 1 : 2, buffers);
+	CLOG_ERROR(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE,
+		"{} lighting targets for the {} layout are incomplete", __FUNCTION__, GBufferLayoutName(gBufferLayout));
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_R_TO_TEXTURE);
+	LOG_INFO("{} {} layout, {} bytes per pixel", __FUNCTION__, GBufferLayoutName(gBufferLayout), formats.BytesPerPixel());
+}
+
+void GameTechRenderer::SetGBufferLayout(GBufferLayout layout) {
+	gBufferLayout = layout;
+	if (renderMode == 1) {
+		AllocateGBuffer();
+	}
+}
+
+void GameTechRenderer::GenerateShadowMaps() {
+	glGenTextures(1, &shadowCascadeTex);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, shadowCascadeTex);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	sceneTextures.push_back(shadowCascadeTex);
+
+	glGenTextures(1, &shadowStaticTex);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, shadowStaticTex);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	sceneTextures.push_back(shadowStaticTex);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	// The shaders declare the cascades whether shadows are on or not, so keep something of the right type bound
+	// until they're first drawn
+	AllocateShadowMaps(1);
+
+	glGenFramebuffers(1, &shadowFBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, shadowFBO);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadowCascadeTex, 0, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	sceneBuffers.push_back(shadowFBO);
+}
+
+void GameTechRenderer::AllocateShadowMaps(uint size) {
+	for (GLuint texture : { shadowCascadeTex, shadowStaticTex }) {
+		glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT16, size, size, SHADOW_CASCADE_COUNT, 0,
+			GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+	}
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	shadowMapSize = size;
+	shadowCascades.Invalidate();
+	shadowLayerIsStatic.fill(false);
+}
+
+void GameTechRenderer::GeneratePointShadowAtlas() {
+	glGenTextures(1, &pointShadowAtlasTex);
+	glBindTexture(GL_TEXTURE_2D, pointShadowAtlasTex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
 	glBindTexture(GL_TEXTURE_2D, 0);
-	sceneTextures.push_back(shadowTex);
+	sceneTextures.push_back(pointShadowAtlasTex);
+	AllocatePointShadowAtlas(1);
 
-	glGenFramebuffers(1, &into);
-	glBindFramebuffer(GL_FRAMEBUFFER, into);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, shadowTex, 0);
+	glGenFramebuffers(1, &pointShadowFBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, pointShadowFBO);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, pointShadowAtlasTex, 0);
 	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	sceneBuffers.push_back(pointShadowFBO);
+
+	// Every light starts without a slot, after that only lights gaining or losing one are written
+	const std::vector<uint> noSlots(MAX_LIGHTS, POINT_SHADOW_NO_SLOT);
+	glGenBuffers(1, &pointShadowSlotSSBO);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, pointShadowSlotSSBO);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, MAX_LIGHTS * sizeof(uint), noSlots.data(), GL_DYNAMIC_DRAW);
+
+	glGenBuffers(1, &pointShadowSSBO);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, pointShadowSSBO);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, pointShadowAtlas.GetSlotCount() * sizeof(PointShadow), nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
 
-	sceneBuffers.push_back(into);
+void GameTechRenderer::AllocatePointShadowAtlas(uint size) {
+	glBindTexture(GL_TEXTURE_2D, pointShadowAtlasTex);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT16, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	pointShadowAtlasSize = size;
+	pointShadowAtlas.Invalidate();
 }
 
-void GameTechRenderer::BindAndDraw(RenderObject* obj, bool hasDiff, bool hasBump) {
-	vector<TextureBase*> textures = (*obj).GetTextures();
-	vector<TextureBase*> specTex = (*obj).GetSpecTextures();
+void GameTechRenderer::BindAndDraw(RenderObject* obj, bool hasDiff, bool hasBump, GLuint instances) {
+	const vector<TextureBase*>& textures = (*obj).GetTextures();
+	const vector<TextureBase*>& specTex = (*obj).GetSpecTextures();
 	int layerCount = (*obj).GetMesh()->GetSubMeshCount();
 
-	BindMesh((*obj).GetMesh());
-	int activeDiffuse = -1;
-	int activeBump = -1;
-	int activeSpec = -1;
+	if ((*obj).GetMesh() != drawState.mesh) {
+		BindMesh((*obj).GetMesh());
+		drawState.mesh = (*obj).GetMesh();
+	}
 	for (int i = 0; i < layerCount; ++i) {
-		if (hasDiff && ((OGLTexture*)textures[i])->GetObjectID() != activeDiffuse) {
+		if (hasDiff && textures[i] != drawState.diffuse) {
 			BindTextureToShader((OGLTexture*)textures[i], "mainTex", TEXTURE_BINDING_DIFFUSE);
-			activeDiffuse = ((OGLTexture*)textures[i])->GetObjectID();
+			drawState.diffuse = textures[i];
 		}
-		if (hasBump && ((OGLTexture*)textures[i + layerCount])->GetObjectID() != activeDiffuse) {
+		if (hasBump && textures[i + layerCount] != drawState.bump) {
 			BindTextureToShader((OGLTexture*)textures[i + layerCount], "bumpTex", TEXTURE_BINDING_NORMAL);
-			activeBump = ((OGLTexture*)textures[i + layerCount])->GetObjectID();
+			drawState.bump = textures[i + layerCount];
 		}
-		if (specTex.size() > 0 && ((OGLTexture*)specTex[i])->GetObjectID() != activeSpec) {
+		if (specTex.size() > 0 && specTex[i] != drawState.spec) {
 			BindTextureToShader((OGLTexture*)specTex[i], "specTex", TEXTURE_BINDING_SPECULAR);
-			activeSpec = ((OGLTexture*)specTex[i])->GetObjectID();
+			drawState.spec = specTex[i];
+		}
+		DrawBoundMesh(i, instances);
+	}
+}
+
+void GameTechRenderer::ResetDrawState() {
+	drawState = {};
+}
+
+void GameTechRenderer::InitIndirectDraws(const std::string& shadingFrag) {
+	// The same programs as the per object draws, which take the object index from a constant attribute instead
+	depthPrepassIndirectShader = (OGLShader*)resourceManager->LoadShader("DepthPassVert.vert", "DepthPassFrag.frag");
+	if (!shadingFrag.empty()) {
+		forwardPlusIndirectShader = (OGLShader*)resourceManager->LoadShader("GameTechVert.vert", shadingFrag);
+	}
+	// Occlusion tests the shading commands against the prepass, so it's only there when both are
+	if (!shadingFrag.empty() && depthPyramid) {
+		occlusionCullShader = (OGLShader*)resourceManager->LoadShader("occlusionCull.comp");
+	}
+	meshArena = std::make_unique<OGLMeshArena>();
+	// Enough for a few thousand objects, BuildIndirectDraws replaces it with a bigger one if a frame needs more
+	drawStream = std::make_unique<StreamingBuffer>(1 << 20);
+}
+
+void GameTechRenderer::BuildIndirectDraws() {
+	prepassBatches.clear();
+	shadingBatches.clear();
+	directObjects.clear();
+	indirectObjects.clear();
+	indirectDraws.clear();
+	frameObjectBytes = 0;
+
+	if (!meshArena || !useIndirectDraws) {
+		directObjects = activeObjects;
+		return;
+	}
+
+	// Skinned meshes need their joints, so they stay on the per object path
+	for (RenderObject* obj : activeObjects) {
+		const OGLMeshArena::Entry* entry = (obj->GetMesh() && !obj->GetAnimation()) ? meshArena->Add(*obj->GetMesh()) : nullptr;
+		if (!entry) {
+			directObjects.push_back(obj);
+			continue;
+		}
+
+		// Picks textures the same way as BindAndDraw and DepthPrePass
+		const vector<TextureBase*>& textures = obj->GetTextures();
+		const vector<TextureBase*>& specTex = obj->GetSpecTextures();
+		const size_t layerCount = entry->subMeshes.size();
+		const bool hasDiff = obj->GetDefaultTexture() != nullptr;
+		const bool hasBump = textures.size() == layerCount * 2;
+		OGLTexture* mask = (hasDiff && obj->HasMask()) ? (OGLTexture*)obj->GetDefaultTexture() : nullptr;
+
+		const GLuint objectIndex = (GLuint)indirectObjects.size();
+		indirectObjects.push_back(obj);
+		for (size_t i = 0; i < layerCount; ++i) {
+			IndirectDraw& draw = indirectDraws.emplace_back();
+			draw.objectIndex = objectIndex;
+			draw.firstIndex = entry->subMeshes[i].firstIndex;
+			draw.indexCount = entry->subMeshes[i].indexCount;
+			draw.baseVertex = entry->baseVertex;
+			draw.diffuse = hasDiff ? (OGLTexture*)textures[i] : nullptr;
+			draw.bump = hasBump ? (OGLTexture*)textures[i + layerCount] : nullptr;
+			draw.spec = specTex.empty() ? nullptr : (OGLTexture*)specTex[i];
+			draw.mask = mask;
+		}
+	}
+	if (indirectDraws.empty()) {
+		return;
+	}
+
+	// Each pass's commands start on the stream's alignment, so occlusionCull.comp can bind the shading ones as a range
+	frameObjectBytes = indirectObjects.size() * sizeof(ObjectData);
+	const GLsizeiptr commandBytes = indirectDraws.size() * sizeof(DrawElementsIndirectCommand);
+	const GLsizeiptr prepassStart = AlignUp(frameObjectBytes, drawStream->GetAlignment());
+	const GLsizeiptr shadingStart = AlignUp(prepassStart + commandBytes, drawStream->GetAlignment());
+	const GLsizeiptr frameBytes = shadingStart + commandBytes;
+	if (frameBytes > drawStream->GetSegmentSize()) {
+		GLsizeiptr segmentSize = drawStream->GetSegmentSize();
+		while (segmentSize < frameBytes) {
+			segmentSize *= 2;
+		}
+		// Buffers the GPU is still reading from are only freed once it's done with them
+		drawStream = std::make_unique<StreamingBuffer>(segmentSize);
+	}
+	frameDraws = drawStream->Allocate(frameBytes);
+	if (!frameDraws.data) {
+		indirectDraws.clear();
+		frameObjectBytes = 0;
+		directObjects = activeObjects;
+		return;
+	}
+	meshArena->ReserveObjects((GLuint)indirectObjects.size());
+
+	ObjectData* objects = (ObjectData*)frameDraws.data;
+	for (size_t i = 0; i < indirectObjects.size(); ++i) {
+		const RenderObject* obj = indirectObjects[i];
+		ObjectData object = MakeObjectData(*obj);
+		Vector3 boundsCentre;
+		Vector3 boundsHalfSize;
+		GetWorldBounds(*obj, boundsCentre, boundsHalfSize);
+		object.boundsCentre = Vector4(boundsCentre, 1.0f);
+		object.boundsHalfSize = Vector4(boundsHalfSize, 0.0f);
+		std::memcpy(&objects[i], &object, sizeof(ObjectData));
+	}
+
+	// Sorts the draws by the textures a pass binds, keeping them front to back within each batch, and writes
+	// them out as commands with a batch for each run of the same textures
+	auto writeBatches = [&](char* commandData, vector<IndirectBatch>& batches, auto textureKey) {
+		indirectDrawOrder.resize(indirectDraws.size());
+		std::iota(indirectDrawOrder.begin(), indirectDrawOrder.end(), 0u);
+		std::stable_sort(indirectDrawOrder.begin(), indirectDrawOrder.end(), [&](uint a, uint b) {
+			return textureKey(indirectDraws[a]) < textureKey(indirectDraws[b]);
+		});
+
+		DrawElementsIndirectCommand* commands = (DrawElementsIndirectCommand*)commandData;
+		for (size_t i = 0; i < indirectDrawOrder.size(); ++i) {
+			const IndirectDraw& draw = indirectDraws[indirectDrawOrder[i]];
+			const DrawElementsIndirectCommand command = { draw.indexCount, 1, draw.firstIndex, draw.baseVertex, draw.objectIndex };
+			std::memcpy(&commands[i], &command, sizeof(DrawElementsIndirectCommand));
+
+			if (batches.empty() || textureKey(draw) != textureKey(indirectDraws[indirectDrawOrder[i - 1]])) {
+				const auto [diffuse, bump, spec] = textureKey(draw);
+				batches.push_back({ (GLuint)i, 0, diffuse, bump, spec });
+			}
+			batches.back().commandCount++;
+		}
+	};
+
+	prepassCommandOffset = frameDraws.offset + prepassStart;
+	shadingCommandOffset = frameDraws.offset + shadingStart;
+	writeBatches((char*)frameDraws.data + prepassStart, prepassBatches, [](const IndirectDraw& draw) {
+		return std::make_tuple(draw.mask, (OGLTexture*)nullptr, (OGLTexture*)nullptr);
+	});
+	writeBatches((char*)frameDraws.data + shadingStart, shadingBatches, [](const IndirectDraw& draw) {
+		return std::make_tuple(draw.diffuse, draw.bump, draw.spec);
+	});
+}
+
+void GameTechRenderer::DrawIndirectBatches(const vector<IndirectBatch>& batches, GLuint commandBuffer, GLintptr commandOffset, bool depthOnly) {
+	meshArena->Bind();
+	frameCounters.meshChanges++;
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, COMPUTE_BINDING_OBJECT_BUFFER, drawStream->GetID(), frameDraws.offset, frameObjectBytes);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+
+	for (const IndirectBatch& batch : batches) {
+		if (depthOnly) {
+			boundShader->SetUniform("hasMask"_u, batch.diffuse ? 1 : 0);
+			if (batch.diffuse) {
+				BindTextureToShader(batch.diffuse, "mainTex", 0);
+			}
+		}
+		else {
+			OGLShader::SetUniforms(boundShader,
+				"hasTexture"_u, batch.diffuse ? 1 : 0,
+				"hasBump"_u, batch.bump ? 1 : 0,
+				"hasSpec"_u, batch.spec ? 1 : 0);
+			if (batch.diffuse) {
+				BindTextureToShader(batch.diffuse, "mainTex", TEXTURE_BINDING_DIFFUSE);
+			}
+			if (batch.bump) {
+				BindTextureToShader(batch.bump, "bumpTex", TEXTURE_BINDING_NORMAL);
+			}
+			if (batch.spec) {
+				BindTextureToShader(batch.spec, "specTex", TEXTURE_BINDING_SPECULAR);
+			}
+		}
+		const GLintptr batchOffset = commandOffset + batch.firstCommand * sizeof(DrawElementsIndirectCommand);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)batchOffset, batch.commandCount, 0);
+		frameCounters.drawCalls++;
+	}
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	BindMesh(nullptr);
+}
+
+void GameTechRenderer::DrawShadingBatches() {
+	if (shadingCommandsCulled) {
+		DrawIndirectBatches(shadingBatches, culledCommandBuffer, 0, false);
+	}
+	else {
+		DrawIndirectBatches(shadingBatches, drawStream->GetID(), shadingCommandOffset, false);
+	}
+}
+
+void GameTechRenderer::UploadFrameData(Camera* current_camera) {
+	// One allocation for the whole frame, so nothing read this frame can be left behind in a segment that's
+	// already been fenced. Room for FrameData, ShadowData, two passes of ObjectData, e.g. the prepass and
+	// shading, and the shadow casters, which can be any of the cull candidates.
+	const GLsizeiptr alignment = uniformStream->GetAlignment();
+	const GLsizeiptr frameDataBytes = AlignUp(sizeof(FrameData), alignment);
+	const GLsizeiptr shadowDataBytes = AlignUp(sizeof(ShadowData), alignment);
+	const GLsizeiptr frameBytes = frameDataBytes + shadowDataBytes + 2 * AlignUp(activeObjects.size() * sizeof(ObjectData), alignment) +
+		AlignUp(cullCandidates.size() * sizeof(ObjectData), alignment);
+	if (frameBytes > uniformStream->GetSegmentSize()) {
+		GLsizeiptr segmentSize = uniformStream->GetSegmentSize();
+		while (segmentSize < frameBytes) {
+			segmentSize *= 2;
 		}
-		DrawBoundMesh(i);
+		uniformStream = std::make_unique<StreamingBuffer>(segmentSize);
+	}
+	frameUniforms = uniformStream->Allocate(frameBytes);
+	frameUniformsUsed = 0;
+	if (!frameUniforms.data) {
+		return;
+	}
+
+	FrameData frame = {};
+	frame.viewMatrix = viewMat;
+	frame.projMatrix = projMat;
+	frame.cameraPos = current_camera->GetPosition();
+	frame.noOfLights = (int)numLights;
+	std::memcpy(frameUniforms.data, &frame, sizeof(FrameData));
+	uniformStream->BindRange(GL_UNIFORM_BUFFER, UNIFORM_BINDING_FRAME, { frameUniforms.data, frameUniforms.offset, sizeof(FrameData) });
+
+	// Written even with shadows off, the shaders check sunDirection.w before using the rest
+	ShadowData shadow = {};
+	if (useShadows && renderMode != 0) {
+		shadowCascades.FillShadowData(shadow);
+		shadow.sunDirection = Vector4(sunDirection.Normalised(), 1.0f);
 	}
+	shadow.sunColour = sunColour;
+	shadow.pointShadowParams = Vector4(usePointShadows && renderMode == 3 ? 1.0f : 0.0f, pointShadowAtlas.GetTexelScale(), 0.0f, 0.0f);
+	char* shadowDst = (char*)frameUniforms.data + frameDataBytes;
+	std::memcpy(shadowDst, &shadow, sizeof(ShadowData));
+	uniformStream->BindRange(GL_UNIFORM_BUFFER, UNIFORM_BINDING_SHADOW, { shadowDst, frameUniforms.offset + frameDataBytes, sizeof(ShadowData) });
+	frameUniformsUsed = frameDataBytes + shadowDataBytes;
 }
 
-void GameTechRenderer::UpdateShaderMatrices() {
-	if (boundShader) {
-		OGLShader::SetUniforms(boundShader,
-			"projMatrix", projMat,
-			"viewMatrix", viewMat);
+void GameTechRenderer::UploadDrawObjects(const vector<RenderObject*>& objects) {
+	const GLsizeiptr objectBytes = objects.size() * sizeof(ObjectData);
+	if (objects.empty() || frameUniformsUsed + objectBytes > frameUniforms.size) {
+		CLOG_ERROR(!objects.empty(), "{} has no room left for {} objects this frame", __FUNCTION__, objects.size());
 		return;
-		// Might need these at some point
-		/*glUniformMatrix4fv(glGetUniformLocation(currentShader->GetProgram(), "modelMatrix"), 1, false, modelMatrix.values);
-		glUniformMatrix4fv(glGetUniformLocation(currentShader->GetProgram(), "textureMatrix"), 1, false, textureMatrix.values);
-		glUniformMatrix4fv(glGetUniformLocation(currentShader->GetProgram(), "shadowMatrix"), 1, false, shadowMatrix.values);*/
 	}
-	LOG_WARN("{} no shader was bound when calling", __FUNCTION__);
+
+	const StreamingBuffer::Allocation range = { (char*)frameUniforms.data + frameUniformsUsed, frameUniforms.offset + frameUniformsUsed, objectBytes };
+	ObjectData* data = (ObjectData*)range.data;
+	for (size_t i = 0; i < objects.size(); ++i) {
+		const ObjectData object = MakeObjectData(*objects[i]);
+		std::memcpy(&data[i], &object, sizeof(ObjectData));
+	}
+	uniformStream->BindRange(GL_SHADER_STORAGE_BUFFER, COMPUTE_BINDING_OBJECT_BUFFER, range);
+	frameUniformsUsed += AlignUp(objectBytes, uniformStream->GetAlignment());
+}
+
+void GameTechRenderer::SetDrawObject(GLuint objectIndex) {
+	// The object mesh VAOs leave the attribute disabled, so every vertex reads this constant value
+	glVertexAttribI1ui(VERTEX_ATTRIBUTE_OBJECT_INDEX, objectIndex);
+}
+
+GLuint GameTechRenderer::CountInstances(const vector<RenderObject*>& objects, size_t first, InstanceMatch match) const {
+	const RenderObject& obj = *objects[first];
+	// Skinned meshes each need their own joints
+	if (!useInstancing || obj.GetAnimation()) {
+		return 1;
+	}
+
+	size_t last = first + 1;
+	for (; last < objects.size(); ++last) {
+		const RenderObject& other = *objects[last];
+		if (other.GetAnimation() || other.GetMesh() != obj.GetMesh()) {
+			break;
+		}
+		if (match == InstanceMatch::Mesh) {
+			continue;
+		}
+		if (other.HasMask() != obj.HasMask() || other.GetDefaultTexture() != obj.GetDefaultTexture()) {
+			break;
+		}
+		if (match == InstanceMatch::Depth) {
+			continue;
+		}
+		if (other.GetShader() != obj.GetShader() || other.GetTextures() != obj.GetTextures() || other.GetSpecTextures() != obj.GetSpecTextures()) {
+			break;
+		}
+	}
+	return (GLuint)(last - first);
 }
 
 void GameTechRenderer::UploadLights(std::span<const PointLight> newLights) {
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightSSBO);
-	glBufferSubData(GL_SHADER_STORAGE_BUFFER, numLights * sizeof(PointLight), newLights.size() * sizeof(PointLight), newLights.data());
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	const StreamingBuffer::Allocation staging = lightStream->Allocate(newLights.size_bytes());
+	if (staging.data) {
+		std::memcpy(staging.data, newLights.data(), staging.size);
+		lightStream->CopyTo(lightSSBO, numLights * sizeof(PointLight), staging);
+	}
+	else {
+		// Without a mapped stream the lights still have to reach the SSBO, or they'd be culled and shaded uninitialised
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightSSBO);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, numLights * sizeof(PointLight), newLights.size_bytes(), newLights.data());
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
 
-	numLights += newLights.size();
+	cpuLights.insert(cpuLights.end(), newLights.begin(), newLights.end());
+	numLights += (uint)newLights.size();
+	++lightVersion;
+}
+
+std::span<const PointLight> GameTechRenderer::GetCPULights() {
+	if (cpuLightsStale) {
+		cpuLightsWanted = true;
+		const ReadbackBuffer::Result latest = lightReadback ? lightReadback->Latest() : ReadbackBuffer::Result{};
+		if (latest.sequence != cpuLightsSequence) {
+			// Lights added since the copy was made are already at the end of cpuLights
+			std::memcpy(cpuLights.data(), latest.data, std::min<size_t>(latest.size, cpuLights.size() * sizeof(PointLight)));
+			cpuLightsSequence = latest.sequence;
+		}
+	}
+	return cpuLights;
 }
 
 void GameTechRenderer::ResizeSceneTextures(float width, float height) {
@@ -779,30 +1657,34 @@ void GameTechRenderer::ResizeSceneTextures(float width, float height) {
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, currentWidth, currentHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
 	glBindTexture(GL_TEXTURE_2D, 0);
 
-	for (auto tex : screenTextures) {
-		if (tex != bufferDepthTex) {
-			glBindTexture(GL_TEXTURE_2D, tex);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, currentWidth, currentHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-			glBindTexture(GL_TEXTURE_2D, 0);
-		}
+	for (const ScreenTexture& screenTexture : screenTextures) {
+		AllocateScreenTexture(screenTexture.texture, screenTexture.internalFormat);
 	}
 
-	glBindTexture(GL_TEXTURE_2D, bufferDepthTex);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, currentWidth, currentHeight, GL_DEPTH_COMPONENT, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	if (depthPyramid) {
+		depthPyramid->Resize(currentWidth, currentHeight);
+	}
 }
 
 void GameTechRenderer::RenderFrame() {
+	NCL_GPU_SCOPE(profiler, "Frame");
 	glEnable(GL_CULL_FACE);
 	glClearColor(1, 1, 1, 1);
 	BuildObjectList(gameWorld.GetMainCamera());
+	if (occlusionCulling == OcclusionCulling::CPU) {
+		OcclusionCullCPU(gameWorld.GetMainCamera());
+	}
+	else {
+		occludedObjects = 0;
+	}
 	SortObjectList();
+	BuildIndirectDraws();
 
 	viewMat = gameWorld.GetMainCamera()->BuildViewMatrix();
+	UpdateShadowCascades(gameWorld.GetMainCamera());
+	UploadFrameData(gameWorld.GetMainCamera());
+	RenderShadows(gameWorld.GetMainCamera());
 
-
-	//RenderShadowMap();
-	
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	switch (renderMode) {
@@ -873,7 +1755,13 @@ void GameTechRenderer::RenderDeferred() {
 
 	//RenderSkybox(gameWorld.GetMainCamera());
 
-	DrawPointLights(gameWorld.GetMainCamera());
+	if (useLightVolumes) {
+		DrawPointLights(gameWorld.GetMainCamera());
+	}
+	else {
+		ClusteredCullLights();
+		DeferredLighting();
+	}
 	CombineBuffers(gameWorld.GetMainCamera());
 
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -892,6 +1780,8 @@ void GameTechRenderer::RenderForwardPlus() {
 	DepthPrePass();
 	glEnable(GL_BLEND);
 
+	BuildDepthPyramid();
+	OcclusionCullGPU();
 	ForwardPlusCullLights();
 	glBindFramebuffer(GL_FRAMEBUFFER, forwardPlusFBO);
 
@@ -919,6 +1809,8 @@ void GameTechRenderer::RenderClustered(bool withPrepass) {
 
 	if (withPrepass) {
 		DepthPrePass();
+		BuildDepthPyramid();
+		OcclusionCullGPU();
 		ComputeActiveClusters();
 		CompactClusterList();
 	}
@@ -940,21 +1832,37 @@ void GameTechRenderer::RenderClustered(bool withPrepass) {
 	//glActiveTexture(GL_TEXTURE0 + 2);
 	//glBindTexture(GL_TEXTURE_2D, shadowTex);
 
+	profiler.BeginScope("Shading");
+	if (!shadingBatches.empty()) {
+		BindShader(forwardPlusIndirectShader);
+		OGLShader::SetUniforms(forwardPlusIndirectShader,
+			"scale"_u, clusterParams.scaleFactor,
+			"bias"_u, clusterParams.biasFactor,
+			"tilePxX"_u, clusterX,
+			"tilePxY"_u, clusterY,
+			"inDebug"_u, inDebugMode);
+		DrawShadingBatches();
+	}
+
 	BindShader(forwardPlusShader);
+	ResetDrawState();
+	UploadDrawObjects(directObjects);
 
-	for (const auto& i : activeObjects) {
+	for (size_t first = 0; first < directObjects.size();) {
+		RenderObject* i = directObjects[first];
+		// The objects after this one that can be drawn as instances of it
+		const GLuint instances = CountInstances(directObjects, first);
 		OGLShader* shader = forwardPlusShader;
 
 		vector<TextureBase*> textures = (*i).GetTextures();
 
 		if (activeShader != shader) {
-			
-			shader->SetUniform("cameraPos", gameWorld.GetMainCamera()->GetPosition());
-
 			OGLShader::SetUniforms(shader,
-				"projMatrix", projMat,
-				"viewMatrix", viewMat,
-				"noOfLights", numLights);
+				"scale"_u, clusterParams.scaleFactor,
+				"bias"_u, clusterParams.biasFactor,
+				"tilePxX"_u, clusterX,
+				"tilePxY"_u, clusterY,
+				"inDebug"_u, inDebugMode);
 
 			/*int shadowTexLocation = glGetUniformLocation(shader->GetProgramID(), "shadowTex");
 			glUniform1i(shadowTexLocation, 1);*/
@@ -962,8 +1870,6 @@ void GameTechRenderer::RenderClustered(bool withPrepass) {
 			activeShader = shader;
 		}
 
-		Matrix4 modelMatrix = (*i).GetTransform()->GetMatrix();
-
 		//Matrix4 fullShadowMat = shadowMatrix * modelMatrix;
 		//glUniformMatrix4fv(shadowLocation, 1, false, (float*)&fullShadowMat);
 
@@ -972,18 +1878,11 @@ void GameTechRenderer::RenderClustered(bool withPrepass) {
 		const bool hasBump = textures.size() == layerCount * 2;
 		const bool hasSpec = (*i).GetSpecTextures().size() > 0;
 
-		OGLShader::SetUniforms(activeShader, 
-			"modelMatrix", modelMatrix,
-			"scale", clusterParams.scaleFactor,
-			"bias", clusterParams.biasFactor,
-			"tilePxX", clusterX,
-			"tilePxY", clusterY,
-			"inDebug", inDebugMode,
-			"objectColour", i->GetColour(),
-			"hasVertexColours", !(*i).GetMesh()->GetColourData().empty(),
-			"hasTexture", (OGLTexture*)(*i).GetDefaultTexture() ? 1 : 0,
-			"hasBump", hasBump,
-			"hasSpec", hasSpec);
+		SetDrawObject((GLuint)first);
+		OGLShader::SetUniforms(activeShader,
+			"hasTexture"_u, (OGLTexture*)(*i).GetDefaultTexture() ? 1 : 0,
+			"hasBump"_u, hasBump,
+			"hasSpec"_u, hasSpec);
 
 		if (i->GetAnimation()) {
 			MeshGeometry* mesh = i->GetMesh();
@@ -996,13 +1895,15 @@ void GameTechRenderer::RenderClustered(bool withPrepass) {
 				frameMatrices.emplace_back(frameData[i] * matrix);
 			}
 
-			int j = glGetUniformLocation(((OGLShader*)(*i).GetShader())->GetProgramID(), "joints");
+			int j = ((OGLShader*)(*i).GetShader())->GetUniformLocation("joints"_u);
 			glUniformMatrix4fv(j, frameMatrices.size(), false,
 				(float*)frameMatrices.data());
 		}
 
-		BindAndDraw(i, hasDiff, hasBump);
+		BindAndDraw(i, hasDiff, hasBump, instances);
+		first += instances;
 	}
+	profiler.EndScope();
 
 	if (withPrepass) {
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -1026,7 +1927,7 @@ void GameTechRenderer::GenPrePassFBO() {
 		GL_COLOR_ATTACHMENT0
 	};
 
-	GenerateScreenTexture(bufferDepthTex, true);
+	GenerateScreenTexture(bufferDepthTex, GL_DEPTH_COMPONENT24);
 	GenerateScreenTexture(depthColourTex);
 
 	glBindFramebuffer(GL_FRAMEBUFFER, bufferFBO);
@@ -1055,14 +1956,18 @@ void GameTechRenderer::GenPrePassFBO() {
 
 
 void GameTechRenderer::FillBuffers(Camera* current_camera, float depth) {
+	NCL_GPU_SCOPE(profiler, "GBuffer");
 	BindShader(sceneShader);
 
 	OGLShader* activeShader = nullptr;
 	/*glActiveTexture(GL_TEXTURE0 + 2);
 	glBindTexture(GL_TEXTURE_2D, shadowTex);*/
 
-	int count = 0;
-	for (const auto& i : activeObjects) {
+	ResetDrawState();
+	UploadDrawObjects(activeObjects);
+	for (size_t first = 0; first < activeObjects.size();) {
+		RenderObject* i = activeObjects[first];
+		const GLuint instances = CountInstances(activeObjects, first);
 		//OGLShader* shader = (OGLShader*)(*i).GetShader();
 		OGLShader* shader = sceneShader;
 		//BindShader(shader);
@@ -1070,12 +1975,9 @@ void GameTechRenderer::FillBuffers(Camera* current_camera, float depth) {
 		vector<TextureBase*> textures = (*i).GetTextures();
 
 		if (activeShader != shader) {
-			shader->SetUniform("cameraPos", current_camera->GetPosition());
-
 			OGLShader::SetUniforms(shader,
-				"projMatrix", projMat,
-				"viewMatrix", viewMat,
-				"noOfLights", numLights);
+				"isDepth"_u, depth,
+				"compactGBuffer"_u, GetGBufferFormats(gBufferLayout).compact);
 
 			/*int shadowTexLocation = glGetUniformLocation(shader->GetProgramID(), "shadowTex");
 			glUniform1i(shadowTexLocation, 2);*/
@@ -1083,8 +1985,6 @@ void GameTechRenderer::FillBuffers(Camera* current_camera, float depth) {
 			activeShader = shader;
 		}
 
-		Matrix4 modelMatrix = (*i).GetTransform()->GetMatrix();
-
 	/*	Matrix4 fullShadowMat = shadowMatrix * modelMatrix;
 		glUniformMatrix4fv(shadowLocation, 1, false, (float*)&fullShadowMat);*/
 
@@ -1093,15 +1993,11 @@ void GameTechRenderer::FillBuffers(Camera* current_camera, float depth) {
 		bool hasBump = textures.size() == layerCount * 2;
 		bool hasSpec = (*i).GetSpecTextures().size() > 0;
 
+		SetDrawObject((GLuint)first);
 		OGLShader::SetUniforms(activeShader,
-			"modelMatrix", modelMatrix,
-			"inDebug", inDebugMode,
-			"objectColour", i->GetColour(),
-			"hasVertexColours", !(*i).GetMesh()->GetColourData().empty(),
-			"hasTexture", (OGLTexture*)(*i).GetDefaultTexture() ? 1 : 0,
-			"hasBump", hasBump,
-			"hasSpec", hasSpec,
-			"isDepth", depth);
+			"hasTexture"_u, (OGLTexture*)(*i).GetDefaultTexture() ? 1 : 0,
+			"hasBump"_u, hasBump,
+			"hasSpec"_u, hasSpec);
 
 		if (i->GetAnimation()) {
 			MeshGeometry* mesh = i->GetMesh();
@@ -1114,14 +2010,14 @@ void GameTechRenderer::FillBuffers(Camera* current_camera, float depth) {
 				frameMatrices.emplace_back(frameData[i] * matrix);
 			}
 
-			int j = glGetUniformLocation(((OGLShader*)(*i).GetShader())->GetProgramID(), "joints");
+			int j = ((OGLShader*)(*i).GetShader())->GetUniformLocation("joints"_u);
 			glUniformMatrix4fv(j, frameMatrices.size(), false,
 				(float*)frameMatrices.data());
 
 		}
 
-		BindAndDraw(i, hasDiff, hasBump);
-		count++;
+		BindAndDraw(i, hasDiff, hasBump, instances);
+		first += instances;
 	}
 
 	glDisable(GL_CULL_FACE);
@@ -1130,6 +2026,7 @@ void GameTechRenderer::FillBuffers(Camera* current_camera, float depth) {
 }
 
 void GameTechRenderer::DrawPointLights(Camera* current_camera) {
+	NCL_GPU_SCOPE(profiler, "Shading");
 
 //	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, lightSSBO);
 
@@ -1140,41 +2037,34 @@ void GameTechRenderer::DrawPointLights(Camera* current_camera) {
 	glClearColor(0, 0, 0, 1);
 	glClear(GL_COLOR_BUFFER_BIT);
 	glBlendFunc(GL_ONE, GL_ONE);
-	Vector3 pos = current_camera->GetPosition();
 	glCullFace(GL_FRONT);
 	glDepthFunc(GL_ALWAYS);
 	glDepthMask(GL_FALSE);
 
-	const uint depthBinding = 0, normBinding = 1;
-	// TODO: Shouldn't we have a specular texture here, what did we do with it?
+	const uint depthBinding = 0, normBinding = 1, albedoBinding = 2;
 	Cmds::BindTexture(depthBinding, bufferDepthTex);
 	Cmds::BindTexture(normBinding, bufferNormalTex);
+	// Specular intensity is in albedo's alpha, only read with a compact G-buffer
+	Cmds::BindTexture(albedoBinding, bufferColourTex);
+	pointLightShader->SetUniform("compactGBuffer"_u, GetGBufferFormats(gBufferLayout).compact);
 
 	//glUniform1i(glGetUniformLocation(pointLightShader->GetProgramID(), "shadowTex"), 2);
 	//glActiveTexture(GL_TEXTURE2);
 	//glBindTexture(GL_TEXTURE_2D, bufferShadowTex);
-	const Vector2 cameraPos = current_camera->GetPosition();
-	glUniform3fv(glGetUniformLocation(pointLightShader->GetProgramID(), "cameraPos"), 1, (float*)&cameraPos);
-	//std::cout << current_camera->GetPosition() << std::endl;
-
-	glUniform2f(glGetUniformLocation(pointLightShader->GetProgramID(), "pixelSize"), 1.0f / currentWidth, 1.0f / currentHeight);
-
-	Matrix4 invViewProj = (projMat * viewMat).Inverse();
-
-	int projLocation = glGetUniformLocation(pointLightShader->GetProgramID(), "projMatrix");
-	int viewLocation = glGetUniformLocation(pointLightShader->GetProgramID(), "viewMatrix");
-	int modelLocation = glGetUniformLocation(pointLightShader->GetProgramID(), "modelMatrix");
-	glUniformMatrix4fv(projLocation, 1, false, (float*)&projMat);
-	glUniformMatrix4fv(viewLocation, 1, false, (float*)&viewMat);
+	const Vector3 cameraPos = current_camera->GetPosition();
+	const Matrix4 invViewProj = (projMat * viewMat).Inverse();
 
-	glUniformMatrix4fv(glGetUniformLocation(pointLightShader->GetProgramID(), "inverseProjView"), 1, false, invViewProj.array);
+	OGLShader::SetUniforms(pointLightShader,
+		"cameraPos"_u, cameraPos,
+		"pixelSize"_u, Vector2(1.0f / currentWidth, 1.0f / currentHeight),
+		"projMatrix"_u, projMat,
+		"viewMatrix"_u, viewMat,
+		"inverseProjView"_u, invViewProj);
 
 	BindMesh(sphere);
 
-	for (uint i = 0; i < numLights; i++) {
-		glUniform1i(glGetUniformLocation(pointLightShader->GetProgramID(), "lightIndex"), i);
-		DrawBoundMesh();
-	}
+	// pointlightvertex.vert picks the light by instance
+	DrawBoundMesh(0, numLights);
 
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	glCullFace(GL_BACK);
@@ -1189,7 +2079,39 @@ void GameTechRenderer::DrawPointLights(Camera* current_camera) {
 
 }
 
+void GameTechRenderer::DeferredLighting() {
+	NCL_GPU_SCOPE(profiler, "Shading");
+	BindShader(deferredLightingShader);
+
+	const GBufferFormats& formats = GetGBufferFormats(gBufferLayout);
+	const Matrix4 invViewProj = (projMat * viewMat).Inverse();
+	OGLShader::SetUniforms(deferredLightingShader,
+		"inverseProjView"_u, invViewProj,
+		"tilePxX"_u, clusterX,
+		"tilePxY"_u, clusterY,
+		"scale"_u, clusterParams.scaleFactor,
+		"bias"_u, clusterParams.biasFactor,
+		"compactGBuffer"_u, formats.compact);
+	glUniform2i(deferredLightingShader->GetUniformLocation("screenSize"_u), currentWidth, currentHeight);
+
+	Cmds::BindTexture(0, bufferDepthTex);
+	Cmds::BindTexture(1, bufferNormalTex);
+	Cmds::BindTexture(2, bufferColourTex);
+	glBindImageTexture(0, lightDiffuseTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, formats.lightDiffuse.internalFormat);
+	if (!formats.compact) {
+		glBindImageTexture(1, lightSpecularTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, formats.lightSpecular.internalFormat);
+	}
+
+	glDispatchCompute((currentWidth + DEFERRED_LIGHTING_GROUP_SIZE - 1) / DEFERRED_LIGHTING_GROUP_SIZE,
+		(currentHeight + DEFERRED_LIGHTING_GROUP_SIZE - 1) / DEFERRED_LIGHTING_GROUP_SIZE, 1);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+	glBindImageTexture(1, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+}
+
 void GameTechRenderer::CombineBuffers(Camera* current) {
+	NCL_GPU_SCOPE(profiler, "Combine");
 
 	BindShader(combineShader);
 	Matrix4 viewMatrix = viewMat;
@@ -1201,7 +2123,8 @@ void GameTechRenderer::CombineBuffers(Camera* current) {
 	OGLShader::SetUniforms(combineShader,
 		"projMatrix", projMatrix,
 		"viewMatrix", viewMatrix,
-		"modelMatrix", identity);
+		"modelMatrix", identity,
+		"compactGBuffer", GetGBufferFormats(gBufferLayout).compact);
 
 	Cmds::BindTexture(0, bufferColourTex);
 	Cmds::BindTexture(1, lightDiffuseTex);
@@ -1249,61 +2172,348 @@ void GameTechRenderer::BeginFrame() {
 	BindMesh(nullptr);
 }
 
+void GameTechRenderer::EndFrame() {
+	OGLRenderer::EndFrame();
+	profiler.EndFrame();
+}
+
 void GameTechRenderer::BuildObjectList(Camera* currentCamera) {
-	activeObjects.clear();
 	frameFrustum.FromMatrix(currentCamera->BuildProjectionMatrix((float)currentWidth / (float)currentHeight) * currentCamera->BuildViewMatrix());
 
+	cullCandidates.clear();
+	staticCandidates.clear();
+	objectCuller.Clear();
 	gameWorld.OperateOnContents(
 		[&](GameObject* o) {
-			if (o->IsActive()) {
-				RenderObject* g = o->GetRenderObject();
-			//	if (g && frameFrustum.InsideFrustum(*g)) {
-					Vector3 dir = g->GetTransform()->GetPosition() - currentCamera->GetPosition();
-					g->SetCameraDistance(dir.LengthSquared());
-					activeObjects.emplace_back(g);
-			//	}
+			RenderObject* g = o->GetRenderObject();
+			if (o->IsActive() && g) {
+				const Transform* transform = g->GetTransform();
+				if (g->HasBoundingBox()) {
+					objectCuller.AddBox(transform->GetMatrix(), g->GetBoundingBoxCentre(), g->GetBoundingBoxHalfSize());
+				}
+				else {
+					objectCuller.AddSphere(transform->GetPosition(), g->GetBoundingRadius());
+				}
+				cullCandidates.emplace_back(g);
+				PhysicsObject* physics = o->GetPhysicsObject();
+				staticCandidates.push_back((!physics || physics->IsStatic()) && !g->GetAnimation());
 			}
 		}
 	);
+
+	UpdateStaticCasters();
+
+	CullObjectList(frameFrustum, activeObjects);
+	for (RenderObject* g : activeObjects) {
+		Vector3 dir = g->GetTransform()->GetPosition() - currentCamera->GetPosition();
+		g->SetCameraDistance(dir.LengthSquared());
+	}
+}
+
+void GameTechRenderer::UpdateStaticCasters() {
+	movingCasters.clear();
+	uint64_t version = 14695981039346656037ull;
+	staticCasterMin = Vector3(FLT_MAX, FLT_MAX, FLT_MAX);
+	staticCasterMax = Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (uint i = 0; i < objectCuller.GetObjectCount(); ++i) {
+		if (!staticCandidates[i]) {
+			movingCasters.push_back(i);
+			continue;
+		}
+		Vector3 centre, halfSize;
+		objectCuller.GetBox(i, centre, halfSize);
+		for (int axis = 0; axis < 3; ++axis) {
+			staticCasterMin[axis] = std::min(staticCasterMin[axis], centre[axis] - halfSize[axis]);
+			staticCasterMax[axis] = std::max(staticCasterMax[axis], centre[axis] + halfSize[axis]);
+		}
+		version = (version ^ i) * 1099511628211ull;
+		for (float f : { centre.x, centre.y, centre.z, halfSize.x, halfSize.y, halfSize.z }) {
+			version = (version ^ std::bit_cast<uint32_t>(f)) * 1099511628211ull;
+		}
+	}
+	if (version == staticCasterVersion) {
+		return;
+	}
+	// Checked every frame, shadows or not, so neither shadow cache keeps a caster that's gone
+	staticCasterVersion = version;
+	objectOctreeDirty = true;
+	shadowCascades.Invalidate();
+	pointShadowAtlas.Invalidate();
+}
+
+void GameTechRenderer::CullObjectList(const Frustum& frustum, vector<RenderObject*>& out) {
+	objectCuller.Cull(frustum, visibleObjects);
+	out.clear();
+	for (uint i : visibleObjects) {
+		out.emplace_back(cullCandidates[i]);
+	}
 }
 
 void GameTechRenderer::SortObjectList() {
-	std::sort(activeObjects.begin(),
-		activeObjects.end(),
-		RenderObject::CompareByCameraDistance);
+	constexpr uint SORT_PASS_SCENE = 0;
+
+	sortKeys.clear();
+	sortOrder.clear();
+	for (uint i = 0; i < (uint)activeObjects.size(); ++i) {
+		RenderObject* obj = activeObjects[i];
+		SortBlend blend = SortBlend::Opaque;
+		if (obj->GetColour().w < 1.0f) {
+			blend = SortBlend::Transparent;
+		}
+		else if (obj->HasMask()) {
+			blend = SortBlend::Masked;
+		}
+		sortKeys.push_back(SortKey::Make(SORT_PASS_SCENE, blend, shaderSortIDs.Get(obj->GetShader()),
+			materialSortIDs.Get(obj->GetDefaultTexture()), meshSortIDs.Get(obj->GetMesh()), obj->GetCameraDistance()));
+		sortOrder.push_back(i);
+	}
+	RadixSort(sortKeys, sortOrder, sortKeyScratch, sortOrderScratch);
+
+	sortedObjects.clear();
+	for (uint i : sortOrder) {
+		sortedObjects.push_back(activeObjects[i]);
+	}
+	activeObjects.swap(sortedObjects);
 }
 
-void GameTechRenderer::RenderShadowMap() {
-	glBindFramebuffer(GL_FRAMEBUFFER, shadowFBO);
-	glClear(GL_DEPTH_BUFFER_BIT);
-	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
-	glViewport(0, 0, SHADOWSIZE, SHADOWSIZE);
+void GameTechRenderer::UpdateShadowCascades(Camera* current_camera) {
+	Vector3 sceneMin, sceneMax;
+	if (!useShadows || renderMode == 0 || !objectCuller.GetBounds(sceneMin, sceneMax)) {
+		return;
+	}
+	shadowCascades.Update(viewMat, current_camera->GetFieldOfVision(), (float)currentWidth / (float)currentHeight,
+		current_camera->GetNearPlane(), current_camera->GetFarPlane(), sunDirection, sceneMin, sceneMax);
+}
 
-	glCullFace(GL_FRONT);
+void GameTechRenderer::RenderShadows(Camera* current_camera) {
+	// The shaders declare these whether or not the shadows are on
+	Cmds::BindTexture(TEXTURE_BINDING_SHADOW_CASCADES, shadowCascadeTex);
+	Cmds::BindTexture(TEXTURE_BINDING_POINT_SHADOW_ATLAS, pointShadowAtlasTex);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMPUTE_BINDING_POINT_SHADOW_SLOTS, pointShadowSlotSSBO);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMPUTE_BINDING_POINT_SHADOWS, pointShadowSSBO);
+
+	const bool sunShadows = useShadows && renderMode != 0;
+	const bool pointShadows = usePointShadows && renderMode == 3;
+	if ((!sunShadows && !pointShadows) || cullCandidates.empty()) {
+		return;
+	}
+	NCL_GPU_SCOPE(profiler, "Shadows");
 
 	BindShader(shadowShader);
-	int mvpLocation = glGetUniformLocation(shadowShader->GetProgramID(), "mvpMatrix");
-	int hasJointsLocation = glGetUniformLocation(shadowShader->GetProgramID(), "hasJoints");
+	// Every cascade and cube face draws from the same upload, by cull candidate index
+	UploadDrawObjects(cullCandidates);
+	glCullFace(GL_FRONT);
+
+	if (sunShadows) {
+		RenderShadowMaps();
+	}
+	if (pointShadows) {
+		RenderPointShadows(current_camera);
+	}
+
+	glCullFace(GL_BACK);
+	glViewport(0, 0, currentWidth, currentHeight);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
 
-	Matrix4 shadowViewMatrix = Matrix4::BuildViewMatrix(lightPosition, Vector3(0, 0, 0), Vector3(0, 1, 0));
-	Matrix4 shadowProjMatrix = Matrix4::Perspective(100.0f, 500.0f, 1, 45.0f);
+void GameTechRenderer::RenderShadowMaps() {
+	const uint size = shadowCascades.GetSettings().resolution;
+	if (shadowMapSize != size) {
+		AllocateShadowMaps(size);
+	}
 
-	Matrix4 mvMatrix = shadowProjMatrix * shadowViewMatrix;
+	glBindFramebuffer(GL_FRAMEBUFFER, shadowFBO);
+	glViewport(0, 0, size, size);
+
+	for (uint i = 0; i < SHADOW_CASCADE_COUNT; ++i) {
+		const ShadowCascade& cascade = shadowCascades.GetCascade(i);
+		Frustum cascadeFrustum;
+		cascadeFrustum.FromMatrix(cascade.viewProjMatrix);
+		objectCuller.Cull(cascadeFrustum, shadowCasters);
+
+		staticShadowCasters.clear();
+		dynamicShadowCasters.clear();
+		for (uint caster : shadowCasters) {
+			(staticCandidates[caster] ? staticShadowCasters : dynamicShadowCasters).push_back(caster);
+		}
+		shadowShader->SetUniform("viewProjMatrix"_u, cascade.viewProjMatrix);
+
+		if (cascade.staticDirty) {
+			glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadowStaticTex, 0, i);
+			glClear(GL_DEPTH_BUFFER_BIT);
+			DrawShadowCasters(staticShadowCasters);
+			shadowCascades.MarkStaticDrawn(i);
+			shadowLayerIsStatic[i] = false;
+		}
 
-	shadowMatrix = biasMatrix * mvMatrix; //we'll use this one later on
+		// Nothing moving in this cascade and last frame's copy of the static casters is still there
+		if (dynamicShadowCasters.empty() && shadowLayerIsStatic[i]) {
+			continue;
+		}
+		glCopyImageSubData(shadowStaticTex, GL_TEXTURE_2D_ARRAY, 0, 0, 0, i,
+			shadowCascadeTex, GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, size, size, 1);
+		shadowLayerIsStatic[i] = dynamicShadowCasters.empty();
 
-	for (const auto& i : activeObjects) {
-		if (i->GetAnimation()) {
-			MeshGeometry* mesh = i->GetMesh();
+		if (!dynamicShadowCasters.empty()) {
+			glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadowCascadeTex, 0, i);
+			DrawShadowCasters(dynamicShadowCasters);
+		}
+	}
+}
+
+void GameTechRenderer::RenderPointShadows(Camera* current_camera) {
+	const uint size = pointShadowAtlas.GetSettings().atlasSize;
+	if (pointShadowAtlasSize != size) {
+		AllocatePointShadowAtlas(size);
+	}
+	++pointShadowFrame;
+
+	std::span<const PointLight> lights = GetCPULights();
+	const Vector3 cameraPos = current_camera->GetPosition();
+	const float tanHalfFov = std::tan(DegreesToRadians(current_camera->GetFieldOfVision()) * 0.5f);
+	pointShadowRequests.clear();
+	for (uint i = 0; i < (uint)lights.size(); ++i) {
+		const PointLight& light = lights[i];
+		const Vector3 pos(light.pos.x, light.pos.y, light.pos.z);
+		if (frameFrustum.IsInsideFrustum(pos, light.radius.x)) {
+			pointShadowRequests.push_back({ i, PointShadowAtlas::Importance(pos, light.radius.x, light.colour.w, cameraPos, tanHalfFov) });
+		}
+	}
+	pointShadowAtlas.Allocate(pointShadowRequests);
+
+	// Only lights gaining or losing a slot change the slot table
+	const std::vector<uint>& deactivated = pointShadowAtlas.GetDeactivated();
+	const std::vector<PointShadowAssignment>& activated = pointShadowAtlas.GetActivated();
+	const size_t tableChanges = deactivated.size() + activated.size();
+	const StreamingBuffer::Allocation table = tableChanges ? lightStream->Allocate(tableChanges * sizeof(uint)) : StreamingBuffer::Allocation{};
+	if (table.data) {
+		uint* entries = (uint*)table.data;
+		size_t entry = 0;
+		auto setSlot = [&](uint light, uint slot) {
+			entries[entry] = slot;
+			lightStream->CopyTo(pointShadowSlotSSBO, light * sizeof(uint),
+				{ &entries[entry], table.offset + (GLintptr)(entry * sizeof(uint)), sizeof(uint) });
+			++entry;
+		};
+		for (uint light : deactivated) {
+			setSlot(light, POINT_SHADOW_NO_SLOT);
+		}
+		for (const PointShadowAssignment& assignment : activated) {
+			setSlot(assignment.lightIndex, assignment.slot);
+		}
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, pointShadowFBO);
+	glEnable(GL_SCISSOR_TEST);
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(1.5f, 4.0f);
+
+	// Each light only needs the few casters around it. The ones that never move are looked up in an octree, which
+	// costs as much to build as culling every caster against every light, so it's only rebuilt when
+	// UpdateStaticCasters saw one of them move or the set change. The moving ones are few enough to test against
+	// each light directly.
+	if (objectOctreeDirty && !pointShadowAtlas.GetAssignments().empty()) {
+		objectOctreeDirty = false;
+		objectOctree.Clear();
+		if (movingCasters.size() < objectCuller.GetObjectCount()) {
+			objectOctree.Reset(staticCasterMin, staticCasterMax);
+			for (uint i = 0; i < objectCuller.GetObjectCount(); ++i) {
+				if (staticCandidates[i]) {
+					Vector3 centre, halfSize;
+					objectCuller.GetBox(i, centre, halfSize);
+					objectOctree.Insert(i, centre, halfSize);
+				}
+			}
+		}
+	}
+
+	const uint faceSize = pointShadowAtlas.GetSettings().faceSize;
+	for (const PointShadowAssignment& assignment : pointShadowAtlas.GetAssignments()) {
+		const PointLight& light = lights[assignment.lightIndex];
+		const Vector3 pos(light.pos.x, light.pos.y, light.pos.z);
+		const float radius = light.radius.x;
+
+		// Everything in the box around the light's sphere, drawn into all six faces. DrawShadowCasters finds
+		// instanced runs by index, so they go back in order.
+		const Vector3 extent(radius, radius, radius);
+		shadowCasters.clear();
+		objectOctree.QueryBox(pos - extent, pos + extent, [&](uint caster) {
+			shadowCasters.push_back(caster);
+		});
+		for (uint caster : movingCasters) {
+			Vector3 centre, halfSize;
+			objectCuller.GetBox(caster, centre, halfSize);
+			bool overlaps = true;
+			for (int axis = 0; axis < 3; ++axis) {
+				overlaps &= std::abs(centre[axis] - pos[axis]) <= halfSize[axis] + radius;
+			}
+			if (overlaps) {
+				shadowCasters.push_back(caster);
+			}
+		}
+		std::sort(shadowCasters.begin(), shadowCasters.end());
+
+		// A still light keeps its cached faces until a caster near it moves, or UpdateStaticCasters invalidates them
+		uint64_t version = PointShadowVersion(light);
+		for (uint caster : shadowCasters) {
+			if (!staticCandidates[caster]) {
+				version ^= pointShadowFrame * 0x9E3779B97F4A7C15ull;
+				break;
+			}
+		}
+		if (!pointShadowAtlas.NeedsRender(assignment.slot, version)) {
+			continue;
+		}
+
+		Matrix4 faceViewProj[POINT_SHADOW_FACE_COUNT];
+		const StreamingBuffer::Allocation staging = lightStream->Allocate(sizeof(PointShadow));
+		if (!staging.data) {
+			continue;
+		}
+		pointShadowAtlas.BuildFaceMatrices(assignment.slot, pos, radius, faceViewProj, *(PointShadow*)staging.data);
+		lightStream->CopyTo(pointShadowSSBO, assignment.slot * sizeof(PointShadow), staging);
+
+		for (uint face = 0; face < POINT_SHADOW_FACE_COUNT; ++face) {
+			uint x, y;
+			pointShadowAtlas.GetFaceOrigin(assignment.slot, face, x, y);
+			glViewport(x, y, faceSize, faceSize);
+			glScissor(x, y, faceSize, faceSize);
+			glClear(GL_DEPTH_BUFFER_BIT);
+			shadowShader->SetUniform("viewProjMatrix"_u, faceViewProj[face]);
+			DrawShadowCasters(shadowCasters);
+		}
+		pointShadowAtlas.MarkRendered(assignment.slot, version);
+	}
+
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glDisable(GL_SCISSOR_TEST);
+}
+
+void GameTechRenderer::DrawShadowCasters(const vector<uint>& casters) {
+	const GLint hasJointsLocation = shadowShader->GetUniformLocation("hasJoints"_u);
+	MeshGeometry* lastMesh = nullptr;
+	for (size_t first = 0; first < casters.size();) {
+		RenderObject* obj = cullCandidates[casters[first]];
+		// Instances read consecutive ObjectData, so they have to be next to each other in cullCandidates as well
+		const GLuint candidateRun = CountInstances(cullCandidates, casters[first], InstanceMatch::Mesh);
+		GLuint instances = 1;
+		while (instances < candidateRun && first + instances < casters.size() &&
+			casters[first + instances] == casters[first] + instances) {
+			++instances;
+		}
+		SetDrawObject(casters[first]);
+
+		if (obj->GetAnimation()) {
+			MeshGeometry* mesh = obj->GetMesh();
 			vector <Matrix4> frameMatrices;
 			const vector<Matrix4> invBindPose = mesh->GetInverseBindPose();
-			const Matrix4* frameData = i->GetAnimation()->GetJointData(i->GetCurrentFrame());
+			const Matrix4* frameData = obj->GetAnimation()->GetJointData(obj->GetCurrentFrame());
 
 			for (unsigned int i = 0; i < mesh->GetJointCount(); ++i) {
 				frameMatrices.emplace_back(frameData[i] * invBindPose[i]);
 			}
 
-			glUniformMatrix4fv(glGetUniformLocation(shadowShader->GetProgramID(), "joints"), frameMatrices.size(), false,
+			glUniformMatrix4fv(shadowShader->GetUniformLocation("joints"_u), frameMatrices.size(), false,
 				(float*)frameMatrices.data());
 
 			glUniform1i(hasJointsLocation, true);
@@ -1312,24 +2522,20 @@ void GameTechRenderer::RenderShadowMap() {
 			glUniform1i(hasJointsLocation, false);
 		}
 
-		Matrix4 modelMatrix = (*i).GetTransform()->GetMatrix();
-		Matrix4 mvpMatrix = mvMatrix * modelMatrix;
-		glUniformMatrix4fv(mvpLocation, 1, false, (float*)&mvpMatrix);
-		BindMesh((*i).GetMesh());
-		int layerCount = (*i).GetMesh()->GetSubMeshCount();
+		if (obj->GetMesh() != lastMesh) {
+			BindMesh(obj->GetMesh());
+			lastMesh = obj->GetMesh();
+		}
+		int layerCount = obj->GetMesh()->GetSubMeshCount();
 		for (int i = 0; i < layerCount; ++i) {
-			DrawBoundMesh(i);
+			DrawBoundMesh(i, instances);
 		}
+		first += instances;
 	}
-
-	glViewport(0, 0, currentWidth, currentHeight);
-	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-	glCullFace(GL_BACK);
 }
 
 void GameTechRenderer::RenderSkybox(Camera* current_camera) {
+	NCL_GPU_SCOPE(profiler, "Skybox");
 
 	glDisable(GL_CULL_FACE);
 	glDisable(GL_BLEND);
@@ -1362,6 +2568,7 @@ void GameTechRenderer::RenderSkybox(Camera* current_camera) {
 }
 
 void GameTechRenderer::RenderCamera(Camera* current_camera) {
+	NCL_GPU_SCOPE(profiler, "Shading");
 
 	OGLShader* activeShader = nullptr;
 
@@ -1370,20 +2577,20 @@ void GameTechRenderer::RenderCamera(Camera* current_camera) {
 
 	//glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, lightSSBO);
 
-	for (const auto& i : activeObjects) {
+	ResetDrawState();
+	UploadDrawObjects(activeObjects);
+	for (size_t first = 0; first < activeObjects.size();) {
+		RenderObject* i = activeObjects[first];
+		// The objects after this one that can be drawn as instances of it
+		const GLuint instances = CountInstances(activeObjects, first);
 		OGLShader* shader = (OGLShader*)(*i).GetShader();
-		BindShader(shader);
 
 		vector<TextureBase*> textures = (*i).GetTextures();
 
 		if (activeShader != shader) {
-
-			shader->SetUniform("cameraPos", current_camera->GetPosition());
-
-			OGLShader::SetUniforms(shader,
-				"projMatrix", projMat,
-				"viewMatrix", viewMat,
-				"noOfLights", numLights);
+			BindShader(shader);
+			// Texture uniforms are per program, so nothing bound for the last shader carries over
+			ResetDrawState();
 
 			/*int shadowTexLocation = glGetUniformLocation(shader->GetProgramID(), "shadowTex");
 			glUniform1i(shadowTexLocation, 1);*/
@@ -1391,8 +2598,6 @@ void GameTechRenderer::RenderCamera(Camera* current_camera) {
 			activeShader = shader;
 		}
 
-		Matrix4 modelMatrix = (*i).GetTransform()->GetMatrix();
-
 		//Matrix4 fullShadowMat = shadowMatrix * modelMatrix;
 		//glUniformMatrix4fv(shadowLocation, 1, false, (float*)&fullShadowMat);
 
@@ -1401,13 +2606,11 @@ void GameTechRenderer::RenderCamera(Camera* current_camera) {
 		const bool hasBump = textures.size() == layerCount * 2;
 		const bool hasSpec = (*i).GetSpecTextures().size() > 0;
 
+		SetDrawObject((GLuint)first);
 		OGLShader::SetUniforms(activeShader,
-			"modelMatrix", modelMatrix,
-			"objectColour", i->GetColour(),
-			"hasVertexColours", !(*i).GetMesh()->GetColourData().empty(),
-			"hasTexture", (OGLTexture*)(*i).GetDefaultTexture() ? 1 : 0,
-			"hasBump", hasBump,
-			"hasSpec", hasSpec);
+			"hasTexture"_u, (OGLTexture*)(*i).GetDefaultTexture() ? 1 : 0,
+			"hasBump"_u, hasBump,
+			"hasSpec"_u, hasSpec);
 
 		if (i->GetAnimation()) {
 			MeshGeometry* mesh = i->GetMesh();
@@ -1420,18 +2623,20 @@ void GameTechRenderer::RenderCamera(Camera* current_camera) {
 				frameMatrices.emplace_back(frameData[i] * matrix);
 			}
 
-			int j = glGetUniformLocation(((OGLShader*)(*i).GetShader())->GetProgramID(), "joints");
+			int j = ((OGLShader*)(*i).GetShader())->GetUniformLocation("joints"_u);
 			glUniformMatrix4fv(j, frameMatrices.size(), false,
 				(float*)frameMatrices.data());
 		}
 
-		BindAndDraw(i, hasDiff, hasBump);
+		BindAndDraw(i, hasDiff, hasBump, instances);
+		first += instances;
 	}
 //	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
 
 }
 
 void GameTechRenderer::RenderCameraPlus(Camera* current_camera) {
+	NCL_GPU_SCOPE(profiler, "Shading");
 	glDepthMask(GL_FALSE);
 	glColorMask(1, 1, 1, 1);
 	glClear(GL_COLOR_BUFFER_BIT);
@@ -1450,21 +2655,32 @@ void GameTechRenderer::RenderCameraPlus(Camera* current_camera) {
 	//glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, aabbGridSSBO);
 	int sizeX = (unsigned int)std::ceilf(currentWidth / (float)TILE_SIZE);
 
-	for (const auto& i : activeObjects) {
+	if (!shadingBatches.empty()) {
+		BindShader(forwardPlusIndirectShader);
+		OGLShader::SetUniforms(forwardPlusIndirectShader,
+			"numTilesX"_u, tilesX,
+			"tilePxX"_u, sizeX,
+			"inDebug"_u, inDebugMode);
+		DrawShadingBatches();
+		BindShader(forwardPlusShader);
+	}
+
+	ResetDrawState();
+	UploadDrawObjects(directObjects);
+	for (size_t first = 0; first < directObjects.size();) {
+		RenderObject* i = directObjects[first];
+		// The objects after this one that can be drawn as instances of it
+		const GLuint instances = CountInstances(directObjects, first);
 	//	OGLShader* shader = (OGLShader*)(*i).GetShader();
 		OGLShader* shader = forwardPlusShader;
 
 		vector<TextureBase*> textures = (*i).GetTextures();
 
 		if (activeShader != shader) {
-			shader->SetUniform("cameraPos", current_camera->GetPosition());
-
 			OGLShader::SetUniforms(shader,
-				"projMatrix", projMat,
-				"viewMatrix", viewMat,
-				"noOfLights", numLights,
-				"numTilesX", tilesX,
-				"tilePxX", sizeX);
+				"numTilesX"_u, tilesX,
+				"tilePxX"_u, sizeX,
+				"inDebug"_u, inDebugMode);
 
 			/*int shadowTexLocation = glGetUniformLocation(shader->GetProgramID(), "shadowTex");
 			glUniform1i(shadowTexLocation, 1);*/
@@ -1472,26 +2688,22 @@ void GameTechRenderer::RenderCameraPlus(Camera* current_camera) {
 			activeShader = shader;
 		}
 
-		Matrix4 modelMatrix = (*i).GetTransform()->GetMatrix();
-
 		int layerCount = (*i).GetMesh()->GetSubMeshCount();
 		bool hasDiff = (OGLTexture*)(*i).GetDefaultTexture() ? true : false;
 		bool hasBump = textures.size() == layerCount * 2;
 		bool hasSpec = (*i).GetSpecTextures().size() > 0;
 
+		SetDrawObject((GLuint)first);
 		OGLShader::SetUniforms(activeShader,
-			"modelMatrix", modelMatrix,
-			"inDebug", inDebugMode,
-			"objectColour", i->GetColour(),
-			"hasVertexColours", !(*i).GetMesh()->GetColourData().empty(),
-			"hasTexture", (OGLTexture*)(*i).GetDefaultTexture() ? 1 : 0,
-			"hasBump", hasBump,
-			"hasSpec", hasSpec);
+			"hasTexture"_u, (OGLTexture*)(*i).GetDefaultTexture() ? 1 : 0,
+			"hasBump"_u, hasBump,
+			"hasSpec"_u, hasSpec);
 
 		//Matrix4 fullShadowMat = shadowMatrix * modelMatrix;
 		//glUniformMatrix4fv(shadowLocation, 1, false, (float*)&fullShadowMat);
 
-		BindAndDraw(i, hasDiff, hasBump);
+		BindAndDraw(i, hasDiff, hasBump, instances);
+		first += instances;
 	}
 //	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
 	//glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, 0);
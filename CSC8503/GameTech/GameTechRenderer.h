@@ -4,8 +4,24 @@
 #include "Plugins/OpenGLRendering/OGLShader.h"
 #include "Plugins/OpenGLRendering/OGLTexture.h"
 #include "Plugins/OpenGLRendering/OGLMesh.h"
+#include "Plugins/OpenGLRendering/GpuProfiler.h"
+#include "Plugins/OpenGLRendering/GpuScan.h"
+#include "Plugins/OpenGLRendering/GpuDepthPyramid.h"
+#include "Plugins/OpenGLRendering/GBufferLayout.h"
+#include "Plugins/OpenGLRendering/OGLShaderStorageBuffer.h"
+#include "Plugins/OpenGLRendering/OGLMeshArena.h"
 #include "Common/Math/Frustum.h"
+#include "Common/Graphics/ClusterCuller.h"
+#include "Common/Graphics/FrustumCuller.h"
+#include "Common/Graphics/LightBVH.h"
+#include "Common/Graphics/LightAnimator.h"
+#include "Common/Graphics/OcclusionRasterizer.h"
+#include "Common/Graphics/PointShadowAtlas.h"
+#include "Common/Graphics/RadixSort.h"
+#include "Common/Graphics/RenderSortKey.h"
+#include "Common/Graphics/ShadowCascades.h"
 #include "Common/Math/MathsFwd.h"
+#include "Common/Math/Octree.h"
 
 #include "CSC8503Common/GameWorld.h"
 #include "CSC8503Common/NavigationMesh.h"
@@ -27,6 +43,8 @@ namespace NCL {
 #define CLUSTER_GRID_Z 24
 
 #define MAX_LIGHTS_PER_TILE 2048
+// Starting size of the packed light index list, per tile/cluster. The list grows to fit when culling overflows it.
+#define INITIAL_LIGHTS_PER_CELL 32
 #define LIGHT_RADIUS 40.0 / WORLD_SCALE
 
 		constexpr unsigned int numClusters = CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z;
@@ -37,6 +55,15 @@ namespace NCL {
 			float ratio = 1.0f;
 		};
 
+		// Where objects hidden behind others are culled, if anywhere
+		enum class OcclusionCulling {
+			Off,
+			// occlusionCull.comp against the depth prepass pyramid, needs forward+ or clustered with the prepass
+			GPU,
+			// OcclusionRasterizer on the CPU before any drawing, works in every mode
+			CPU,
+		};
+
 		class GameTechRenderer : public OGLRenderer {
 		public:
 			GameTechRenderer(GameWorld& w, ResourceManager* rm, int type = 0, bool prepass = false);
@@ -48,12 +75,19 @@ namespace NCL {
 			void RenderStartView();
 			void ResizeSceneTextures(float width, float height);
 
-			// Updates the positon of all lights in the SSBO on the CPU.
+			// Animates all lights in the SSBO on the CPU with LightAnimator, spread across threads.
 			void UpdateLights(float dt);
 
-			// Dispatches a compute shader to update the position of all lights in the SSBO.
+			// Animates all lights in the SSBO with updateLights.comp, one thread per light.
 			void UpdateLightsGPU(float dt);
 
+			// Sets which motion models the light updates apply, as LIGHT_ANIMATION_ flags
+			void SetLightAnimation(uint models);
+
+			uint GetLightAnimation() const {
+				return lightAnimation.models;
+			}
+
 			/// <summary>
 			/// Adds N lights to the scene with random positions and colours.
 			/// </summary>
@@ -83,20 +117,144 @@ namespace NCL {
 				inDebugMode = !inDebugMode;
 			}
 
+			void ToggleLightBVH() {
+				useLightBVH = !useLightBVH;
+			}
+
+			bool IsUsingLightBVH() const {
+				return useLightBVH;
+			}
+
+			// Deferred only, switches between DeferredLighting and DrawPointLights
+			void ToggleLightVolumes() {
+				useLightVolumes = !useLightVolumes;
+			}
+
+			bool IsUsingLightVolumes() const {
+				return useLightVolumes;
+			}
+
+			// Deferred only, reallocates the G-buffer and lighting targets in the layout's formats
+			void SetGBufferLayout(GBufferLayout layout);
+
+			GBufferLayout GetGBufferLayout() const {
+				return gBufferLayout;
+			}
+
+			// Cascaded shadow maps for the sun, forward+, clustered and deferred only
+			void ToggleShadows() {
+				useShadows = !useShadows;
+			}
+
+			bool IsUsingShadows() const {
+				return useShadows;
+			}
+
+			// Clustered only, cube shadows in an atlas for the most important point lights
+			void TogglePointShadows() {
+				usePointShadows = !usePointShadows;
+			}
+
+			bool IsUsingPointShadows() const {
+				return usePointShadows;
+			}
+
+			// Redraws the static casters into every cascade and point shadow next frame. Moving, adding or removing
+			// one does this by itself, this is for changes that leave the bounds alone, like a new mesh.
+			void InvalidateShadowCache() {
+				shadowCascades.Invalidate();
+				pointShadowAtlas.Invalidate();
+			}
+
+			void ToggleInstancing() {
+				useInstancing = !useInstancing;
+			}
+
+			bool IsUsingInstancing() const {
+				return useInstancing;
+			}
+
+			void ToggleIndirectDraws() {
+				useIndirectDraws = !useIndirectDraws;
+			}
+
+			bool IsUsingIndirectDraws() const {
+				return useIndirectDraws;
+			}
+
+			void SetOcclusionCulling(OcclusionCulling mode) {
+				occlusionCulling = mode;
+			}
+
+			OcclusionCulling GetOcclusionCulling() const {
+				return occlusionCulling;
+			}
+
+			// Logs how many objects the next frame's GPU occlusion cull keeps, read back from objectVisibilityBuffer
+			void RequestOcclusionStats() {
+				checkOcclusion = true;
+			}
+
+			// Objects the CPU occlusion cull removed last frame
+			uint GetOccludedObjectCount() const {
+				return occludedObjects;
+			}
+
+			// Checks the next frame's GPU compacted cluster list against CompactIndices on the CPU
+			void RequestCompactionCheck() {
+				checkCompaction = true;
+			}
+
+			GpuProfiler& GetProfiler() {
+				return profiler;
+			}
+
+			// Times streaming light data had to wait for the GPU to catch up, should stay at 0
+			uint64_t GetLightStreamStalls() const {
+				return lightStream ? lightStream->GetStallCount() : 0;
+			}
+
 
 		protected:
+			// One submesh of an object drawn from the mesh arena, with the textures it needs bound
+			struct IndirectDraw {
+				GLuint objectIndex;
+				GLuint firstIndex;
+				GLuint indexCount;
+				GLint baseVertex;
+				OGLTexture* diffuse;
+				OGLTexture* bump;
+				OGLTexture* spec;
+				// The diffuse texture if the prepass alpha tests this object
+				OGLTexture* mask;
+			};
+
+			// A run of a pass's commands sharing the same textures, drawn with one glMultiDrawElementsIndirect.
+			// The prepass uses diffuse as its mask.
+			struct IndirectBatch {
+				GLuint firstCommand;
+				GLsizei commandCount;
+				OGLTexture* diffuse;
+				OGLTexture* bump;
+				OGLTexture* spec;
+			};
+
 			virtual void RenderFrame()	override final;
 			virtual void BeginFrame() override final;
+			virtual void EndFrame() override final;
 
 			void InitForward(bool withPrepass = false);
 			void InitDeferred();
 			void InitForwardPlus();
 			void InitClustered(bool withPrepass = false);
+			// The cluster grid, light lists and culling shaders, shared by clustered shading and deferred lighting
+			void InitClusterCulling();
 
 			void ComputeTileGrid();
 			void ComputeClusterGrid();
 			void ComputeActiveClusters();
 			void CompactClusterList();
+			void CheckCompaction();
 
 			void RenderForward(bool withPrepass = false);
 			void RenderDeferred();
@@ -106,9 +264,35 @@ namespace NCL {
 			void GenPrePassFBO();
 
 			void DepthPrePass();
+			// Reduces the prepass depth into depthPyramid, for the forward+ tile bounds and active cluster flags
+			void BuildDepthPyramid();
+			// Tests the object behind each shading command against depthPyramid with occlusionCull.comp, writing the
+			// commands the shading pass draws to culledCommandBuffer
+			void OcclusionCullGPU();
+			// Rasterizes the largest objects in activeObjects with occlusionRasterizer, up to a triangle budget and only
+			// when they or the view have changed, and removes the objects hidden behind them
+			void OcclusionCullCPU(Camera* currentCamera);
+			void CheckOcclusion();
 
 			void ForwardPlusCullLights();
 			void ClusteredCullLights();
+			// Culls lights with ClusterCuller and uploads the result to lightGridSSBO and lightIndexSSBO.
+			void ClusteredCullLightsCPU();
+			// Clustered culling that walks lightBVH instead of testing every light against every cluster.
+			void ClusteredCullLightsBVH();
+			// Keeps lightBVH's buffers up to date for clusterCullBVH.comp. The lights are re-sorted on the CPU when their
+			// count changes, or every LIGHT_BVH_REBUILD_FRAMES frames while they move, and the node bounds are refit
+			// with lightBVHRefit.comp whenever they've moved.
+			void BuildLightBVH();
+			void GenLightBVHBuffers();
+
+			// Allocates the LightGrid, packed light index list and index counter used by the forward+ and clustered paths.
+			void GenLightListBuffers(size_t numCells);
+			// Advances the animation clock and returns the parameters for this update of the lights
+			LightAnimationParams NextLightAnimation(float dt);
+			// Grows the light index list if a recent cull overflowed it and resets the counter. Call before culling.
+			void PrepareLightIndexList();
+			void GrowLightIndexList(GLuint required);
 
 			virtual Matrix4 SetupDebugLineMatrix()	const override final;
 			virtual Matrix4 SetupDebugStringMatrix() const override final;
@@ -117,31 +301,140 @@ namespace NCL {
 
 			GameWorld& gameWorld;
 
+			// Gathers the bounds of every active object into objectCuller and keeps the ones inside the camera's frustum
 			void BuildObjectList(Camera* current_camera);
+			// Splits the objects BuildObjectList gathered into movingCasters and the static casters, and redraws the
+			// static layer of every cascade and every cached point shadow when the static casters' bounds change
+			void UpdateStaticCasters();
+			// Fills out with the objects gathered by BuildObjectList that are at least partly inside frustum
+			void CullObjectList(const Frustum& frustum, vector<RenderObject*>& out);
+			// Orders activeObjects by a sort key per object: opaque front to back grouped by shader, texture and mesh, then
+			// masked, then transparent back to front
 			void SortObjectList();
-			void RenderShadowMap();
+			// Fits shadowCascades to the camera, before UploadFrameData writes them out
+			void UpdateShadowCascades(Camera* current_camera);
+			// Binds the shadow textures and buffers the shaders read, and draws whichever shadows are on
+			void RenderShadows(Camera* current_camera);
+			// Redraws the static casters of any cascade that moved into shadowStaticTex, copies them into
+			// shadowCascadeTex and draws the moving casters over them
+			void RenderShadowMaps();
+			// Ranks the lights inside the camera's frustum, gives the most important slots in pointShadowAtlas and
+			// redraws the ones whose light or casters changed since their slot was drawn
+			void RenderPointShadows(Camera* current_camera);
+			// Draws cullCandidates[casters[i]] with shadowShader, casters ascending. Needs the candidates uploaded with
+			// UploadDrawObjects.
+			void DrawShadowCasters(const vector<uint>& casters);
 			void RenderCamera(Camera* current_camera);
 			void RenderCameraPlus(Camera* current_camera);
 			void RenderSkybox(Camera* current_camera);
 			void LoadSkybox();
 
 			void FillBuffers(Camera* current_camera, float depth);
+			// Lights the G-buffer by drawing a sphere around each light, as one instanced draw
 			void DrawPointLights(Camera* current_camera);
+			// Lights the G-buffer with a compute pass over its pixels, each reading its cluster's light list
+			// from ClusteredCullLights. Writes the same diffuse and specular targets as DrawPointLights.
+			void DeferredLighting();
 		//	void DrawPaintDecals(Camera* current_camera);
 			void CombineBuffers(Camera* current_camera);
 
-			void GenerateScreenTexture(GLuint& into, bool depth = false);
-			void GenerateShadowBuffer(GLuint& into);
-
-			void BindAndDraw(RenderObject* obj, bool hasDiff, bool hasBump);
-
-			// Updates the currently bound shader with projMat and viewMat;
-			void UpdateShaderMatrices();
+			// Creates a screen sized texture that ResizeSceneTextures keeps at the window size
+			void GenerateScreenTexture(GLuint& into, GLenum internalFormat = GL_RGBA8);
+			// Reallocates a texture from GenerateScreenTexture in another format. GL_NONE releases its storage.
+			void SetScreenTextureFormat(GLuint texture, GLenum internalFormat);
+			void AllocateScreenTexture(GLuint texture, GLenum internalFormat);
+			// Puts the G-buffer and lighting targets in gBufferLayout's formats and attaches the lighting targets
+			void AllocateGBuffer();
+			void GenerateShadowMaps();
+			// Sizes both cascade arrays to size x size and marks every cascade's static casters to be redrawn
+			void AllocateShadowMaps(uint size);
+			void GeneratePointShadowAtlas();
+			void AllocatePointShadowAtlas(uint size);
+
+			// Binds obj's mesh and textures, skipping whatever drawState says is still bound, then draws each sub mesh
+			// with instances copies, reading consecutive ObjectData from the one SetDrawObject picked
+			void BindAndDraw(RenderObject* obj, bool hasDiff, bool hasBump, GLuint instances = 1);
+			// Forgets what BindAndDraw last bound, for the start of a draw loop or after something else has bound state
+			void ResetDrawState();
+
+			// Loads the arena shaders for the prepass and, if shadingFrag isn't empty, shading with it
+			void InitIndirectDraws(const std::string& shadingFrag);
+			// Writes this frame's ObjectData and the prepass and shading commands into drawStream, and puts
+			// anything the arena can't draw (skinned or non-triangle meshes) in directObjects
+			void BuildIndirectDraws();
+			// Issues prepassBatches or shadingBatches with the bound shader, one glMultiDrawElementsIndirect each.
+			// The batches' commands are read from commandBuffer, starting commandOffset bytes in.
+			void DrawIndirectBatches(const vector<IndirectBatch>& batches, GLuint commandBuffer, GLintptr commandOffset, bool depthOnly);
+			// Draws shadingBatches from culledCommandBuffer if OcclusionCullGPU ran this frame, otherwise from drawStream
+			void DrawShadingBatches();
+
+			// Writes viewMat, projMat, the camera and the light count into the frame uniform block and the sun and its
+			// cascades into the shadow block, and sizes this frame's uniformStream allocation for the ObjectData the
+			// direct draws upload
+			void UploadFrameData(Camera* current_camera);
+			// Writes ObjectData for objects into this frame's uniformStream allocation and binds it where the vertex
+			// shaders read it, so objects[i] is drawn with SetDrawObject(i)
+			void UploadDrawObjects(const vector<RenderObject*>& objects);
+			// Sets the object index the next direct draw reads its ObjectData with
+			void SetDrawObject(GLuint objectIndex);
+
+			// The state objects must share to be drawn as instances of each other, shading needs all of it
+			enum class InstanceMatch {
+				Shading,
+				// Mesh and alpha mask, for the depth prepass
+				Depth,
+				Mesh,
+			};
+			// How many objects from objects[first] on can be drawn as one instanced draw, at least 1. Relies on
+			// objects being sorted so that ones sharing state are next to each other.
+			GLuint CountInstances(const vector<RenderObject*>& objects, size_t first, InstanceMatch match = InstanceMatch::Shading) const;
 
 			// Appends the span of lights to an SSBO on the GPU and increments numLights
 			void UploadLights(std::span<const PointLight> lights);
+			// Returns cpuLights. If the GPU is animating the lights, they're updated from the newest finished copy of
+			// lightSSBO, which lags the GPU by a frame or two, rather than waiting for it.
+			std::span<const PointLight> GetCPULights();
 
 			vector<RenderObject*> activeObjects;
+			// Every active object this frame, before frustum culling, with its bounds at the same index in objectCuller
+			vector<RenderObject*> cullCandidates;
+			FrustumCuller objectCuller;
+			// The same bounds of the cull candidates that don't move, for the point shadow passes to find the casters
+			// near each light. Rebuilt when staticCasterVersion, a hash of those bounds, changes.
+			Octree<uint> objectOctree;
+			bool objectOctreeDirty = true;
+			uint64_t staticCasterVersion = 0;
+			// Bounds of every static caster, the octree's root
+			Vector3 staticCasterMin;
+			Vector3 staticCasterMax;
+			// The cull candidates left out of objectOctree, tested against each light directly
+			vector<uint> movingCasters;
+			vector<uint> visibleObjects;
+			// Set for each cull candidate that neither moves nor animates, so it can stay in the cached shadow maps
+			vector<bool> staticCandidates;
+			// Scratch for RenderShadowMaps, indices into cullCandidates
+			vector<uint> shadowCasters;
+			vector<uint> staticShadowCasters;
+			vector<uint> dynamicShadowCasters;
+			// The part of activeObjects drawn one by one, all of it unless indirect draws are on
+			vector<RenderObject*> directObjects;
+			// SortObjectList's keys and the activeObjects index each belongs to, plus scratch for the radix sort
+			vector<uint64_t> sortKeys;
+			vector<uint> sortOrder;
+			vector<uint64_t> sortKeyScratch;
+			vector<uint> sortOrderScratch;
+			vector<RenderObject*> sortedObjects;
+			SortKeyIDs shaderSortIDs;
+			SortKeyIDs materialSortIDs;
+			SortKeyIDs meshSortIDs;
+
+			// What BindAndDraw last bound, so neighbouring objects that share state don't rebind it
+			struct BoundDrawState {
+				MeshGeometry* mesh = nullptr;
+				const TextureBase* diffuse = nullptr;
+				const TextureBase* bump = nullptr;
+				const TextureBase* spec = nullptr;
+			} drawState;
 			RenderObject* root;
 			Frustum      frameFrustum;
 			Frustum      viceFrustum;
@@ -152,9 +445,33 @@ namespace NCL {
 
 			//shadow mapping things
 			OGLShader* shadowShader;
-			GLuint		shadowTex;
-			GLuint		shadowFBO;
-			Matrix4     shadowMatrix;
+			ShadowCascades shadowCascades;
+			// A depth layer per cascade, what the shaders sample: the static casters with the moving ones drawn over them
+			GLuint		shadowCascadeTex = 0;
+			// Only the static casters, kept between frames and redrawn for a cascade only when it moves
+			GLuint		shadowStaticTex = 0;
+			GLuint		shadowFBO = 0;
+			uint		shadowMapSize = 0;
+			// Set for each layer of shadowCascadeTex that holds nothing but a copy of the static casters
+			std::array<bool, SHADOW_CASCADE_COUNT> shadowLayerIsStatic = {};
+			bool		useShadows = false;
+			// The way the sun's light travels
+			Vector3		sunDirection = Vector3(-0.4f, -1.0f, -0.3f);
+			// rgb colour, a intensity
+			Vector4		sunColour = Vector4(1.0f, 0.95f, 0.85f, 0.8f);
+
+			PointShadowAtlas pointShadowAtlas;
+			GLuint		pointShadowAtlasTex = 0;
+			GLuint		pointShadowFBO = 0;
+			uint		pointShadowAtlasSize = 0;
+			// POINT_SHADOW_NO_SLOT or the atlas slot of each light in lightSSBO, updated as lights gain and lose slots
+			GLuint		pointShadowSlotSSBO = 0;
+			// A PointShadow per atlas slot, written when the slot is drawn
+			GLuint		pointShadowSSBO = 0;
+			bool		usePointShadows = false;
+			// Counts RenderPointShadows calls, so lights with moving casters get a new version every frame
+			uint64_t	pointShadowFrame = 0;
+			vector<PointShadowRequest> pointShadowRequests;
 
 			OGLShader* sceneShader;
 			OGLShader* lightUpdateShader;
@@ -163,6 +480,8 @@ namespace NCL {
 			OGLShader* forwardPlusShader;
 			OGLShader* forwardPlusGridShader;
 			OGLShader* forwardPlusCullShader;
+			OGLShader* lightBVHCullShader = nullptr;
+			OGLShader* deferredLightingShader = nullptr;
 			OGLShader* depthPrepassShader;
 			OGLShader* debugShader;
 
@@ -180,13 +499,21 @@ namespace NCL {
 			
 			GLuint lightSSBO;
 			GLuint lightGridSSBO;
+			GLuint lightIndexSSBO;
+			GLuint lightIndexCounterSSBO;
+			GLuint lightIndexCapacity = 0;
+			// Copies of lightIndexCounterSSBO, so PrepareLightIndexList can size the list without waiting on the GPU
+			std::unique_ptr<ReadbackBuffer> lightIndexCountReadback;
+			GLuint lightBVHNodeSSBO;
+			GLuint lightBVHOrderSSBO;
 			GLuint aabbGridSSBO;
+			// Compacted list of clusters with geometry in them, and the indirect dispatch that culls them
 			GLuint activeClusterSSBO;
+			GLuint activeClusterDispatchSSBO;
 
 			// Test/debug buffers.
 			GLuint globalListSSBO;
 			GLuint globalCountSSBO;
-			GLuint activeCountSSBO;
 
 			int tilesX;
 			int tilesY;
@@ -226,7 +553,11 @@ namespace NCL {
 			bool loading;
 
 			vector<GLuint> sceneTextures;
-			vector<GLuint> screenTextures;
+			struct ScreenTexture {
+				GLuint texture;
+				GLenum internalFormat;
+			};
+			vector<ScreenTexture> screenTextures;
 			vector<GLuint> sceneBuffers;
 
 			int renderMode;
@@ -241,6 +572,105 @@ namespace NCL {
 			// clustered 
 			ClusterParams clusterParams;
 
+			// CPU fallback for drivers missing the subgroup extensions used by clusterCull.comp
+			ClusterCuller cpuCuller{ ClusterGridDesc{ CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z, MAX_LIGHTS_PER_TILE } };
+			bool useCPUCulling = false;
+			// Cull only the clusters ComputeActiveClusters found geometry in, clustered with the prepass
+			bool activeClusterCulling = false;
+			// Light the G-buffer with DrawPointLights rather than DeferredLighting
+			bool useLightVolumes = false;
+			GBufferLayout gBufferLayout = GBufferLayout::RGBA8;
+
+			LightBVH lightBVH;
+			bool useLightBVH = false;
+			OGLShader* lightBVHRefitShader = nullptr;
+			// lightBVH's nodes and order are the ones in lightBVHNodeSSBO and lightBVHOrderSSBO
+			bool lightBVHUploaded = false;
+			// Frames since lightBVH was last sorted for the GPU
+			uint lightBVHAge = 0;
+			// Bumped whenever the lights in lightSSBO change, and the value the BVH's bounds were last refit for
+			uint64_t lightVersion = 0;
+			uint64_t lightBVHVersion = 0;
+
+			// Hierarchical min/max of the prepass depth, only created for forward+ and clustering with the depth prepass
+			std::unique_ptr<GpuDepthPyramid> depthPyramid;
+
+			// Builds the active cluster list from the flags, only created when clustering with the depth prepass
+			std::unique_ptr<GpuCompact> clusterCompact;
+			bool checkCompaction = false;
+
+			GpuProfiler profiler;
+
+			// Motion models and their settings, dt, time and lightCount are filled in each update
+			LightAnimationParams lightAnimation;
+			float lightAnimationTime = 0.0f;
+			// Set when flicker is turned off, so the next update puts every light back to full intensity
+			bool resetLightIntensity = false;
+			LightAnimator lightAnimator{ JobSystem::Get() };
+
+			// Copy of the lights in lightSSBO, animated by UpdateLights and read by the CPU culling
+			std::vector<PointLight> cpuLights;
+			// Set by UpdateLightsGPU, cpuLights is behind lightSSBO until the CPU animates them again
+			bool cpuLightsStale = false;
+			// Set by GetCPULights while the lights are stale, so UpdateLightsGPU copies lightSSBO into lightReadback
+			bool cpuLightsWanted = false;
+			// Sequence number of the lightReadback copy cpuLights was last updated from
+			uint64_t cpuLightsSequence = 0;
+			// Made the first time the CPU wants lights animated on the GPU
+			std::unique_ptr<ReadbackBuffer> lightReadback;
+			// Stages light uploads and animation parameters, so neither waits on the GPU
+			std::unique_ptr<StreamingBuffer> lightStream;
+			// The frame uniform block and the direct draws' ObjectData, one allocation per frame carved up by
+			// UploadFrameData and UploadDrawObjects
+			std::unique_ptr<StreamingBuffer> uniformStream;
+			StreamingBuffer::Allocation frameUniforms;
+			GLsizeiptr frameUniformsUsed = 0;
+			// Draw runs of objects that share a mesh and material with one instanced draw on the direct path
+			bool useInstancing = true;
+
+			// Static meshes packed into shared buffers, so the prepass and shading draw them with a few glMultiDrawElementsIndirect
+			std::unique_ptr<OGLMeshArena> meshArena;
+			// Holds each frame's ObjectData followed by its draw commands, in one allocation
+			std::unique_ptr<StreamingBuffer> drawStream;
+			StreamingBuffer::Allocation frameDraws;
+			GLsizeiptr frameObjectBytes = 0;
+			// Where each pass's commands start in drawStream, padded so they can be bound as storage ranges
+			GLintptr prepassCommandOffset = 0;
+			GLintptr shadingCommandOffset = 0;
+			vector<IndirectBatch> prepassBatches;
+			vector<IndirectBatch> shadingBatches;
+			// Scratch for BuildIndirectDraws, kept to avoid reallocating each frame
+			vector<RenderObject*> indirectObjects;
+			vector<IndirectDraw> indirectDraws;
+			vector<uint> indirectDrawOrder;
+			OGLShader* depthPrepassIndirectShader = nullptr;
+			OGLShader* forwardPlusIndirectShader = nullptr;
+			bool useIndirectDraws = true;
+
+			OcclusionCulling occlusionCulling = OcclusionCulling::Off;
+			OGLShader* occlusionCullShader = nullptr;
+			// The shading commands with occluded objects' instance counts zeroed, and a flag per object
+			GLuint culledCommandBuffer = 0;
+			GLuint objectVisibilityBuffer = 0;
+			GLuint culledCommandCapacity = 0;
+			GLuint objectVisibilityCapacity = 0;
+			// Set by OcclusionCullGPU when this frame's shading draws from culledCommandBuffer
+			bool shadingCommandsCulled = false;
+			bool checkOcclusion = false;
+			OcclusionRasterizer occlusionRasterizer;
+			// Scratch for OcclusionCullCPU, the world space bounds of each object in activeObjects
+			vector<Vector3> occlusionCentres;
+			vector<Vector3> occlusionHalfSizes;
+			struct OccluderCandidate {
+				float coverage;
+				// In activeObjects
+				uint index;
+			};
+			vector<OccluderCandidate> occluderCandidates;
+			// Hash of the view and the occluders last rasterized, the depth is only redrawn when it changes
+			uint64_t occluderVersion = 0;
+			uint occludedObjects = 0;
+
 			std::mt19937 lightGen;
 			std::uniform_real_distribution<> lightDist;
 			static constexpr Vector3 LIGHT_MIN_BOUNDS = Vector3(-560.0f, 0.0f, -230.0f) / WORLD_SCALE;
@@ -1,7 +1,6 @@
 #include "Common/Graphics/Window.h"
 #include "../GameTech/TutorialGame.h"
 #include <iostream>
-#include <fstream>
 
 using namespace NCL;
 using namespace CSC8503;
@@ -9,18 +8,8 @@ using namespace CSC8503;
 //extern "C" _declspec(dllexport) DWORD NvOptimusEnablement = 1;
 
 
+// Frame time and light count benchmarking lives in the RenderBench project.
 int main() {
-	
-	int frameCount = 0;
-	bool fileOpen = false;
-	bool init = true;
-	bool reachedCapacity = false;
-	const std::string OUTPUTDIR("../../Data/");
-	//std::ofstream file;
-	//file.open(OUTPUTDIR + "deferrred-final-noatten-clumped.csv", std::ios_base::app);
-	//fileOpen = true;
-	//file << "frame time" << "," << "Number of lights" << std::endl;
-
 	//GamePushdownState::InitGameState();
 	//Window* w = Window::CreateGameWindow("CSC8503 Game technology!", 1280, 720);
 	Window* w = Window::CreateGameWindow("CSC8503 Game technology!", 1920, 1080, false, 0, 0);
@@ -36,7 +25,7 @@ int main() {
 	TutorialGame* g = new TutorialGame();
 	//PushdownMachine machine(new MainMenu());
 	w->GetTimer()->GetTimeDeltaSeconds(); //Clear the timer so we don't get a larget first dt!
-	while (w->UpdateWindow() && !Window::GetKeyboard()->KeyDown(KeyboardKeys::ESCAPE) && !reachedCapacity) {
+	while (w->UpdateWindow() && !Window::GetKeyboard()->KeyDown(KeyboardKeys::ESCAPE)) {
 		float dt = w->GetTimer()->GetTimeDeltaSeconds();
 		if (dt > 0.45f) {
 			std::cout << "Skipping large time delta" << std::endl;
@@ -54,18 +43,6 @@ int main() {
 		}
 		float frameTime = 1000.0f * dt;
 		w->SetTitle("Frame time:" + std::to_string( frameTime) + "    No. of Lights:" + std::to_string(g->GetRenderer()->GetNumLight()));
-		/*if (frameCount > 300) {
-			if (frameCount <= 800) {
-				file << frameTime << "," << g->GetRenderer()->GetNumLight() << std::endl;
-			}
-			else {
-				int count = g->GetRenderer()->GetNumLight() == 0 ? 1 : g->GetRenderer()->GetNumLight();
-				reachedCapacity = !g->GetRenderer()->AddLights(count);
-				frameCount = 240;
-			}
-		}
-		frameCount++;*/
-
 		g->UpdateGame(dt);
 
 		/*if (!machine.Update(dt)) {
@@ -74,8 +51,4 @@ int main() {
 		//DisplayPathfinding();
 	}
 	Window::DestroyGameWindow();
-	//if (file.is_open()) {
-	//	file.close();
-	//}
-
 }
\ No newline at end of file
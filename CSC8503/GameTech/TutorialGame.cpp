@@ -18,9 +18,6 @@ using std::endl;
 using std::cin;
 
 TutorialGame::TutorialGame() {
-	world = new GameWorld();
-	
-	resourceManager = &OGLResourceManager::Get();
 	bool prepass = false;
 	int mode = AskRenderingMode();
 	if (mode == 0 || mode == 3) {
@@ -30,6 +27,18 @@ TutorialGame::TutorialGame() {
 		prepass = AskForwardPlus();
 	}
 
+	InitGame(mode, prepass);
+}
+
+TutorialGame::TutorialGame(int mode, bool prepass) {
+	InitGame(mode, prepass);
+}
+
+void TutorialGame::InitGame(int mode, bool prepass) {
+	world = new GameWorld();
+	
+	resourceManager = &OGLResourceManager::Get();
+
 	InitCamera();
 
 	renderer = new GameTechRenderer(*world, resourceManager, mode, prepass);
@@ -239,10 +248,94 @@ void TutorialGame::UpdateKeys() {
 	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::P)) {
 		Vector3 pos = world->GetMainCamera()->GetPosition();
 		LOG_INFO("Camera Position (x,y,z): {}", pos);
+		physics->UseSleep(!physics->IsUsingSleep());
+		LOG_INFO("Setting sleeping to {}", physics->IsUsingSleep());
+	}
+	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::B)) {
+		physics->UseBroadPhase(!physics->IsUsingBroadPhase());
+		LOG_INFO("Setting broadphase to {}", physics->IsUsingBroadPhase());
+	}
+	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::I)) {
+		physics->SetConstraintIterations(physics->GetConstraintIterations() - 1);
+		LOG_INFO("Setting constraint iterations to {}", physics->GetConstraintIterations());
+	}
+	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::O)) {
+		physics->SetConstraintIterations(physics->GetConstraintIterations() + 1);
+		LOG_INFO("Setting constraint iterations to {}", physics->GetConstraintIterations());
 	}
 	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::NUM9)) {
 		renderer->ToggleDebugMode();
 	}
+	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::NUM8)) {
+		renderer->ToggleLightBVH();
+		LOG_INFO("Light BVH culling {}", renderer->IsUsingLightBVH() ? "enabled" : "disabled");
+	}
+	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::NUM7)) {
+		renderer->RequestCompactionCheck();
+	}
+	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::NUM5)) {
+		renderer->ToggleIndirectDraws();
+		LOG_INFO("Multi-draw-indirect scene submission {}", renderer->IsUsingIndirectDraws() ? "enabled" : "disabled");
+	}
+	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::NUM0)) {
+		renderer->ToggleInstancing();
+		LOG_INFO("Instanced drawing of repeated objects {}", renderer->IsUsingInstancing() ? "enabled" : "disabled");
+	}
+	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::L)) {
+		renderer->ToggleLightVolumes();
+		LOG_INFO("Deferred lighting with {}", renderer->IsUsingLightVolumes() ? "instanced light volumes" : "clustered light lists");
+	}
+	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::G)) {
+		// Deferred only, cycles RGBA8, compact and compact HDR
+		renderer->SetGBufferLayout((Rendering::GBufferLayout)(((int)renderer->GetGBufferLayout() + 1) % Rendering::GBUFFER_LAYOUT_COUNT));
+	}
+	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::H)) {
+		renderer->ToggleShadows();
+		LOG_INFO("Cascaded sun shadows {}", renderer->IsUsingShadows() ? "enabled" : "disabled");
+	}
+	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::J)) {
+		// Clustered only
+		renderer->TogglePointShadows();
+		LOG_INFO("Point light shadow atlas {}", renderer->IsUsingPointShadows() ? "enabled" : "disabled");
+	}
+	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::NUM4)) {
+		// Off, GPU, CPU. GPU does nothing unless the mode has a depth prepass and indirect draws are on.
+		const OcclusionCulling mode = (OcclusionCulling)(((int)renderer->GetOcclusionCulling() + 1) % 3);
+		renderer->SetOcclusionCulling(mode);
+		LOG_INFO("Occlusion culling {}", mode == OcclusionCulling::Off ? "off" : mode == OcclusionCulling::GPU ? "on the GPU" : "on the CPU");
+	}
+	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::NUM3)) {
+		if (renderer->GetOcclusionCulling() == OcclusionCulling::CPU) {
+			LOG_INFO("CPU occlusion culled {} objects last frame", renderer->GetOccludedObjectCount());
+		}
+		else {
+			renderer->RequestOcclusionStats();
+		}
+	}
+	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::NUM2)) {
+		const Rendering::RenderStateCounters& counters = renderer->GetLastFrameCounters();
+		LOG_INFO("Last frame: {} draws, {} shader changes, {} mesh changes, {} texture binds",
+			counters.drawCalls, counters.shaderChanges, counters.meshChanges, counters.textureBinds);
+	}
+	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::NUM6)) {
+		// Steps through every combination of the motion models
+		const uint models = (renderer->GetLightAnimation() + 1) % (LIGHT_ANIMATION_FLICKER * 2);
+		renderer->SetLightAnimation(models);
+		LOG_INFO("Light animation fall {}, orbit {}, flicker {}", (models & LIGHT_ANIMATION_FALL) != 0,
+			(models & LIGHT_ANIMATION_ORBIT) != 0, (models & LIGHT_ANIMATION_FLICKER) != 0);
+	}
+	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::F3)) {
+		GpuProfiler& profiler = renderer->GetProfiler();
+		if (!profiler.IsCapturing()) {
+			profiler.StartCapture();
+			LOG_INFO("GPU profiler capture started, press F3 again to stop");
+		}
+		else {
+			profiler.Flush();
+			profiler.StopCapture();
+			profiler.WriteChromeTrace(Assets::OUTPUTDIR + "gpu_trace.json");
+		}
+	}
 	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::MINUS)) {
 		lightsToAdd = (std::max)(lightsToAdd / 2, 1u);
 		LOG_INFO("Decreased lights to {}", lightsToAdd);
@@ -18,6 +18,9 @@ namespace NCL {
 		public:
 			TutorialGame();
 			TutorialGame(int level);
+			// Skips the console prompts. Mode is 0 forward, 1 deferred, 2 forward+, 3 clustered.
+			// Prepass selects the depth prepass for forward and clustered, and AABB culling for forward+.
+			TutorialGame(int mode, bool prepass);
 			TutorialGame(GameWorld* gameWorld, GameTechRenderer* gameRenderer);
 			~TutorialGame();
 
@@ -47,6 +50,7 @@ namespace NCL {
 			bool AskForwardPlus();
 
 		protected:
+			void InitGame(int mode, bool prepass);
 			void InitialiseAssets(int level = 1);
 
 			void InitCamera();
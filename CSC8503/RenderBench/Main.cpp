@@ -0,0 +1,15 @@
+#include "RenderBench.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+int main(int argc, char** argv) {
+	RenderBenchConfig config;
+	if (!config.Parse(argc, argv)) {
+		RenderBenchConfig::PrintUsage(argv[0]);
+		return 1;
+	}
+
+	RenderBench bench(config);
+	return bench.Run();
+}
@@ -0,0 +1,573 @@
+#include "RenderBench.h"
+#include "GameTech/TutorialGame.h"
+#include "Common/Graphics/Window.h"
+#include "Common/Graphics/Camera.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string_view>
+
+using namespace NCL;
+using namespace CSC8503;
+
+namespace {
+	constexpr std::string_view MODE_NAMES[] = { "forward", "deferred", "forward+", "clustered" };
+	constexpr std::string_view OCCLUSION_NAMES[] = { "none", "gpu", "cpu" };
+
+	// Comma separated motion models, e.g. "fall,flicker"
+	bool ParseLightAnimation(const std::string& arg, uint& models) {
+		models = 0;
+		std::stringstream stream(arg);
+		std::string item;
+		while (std::getline(stream, item, ',')) {
+			if (item == "fall") {
+				models |= LIGHT_ANIMATION_FALL;
+			}
+			else if (item == "orbit") {
+				models |= LIGHT_ANIMATION_ORBIT;
+			}
+			else if (item == "flicker") {
+				models |= LIGHT_ANIMATION_FLICKER;
+			}
+			else if (item != "none") {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Steps of "first:last" double from first, always finishing on last
+	bool ParseLightCounts(const std::string& arg, std::vector<uint>& counts) {
+		const size_t colon = arg.find(':');
+		if (colon != std::string::npos) {
+			const uint first = (uint)std::strtoul(arg.substr(0, colon).c_str(), nullptr, 10);
+			const uint last = (uint)std::strtoul(arg.substr(colon + 1).c_str(), nullptr, 10);
+			if (first == 0 || last < first) {
+				return false;
+			}
+			for (uint count = first; count < last; count *= 2) {
+				counts.push_back(count);
+			}
+			counts.push_back(last);
+			return true;
+		}
+
+		std::stringstream stream(arg);
+		std::string item;
+		while (std::getline(stream, item, ',')) {
+			counts.push_back((uint)std::strtoul(item.c_str(), nullptr, 10));
+		}
+		return !counts.empty();
+	}
+
+	struct Summary {
+		double mean = 0.0;
+		double min = 0.0;
+		double max = 0.0;
+		double p95 = 0.0;
+	};
+
+	template <typename Func>
+	Summary Summarise(const std::vector<FrameSample>& samples, uint lights, Func&& value) {
+		std::vector<double> values;
+		for (const FrameSample& sample : samples) {
+			if (sample.lights == lights) {
+				values.push_back(value(sample));
+			}
+		}
+		Summary summary;
+		if (values.empty()) {
+			return summary;
+		}
+		std::sort(values.begin(), values.end());
+		for (double v : values) {
+			summary.mean += v;
+		}
+		summary.mean /= values.size();
+		summary.min = values.front();
+		summary.max = values.back();
+		summary.p95 = values[std::min(values.size() - 1, (size_t)(values.size() * 0.95))];
+		return summary;
+	}
+
+	void WriteJSONSummary(std::ofstream& file, const char* name, const Summary& summary) {
+		file << "\"" << name << "\": { \"mean\": " << summary.mean << ", \"min\": " << summary.min
+			<< ", \"max\": " << summary.max << ", \"p95\": " << summary.p95 << " }";
+	}
+
+	// Quotes and backslashes are the only characters GL_RENDERER strings are likely to need escaped
+	std::string EscapeJSON(const std::string& text) {
+		std::string result;
+		for (char c : text) {
+			if (c == '"' || c == '\\') {
+				result += '\\';
+			}
+			result += c;
+		}
+		return result;
+	}
+}
+
+CameraPath::CameraPath() {
+	// Down the centre of sponza from the default camera, up over the arches, then turning back at the far end
+	keys = {
+		{ Maths::Vector3(-530.0f, 71.0f, -12.0f), 270.0f, -5.5f },
+		{ Maths::Vector3(-50.0f, 160.0f, -12.0f), 270.0f, -15.0f },
+		{ Maths::Vector3(420.0f, 71.0f, -12.0f), 270.0f, -5.5f },
+		{ Maths::Vector3(420.0f, 71.0f, -12.0f), 90.0f, -5.5f },
+	};
+}
+
+bool CameraPath::LoadFromFile(const std::string& filename) {
+	std::ifstream file(filename);
+	if (!file) {
+		LOG_ERROR("{} couldn't open camera path {}", __FUNCTION__, filename);
+		return false;
+	}
+
+	std::vector<CameraKey> loaded;
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+		std::stringstream stream(line);
+		CameraKey key;
+		if (!(stream >> key.position.x >> key.position.y >> key.position.z >> key.yaw >> key.pitch)) {
+			LOG_ERROR("{} couldn't parse camera key '{}'", __FUNCTION__, line);
+			return false;
+		}
+		loaded.push_back(key);
+	}
+
+	if (loaded.empty()) {
+		LOG_ERROR("{} camera path {} has no keys", __FUNCTION__, filename);
+		return false;
+	}
+	keys = std::move(loaded);
+	return true;
+}
+
+CameraKey CameraPath::Sample(int frame, int frameCount) const {
+	if (keys.size() == 1 || frameCount <= 1) {
+		return keys.front();
+	}
+
+	const float t = (float)frame / (float)(frameCount - 1) * (float)(keys.size() - 1);
+	const size_t index = std::min((size_t)t, keys.size() - 2);
+	const float alpha = t - (float)index;
+
+	const CameraKey& a = keys[index];
+	const CameraKey& b = keys[index + 1];
+	CameraKey key;
+	key.position = a.position + (b.position - a.position) * alpha;
+	key.yaw = a.yaw + (b.yaw - a.yaw) * alpha;
+	key.pitch = a.pitch + (b.pitch - a.pitch) * alpha;
+	return key;
+}
+
+bool RenderBenchConfig::Parse(int argc, char** argv) {
+	for (int i = 1; i < argc; ++i) {
+		const std::string_view arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+
+		if (arg == "--mode" && hasValue) {
+			const std::string_view name = argv[++i];
+			const auto found = std::find(std::begin(MODE_NAMES), std::end(MODE_NAMES), name);
+			if (found == std::end(MODE_NAMES)) {
+				LOG_ERROR("Unknown render mode {}", name);
+				return false;
+			}
+			mode = (int)(found - std::begin(MODE_NAMES));
+		}
+		else if (arg == "--prepass" || arg == "--aabb") {
+			prepass = true;
+		}
+		else if (arg == "--resolution" && hasValue) {
+			if (std::sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+				LOG_ERROR("Resolution should look like 1920x1080, got {}", argv[i]);
+				return false;
+			}
+		}
+		else if (arg == "--lights" && hasValue) {
+			lightCounts.clear();
+			if (!ParseLightCounts(argv[++i], lightCounts)) {
+				LOG_ERROR("Couldn't parse light counts {}", argv[i]);
+				return false;
+			}
+		}
+		else if (arg == "--warmup" && hasValue) {
+			warmupFrames = std::max(0, std::atoi(argv[++i]));
+		}
+		else if (arg == "--frames" && hasValue) {
+			frames = std::max(1, std::atoi(argv[++i]));
+		}
+		else if (arg == "--camera-path" && hasValue) {
+			cameraPathFile = argv[++i];
+		}
+		else if (arg == "--csv" && hasValue) {
+			csvFile = argv[++i];
+		}
+		else if (arg == "--json" && hasValue) {
+			jsonFile = argv[++i];
+		}
+		else if (arg == "--trace" && hasValue) {
+			traceFile = argv[++i];
+		}
+		else if (arg == "--cpu-lights") {
+			cpuLights = true;
+		}
+		else if (arg == "--direct-draws") {
+			directDraws = true;
+		}
+		else if (arg == "--no-instancing") {
+			noInstancing = true;
+		}
+		else if (arg == "--light-volumes") {
+			lightVolumes = true;
+		}
+		else if (arg == "--gbuffer" && hasValue) {
+			if (!Rendering::ParseGBufferLayout(argv[++i], gBufferLayout)) {
+				LOG_ERROR("G-buffer layout should be rgba8, compact or compact-hdr, got {}", argv[i]);
+				return false;
+			}
+		}
+		else if (arg == "--gbuffer-report") {
+			gBufferReport = true;
+		}
+		else if (arg == "--shadows") {
+			shadows = true;
+		}
+		else if (arg == "--point-shadows") {
+			pointShadows = true;
+		}
+		else if (arg == "--occlusion" && hasValue) {
+			const std::string_view name = argv[++i];
+			const auto found = std::find(std::begin(OCCLUSION_NAMES), std::end(OCCLUSION_NAMES), name);
+			if (found == std::end(OCCLUSION_NAMES)) {
+				LOG_ERROR("Occlusion culling should be none, gpu or cpu, got {}", name);
+				return false;
+			}
+			occlusion = (int)(found - std::begin(OCCLUSION_NAMES));
+		}
+		else if (arg == "--light-animation" && hasValue) {
+			if (!ParseLightAnimation(argv[++i], lightAnimation)) {
+				LOG_ERROR("Light animation should be none or a list of fall, orbit and flicker, got {}", argv[i]);
+				return false;
+			}
+		}
+		else if (arg == "--software") {
+			software = true;
+		}
+		else if (arg == "--show") {
+			showWindow = true;
+		}
+		else {
+			LOG_ERROR("Unknown or incomplete argument {}", arg);
+			return false;
+		}
+	}
+
+	if (lightCounts.empty()) {
+		ParseLightCounts("1024:98304", lightCounts);
+	}
+	return true;
+}
+
+void RenderBenchConfig::PrintUsage(const char* exe) {
+	std::printf("Usage: %s [options]\n", exe);
+	std::printf("  --mode <forward|deferred|forward+|clustered>  Render mode, default clustered\n");
+	std::printf("  --prepass               Depth prepass for forward and clustered\n");
+	std::printf("  --aabb                  AABB light culling for forward+\n");
+	std::printf("  --resolution <WxH>      Default 1920x1080\n");
+	std::printf("  --lights <a,b,c|a:b>    Light counts to step through, a list or doubling from a to b. Default 1024:98304\n");
+	std::printf("  --warmup <n>            Unrecorded frames at the start of each step, default 60\n");
+	std::printf("  --frames <n>            Recorded frames per step, the camera path is spread over these. Default 300\n");
+	std::printf("  --camera-path <file>    Camera keys as \"x y z yaw pitch\" per line. Defaults to a flight through sponza\n");
+	std::printf("  --csv <file>            Write every recorded frame as CSV\n");
+	std::printf("  --json <file>           Write per step summaries and every recorded frame as JSON\n");
+	std::printf("  --trace <file>          Write a Chrome trace of each step, with the light count added to the name\n");
+	std::printf("  --cpu-lights            Animate the lights on the CPU instead of with updateLights.comp\n");
+	std::printf("  --light-animation <m>   none or a list of fall, orbit and flicker. Default fall\n");
+	std::printf("  --direct-draws          Draw objects one at a time instead of with multi-draw-indirect\n");
+	std::printf("  --no-instancing         Don't merge direct draws of objects sharing a mesh and material\n");
+	std::printf("  --light-volumes         Deferred: draw a sphere per light instead of the clustered compute pass\n");
+	std::printf("  --gbuffer <layout>      Deferred: rgba8, compact (RG16 octahedral normals, RGB10A2 lighting) or compact-hdr\n");
+	std::printf("                          (R11G11B10F lighting). Default rgba8\n");
+	std::printf("  --gbuffer-report        Print the bytes per pixel of each G-buffer layout at the resolution and exit\n");
+	std::printf("  --shadows               Forward+, clustered and deferred: sun light with cached cascaded shadow maps\n");
+	std::printf("  --point-shadows         Clustered: cube shadows in an atlas for the most important point lights\n");
+	std::printf("  --occlusion <m>         none, gpu (forward+ or clustered with --prepass) or cpu. Default none\n");
+	std::printf("  --software              Ask Mesa for llvmpipe, for machines without a GPU\n");
+	std::printf("  --show                  Leave the window visible\n");
+}
+
+const char* RenderBenchConfig::ModeName() const {
+	return MODE_NAMES[mode].data();
+}
+
+const char* RenderBenchConfig::OcclusionName() const {
+	return OCCLUSION_NAMES[occlusion].data();
+}
+
+RenderBench::RenderBench(const RenderBenchConfig& config) : config(config) {
+}
+
+RenderBench::~RenderBench() {
+	delete game;
+	Window::DestroyGameWindow();
+}
+
+int RenderBench::Run() {
+	if (config.gBufferReport) {
+		Rendering::PrintGBufferReport(config.width, config.height);
+		return 0;
+	}
+
+	if (!config.cameraPathFile.empty() && !cameraPath.LoadFromFile(config.cameraPathFile)) {
+		return 1;
+	}
+
+	if (config.software) {
+		// Only read by Mesa, so this does nothing unless Mesa's opengl32.dll sits next to the executable
+		_putenv_s("GALLIUM_DRIVER", "llvmpipe");
+	}
+
+	Window* w = Window::CreateGameWindow("RenderBench", config.width, config.height, false, 0, 0);
+	if (!w || !w->HasInitialised()) {
+		LOG_ERROR("{} couldn't create a {}x{} window", __FUNCTION__, config.width, config.height);
+		return 1;
+	}
+	w->ShowWindow(config.showWindow);
+
+	game = new TutorialGame(config.mode, config.prepass);
+
+	glRenderer = (const char*)glGetString(GL_RENDERER);
+	glVersion = (const char*)glGetString(GL_VERSION);
+	LOG_INFO("{} {}{} on {} ({})", __FUNCTION__, config.ModeName(), config.prepass ? " with prepass" : "", glRenderer, glVersion);
+	CLOG_WARN(config.software && glRenderer.find("llvmpipe") == std::string::npos,
+		"{} --software was given but the renderer isn't llvmpipe, is Mesa's opengl32.dll next to the executable?", __FUNCTION__);
+
+	game->GetRenderer()->SetVerticalSync(VerticalSyncState::VSync_OFF);
+	// Every recorded frame needs its GPU times, late ones are waited for rather than dropped
+	game->GetRenderer()->GetProfiler().SetWaitForResults(true);
+	game->GetRenderer()->SetLightAnimation(config.lightAnimation);
+	if (config.directDraws && game->GetRenderer()->IsUsingIndirectDraws()) {
+		game->GetRenderer()->ToggleIndirectDraws();
+	}
+	if (config.noInstancing && game->GetRenderer()->IsUsingInstancing()) {
+		game->GetRenderer()->ToggleInstancing();
+	}
+	if (config.lightVolumes && !game->GetRenderer()->IsUsingLightVolumes()) {
+		game->GetRenderer()->ToggleLightVolumes();
+	}
+	game->GetRenderer()->SetGBufferLayout(config.gBufferLayout);
+	if (config.shadows != game->GetRenderer()->IsUsingShadows()) {
+		game->GetRenderer()->ToggleShadows();
+	}
+	if (config.pointShadows != game->GetRenderer()->IsUsingPointShadows()) {
+		game->GetRenderer()->TogglePointShadows();
+	}
+	game->GetRenderer()->SetOcclusionCulling((OcclusionCulling)config.occlusion);
+
+	for (uint lightCount : config.lightCounts) {
+		if (lightCount > game->GetRenderer()->GetNumLight()) {
+			game->GetRenderer()->AddLights(lightCount - game->GetRenderer()->GetNumLight());
+		}
+		if (game->GetRenderer()->GetNumLight() < lightCount) {
+			LOG_WARN("{} renderer is capped at {} lights, stopping before {}", __FUNCTION__, game->GetRenderer()->GetNumLight(), lightCount);
+			break;
+		}
+		RunStep(lightCount);
+	}
+
+	bool written = true;
+	if (!config.csvFile.empty()) {
+		written &= WriteCSV(config.csvFile);
+	}
+	if (!config.jsonFile.empty()) {
+		written &= WriteJSON(config.jsonFile);
+	}
+	return written ? 0 : 1;
+}
+
+void RenderBench::RunStep(uint lightCount) {
+	// Fixed timestep, so the lights animate the same way however fast the frames are
+	const float dt = 1.0f / 60.0f;
+	Camera* camera = game->GetWorld()->GetMainCamera();
+	GameTechRenderer* renderer = game->GetRenderer();
+	GpuProfiler& profiler = renderer->GetProfiler();
+
+	const size_t firstSample = samples.size();
+	uint64_t firstFrame = 0;
+	const uint64_t firstStalls = renderer->GetLightStreamStalls();
+
+	const int totalFrames = config.warmupFrames + config.frames;
+	for (int frame = 0; frame < totalFrames; ++frame) {
+		Window::GetWindow()->UpdateWindow();
+
+		if (frame == config.warmupFrames) {
+			// Read back the warmup frames first so none of them end up in the capture
+			profiler.Flush();
+			profiler.StartCapture();
+			firstFrame = profiler.GetFrameIndex();
+		}
+
+		const int pathFrame = std::max(0, frame - config.warmupFrames);
+		const CameraKey key = cameraPath.Sample(pathFrame, config.frames);
+		camera->SetPosition(key.position);
+		camera->SetYaw(key.yaw);
+		camera->SetPitch(key.pitch);
+
+		const bool recorded = frame >= config.warmupFrames;
+
+		const Timepoint start = Clock::now();
+		renderer->Update(dt);
+		if (config.cpuLights) {
+			renderer->UpdateLights(dt);
+		}
+		else {
+			renderer->UpdateLightsGPU(dt);
+		}
+		renderer->Render();
+		const double cpuMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+		if (recorded) {
+			FrameSample sample;
+			sample.lights = lightCount;
+			sample.frame = pathFrame;
+			sample.cpuMs = cpuMs;
+			sample.stateChanges = renderer->GetLastFrameCounters().StateChanges();
+			sample.drawCalls = renderer->GetLastFrameCounters().drawCalls;
+			samples.push_back(sample);
+		}
+	}
+
+	profiler.Flush();
+	profiler.StopCapture();
+	CollectGpuTimes(firstSample, firstFrame);
+
+	if (!config.traceFile.empty()) {
+		std::filesystem::path tracePath(config.traceFile);
+		tracePath.replace_filename(tracePath.stem().string() + "_" + std::to_string(lightCount) + tracePath.extension().string());
+		profiler.WriteChromeTrace(tracePath.string());
+	}
+
+	const Summary cpu = Summarise(samples, lightCount, [](const FrameSample& s) { return s.cpuMs; });
+	const Summary gpu = Summarise(samples, lightCount, [](const FrameSample& s) { return s.gpuMs; });
+	const Summary stateChanges = Summarise(samples, lightCount, [](const FrameSample& s) { return (double)s.stateChanges; });
+	const Summary drawCalls = Summarise(samples, lightCount, [](const FrameSample& s) { return (double)s.drawCalls; });
+	LOG_INFO("{} lights: cpu {:.3f}ms mean {:.3f}ms p95, gpu {:.3f}ms mean {:.3f}ms p95, {:.0f} state changes and {:.0f} draws mean",
+		lightCount, cpu.mean, cpu.p95, gpu.mean, gpu.p95, stateChanges.mean, drawCalls.mean);
+	const uint64_t stalls = renderer->GetLightStreamStalls() - firstStalls;
+	CLOG_WARN(stalls > 0, "{} lights: light streaming waited on the GPU {} times", lightCount, stalls);
+}
+
+void RenderBench::CollectGpuTimes(size_t firstSample, uint64_t firstFrame) {
+	for (const GpuProfiler::FrameResult& result : game->GetRenderer()->GetProfiler().GetCapturedFrames()) {
+		const size_t index = firstSample + (size_t)(result.frame - firstFrame);
+		if (result.frame < firstFrame || index >= samples.size()) {
+			continue;
+		}
+
+		FrameSample& sample = samples[index];
+		// Light updates are dispatched before Render, so they sit outside the Frame scope
+		sample.gpuMs = result.GetGpuMs("Frame") + result.GetGpuMs("LightUpdate");
+		for (size_t pass = 0; pass < BENCH_PASS_COUNT; ++pass) {
+			sample.passGpuMs[pass] = result.GetGpuMs(BENCH_PASS_NAMES[pass]);
+		}
+	}
+}
+
+bool RenderBench::WriteCSV(const std::string& filename) const {
+	std::ofstream file(filename);
+	if (!file) {
+		LOG_ERROR("{} couldn't open {}", __FUNCTION__, filename);
+		return false;
+	}
+
+	file << "mode,prepass,gbuffer,width,height,lights,frame,cpu_ms,gpu_ms,state_changes,draw_calls";
+	for (const char* pass : BENCH_PASS_NAMES) {
+		file << "," << pass << "_gpu_ms";
+	}
+	file << "\n";
+
+	for (const FrameSample& sample : samples) {
+		file << config.ModeName() << "," << config.prepass << "," << Rendering::GBufferLayoutName(config.gBufferLayout) << "," << config.width << "," << config.height << ","
+			<< sample.lights << "," << sample.frame << "," << sample.cpuMs << "," << sample.gpuMs << ","
+			<< sample.stateChanges << "," << sample.drawCalls;
+		for (double passMs : sample.passGpuMs) {
+			file << "," << passMs;
+		}
+		file << "\n";
+	}
+	return true;
+}
+
+bool RenderBench::WriteJSON(const std::string& filename) const {
+	std::ofstream file(filename);
+	if (!file) {
+		LOG_ERROR("{} couldn't open {}", __FUNCTION__, filename);
+		return false;
+	}
+
+	file << "{\n";
+	file << "  \"renderer\": \"" << EscapeJSON(glRenderer) << "\",\n";
+	file << "  \"version\": \"" << EscapeJSON(glVersion) << "\",\n";
+	file << "  \"mode\": \"" << config.ModeName() << "\",\n";
+	file << "  \"prepass\": " << (config.prepass ? "true" : "false") << ",\n";
+	file << "  \"cpu_lights\": " << (config.cpuLights ? "true" : "false") << ",\n";
+	file << "  \"light_animation\": " << config.lightAnimation << ",\n";
+	file << "  \"direct_draws\": " << (config.directDraws ? "true" : "false") << ",\n";
+	file << "  \"instancing\": " << (config.noInstancing ? "false" : "true") << ",\n";
+	file << "  \"light_volumes\": " << (config.lightVolumes ? "true" : "false") << ",\n";
+	file << "  \"gbuffer\": \"" << Rendering::GBufferLayoutName(config.gBufferLayout) << "\",\n";
+	file << "  \"gbuffer_bytes_per_pixel\": " << Rendering::GetGBufferFormats(config.gBufferLayout).BytesPerPixel() << ",\n";
+	file << "  \"gbuffer_traffic_per_pixel\": " << Rendering::GetGBufferFormats(config.gBufferLayout).TrafficPerPixel() << ",\n";
+	file << "  \"shadows\": " << (config.shadows ? "true" : "false") << ",\n";
+	file << "  \"point_shadows\": " << (config.pointShadows ? "true" : "false") << ",\n";
+	file << "  \"occlusion\": \"" << config.OcclusionName() << "\",\n";
+	file << "  \"width\": " << config.width << ",\n";
+	file << "  \"height\": " << config.height << ",\n";
+	file << "  \"steps\": [";
+
+	bool firstStep = true;
+	for (uint lights : config.lightCounts) {
+		const auto inStep = [lights](const FrameSample& s) { return s.lights == lights; };
+		if (std::none_of(samples.begin(), samples.end(), inStep)) {
+			continue;
+		}
+
+		file << (firstStep ? "\n" : ",\n") << "    {\n      \"lights\": " << lights << ",\n      ";
+		WriteJSONSummary(file, "cpu_ms", Summarise(samples, lights, [](const FrameSample& s) { return s.cpuMs; }));
+		file << ",\n      ";
+		WriteJSONSummary(file, "gpu_ms", Summarise(samples, lights, [](const FrameSample& s) { return s.gpuMs; }));
+		file << ",\n      ";
+		WriteJSONSummary(file, "state_changes", Summarise(samples, lights, [](const FrameSample& s) { return (double)s.stateChanges; }));
+		file << ",\n      ";
+		WriteJSONSummary(file, "draw_calls", Summarise(samples, lights, [](const FrameSample& s) { return (double)s.drawCalls; }));
+		file << ",\n      \"passes_gpu_ms\": {";
+		for (size_t pass = 0; pass < BENCH_PASS_COUNT; ++pass) {
+			file << (pass == 0 ? "\n        " : ",\n        ");
+			WriteJSONSummary(file, BENCH_PASS_NAMES[pass], Summarise(samples, lights, [pass](const FrameSample& s) { return s.passGpuMs[pass]; }));
+		}
+		file << "\n      },\n      \"frames\": [";
+
+		bool firstFrame = true;
+		for (const FrameSample& sample : samples) {
+			if (!inStep(sample)) {
+				continue;
+			}
+			file << (firstFrame ? "" : ", ") << "{ \"cpu_ms\": " << sample.cpuMs << ", \"gpu_ms\": " << sample.gpuMs << " }";
+			firstFrame = false;
+		}
+		file << "]\n    }";
+		firstStep = false;
+	}
+	file << "\n  ]\n}\n";
+	return true;
+}
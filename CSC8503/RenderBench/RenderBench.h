@@ -0,0 +1,129 @@
+#pragma once
+#include "Common/Math/Vector3.h"
+#include "Common/NCLAliases.h"
+#include "Assets/Shaders/Shared/LightAnimationDefinitions.h"
+#include "Plugins/OpenGLRendering/GBufferLayout.h"
+
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace NCL {
+	namespace CSC8503 {
+		class TutorialGame;
+
+		struct CameraKey {
+			Maths::Vector3 position;
+			float yaw = 0.0f;
+			float pitch = 0.0f;
+		};
+
+		/*
+		* Keyframed camera path, sampled by frame index rather than time so every run sees the same views
+		* regardless of frame rate. Keys are spaced evenly over the frames of a benchmark step.
+		*/
+		class CameraPath {
+		public:
+			CameraPath();
+
+			// One key per line as "x y z yaw pitch". Blank lines and lines starting with # are skipped.
+			bool LoadFromFile(const std::string& filename);
+
+			CameraKey Sample(int frame, int frameCount) const;
+
+		protected:
+			std::vector<CameraKey> keys;
+		};
+
+		struct RenderBenchConfig {
+			int mode = 3;
+			bool prepass = false;
+			int width = 1920;
+			int height = 1080;
+			std::vector<uint> lightCounts;
+			int warmupFrames = 60;
+			int frames = 300;
+			std::string cameraPathFile;
+			std::string csvFile;
+			std::string jsonFile;
+			std::string traceFile;
+			bool software = false;
+			bool showWindow = false;
+			// Animate the lights with GameTechRenderer::UpdateLights instead of UpdateLightsGPU
+			bool cpuLights = false;
+			// Draw each object with its own calls instead of multi-draw-indirect from the mesh arena
+			bool directDraws = false;
+			// Draw objects that share a mesh and material one by one instead of instanced
+			bool noInstancing = false;
+			// Deferred only, light with a sphere per light instead of the clustered light lists
+			bool lightVolumes = false;
+			// Deferred only, the formats of the G-buffer and lighting targets
+			Rendering::GBufferLayout gBufferLayout = Rendering::GBufferLayout::RGBA8;
+			// Print the bytes per pixel of every G-buffer layout at the resolution and exit without rendering
+			bool gBufferReport = false;
+			// Light the scene with the sun and its cascaded shadow maps, not in forward
+			bool shadows = false;
+			// Cube shadows in an atlas for the most important point lights, clustered only
+			bool pointShadows = false;
+			// Index into the occlusion names, in the same order as OcclusionCulling
+			int occlusion = 0;
+			// LIGHT_ANIMATION_ flags
+			uint lightAnimation = LIGHT_ANIMATION_FALL;
+
+			// Returns false and prints the reason on bad arguments.
+			bool Parse(int argc, char** argv);
+			static void PrintUsage(const char* exe);
+
+			const char* ModeName() const;
+			const char* OcclusionName() const;
+		};
+
+		// GpuProfiler scopes reported per pass. A scope that appears more than once in a frame is summed.
+		inline constexpr const char* BENCH_PASS_NAMES[] = {
+			"LightUpdate", "Shadows", "DepthPrepass", "OcclusionCull", "ActiveClusters", "Compaction", "LightCull", "GBuffer", "Shading", "Combine", "Skybox"
+		};
+		constexpr size_t BENCH_PASS_COUNT = std::size(BENCH_PASS_NAMES);
+
+		struct FrameSample {
+			uint lights = 0;
+			int frame = 0;
+			double cpuMs = 0.0;
+			double gpuMs = 0.0;
+			std::array<double, BENCH_PASS_COUNT> passGpuMs{};
+			// From the renderer's RenderStateCounters for the frame
+			uint stateChanges = 0;
+			uint drawCalls = 0;
+		};
+
+		/*
+		* Renders the sponza scene through a fixed camera path for each light count in the ramp, recording CPU frame
+		* time, GPU frame time and GPU time per pass for every frame. GPU times come from the renderer's GpuProfiler,
+		* which reads its queries back a few frames late so collecting them never stalls the frame being measured.
+		*/
+		class RenderBench {
+		public:
+			RenderBench(const RenderBenchConfig& config);
+			~RenderBench();
+
+			int Run();
+
+		protected:
+			void RunStep(uint lightCount);
+			// Fills in the GPU times of this step's samples from the profiler's capture
+			void CollectGpuTimes(size_t firstSample, uint64_t firstFrame);
+
+			bool WriteCSV(const std::string& filename) const;
+			bool WriteJSON(const std::string& filename) const;
+
+			RenderBenchConfig config;
+			CameraPath cameraPath;
+			TutorialGame* game = nullptr;
+
+			std::vector<FrameSample> samples;
+			std::string glRenderer;
+			std::string glVersion;
+		};
+	}
+}
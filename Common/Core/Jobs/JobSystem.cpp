@@ -0,0 +1,132 @@
+#include "pch.h"
+#include "JobSystem.h"
+
+using namespace NCL;
+
+namespace {
+	// Which system started this thread, and its queue there
+	struct WorkerIdentity {
+		const JobSystem* system = nullptr;
+		uint index = 0;
+	};
+	thread_local WorkerIdentity currentWorker;
+}
+
+JobSystem::JobSystem(uint threadCount) {
+	SetThreadCount(threadCount);
+}
+
+JobSystem::~JobSystem() {
+	StopWorkers();
+}
+
+void JobSystem::SetThreadCount(uint count) {
+	StopWorkers();
+	count = count > 0 ? count : std::max(1u, std::thread::hardware_concurrency());
+	queues.clear();
+	for (uint i = 0; i < count; ++i) {
+		queues.push_back(std::make_unique<Queue>());
+	}
+	StartWorkers();
+}
+
+uint JobSystem::GetThreadIndex() const {
+	return currentWorker.system == this ? currentWorker.index : 0;
+}
+
+void JobSystem::Submit(const Job& job) {
+	Queue& queue = *queues[GetThreadIndex()];
+	{
+		std::lock_guard lock(queue.mutex);
+		queue.jobs.push_back(job);
+	}
+	queued.fetch_add(1, std::memory_order_release);
+	// Taking the lock means a worker between checking queued and sleeping can't miss this
+	{
+		std::lock_guard lock(sleepMutex);
+	}
+	wake.notify_all();
+}
+
+bool JobSystem::TakeJob(uint thread, Job& job) {
+	if (queued.load(std::memory_order_acquire) == 0) {
+		return false;
+	}
+	const uint count = (uint)queues.size();
+	for (uint i = 0; i < count; ++i) {
+		const uint victim = (thread + i) % count;
+		Queue& queue = *queues[victim];
+		std::lock_guard lock(queue.mutex);
+		if (queue.jobs.empty()) {
+			continue;
+		}
+		// Newest from our own queue while its data is still in cache, oldest from anyone else's
+		if (victim == thread) {
+			job = queue.jobs.back();
+			queue.jobs.pop_back();
+		}
+		else {
+			job = queue.jobs.front();
+			queue.jobs.pop_front();
+		}
+		queued.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+	return false;
+}
+
+void JobSystem::Execute(const Job& job) {
+	job.run(job.data, job.begin, job.end);
+	job.counter->pending.fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::Wait(JobCounter& counter) {
+	const uint thread = GetThreadIndex();
+	Job job;
+	while (!counter.IsDone()) {
+		if (TakeJob(thread, job)) {
+			Execute(job);
+		}
+		else {
+			// The last jobs are running elsewhere
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::StartWorkers() {
+	stopping = false;
+	for (uint i = 1; i < (uint)queues.size(); ++i) {
+		workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+	}
+}
+
+void JobSystem::StopWorkers() {
+	{
+		std::lock_guard lock(sleepMutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+}
+
+void JobSystem::WorkerLoop(uint thread) {
+	currentWorker = { this, thread };
+	Job job;
+	while (true) {
+		if (TakeJob(thread, job)) {
+			Execute(job);
+			continue;
+		}
+		std::unique_lock lock(sleepMutex);
+		wake.wait(lock, [&] {
+			return stopping || queued.load(std::memory_order_acquire) > 0;
+		});
+		if (stopping) {
+			return;
+		}
+	}
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include "NCLAliases.h"
+#include "Misc.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace NCL {
+	// Counts a batch of jobs still to finish, JobSystem::Wait returns once it reaches 0
+	class JobCounter {
+	public:
+		bool IsDone() const {
+			return pending.load(std::memory_order_acquire) == 0;
+		}
+
+	protected:
+		friend class JobSystem;
+		std::atomic<uint> pending = 0;
+	};
+
+	/*
+	* A fixed pool of worker threads, each with its own queue of jobs. A thread takes the newest job from its own
+	* queue and, when that's empty, steals the oldest from another's, so work that's split up where it's submitted
+	* spreads itself over whichever threads are free.
+	* The thread that submits jobs runs them too while it waits, so a system of N threads starts N - 1 workers,
+	* and jobs can submit and wait on jobs of their own.
+	* Jobs point at a callable that has to outlive the Wait for them, ParallelFor handles that itself.
+	* JobSystem::Get() is the one the game shares, so physics and the renderer don't each start a set of workers.
+	*/
+	class JobSystem : public Singleton<JobSystem> {
+	public:
+		// 0 threads is one per hardware thread
+		JobSystem(uint threadCount = 0);
+		~JobSystem();
+
+		// Stops and restarts the workers, so not while jobs are running
+		void SetThreadCount(uint count);
+		uint GetThreadCount() const {
+			return (uint)queues.size();
+		}
+
+		// Calls func(begin, end) over [0, count) in chunks of grain. Chunks are the same whatever the thread
+		// count, so anything written per chunk comes out the same however they were shared out.
+		template <typename Func>
+		void ParallelFor(uint count, uint grain, Func&& func);
+
+		// Runs jobs until every job counted by counter has finished
+		void Wait(JobCounter& counter);
+
+		// The calling thread's queue, 0 for threads this system didn't start
+		uint GetThreadIndex() const;
+
+	protected:
+		struct Job {
+			void (*run)(const void* data, uint begin, uint end);
+			const void* data;
+			uint begin;
+			uint end;
+			JobCounter* counter;
+		};
+
+		struct Queue {
+			std::mutex mutex;
+			std::deque<Job> jobs;
+		};
+
+		void Submit(const Job& job);
+		bool TakeJob(uint thread, Job& job);
+		void Execute(const Job& job);
+
+		void StartWorkers();
+		void StopWorkers();
+		void WorkerLoop(uint thread);
+
+		std::vector<std::unique_ptr<Queue>> queues;
+		std::vector<std::thread> workers;
+
+		// Jobs in every queue, for sleeping workers to wait on
+		std::atomic<uint> queued = 0;
+		std::mutex sleepMutex;
+		std::condition_variable wake;
+		bool stopping = false;
+	};
+
+	template <typename Func>
+	void JobSystem::ParallelFor(uint count, uint grain, Func&& func) {
+		grain = grain > 0 ? grain : 1;
+		const uint chunks = (count + grain - 1) / grain;
+		if (chunks <= 1 || queues.size() == 1) {
+			for (uint begin = 0; begin < count; begin += grain) {
+				func(begin, std::min(begin + grain, count));
+			}
+			return;
+		}
+
+		using FuncType = std::remove_reference_t<Func>;
+		JobCounter counter;
+		counter.pending.store(chunks, std::memory_order_relaxed);
+		// Last chunk first, so this thread pops chunks from the start and thieves take them from the end
+		for (uint chunk = chunks; chunk-- > 0; ) {
+			const uint begin = chunk * grain;
+			Submit({ [](const void* data, uint begin, uint end) {
+				(*(FuncType*)data)(begin, end);
+			}, &func, begin, std::min(begin + grain, count), &counter });
+		}
+		Wait(counter);
+	}
+}
@@ -0,0 +1,84 @@
+#include "pch.h"
+#include "ActiveClusterList.h"
+#include "StreamCompaction.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace NCL;
+using namespace Maths;
+using namespace Rendering;
+
+ActiveClusterList::ActiveClusterList(const ClusterGridDesc& inDesc) : desc(inDesc) {
+	flags.resize(desc.ClusterCount());
+	activeClusters.reserve(desc.ClusterCount());
+}
+
+void ActiveClusterList::Reset() {
+	std::fill(flags.begin(), flags.end(), 0);
+	activeClusters.clear();
+}
+
+void ActiveClusterList::MarkFromDepth(std::span<const float> depth, int width, int height, int tilePxX, int tilePxY,
+	const Matrix4& projMatrix, float scale, float bias) {
+	for (int y = 0; y < height; ++y) {
+		const uint tileY = std::min((uint)(y / tilePxY), desc.gridY - 1);
+		for (int x = 0; x < width; ++x) {
+			const float sample = depth[y * width + x];
+			// Nothing was drawn here
+			if (sample >= 1.0f) {
+				continue;
+			}
+
+			const uint tileZ = DepthSlice(sample, projMatrix, scale, bias);
+			const uint tileX = std::min((uint)(x / tilePxX), desc.gridX - 1);
+			flags[tileX + desc.gridX * (tileY + desc.gridY * tileZ)] = 1;
+		}
+	}
+}
+
+void ActiveClusterList::MarkFromPyramid(const DepthPyramid& pyramid, int level, int width, int height, int tilePxX, int tilePxY,
+	const Matrix4& projMatrix, float scale, float bias) {
+	const int levelWidth = pyramid.GetLevelWidth(level);
+	const int levelHeight = pyramid.GetLevelHeight(level);
+	const int texelPx = 1 << (level + 1);
+
+	for (int y = 0; y < levelHeight; ++y) {
+		for (int x = 0; x < levelWidth; ++x) {
+			const DepthPyramid::Bounds& bounds = pyramid.GetBounds(level, x, y);
+			if (!bounds.AnythingDrawn()) {
+				continue;
+			}
+
+			// The last row and column also cover the pixels left over when the pyramid halved unevenly
+			const int lastPxX = x == levelWidth - 1 ? width - 1 : std::min((x + 1) * texelPx - 1, width - 1);
+			const int lastPxY = y == levelHeight - 1 ? height - 1 : std::min((y + 1) * texelPx - 1, height - 1);
+			const uint firstTileX = std::min((uint)(x * texelPx / tilePxX), desc.gridX - 1);
+			const uint firstTileY = std::min((uint)(y * texelPx / tilePxY), desc.gridY - 1);
+			const uint lastTileX = std::min((uint)(lastPxX / tilePxX), desc.gridX - 1);
+			const uint lastTileY = std::min((uint)(lastPxY / tilePxY), desc.gridY - 1);
+			const uint firstSlice = DepthSlice(bounds.nearest, projMatrix, scale, bias);
+			const uint lastSlice = DepthSlice(bounds.farthestDrawn, projMatrix, scale, bias);
+
+			for (uint tileZ = firstSlice; tileZ <= lastSlice; ++tileZ) {
+				for (uint tileY = firstTileY; tileY <= lastTileY; ++tileY) {
+					for (uint tileX = firstTileX; tileX <= lastTileX; ++tileX) {
+						flags[tileX + desc.gridX * (tileY + desc.gridY * tileZ)] = 1;
+					}
+				}
+			}
+		}
+	}
+}
+
+uint ActiveClusterList::DepthSlice(float depth, const Matrix4& projMatrix, float scale, float bias) const {
+	// projMatrix[3][2] and projMatrix[2][2] in activeClusters.comp
+	const float projZW = projMatrix.array[14];
+	const float projZZ = projMatrix.array[10];
+	const float linearDepth = projZW / (projZZ + (depth * 2.0f - 1.0f));
+	return std::min((uint)std::max(std::log2(linearDepth) * scale + bias, 0.0f), desc.gridZ - 1);
+}
+
+GLSL::DispatchIndirectCommand ActiveClusterList::Compact() {
+	return CompactIndices(flags, activeClusters);
+}
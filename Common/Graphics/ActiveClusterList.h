@@ -0,0 +1,57 @@
+#pragma once
+#include "ClusterCuller.h"
+#include "DepthPyramid.h"
+#include "Math/Matrix4.h"
+#include "NCLAliases.h"
+#include "../../Assets/Shaders/Shared/LightGridDefinitions.h"
+
+#include <span>
+#include <vector>
+
+namespace NCL {
+	namespace Rendering {
+		/*
+		* CPU model of activeClusters.comp and the GpuCompact pass after it.
+		* Flags every cluster a depth buffer sample falls in, or every cluster a depth pyramid texel's bounds span, then compacts the flags into the list
+		* clusterActiveCull.comp is dispatched over, along with the indirect dispatch command for it.
+		* The list is in ascending order, the same order GpuCompact produces, so the two can be compared directly.
+		*/
+		class ActiveClusterList {
+		public:
+			ActiveClusterList(const ClusterGridDesc& desc = ClusterGridDesc());
+			~ActiveClusterList() = default;
+
+			// Clears every flag, as the renderer does before dispatching activeClusters.comp.
+			void Reset();
+
+			void Mark(uint cluster) { flags[cluster] = 1; }
+
+			// Mirrors activeClusters.comp. depth holds width * height depth buffer values in [0, 1], row by row.
+			// scale and bias map log2 of view depth to a depth slice, the same ClusterParams the renderer uses.
+			void MarkFromDepth(std::span<const float> depth, int width, int height, int tilePxX, int tilePxY,
+				const Maths::Matrix4& projMatrix, float scale, float bias);
+
+			// Mirrors activeClusters.comp, which reads level DEPTH_PYRAMID_ACTIVE_CLUSTER_LEVEL of the pyramid built from a
+			// width x height depth buffer. Flags every cluster from the nearest to the farthest drawn depth of each texel,
+			// so always flags at least the clusters MarkFromDepth does.
+			void MarkFromPyramid(const DepthPyramid& pyramid, int level, int width, int height, int tilePxX, int tilePxY,
+				const Maths::Matrix4& projMatrix, float scale, float bias);
+
+			// Mirrors GpuCompact. Returns the command clusterActiveCull.comp is dispatched with.
+			GLSL::DispatchIndirectCommand Compact();
+
+			bool IsActive(uint cluster) const { return flags[cluster] != 0; }
+			// Only valid after Compact.
+			std::span<const uint> GetActiveClusters() const { return activeClusters; }
+
+			const ClusterGridDesc& GetDesc() const { return desc; }
+
+		protected:
+			uint DepthSlice(float depth, const Maths::Matrix4& projMatrix, float scale, float bias) const;
+
+			ClusterGridDesc desc;
+			std::vector<uint> flags;
+			std::vector<uint> activeClusters;
+		};
+	}
+}
@@ -0,0 +1,362 @@
+#include "pch.h"
+#include "ClusterCuller.h"
+#include "Math/SIMD.h"
+#include "Math/Vector3.h"
+#include "Math/Vector4.h"
+
+#include <algorithm>
+#include <bit>
+#include <cfloat>
+
+using namespace NCL;
+using namespace Maths;
+using namespace Rendering;
+
+using GLSL::ClusterFrustum;
+using GLSL::PointLight;
+
+namespace {
+	Vector4 ScreenToView(const Matrix4& invProj, const Vector4& screenSpace, float pixelSizeX, float pixelSizeY) {
+		const float u = screenSpace.x * pixelSizeX;
+		const float v = screenSpace.y * pixelSizeY;
+		Vector4 clip(u * 2.0f - 1.0f, v * 2.0f - 1.0f, screenSpace.z, screenSpace.w);
+		Vector4 view = invProj * clip;
+		return view / view.w;
+	}
+
+	GLSL::Plane ComputePlane(const Vector3& a, const Vector3& b, const Vector3& c) {
+		const Vector3 ab = b - a;
+		const Vector3 ac = c - a;
+		const Vector3 normal = Vector3::Cross(ac, ab).Normalised();
+
+		GLSL::Plane plane;
+		plane.normal = Vector4(normal, 0.0f);
+		plane.distance = Vector4(Vector3::Dot(normal, a), 0.0f, 0.0f, 0.0f);
+		return plane;
+	}
+}
+
+ClusterCuller::ClusterCuller(const ClusterGridDesc& inDesc) : desc(inDesc) {
+	grid.resize(desc.ClusterCount());
+	lightList.Reset(desc.ClusterCount(), desc.maxLightsPerCluster);
+	visibleCounts.resize(desc.ClusterCount());
+}
+
+void ClusterCuller::BuildGrid(const Matrix4& invProj, float screenWidth, float screenHeight, int tilePxX, int tilePxY, float zNear, float zFar) {
+	const Vector3 eyePos(0.0f, 0.0f, 0.0f);
+	const float pixelSizeX = 1.0f / screenWidth;
+	const float pixelSizeY = 1.0f / screenHeight;
+
+	for (uint z = 0; z < desc.gridZ; ++z) {
+		const float tileNear = -zNear * std::pow(zFar / zNear, z / (float)desc.gridZ);
+		const float tileFar = -zNear * std::pow(zFar / zNear, (z + 1) / (float)desc.gridZ);
+
+		for (uint y = 0; y < desc.gridY; ++y) {
+			for (uint x = 0; x < desc.gridX; ++x) {
+				// Same corner order as clusterGrid.comp, all on the far plane
+				const Vector4 screenSpace[4] = {
+					Vector4((float)(x * tilePxX), (float)(y * tilePxY), -1.0f, 1.0f),
+					Vector4((float)((x + 1) * tilePxX), (float)(y * tilePxY), -1.0f, 1.0f),
+					Vector4((float)(x * tilePxX), (float)((y + 1) * tilePxY), -1.0f, 1.0f),
+					Vector4((float)((x + 1) * tilePxX), (float)((y + 1) * tilePxY), -1.0f, 1.0f)
+				};
+
+				Vector3 viewSpace[4];
+				for (int i = 0; i < 4; ++i) {
+					viewSpace[i] = Vector3(ScreenToView(invProj, screenSpace[i], pixelSizeX, pixelSizeY));
+				}
+
+				ClusterFrustum& frustum = grid[x + y * desc.gridX + z * desc.gridX * desc.gridY];
+				frustum.planes[0] = ComputePlane(eyePos, viewSpace[2], viewSpace[0]); // Left
+				frustum.planes[1] = ComputePlane(eyePos, viewSpace[1], viewSpace[3]); // Right
+				frustum.planes[2] = ComputePlane(eyePos, viewSpace[0], viewSpace[1]); // Top
+				frustum.planes[3] = ComputePlane(eyePos, viewSpace[3], viewSpace[2]); // Bottom
+				frustum.nearFar = Vector4(tileNear, tileFar, 0.0f, 0.0f);
+			}
+		}
+	}
+}
+
+void ClusterCuller::CullLights(std::span<const PointLight> lights, const Matrix4& viewMatrix, const Matrix4& invProj) {
+	TransformLights(lights, viewMatrix);
+
+	const Vector4 nearClip = invProj * Vector4(0.0f, 0.0f, 0.0f, 1.0f);
+	const float nearClipVS = nearClip.z / nearClip.w;
+
+	lightList.Reset(desc.ClusterCount(), desc.maxLightsPerCluster);
+	for (uint cluster = 0; cluster < desc.ClusterCount(); ++cluster) {
+		SetVisibleCount(cluster, CullCluster(grid[cluster], nearClipVS, nullptr));
+	}
+
+	lightList.PrefixSum();
+
+	for (uint cluster = 0; cluster < desc.ClusterCount(); ++cluster) {
+		CullCluster(grid[cluster], nearClipVS, BeginScatter(cluster));
+		EndScatter(cluster);
+	}
+}
+
+void ClusterCuller::CullLights(std::span<const PointLight> lights, const Matrix4& viewMatrix, const Matrix4& invProj, const LightBVH& bvh) {
+	// Light i * LIGHT_BVH_LEAF_SIZE starts each leaf, so storing the lights in BVH order keeps every leaf contiguous in the SoA arrays
+	TransformLights(lights, viewMatrix, bvh.GetLightOrder());
+	TransformNodes(bvh, viewMatrix);
+
+	const Vector4 nearClip = invProj * Vector4(0.0f, 0.0f, 0.0f, 1.0f);
+	const float nearClipVS = nearClip.z / nearClip.w;
+
+	lightList.Reset(desc.ClusterCount(), desc.maxLightsPerCluster);
+	for (uint cluster = 0; cluster < desc.ClusterCount(); ++cluster) {
+		SetVisibleCount(cluster, CullClusterBVH(bvh, grid[cluster], nearClipVS, nullptr));
+	}
+
+	lightList.PrefixSum();
+
+	for (uint cluster = 0; cluster < desc.ClusterCount(); ++cluster) {
+		CullClusterBVH(bvh, grid[cluster], nearClipVS, BeginScatter(cluster));
+		EndScatter(cluster);
+	}
+}
+
+void ClusterCuller::CullLights(std::span<const PointLight> lights, const Matrix4& viewMatrix, const Matrix4& invProj, std::span<const uint> activeClusters) {
+	TransformLights(lights, viewMatrix);
+
+	const Vector4 nearClip = invProj * Vector4(0.0f, 0.0f, 0.0f, 1.0f);
+	const float nearClipVS = nearClip.z / nearClip.w;
+
+	lightList.Reset(desc.ClusterCount(), desc.maxLightsPerCluster);
+	std::fill(visibleCounts.begin(), visibleCounts.end(), 0);
+	for (uint cluster : activeClusters) {
+		SetVisibleCount(cluster, CullCluster(grid[cluster], nearClipVS, nullptr));
+	}
+
+	lightList.PrefixSum();
+
+	for (uint cluster : activeClusters) {
+		CullCluster(grid[cluster], nearClipVS, BeginScatter(cluster));
+		EndScatter(cluster);
+	}
+}
+
+uint ClusterCuller::GetCappedClusterCount() const {
+	return (uint)std::count_if(visibleCounts.begin(), visibleCounts.end(), [&](uint visible) {
+		return visible > desc.maxLightsPerCluster;
+	});
+}
+
+void ClusterCuller::SetVisibleCount(uint cluster, uint visible) {
+	visibleCounts[cluster] = visible;
+	lightList.SetCount(cluster, visible);
+}
+
+uint* ClusterCuller::BeginScatter(uint cluster) {
+	if (visibleCounts[cluster] <= desc.maxLightsPerCluster) {
+		return lightList.GetCellIndices(cluster).data();
+	}
+	overflow.resize(visibleCounts[cluster]);
+	return overflow.data();
+}
+
+void ClusterCuller::EndScatter(uint cluster) {
+	if (visibleCounts[cluster] <= desc.maxLightsPerCluster) {
+		return;
+	}
+	const std::span<uint> kept = lightList.GetCellIndices(cluster);
+	std::nth_element(overflow.begin(), overflow.begin() + kept.size(), overflow.end());
+	std::copy(overflow.begin(), overflow.begin() + kept.size(), kept.begin());
+	// Same ascending order as an uncapped brute force cluster, whichever order the lights were visited in
+	std::sort(kept.begin(), kept.end());
+}
+
+void ClusterCuller::TransformLights(std::span<const PointLight> lights, const Matrix4& viewMatrix, std::span<const uint> order) {
+	lightOrder = order;
+	numLights = (uint)lights.size();
+	const size_t padded = PadToSIMDWidth(numLights);
+
+	lightX.resize(padded);
+	lightY.resize(padded);
+	lightZ.resize(padded);
+	lightRadius.resize(padded);
+
+	for (uint i = 0; i < numLights; ++i) {
+		const PointLight& light = lights[order.empty() ? i : order[i]];
+		const Vector4 viewPos = viewMatrix * Vector4(light.pos.x, light.pos.y, light.pos.z, 1.0f);
+		lightX[i] = viewPos.x;
+		lightY[i] = viewPos.y;
+		lightZ[i] = viewPos.z;
+		lightRadius[i] = light.radius.x;
+	}
+
+	// Padding lights sit infinitely far behind the camera so they always fail the near test.
+	for (size_t i = numLights; i < padded; ++i) {
+		lightX[i] = 0.0f;
+		lightY[i] = 0.0f;
+		lightZ[i] = FLT_MAX;
+		lightRadius[i] = 0.0f;
+	}
+}
+
+void ClusterCuller::TransformNodes(const LightBVH& bvh, const Matrix4& viewMatrix) {
+	// An AABB's extent in view space is the absolute rotation applied to its extent
+	Vector3 absRows[3];
+	for (int row = 0; row < 3; ++row) {
+		absRows[row] = Vector3(std::abs(viewMatrix.array[row]), std::abs(viewMatrix.array[4 + row]), std::abs(viewMatrix.array[8 + row]));
+	}
+
+	const std::vector<GLSL::LightBVHNode>& nodes = bvh.GetNodes();
+	nodeBounds.resize(nodes.size());
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		const Vector3 centre = Vector3(nodes[i].boundsMin + nodes[i].boundsMax) * 0.5f;
+		const Vector3 extent = Vector3(nodes[i].boundsMax - nodes[i].boundsMin) * 0.5f;
+
+		const Vector4 viewCentre = viewMatrix * Vector4(centre, 1.0f);
+		nodeBounds[i].centre = Vector3(viewCentre);
+		nodeBounds[i].extent = Vector3(Vector3::Dot(absRows[0], extent), Vector3::Dot(absRows[1], extent), Vector3::Dot(absRows[2], extent));
+	}
+}
+
+// Conservative box version of the sphere tests below. The radius becomes the box's projected extent along each normal.
+bool ClusterCuller::NodeOverlapsCluster(const NodeBounds& node, const ClusterFrustum& frustum, float nearClipVS) const {
+	const float z = node.centre.z;
+	const float ez = node.extent.z;
+	if (z - ez > nearClipVS || z + ez < frustum.nearFar.y || z - ez > frustum.nearFar.x) {
+		return false;
+	}
+	for (int p = 0; p < 4; ++p) {
+		const Vector3 normal(frustum.planes[p].normal);
+		const float dist = Vector3::Dot(normal, node.centre) - frustum.planes[p].distance.x;
+		const float radius = std::abs(normal.x) * node.extent.x + std::abs(normal.y) * node.extent.y + std::abs(normal.z) * node.extent.z;
+		if (dist < -radius) {
+			return false;
+		}
+	}
+	return true;
+}
+
+uint ClusterCuller::CullCluster(const ClusterFrustum& frustum, float nearClipVS, uint* out) const {
+	return CullRange(frustum, nearClipVS, 0, lightX.size(), out, 0);
+}
+
+uint ClusterCuller::CullClusterBVH(const LightBVH& bvh, const ClusterFrustum& frustum, float nearClipVS, uint* out) const {
+	const std::vector<GLSL::LightBVHNode>& nodes = bvh.GetNodes();
+	uint count = 0;
+
+	for (uint top = 0; top < bvh.GetTopLevelCount(); ++top) {
+		if (!NodeOverlapsCluster(nodeBounds[top], frustum, nearClipVS)) {
+			continue;
+		}
+		const uint firstLeaf = nodes[top].first;
+		for (uint leaf = firstLeaf; leaf < firstLeaf + nodes[top].count; ++leaf) {
+			if (!NodeOverlapsCluster(nodeBounds[leaf], frustum, nearClipVS)) {
+				continue;
+			}
+			// Leaves start on a multiple of LIGHT_BVH_LEAF_SIZE and the SoA arrays are padded, so whole batches can be read
+			const size_t begin = nodes[leaf].first;
+			const size_t end = std::min(PadToSIMDWidth(begin + nodes[leaf].count), lightX.size());
+			count = CullRange(frustum, nearClipVS, begin, end, out, count);
+		}
+	}
+	return count;
+}
+
+/*
+* A light is visible in a cluster when, in view space:
+*	z - r <= nearClip, z + r >= clusterFar, -z + clusterNear >= -r
+*	and for each side plane dot(n, p) - d >= -r
+* which is the negation of the rejection tests in clusterCull.comp.
+*/
+uint ClusterCuller::CullRange(const ClusterFrustum& frustum, float nearClipVS, size_t begin, size_t end, uint* out, uint count) const {
+	const float minDepthVS = frustum.nearFar.x;
+	const float maxDepthVS = frustum.nearFar.y;
+
+	auto emit = [&](uint bits, uint base) {
+		if (!out) {
+			count += (uint)std::popcount(bits);
+			return;
+		}
+		while (bits != 0) {
+			const uint slot = base + (uint)std::countr_zero(bits);
+			out[count++] = lightOrder.empty() ? slot : lightOrder[slot];
+			bits &= bits - 1;
+		}
+	};
+
+#if NCL_SIMD_AVX2
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 nearClip = _mm256_set1_ps(nearClipVS);
+	const __m256 minDepth = _mm256_set1_ps(minDepthVS);
+	const __m256 maxDepth = _mm256_set1_ps(maxDepthVS);
+	__m256 nx[4], ny[4], nz[4], nd[4];
+	for (int p = 0; p < 4; ++p) {
+		nx[p] = _mm256_set1_ps(frustum.planes[p].normal.x);
+		ny[p] = _mm256_set1_ps(frustum.planes[p].normal.y);
+		nz[p] = _mm256_set1_ps(frustum.planes[p].normal.z);
+		nd[p] = _mm256_set1_ps(frustum.planes[p].distance.x);
+	}
+
+	for (size_t i = begin; i < end; i += 8) {
+		const __m256 x = _mm256_loadu_ps(&lightX[i]);
+		const __m256 y = _mm256_loadu_ps(&lightY[i]);
+		const __m256 z = _mm256_loadu_ps(&lightZ[i]);
+		const __m256 r = _mm256_loadu_ps(&lightRadius[i]);
+		const __m256 negR = _mm256_sub_ps(zero, r);
+
+		__m256 mask = _mm256_cmp_ps(_mm256_sub_ps(z, r), nearClip, _CMP_LE_OQ);
+		mask = _mm256_and_ps(mask, _mm256_cmp_ps(_mm256_add_ps(z, r), maxDepth, _CMP_GE_OQ));
+		mask = _mm256_and_ps(mask, _mm256_cmp_ps(_mm256_sub_ps(minDepth, z), negR, _CMP_GE_OQ));
+
+		for (int p = 0; p < 4; ++p) {
+			__m256 dist = _mm256_add_ps(_mm256_mul_ps(nx[p], x), _mm256_mul_ps(ny[p], y));
+			dist = _mm256_add_ps(dist, _mm256_mul_ps(nz[p], z));
+			dist = _mm256_sub_ps(dist, nd[p]);
+			mask = _mm256_and_ps(mask, _mm256_cmp_ps(dist, negR, _CMP_GE_OQ));
+		}
+
+		emit((uint)_mm256_movemask_ps(mask), (uint)i);
+	}
+#elif NCL_SIMD_SSE
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 nearClip = _mm_set1_ps(nearClipVS);
+	const __m128 minDepth = _mm_set1_ps(minDepthVS);
+	const __m128 maxDepth = _mm_set1_ps(maxDepthVS);
+	__m128 nx[4], ny[4], nz[4], nd[4];
+	for (int p = 0; p < 4; ++p) {
+		nx[p] = _mm_set1_ps(frustum.planes[p].normal.x);
+		ny[p] = _mm_set1_ps(frustum.planes[p].normal.y);
+		nz[p] = _mm_set1_ps(frustum.planes[p].normal.z);
+		nd[p] = _mm_set1_ps(frustum.planes[p].distance.x);
+	}
+
+	for (size_t i = begin; i < end; i += 4) {
+		const __m128 x = _mm_loadu_ps(&lightX[i]);
+		const __m128 y = _mm_loadu_ps(&lightY[i]);
+		const __m128 z = _mm_loadu_ps(&lightZ[i]);
+		const __m128 r = _mm_loadu_ps(&lightRadius[i]);
+		const __m128 negR = _mm_sub_ps(zero, r);
+
+		__m128 mask = _mm_cmple_ps(_mm_sub_ps(z, r), nearClip);
+		mask = _mm_and_ps(mask, _mm_cmpge_ps(_mm_add_ps(z, r), maxDepth));
+		mask = _mm_and_ps(mask, _mm_cmpge_ps(_mm_sub_ps(minDepth, z), negR));
+
+		for (int p = 0; p < 4; ++p) {
+			__m128 dist = _mm_add_ps(_mm_mul_ps(nx[p], x), _mm_mul_ps(ny[p], y));
+			dist = _mm_add_ps(dist, _mm_mul_ps(nz[p], z));
+			dist = _mm_sub_ps(dist, nd[p]);
+			mask = _mm_and_ps(mask, _mm_cmpge_ps(dist, negR));
+		}
+
+		emit((uint)_mm_movemask_ps(mask), (uint)i);
+	}
+#else
+	for (size_t i = begin; i < end; ++i) {
+		const float x = lightX[i], y = lightY[i], z = lightZ[i], r = lightRadius[i];
+		bool visible = (z - r <= nearClipVS) && (z + r >= maxDepthVS) && (minDepthVS - z >= -r);
+		for (int p = 0; p < 4 && visible; ++p) {
+			const GLSL::Plane& plane = frustum.planes[p];
+			const float dist = plane.normal.x * x + plane.normal.y * y + plane.normal.z * z - plane.distance.x;
+			visible = dist >= -r;
+		}
+		emit(visible ? 1u : 0u, (uint)i);
+	}
+#endif
+	return count;
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include "LightBVH.h"
+#include "LightListBuilder.h"
+#include "Math/Matrix4.h"
+#include "Math/Vector3.h"
+#include "NCLAliases.h"
+#include "../../Assets/Shaders/Shared/LightDefinitions.h"
+#include "../../Assets/Shaders/Shared/LightGridDefinitions.h"
+
+#include <span>
+#include <vector>
+
+namespace NCL {
+	namespace Rendering {
+		// Dimensions of the cluster grid. Defaults match the values used by GameTechRenderer and the cluster shaders.
+		struct ClusterGridDesc {
+			uint gridX = 16;
+			uint gridY = 8;
+			uint gridZ = 24;
+			uint maxLightsPerCluster = 2048;
+
+			uint ClusterCount() const { return gridX * gridY * gridZ; }
+		};
+
+		/*
+		* CPU reference implementation of clusterGrid.comp and clusterCull.comp.
+		* Builds the same ClusterFrustum grid and the same packed LightGrid/index list layout.
+		* Each cluster is culled twice, once to count its lights and once to scatter them after the prefix sum,
+		* with at most maxLightsPerCluster lights kept per cluster.
+		* A cluster that sees more lights than that keeps the lowest indexed ones, so every CullLights overload keeps
+		* the same set whatever order it visits the lights in. The shaders keep whichever their atomics reach first.
+		* Lights are tested 8 at a time with AVX2 (4 with SSE) when available.
+		* Indices within a cluster are written in ascending order, or in Morton order when culling with a LightBVH.
+		* The GPU order depends on atomics, so compare per-cluster sets when validating against GPU output.
+		*/
+		class ClusterCuller {
+		public:
+			ClusterCuller(const ClusterGridDesc& desc = ClusterGridDesc());
+			~ClusterCuller() = default;
+
+			// Mirrors clusterGrid.comp. tilePxX/tilePxY are the size of a cluster in pixels.
+			void BuildGrid(const Maths::Matrix4& invProj, float screenWidth, float screenHeight, int tilePxX, int tilePxY, float zNear, float zFar);
+
+			// Mirrors clusterCull.comp. BuildGrid must have been called first.
+			void CullLights(std::span<const GLSL::PointLight> lights, const Maths::Matrix4& viewMatrix, const Maths::Matrix4& invProj);
+			// Same result as above, but only tests lights in BVH nodes that overlap each cluster. bvh must have been built from lights.
+			void CullLights(std::span<const GLSL::PointLight> lights, const Maths::Matrix4& viewMatrix, const Maths::Matrix4& invProj, const LightBVH& bvh);
+			// Mirrors clusterActiveCull.comp. Only the listed clusters are culled, every other cluster is left empty.
+			void CullLights(std::span<const GLSL::PointLight> lights, const Maths::Matrix4& viewMatrix, const Maths::Matrix4& invProj, std::span<const uint> activeClusters);
+
+			const ClusterGridDesc& GetDesc() const { return desc; }
+			const std::vector<GLSL::ClusterFrustum>& GetGrid() const { return grid; }
+			const LightListBuilder& GetLightList() const { return lightList; }
+
+			uint GetLightCount(uint cluster) const { return lightList.GetGrid()[cluster].count; }
+			std::span<const uint> GetClusterLights(uint cluster) const { return lightList.GetCellLights(cluster); }
+			// Lights the cluster sees before maxLightsPerCluster is applied
+			uint GetVisibleCount(uint cluster) const { return visibleCounts[cluster]; }
+			// Clusters that saw more than maxLightsPerCluster lights and had some dropped
+			uint GetCappedClusterCount() const;
+
+		protected:
+			// View space bounds of a LightBVH node.
+			struct NodeBounds {
+				Maths::Vector3 centre;
+				Maths::Vector3 extent;
+			};
+
+			// order, if not empty, maps each SoA slot to the light it holds.
+			void TransformLights(std::span<const GLSL::PointLight> lights, const Maths::Matrix4& viewMatrix, std::span<const uint> order = {});
+			void TransformNodes(const LightBVH& bvh, const Maths::Matrix4& viewMatrix);
+			bool NodeOverlapsCluster(const NodeBounds& node, const GLSL::ClusterFrustum& frustum, float nearClipVS) const;
+
+			// Records a cluster's visible count from the counting pass, and keeps at most maxLightsPerCluster of them
+			void SetVisibleCount(uint cluster, uint visible);
+			// Where the scattering pass writes a cluster's visible lights. Clusters over the cap go to overflow,
+			// which EndScatter sorts to copy the lowest indexed lights into the cluster's range.
+			uint* BeginScatter(uint cluster);
+			void EndScatter(uint cluster);
+
+			// Return the number of visible lights, ignoring maxLightsPerCluster. Indices are only written if out isn't null.
+			uint CullCluster(const GLSL::ClusterFrustum& frustum, float nearClipVS, uint* out) const;
+			uint CullClusterBVH(const LightBVH& bvh, const GLSL::ClusterFrustum& frustum, float nearClipVS, uint* out) const;
+			// Tests the SoA slots [begin, end), appending to out from count onwards. Returns the new count.
+			uint CullRange(const GLSL::ClusterFrustum& frustum, float nearClipVS, size_t begin, size_t end, uint* out, uint count) const;
+
+			ClusterGridDesc desc;
+			std::vector<GLSL::ClusterFrustum> grid;
+			LightListBuilder lightList;
+			std::vector<uint> visibleCounts;
+			std::vector<uint> overflow;
+
+			// View space light positions and radii in SoA form, padded to a multiple of the SIMD width.
+			std::vector<float> lightX;
+			std::vector<float> lightY;
+			std::vector<float> lightZ;
+			std::vector<float> lightRadius;
+			std::span<const uint> lightOrder;
+			uint numLights = 0;
+
+			std::vector<NodeBounds> nodeBounds;
+		};
+	}
+}
@@ -0,0 +1,64 @@
+#include "pch.h"
+#include "DepthPyramid.h"
+
+#include <algorithm>
+
+using namespace NCL;
+using namespace Rendering;
+
+namespace {
+	DepthPyramid::Bounds CombineBounds(const DepthPyramid::Bounds& a, const DepthPyramid::Bounds& b) {
+		return { std::min(a.nearest, b.nearest), std::max(a.farthestDrawn, b.farthestDrawn), std::max(a.farthest, b.farthest) };
+	}
+
+	// One dispatch of depthPyramid.comp. load(x, y) reads the source level.
+	template <typename LoadFunc>
+	void ReduceLevel(int sourceWidth, int sourceHeight, int destWidth, int destHeight, std::vector<DepthPyramid::Bounds>& dest, LoadFunc&& load) {
+		dest.resize(destWidth * destHeight);
+		for (int y = 0; y < destHeight; ++y) {
+			const int firstY = y * 2;
+			const int lastY = y == destHeight - 1 ? sourceHeight - 1 : std::min(firstY + 1, sourceHeight - 1);
+			for (int x = 0; x < destWidth; ++x) {
+				const int firstX = x * 2;
+				const int lastX = x == destWidth - 1 ? sourceWidth - 1 : std::min(firstX + 1, sourceWidth - 1);
+
+				DepthPyramid::Bounds bounds;
+				for (int sy = firstY; sy <= lastY; ++sy) {
+					for (int sx = firstX; sx <= lastX; ++sx) {
+						bounds = CombineBounds(bounds, load(sx, sy));
+					}
+				}
+				dest[y * destWidth + x] = bounds;
+			}
+		}
+	}
+}
+
+void DepthPyramid::Build(std::span<const float> depth, int width, int height) {
+	levels.clear();
+
+	int levelWidth = std::max(1, width / 2);
+	int levelHeight = std::max(1, height / 2);
+	levels.push_back({ levelWidth, levelHeight, {} });
+	ReduceLevel(width, height, levelWidth, levelHeight, levels.back().texels, [&](int x, int y) {
+		const float sample = depth[y * width + x];
+		return Bounds{ sample, sample < 1.0f ? sample : 0.0f, sample };
+	});
+
+	while (levelWidth > 1 || levelHeight > 1) {
+		levelWidth = std::max(1, levelWidth / 2);
+		levelHeight = std::max(1, levelHeight / 2);
+		levels.push_back({ levelWidth, levelHeight, {} });
+
+		const Level& source = levels[levels.size() - 2];
+		ReduceLevel(source.width, source.height, levelWidth, levelHeight, levels.back().texels, [&](int x, int y) {
+			return source.texels[y * source.width + x];
+		});
+	}
+}
+
+const DepthPyramid::Bounds& DepthPyramid::GetPixelBounds(int level, int x, int y) const {
+	const Level& l = levels[level];
+	const int shift = level + 1;
+	return GetBounds(level, std::min(x >> shift, l.width - 1), std::min(y >> shift, l.height - 1));
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "NCLAliases.h"
+
+#include <span>
+#include <vector>
+
+namespace NCL {
+	namespace Rendering {
+		/*
+		* CPU twin of GpuDepthPyramid and depthPyramid.comp, for validating them and for benchmarks.
+		* Produces the same levels, sizes and conservative edge handling, see DepthPyramidDefinitions.h.
+		*/
+		class DepthPyramid {
+		public:
+			struct Bounds {
+				float nearest = 1.0f;
+				// 0 when nothing was drawn under the texel
+				float farthestDrawn = 0.0f;
+				// Includes cleared pixels
+				float farthest = 0.0f;
+
+				bool AnythingDrawn() const { return farthestDrawn >= nearest; }
+			};
+
+			DepthPyramid() = default;
+			~DepthPyramid() = default;
+
+			// depth holds width * height depth buffer values in [0, 1], row by row
+			void Build(std::span<const float> depth, int width, int height);
+
+			int GetLevelCount() const { return (int)levels.size(); }
+			int GetLevelWidth(int level) const { return levels[level].width; }
+			int GetLevelHeight(int level) const { return levels[level].height; }
+
+			const Bounds& GetBounds(int level, int x, int y) const {
+				const Level& l = levels[level];
+				return l.texels[y * l.width + x];
+			}
+
+			// Bounds of the texel covering pixel (x, y), clamping to the last row and column as the shaders do
+			const Bounds& GetPixelBounds(int level, int x, int y) const;
+
+		protected:
+			struct Level {
+				int width = 0;
+				int height = 0;
+				std::vector<Bounds> texels;
+			};
+
+			std::vector<Level> levels;
+		};
+	}
+}
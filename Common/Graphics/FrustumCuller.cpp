@@ -0,0 +1,220 @@
+#include "pch.h"
+#include "FrustumCuller.h"
+#include "Math/SIMD.h"
+
+#include <algorithm>
+#include <bit>
+#include <cfloat>
+#include <cmath>
+
+using namespace NCL;
+using namespace Maths;
+using namespace Rendering;
+
+void FrustumCuller::Clear() {
+	centreX.clear();
+	centreY.clear();
+	centreZ.clear();
+	halfX.clear();
+	halfY.clear();
+	halfZ.clear();
+	radius.clear();
+}
+
+void FrustumCuller::Reserve(size_t count) {
+	centreX.reserve(count);
+	centreY.reserve(count);
+	centreZ.reserve(count);
+	halfX.reserve(count);
+	halfY.reserve(count);
+	halfZ.reserve(count);
+	radius.reserve(count);
+}
+
+uint FrustumCuller::AddSphere(const Vector3& centre, float sphereRadius) {
+	centreX.push_back(centre.x);
+	centreY.push_back(centre.y);
+	centreZ.push_back(centre.z);
+	halfX.push_back(0.0f);
+	halfY.push_back(0.0f);
+	halfZ.push_back(0.0f);
+	radius.push_back(sphereRadius);
+	return (uint)centreX.size() - 1;
+}
+
+uint FrustumCuller::AddBox(const Vector3& centre, const Vector3& halfSize) {
+	centreX.push_back(centre.x);
+	centreY.push_back(centre.y);
+	centreZ.push_back(centre.z);
+	halfX.push_back(halfSize.x);
+	halfY.push_back(halfSize.y);
+	halfZ.push_back(halfSize.z);
+	radius.push_back(0.0f);
+	return (uint)centreX.size() - 1;
+}
+
+uint FrustumCuller::AddBox(const Matrix4& transform, const Vector3& localCentre, const Vector3& localHalfSize) {
+	Vector3 centre;
+	Vector3 halfSize;
+	TransformBox(transform, localCentre, localHalfSize, centre, halfSize);
+	return AddBox(centre, halfSize);
+}
+
+void FrustumCuller::TransformBox(const Matrix4& transform, const Vector3& localCentre, const Vector3& localHalfSize,
+	Vector3& centre, Vector3& halfSize) {
+	const float* m = transform.array;
+	centre = Vector3(
+		m[0] * localCentre.x + m[4] * localCentre.y + m[8] * localCentre.z + m[12],
+		m[1] * localCentre.x + m[5] * localCentre.y + m[9] * localCentre.z + m[13],
+		m[2] * localCentre.x + m[6] * localCentre.y + m[10] * localCentre.z + m[14]);
+	// Each world axis gets the extent of the rotated and scaled box along it
+	halfSize = Vector3(
+		std::abs(m[0]) * localHalfSize.x + std::abs(m[4]) * localHalfSize.y + std::abs(m[8]) * localHalfSize.z,
+		std::abs(m[1]) * localHalfSize.x + std::abs(m[5]) * localHalfSize.y + std::abs(m[9]) * localHalfSize.z,
+		std::abs(m[2]) * localHalfSize.x + std::abs(m[6]) * localHalfSize.y + std::abs(m[10]) * localHalfSize.z);
+}
+
+bool FrustumCuller::IsVisible(const Frustum& frustum, size_t i) const {
+	for (const Plane& plane : frustum.GetPlanes()) {
+		const Vector3 n = plane.GetNormal();
+		const float dist = n.x * centreX[i] + n.y * centreY[i] + n.z * centreZ[i] + plane.GetDistance();
+		const float extent = radius[i] + std::abs(n.x) * halfX[i] + std::abs(n.y) * halfY[i] + std::abs(n.z) * halfZ[i];
+		if (dist <= -extent) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void FrustumCuller::CullScalar(const Frustum& frustum, std::vector<uint>& visible) const {
+	visible.clear();
+	for (size_t i = 0; i < centreX.size(); ++i) {
+		if (IsVisible(frustum, i)) {
+			visible.push_back((uint)i);
+		}
+	}
+}
+
+/*
+* Per plane, an object is outside when dot(n, c) + d <= -(r + dot(abs(n), h)). The plane terms are broadcast once
+* and each block of objects keeps a mask of the planes it hasn't failed yet.
+*/
+bool FrustumCuller::GetBounds(Vector3& boundsMin, Vector3& boundsMax) const {
+	if (centreX.empty()) {
+		return false;
+	}
+	boundsMin = Vector3(FLT_MAX, FLT_MAX, FLT_MAX);
+	boundsMax = Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (size_t i = 0; i < centreX.size(); ++i) {
+		boundsMin.x = std::min(boundsMin.x, centreX[i] - halfX[i] - radius[i]);
+		boundsMin.y = std::min(boundsMin.y, centreY[i] - halfY[i] - radius[i]);
+		boundsMin.z = std::min(boundsMin.z, centreZ[i] - halfZ[i] - radius[i]);
+		boundsMax.x = std::max(boundsMax.x, centreX[i] + halfX[i] + radius[i]);
+		boundsMax.y = std::max(boundsMax.y, centreY[i] + halfY[i] + radius[i]);
+		boundsMax.z = std::max(boundsMax.z, centreZ[i] + halfZ[i] + radius[i]);
+	}
+	return true;
+}
+
+void FrustumCuller::GetBox(uint i, Vector3& centre, Vector3& halfSize) const {
+	centre = Vector3(centreX[i], centreY[i], centreZ[i]);
+	halfSize = Vector3(halfX[i] + radius[i], halfY[i] + radius[i], halfZ[i] + radius[i]);
+}
+
+void FrustumCuller::Cull(const Frustum& frustum, std::vector<uint>& visible) const {
+	visible.clear();
+	const size_t count = centreX.size();
+	const std::array<Plane, 6>& planes = frustum.GetPlanes();
+
+	auto emit = [&](uint bits, uint base) {
+		while (bits != 0) {
+			visible.push_back(base + (uint)std::countr_zero(bits));
+			bits &= bits - 1;
+		}
+	};
+
+	size_t i = 0;
+#if NCL_SIMD_AVX2
+	__m256 nx[6], ny[6], nz[6], ax[6], ay[6], az[6], nd[6];
+	for (int p = 0; p < 6; ++p) {
+		const Vector3 n = planes[p].GetNormal();
+		nx[p] = _mm256_set1_ps(n.x);
+		ny[p] = _mm256_set1_ps(n.y);
+		nz[p] = _mm256_set1_ps(n.z);
+		ax[p] = _mm256_set1_ps(std::abs(n.x));
+		ay[p] = _mm256_set1_ps(std::abs(n.y));
+		az[p] = _mm256_set1_ps(std::abs(n.z));
+		nd[p] = _mm256_set1_ps(planes[p].GetDistance());
+	}
+	const __m256 zero = _mm256_setzero_ps();
+
+	for (; i + 8 <= count; i += 8) {
+		const __m256 x = _mm256_loadu_ps(&centreX[i]);
+		const __m256 y = _mm256_loadu_ps(&centreY[i]);
+		const __m256 z = _mm256_loadu_ps(&centreZ[i]);
+		const __m256 hx = _mm256_loadu_ps(&halfX[i]);
+		const __m256 hy = _mm256_loadu_ps(&halfY[i]);
+		const __m256 hz = _mm256_loadu_ps(&halfZ[i]);
+		const __m256 r = _mm256_loadu_ps(&radius[i]);
+
+		__m256 mask = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < 6; ++p) {
+			__m256 dist = _mm256_add_ps(_mm256_mul_ps(nx[p], x), _mm256_mul_ps(ny[p], y));
+			dist = _mm256_add_ps(dist, _mm256_mul_ps(nz[p], z));
+			dist = _mm256_add_ps(dist, nd[p]);
+
+			__m256 extent = _mm256_add_ps(r, _mm256_mul_ps(ax[p], hx));
+			extent = _mm256_add_ps(extent, _mm256_mul_ps(ay[p], hy));
+			extent = _mm256_add_ps(extent, _mm256_mul_ps(az[p], hz));
+
+			mask = _mm256_and_ps(mask, _mm256_cmp_ps(dist, _mm256_sub_ps(zero, extent), _CMP_GT_OQ));
+		}
+
+		emit((uint)_mm256_movemask_ps(mask), (uint)i);
+	}
+#elif NCL_SIMD_SSE
+	__m128 nx[6], ny[6], nz[6], ax[6], ay[6], az[6], nd[6];
+	for (int p = 0; p < 6; ++p) {
+		const Vector3 n = planes[p].GetNormal();
+		nx[p] = _mm_set1_ps(n.x);
+		ny[p] = _mm_set1_ps(n.y);
+		nz[p] = _mm_set1_ps(n.z);
+		ax[p] = _mm_set1_ps(std::abs(n.x));
+		ay[p] = _mm_set1_ps(std::abs(n.y));
+		az[p] = _mm_set1_ps(std::abs(n.z));
+		nd[p] = _mm_set1_ps(planes[p].GetDistance());
+	}
+	const __m128 zero = _mm_setzero_ps();
+
+	for (; i + 4 <= count; i += 4) {
+		const __m128 x = _mm_loadu_ps(&centreX[i]);
+		const __m128 y = _mm_loadu_ps(&centreY[i]);
+		const __m128 z = _mm_loadu_ps(&centreZ[i]);
+		const __m128 hx = _mm_loadu_ps(&halfX[i]);
+		const __m128 hy = _mm_loadu_ps(&halfY[i]);
+		const __m128 hz = _mm_loadu_ps(&halfZ[i]);
+		const __m128 r = _mm_loadu_ps(&radius[i]);
+
+		__m128 mask = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < 6; ++p) {
+			__m128 dist = _mm_add_ps(_mm_mul_ps(nx[p], x), _mm_mul_ps(ny[p], y));
+			dist = _mm_add_ps(dist, _mm_mul_ps(nz[p], z));
+			dist = _mm_add_ps(dist, nd[p]);
+
+			__m128 extent = _mm_add_ps(r, _mm_mul_ps(ax[p], hx));
+			extent = _mm_add_ps(extent, _mm_mul_ps(ay[p], hy));
+			extent = _mm_add_ps(extent, _mm_mul_ps(az[p], hz));
+
+			mask = _mm_and_ps(mask, _mm_cmpgt_ps(dist, _mm_sub_ps(zero, extent)));
+		}
+
+		emit((uint)_mm_movemask_ps(mask), (uint)i);
+	}
+#endif
+	// Whatever doesn't fill a whole block
+	for (; i < count; ++i) {
+		if (IsVisible(frustum, i)) {
+			visible.push_back((uint)i);
+		}
+	}
+}
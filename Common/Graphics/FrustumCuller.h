@@ -0,0 +1,60 @@
+#pragma once
+#include "Math/Frustum.h"
+#include "Math/Matrix4.h"
+#include "Math/Vector3.h"
+#include "NCLAliases.h"
+
+#include <vector>
+
+namespace NCL {
+	namespace Rendering {
+		/*
+		* Tests many objects against a Frustum at once, with the bounds kept in SoA form and tested 8 at a time with
+		* AVX2 (4 with SSE) when available.
+		* Every object is a world space box plus a radius: a sphere is a box with no size and a box is a sphere with
+		* no radius, so both go through the same test. That's Plane::SphereInPlane with the radius grown by the box's
+		* extent along each plane normal, so a sphere is kept or culled exactly as Frustum::IsInsideFrustum would.
+		*/
+		class FrustumCuller {
+		public:
+			FrustumCuller() = default;
+			~FrustumCuller() = default;
+
+			void Clear();
+			void Reserve(size_t count);
+
+			// Each Add returns the index Cull reports the object by, objects are numbered in the order they're added
+			uint AddSphere(const Maths::Vector3& centre, float radius);
+			uint AddBox(const Maths::Vector3& centre, const Maths::Vector3& halfSize);
+			// Adds the world space box around a local space box moved by transform
+			uint AddBox(const Maths::Matrix4& transform, const Maths::Vector3& localCentre, const Maths::Vector3& localHalfSize);
+
+			// Fills visible with the indices of the objects at least partly inside frustum, in ascending order
+			void Cull(const Frustum& frustum, std::vector<uint>& visible) const;
+			// Same as Cull without SIMD, the reference the SIMD path is checked against.
+			void CullScalar(const Frustum& frustum, std::vector<uint>& visible) const;
+
+			uint GetObjectCount() const { return (uint)centreX.size(); }
+
+			// Gets the box around every object, false if there are none
+			bool GetBounds(Maths::Vector3& boundsMin, Maths::Vector3& boundsMax) const;
+			// Gets object i as a box, with its radius added to every side
+			void GetBox(uint i, Maths::Vector3& centre, Maths::Vector3& halfSize) const;
+
+			// Gets the world space box around a local space box moved by transform
+			static void TransformBox(const Maths::Matrix4& transform, const Maths::Vector3& localCentre, const Maths::Vector3& localHalfSize,
+				Maths::Vector3& centre, Maths::Vector3& halfSize);
+
+		protected:
+			bool IsVisible(const Frustum& frustum, size_t i) const;
+
+			std::vector<float> centreX;
+			std::vector<float> centreY;
+			std::vector<float> centreZ;
+			std::vector<float> halfX;
+			std::vector<float> halfY;
+			std::vector<float> halfZ;
+			std::vector<float> radius;
+		};
+	}
+}
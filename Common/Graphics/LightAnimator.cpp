@@ -0,0 +1,168 @@
+#include "pch.h"
+#include "LightAnimator.h"
+#include "Math/SIMD.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace NCL;
+using namespace Maths;
+using namespace Rendering;
+
+using GLSL::LightAnimationParams;
+using GLSL::PointLight;
+
+namespace {
+	// Golden ratio spacing keeps neighbouring lights out of phase
+	constexpr float FLICKER_PHASE_STEP = 0.618034f;
+
+	float FastSin(float x) {
+		const float y = (4.0f / PI) * x - (4.0f / (PI * PI)) * x * std::abs(x);
+		return 0.225f * (y * std::abs(y) - y) + y;
+	}
+
+	float Fract(float x) {
+		return x - std::floor(x);
+	}
+
+	// Rotation about the vertical axis for one update, the same for every light
+	struct OrbitStep {
+		float c;
+		float s;
+	};
+
+	OrbitStep GetOrbitStep(const LightAnimationParams& params) {
+		const float angle = params.orbitSpeed * params.dt;
+		return { std::cos(angle), std::sin(angle) };
+	}
+
+	float FlickerIntensity(uint lightIndex, const LightAnimationParams& params) {
+		const float phase = Fract((float)lightIndex * FLICKER_PHASE_STEP);
+		const float wave = Fract(params.time * params.flickerRate + phase);
+		return 1.0f - params.flickerAmount * (0.5f + 0.5f * FastSin(wave * 2.0f * PI - PI));
+	}
+
+	void AnimateLight(PointLight& light, uint lightIndex, const LightAnimationParams& params, const OrbitStep& orbit) {
+		if (params.models & LIGHT_ANIMATION_FALL) {
+			const float range = params.maxBounds.y - params.minBounds.y;
+			const float fallen = light.pos.y - params.fallSpeed * params.dt - params.minBounds.y;
+			light.pos.y = fallen - range * std::floor(fallen / range) + params.minBounds.y;
+		}
+		if (params.models & LIGHT_ANIMATION_ORBIT) {
+			const float offsetX = light.pos.x - params.orbitCentre.x;
+			const float offsetZ = light.pos.z - params.orbitCentre.z;
+			light.pos.x = params.orbitCentre.x + (offsetX * orbit.c - offsetZ * orbit.s);
+			light.pos.z = params.orbitCentre.z + (offsetX * orbit.s + offsetZ * orbit.c);
+		}
+		if (params.models & LIGHT_ANIMATION_FLICKER) {
+			light.colour.w = FlickerIntensity(lightIndex, params);
+		}
+	}
+
+#if NCL_SIMD_SSE
+	// _mm_floor_ps needs SSE4.1, this only needs SSE2. Fine for anything that fits in an int.
+	__m128 Floor(__m128 v) {
+		const __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+		return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, v), _mm_set1_ps(1.0f)));
+	}
+
+	__m128 Fract(__m128 v) {
+		return _mm_sub_ps(v, Floor(v));
+	}
+
+	__m128 Abs(__m128 v) {
+		return _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+	}
+
+	__m128 FastSin(__m128 x) {
+		const __m128 y = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(4.0f / PI), x),
+			_mm_mul_ps(_mm_mul_ps(_mm_set1_ps(4.0f / (PI * PI)), x), Abs(x)));
+		return _mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.225f), _mm_sub_ps(_mm_mul_ps(y, Abs(y)), y)), y);
+	}
+#endif
+}
+
+LightAnimator::LightAnimator(JobSystem& j) : jobs(j) {
+}
+
+void LightAnimator::Animate(std::span<PointLight> lights, const LightAnimationParams& params) {
+	const size_t count = lights.size();
+	const size_t threads = jobs.GetThreadCount();
+
+	// One chunk per thread of whole SIMD batches, so only the last chunk has a scalar tail
+	const size_t chunk = PadToSIMDWidth(std::max(MIN_LIGHTS_PER_THREAD, (count + threads - 1) / threads), 4);
+	jobs.ParallelFor((uint)count, (uint)chunk, [&](uint begin, uint end) {
+		AnimateRange(lights.subspan(begin, end - begin), begin, params);
+	});
+}
+
+void LightAnimator::AnimateRange(std::span<PointLight> lights, uint firstIndex, const LightAnimationParams& params) {
+	size_t i = 0;
+#if NCL_SIMD_SSE
+	const OrbitStep orbit = GetOrbitStep(params);
+	const bool fall = params.models & LIGHT_ANIMATION_FALL;
+	const bool orbiting = params.models & LIGHT_ANIMATION_ORBIT;
+	const bool flicker = params.models & LIGHT_ANIMATION_FLICKER;
+
+	const __m128 minY = _mm_set1_ps(params.minBounds.y);
+	const __m128 rangeY = _mm_set1_ps(params.maxBounds.y - params.minBounds.y);
+	const __m128 fallStep = _mm_set1_ps(params.fallSpeed * params.dt);
+	const __m128 centreX = _mm_set1_ps(params.orbitCentre.x);
+	const __m128 centreZ = _mm_set1_ps(params.orbitCentre.z);
+	const __m128 cosStep = _mm_set1_ps(orbit.c);
+	const __m128 sinStep = _mm_set1_ps(orbit.s);
+	const __m128 laneOffsets = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+
+	for (; i + 4 <= lights.size(); i += 4) {
+		PointLight* batch = &lights[i];
+		if (fall || orbiting) {
+			__m128 x = _mm_loadu_ps(batch[0].pos.array);
+			__m128 y = _mm_loadu_ps(batch[1].pos.array);
+			__m128 z = _mm_loadu_ps(batch[2].pos.array);
+			__m128 w = _mm_loadu_ps(batch[3].pos.array);
+			_MM_TRANSPOSE4_PS(x, y, z, w);
+
+			if (fall) {
+				const __m128 fallen = _mm_sub_ps(_mm_sub_ps(y, fallStep), minY);
+				const __m128 wraps = Floor(_mm_div_ps(fallen, rangeY));
+				y = _mm_add_ps(_mm_sub_ps(fallen, _mm_mul_ps(rangeY, wraps)), minY);
+			}
+			if (orbiting) {
+				const __m128 offsetX = _mm_sub_ps(x, centreX);
+				const __m128 offsetZ = _mm_sub_ps(z, centreZ);
+				x = _mm_add_ps(centreX, _mm_sub_ps(_mm_mul_ps(offsetX, cosStep), _mm_mul_ps(offsetZ, sinStep)));
+				z = _mm_add_ps(centreZ, _mm_add_ps(_mm_mul_ps(offsetX, sinStep), _mm_mul_ps(offsetZ, cosStep)));
+			}
+
+			_MM_TRANSPOSE4_PS(x, y, z, w);
+			_mm_storeu_ps(batch[0].pos.array, x);
+			_mm_storeu_ps(batch[1].pos.array, y);
+			_mm_storeu_ps(batch[2].pos.array, z);
+			_mm_storeu_ps(batch[3].pos.array, w);
+		}
+
+		if (flicker) {
+			const __m128 index = _mm_add_ps(_mm_set1_ps((float)(firstIndex + i)), laneOffsets);
+			const __m128 phase = Fract(_mm_mul_ps(index, _mm_set1_ps(FLICKER_PHASE_STEP)));
+			const __m128 wave = Fract(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(params.time), _mm_set1_ps(params.flickerRate)), phase));
+			const __m128 angle = _mm_sub_ps(_mm_mul_ps(wave, _mm_set1_ps(2.0f * PI)), _mm_set1_ps(PI));
+			const __m128 dip = _mm_add_ps(_mm_set1_ps(0.5f), _mm_mul_ps(_mm_set1_ps(0.5f), FastSin(angle)));
+			const __m128 intensity = _mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_set1_ps(params.flickerAmount), dip));
+
+			alignas(16) float intensities[4];
+			_mm_store_ps(intensities, intensity);
+			for (int lane = 0; lane < 4; ++lane) {
+				batch[lane].colour.w = intensities[lane];
+			}
+		}
+	}
+#endif
+	AnimateScalar(lights.subspan(i), firstIndex + (uint)i, params);
+}
+
+void LightAnimator::AnimateScalar(std::span<PointLight> lights, uint firstIndex, const LightAnimationParams& params) {
+	const OrbitStep orbit = GetOrbitStep(params);
+	for (size_t i = 0; i < lights.size(); ++i) {
+		AnimateLight(lights[i], firstIndex + (uint)i, params, orbit);
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "NCLAliases.h"
+#include "Core/Jobs/JobSystem.h"
+#include "../../Assets/Shaders/Shared/LightDefinitions.h"
+#include "../../Assets/Shaders/Shared/LightAnimationDefinitions.h"
+
+#include <span>
+
+namespace NCL {
+	namespace Rendering {
+		/*
+		* CPU version of updateLights.comp, for the renderer's CPU light update and for benchmarking against the GPU.
+		* Lights are split into one chunk per thread of the JobSystem it's given, and each chunk is animated 4 at a time
+		* with SSE when available, transposing positions into x/y/z registers and back.
+		* Flicker uses the same sine approximation as the shader, so both produce the same lights to within rounding.
+		* The SIMD path isn't bitwise identical to AnimateScalar either, only within rounding of it.
+		*/
+		class LightAnimator {
+		public:
+			// Chunks smaller than this aren't worth a thread
+			static constexpr size_t MIN_LIGHTS_PER_THREAD = 4096;
+
+			LightAnimator(JobSystem& jobs);
+			~LightAnimator() = default;
+
+			// Mirrors updateLights.comp. params.lightCount is ignored, every light in lights is animated.
+			void Animate(std::span<GLSL::PointLight> lights, const GLSL::LightAnimationParams& params);
+
+			// Animates on the calling thread only. firstIndex is the index of lights[0], which sets each light's flicker phase.
+			static void AnimateRange(std::span<GLSL::PointLight> lights, uint firstIndex, const GLSL::LightAnimationParams& params);
+			// Same as AnimateRange without SIMD, the reference the SIMD path is checked against.
+			static void AnimateScalar(std::span<GLSL::PointLight> lights, uint firstIndex, const GLSL::LightAnimationParams& params);
+
+			uint GetThreadCount() const { return jobs.GetThreadCount(); }
+
+		protected:
+			JobSystem& jobs;
+		};
+	}
+}
@@ -0,0 +1,92 @@
+#include "pch.h"
+#include "LightBVH.h"
+#include "RadixSort.h"
+#include "Math/Morton.h"
+#include "Math/Vector3.h"
+#include "Math/Vector4.h"
+
+#include <algorithm>
+#include <cfloat>
+
+using namespace NCL;
+using namespace Maths;
+using namespace Rendering;
+
+using GLSL::LightBVHNode;
+using GLSL::PointLight;
+
+static_assert(sizeof(LightBVHNode) == 48, "LightBVHNode must match the std430 layout used by the shaders");
+
+namespace {
+	LightBVHNode EmptyNode(uint first) {
+		LightBVHNode node;
+		node.boundsMin = Vector4(FLT_MAX, FLT_MAX, FLT_MAX, 0.0f);
+		node.boundsMax = Vector4(-FLT_MAX, -FLT_MAX, -FLT_MAX, 0.0f);
+		node.first = first;
+		node.count = 0;
+		node.pad0 = 0;
+		node.pad1 = 0;
+		return node;
+	}
+
+	void GrowNode(LightBVHNode& node, const Vector4& boundsMin, const Vector4& boundsMax) {
+		for (int i = 0; i < 3; ++i) {
+			node.boundsMin[i] = std::min(node.boundsMin[i], boundsMin[i]);
+			node.boundsMax[i] = std::max(node.boundsMax[i], boundsMax[i]);
+		}
+	}
+}
+
+void LightBVH::Build(std::span<const PointLight> lights) {
+	SortLights(lights);
+
+	const uint numLights = (uint)lights.size();
+	const uint leafCount = (numLights + LIGHT_BVH_LEAF_SIZE - 1) / LIGHT_BVH_LEAF_SIZE;
+	topLevelCount = (leafCount + LIGHT_BVH_BRANCH_SIZE - 1) / LIGHT_BVH_BRANCH_SIZE;
+
+	nodes.resize(topLevelCount + leafCount);
+
+	for (uint leaf = 0; leaf < leafCount; ++leaf) {
+		LightBVHNode& node = nodes[topLevelCount + leaf];
+		node = EmptyNode(leaf * LIGHT_BVH_LEAF_SIZE);
+		node.count = std::min((uint)LIGHT_BVH_LEAF_SIZE, numLights - node.first);
+
+		for (uint i = node.first; i < node.first + node.count; ++i) {
+			const PointLight& light = lights[lightOrder[i]];
+			const float r = light.radius.x;
+			const Vector4 extent(r, r, r, 0.0f);
+			GrowNode(node, light.pos - extent, light.pos + extent);
+		}
+	}
+
+	for (uint top = 0; top < topLevelCount; ++top) {
+		LightBVHNode& node = nodes[top];
+		node = EmptyNode(topLevelCount + top * LIGHT_BVH_BRANCH_SIZE);
+		node.count = std::min((uint)LIGHT_BVH_BRANCH_SIZE, leafCount - top * LIGHT_BVH_BRANCH_SIZE);
+
+		for (uint i = node.first; i < node.first + node.count; ++i) {
+			GrowNode(node, nodes[i].boundsMin, nodes[i].boundsMax);
+		}
+	}
+}
+
+void LightBVH::SortLights(std::span<const PointLight> lights) {
+	Vector3 sceneMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	Vector3 sceneMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (const PointLight& light : lights) {
+		for (int i = 0; i < 3; ++i) {
+			sceneMin[i] = std::min(sceneMin[i], light.pos[i]);
+			sceneMax[i] = std::max(sceneMax[i], light.pos[i]);
+		}
+	}
+
+	sortKeys.resize(lights.size());
+	lightOrder.resize(lights.size());
+	for (size_t i = 0; i < lights.size(); ++i) {
+		sortKeys[i] = MortonEncode(Vector3(lights[i].pos), sceneMin, sceneMax);
+		lightOrder[i] = (uint)i;
+	}
+	// The sort is stable, so ties stay in light index order and the order is deterministic.
+	// The codes are 30 bits, so RadixSort skips the top 4 bytes.
+	RadixSort(sortKeys, lightOrder, keyScratch, orderScratch);
+}
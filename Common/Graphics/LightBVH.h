@@ -0,0 +1,54 @@
+#pragma once
+#include "NCLAliases.h"
+#include "../../Assets/Shaders/Shared/LightDefinitions.h"
+#include "../../Assets/Shaders/Shared/LightBVHDefinitions.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace NCL {
+	namespace Rendering {
+		/*
+		* Two level bounding hierarchy over the point lights.
+		* Lights are sorted by the Morton code of their position, so each run of LIGHT_BVH_LEAF_SIZE lights
+		* in the sorted order is spatially coherent. Leaves bound one of those runs and top level nodes bound
+		* LIGHT_BVH_BRANCH_SIZE consecutive leaves.
+		* With only two fixed levels, culling a cluster tests every top level node, N / 1024 of them, then the leaves
+		* and lights under the ones it overlaps, so a full grid costs O(clusters * (N / 1024 + lights near each cluster)).
+		* Leaf i always starts at light i * LIGHT_BVH_LEAF_SIZE in GetLightOrder, so leaf ranges stay aligned to the SIMD width.
+		* The node layout matches LightBVHNode in the shaders, so GetNodes and GetLightOrder can be uploaded as is,
+		* and lightBVHRefit.comp can refit the bounds to moved lights without re-sorting them.
+		*/
+		class LightBVH {
+		public:
+			LightBVH() = default;
+			~LightBVH() = default;
+
+			void Build(std::span<const GLSL::PointLight> lights);
+
+			// Top level nodes first, followed by the leaves.
+			const std::vector<GLSL::LightBVHNode>& GetNodes() const { return nodes; }
+			// Maps a position in the sorted order to the index of the light in the array passed to Build.
+			const std::vector<uint>& GetLightOrder() const { return lightOrder; }
+
+			uint GetTopLevelCount() const { return topLevelCount; }
+			uint GetLeafCount() const { return (uint)nodes.size() - topLevelCount; }
+			uint GetLightCount() const { return (uint)lightOrder.size(); }
+
+			std::span<const GLSL::LightBVHNode> GetTopLevel() const { return { nodes.data(), topLevelCount }; }
+			std::span<const GLSL::LightBVHNode> GetLeaves() const { return { nodes.data() + topLevelCount, GetLeafCount() }; }
+
+		protected:
+			void SortLights(std::span<const GLSL::PointLight> lights);
+
+			std::vector<GLSL::LightBVHNode> nodes;
+			std::vector<uint> lightOrder;
+			// Morton codes, radix sorted along with lightOrder
+			std::vector<uint64_t> sortKeys;
+			std::vector<uint64_t> keyScratch;
+			std::vector<uint> orderScratch;
+			uint topLevelCount = 0;
+		};
+	}
+}
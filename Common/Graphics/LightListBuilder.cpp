@@ -0,0 +1,22 @@
+#include "pch.h"
+#include "LightListBuilder.h"
+
+using namespace NCL;
+using namespace Rendering;
+
+void LightListBuilder::Reset(uint cellCount, uint cellCapacity) {
+	grid.assign(cellCount, GLSL::LightGrid{ 0, 0 });
+	totalCount = 0;
+	capacity = cellCapacity;
+}
+
+uint LightListBuilder::PrefixSum() {
+	uint offset = 0;
+	for (GLSL::LightGrid& cell : grid) {
+		cell.offset = offset;
+		offset += cell.count;
+	}
+	totalCount = offset;
+	lightIndices.resize(totalCount);
+	return totalCount;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "NCLAliases.h"
+#include "../../Assets/Shaders/Shared/LightGridDefinitions.h"
+
+#include <algorithm>
+#include <climits>
+#include <span>
+#include <vector>
+
+namespace NCL {
+	namespace Rendering {
+		/*
+		* Builds the packed light list used by the forward+ and clustered shaders: one LightGrid {offset, count}
+		* per tile/cluster and a single index list with every cell's lights stored back to back.
+		* Built in three passes:
+		*	1. SetCount for every cell
+		*	2. PrefixSum turns the counts into offsets and sizes the index list
+		*	3. Each cell writes its lights into GetCellIndices
+		* Cells are independent in passes 1 and 3, so they can be filled in any order or in parallel.
+		* Counts are clamped to the cell capacity, and a cell that sees more lights than that only has room for
+		* that many, so the caller picks which to keep.
+		*/
+		class LightListBuilder {
+		public:
+			LightListBuilder() = default;
+			~LightListBuilder() = default;
+
+			// Clears all counts. The index list keeps its allocation between frames.
+			void Reset(uint cellCount, uint cellCapacity = UINT_MAX);
+
+			// Returns the count kept, at most the cell capacity
+			uint SetCount(uint cell, uint count) {
+				grid[cell].count = std::min(count, capacity);
+				return grid[cell].count;
+			}
+
+			// Exclusive prefix sum over the counts. Returns the total number of indices.
+			uint PrefixSum();
+
+			// Destination for a cell's indices. Only valid after PrefixSum.
+			std::span<uint> GetCellIndices(uint cell) {
+				return { lightIndices.data() + grid[cell].offset, grid[cell].count };
+			}
+
+			std::span<const uint> GetCellLights(uint cell) const {
+				return { lightIndices.data() + grid[cell].offset, grid[cell].count };
+			}
+
+			uint GetCellCount() const { return (uint)grid.size(); }
+			uint GetCellCapacity() const { return capacity; }
+			uint GetTotalCount() const { return totalCount; }
+
+			const std::vector<GLSL::LightGrid>& GetGrid() const { return grid; }
+			// Sized to GetTotalCount after PrefixSum.
+			const std::vector<uint>& GetIndices() const { return lightIndices; }
+
+		protected:
+			std::vector<GLSL::LightGrid> grid;
+			std::vector<uint> lightIndices;
+			uint totalCount = 0;
+			uint capacity = UINT_MAX;
+		};
+	}
+}
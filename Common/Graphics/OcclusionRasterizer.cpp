@@ -0,0 +1,194 @@
+#include "pch.h"
+#include "OcclusionRasterizer.h"
+#include "Math/Vector4.h"
+#include "../../Assets/Shaders/Shared/OcclusionDefinitions.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+using namespace NCL;
+using namespace Maths;
+using namespace Rendering;
+
+namespace {
+	struct ScreenVertex {
+		float x;
+		float y;
+		float z;
+	};
+
+	// Twice the signed area of a, b, p, positive when p is to the left of a to b
+	float Edge(const ScreenVertex& a, const ScreenVertex& b, float px, float py) {
+		return (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x);
+	}
+}
+
+OcclusionRasterizer::OcclusionRasterizer(int width, int height) {
+	Resize(width, height);
+}
+
+void OcclusionRasterizer::Resize(int newWidth, int newHeight) {
+	width = std::max(1, newWidth);
+	height = std::max(1, newHeight);
+	depth.assign(width * height, 1.0f);
+}
+
+void OcclusionRasterizer::Begin(const Matrix4& newViewProj) {
+	viewProj = newViewProj;
+	std::fill(depth.begin(), depth.end(), 1.0f);
+	triangleCount = 0;
+}
+
+bool OcclusionRasterizer::ProjectBox(const Vector3& centre, const Vector3& halfSize, Vector3& minNDC, Vector3& maxNDC) const {
+	// Projection is linear before the divide, so each corner is the projected centre plus or minus each projected axis
+	const Vector4 clipCentre = viewProj * Vector4(centre, 1.0f);
+	const Vector4 clipX = viewProj.GetColumn(0) * halfSize.x;
+	const Vector4 clipY = viewProj.GetColumn(1) * halfSize.y;
+	const Vector4 clipZ = viewProj.GetColumn(2) * halfSize.z;
+
+	for (int i = 0; i < 8; ++i) {
+		const Vector4 clip = clipCentre + ((i & 1) ? clipX : -clipX) + ((i & 2) ? clipY : -clipY) + ((i & 4) ? clipZ : -clipZ);
+		if (clip.w <= OCCLUSION_MIN_W) {
+			return false;
+		}
+		const Vector3 ndc(clip.x / clip.w, clip.y / clip.w, clip.z / clip.w);
+		for (int axis = 0; axis < 3; ++axis) {
+			minNDC[axis] = i == 0 ? ndc[axis] : std::min(minNDC[axis], ndc[axis]);
+			maxNDC[axis] = i == 0 ? ndc[axis] : std::max(maxNDC[axis], ndc[axis]);
+		}
+	}
+	return true;
+}
+
+float OcclusionRasterizer::GetScreenCoverage(const Vector3& centre, const Vector3& halfSize) const {
+	Vector3 minNDC;
+	Vector3 maxNDC;
+	if (!ProjectBox(centre, halfSize, minNDC, maxNDC)) {
+		return 1.0f;
+	}
+	const float sizeX = std::clamp(maxNDC.x, -1.0f, 1.0f) - std::clamp(minNDC.x, -1.0f, 1.0f);
+	const float sizeY = std::clamp(maxNDC.y, -1.0f, 1.0f) - std::clamp(minNDC.y, -1.0f, 1.0f);
+	return sizeX * sizeY * 0.25f;
+}
+
+void OcclusionRasterizer::RasterizeTriangles(const Matrix4& modelMatrix, std::span<const Vector3> positions, std::span<const unsigned int> indices) {
+	const Matrix4 mvp = viewProj * modelMatrix;
+
+	for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+		ScreenVertex v[3];
+		bool projected = true;
+		for (int i = 0; i < 3; ++i) {
+			const Vector4 clip = mvp * Vector4(positions[indices[t + i]], 1.0f);
+			if (clip.w <= OCCLUSION_MIN_W) {
+				projected = false;
+				break;
+			}
+			const float invW = 1.0f / clip.w;
+			v[i] = { (clip.x * invW * 0.5f + 0.5f) * width, (clip.y * invW * 0.5f + 0.5f) * height, clip.z * invW * 0.5f + 0.5f };
+		}
+		if (!projected) {
+			continue;
+		}
+
+		float area = Edge(v[0], v[1], v[2].x, v[2].y);
+		if (area == 0.0f) {
+			continue;
+		}
+		// Occluders are drawn from both sides, so flip clockwise triangles rather than dropping them
+		if (area < 0.0f) {
+			std::swap(v[1], v[2]);
+			area = -area;
+		}
+
+		// Pixels whose centres fall inside the triangle's bounds
+		const int minX = std::max(0, (int)std::ceil(std::min({ v[0].x, v[1].x, v[2].x }) - 0.5f));
+		const int maxX = std::min(width - 1, (int)std::floor(std::max({ v[0].x, v[1].x, v[2].x }) - 0.5f));
+		const int minY = std::max(0, (int)std::ceil(std::min({ v[0].y, v[1].y, v[2].y }) - 0.5f));
+		const int maxY = std::min(height - 1, (int)std::floor(std::max({ v[0].y, v[1].y, v[2].y }) - 0.5f));
+		if (minX > maxX || minY > maxY) {
+			continue;
+		}
+		triangleCount++;
+
+		const float invArea = 1.0f / area;
+		const float stepX0 = -(v[2].y - v[1].y);
+		const float stepX1 = -(v[0].y - v[2].y);
+		const float stepX2 = -(v[1].y - v[0].y);
+		const float stepY0 = v[2].x - v[1].x;
+		const float stepY1 = v[0].x - v[2].x;
+		const float stepY2 = v[1].x - v[0].x;
+
+		// Only pixels the triangle covers completely are written, which is where each edge function is positive at
+		// all four corners, so at the centre it has to clear half its change across the pixel
+		const float inner0 = 0.5f * (std::abs(stepX0) + std::abs(stepY0));
+		const float inner1 = 0.5f * (std::abs(stepX1) + std::abs(stepY1));
+		const float inner2 = 0.5f * (std::abs(stepX2) + std::abs(stepY2));
+
+		// Window space depth is affine in screen space, so its farthest over a covered pixel is at a corner, half a
+		// pixel of slope past the centre, and never past the triangle's farthest vertex
+		const float slopeX = (stepX0 * v[0].z + stepX1 * v[1].z + stepX2 * v[2].z) * invArea;
+		const float slopeY = (stepY0 * v[0].z + stepY1 * v[1].z + stepY2 * v[2].z) * invArea;
+		const float farBias = 0.5f * (std::abs(slopeX) + std::abs(slopeY));
+		const float farthest = std::max({ v[0].z, v[1].z, v[2].z });
+
+		for (int y = minY; y <= maxY; ++y) {
+			const float py = y + 0.5f;
+			const float px = minX + 0.5f;
+			float w0 = Edge(v[1], v[2], px, py);
+			float w1 = Edge(v[2], v[0], px, py);
+			float w2 = Edge(v[0], v[1], px, py);
+			float* row = &depth[y * width];
+
+			for (int x = minX; x <= maxX; ++x) {
+				if (w0 >= inner0 && w1 >= inner1 && w2 >= inner2) {
+					const float z = (w0 * v[0].z + w1 * v[1].z + w2 * v[2].z) * invArea;
+					row[x] = std::min(row[x], std::min(z + farBias, farthest));
+				}
+				w0 += stepX0;
+				w1 += stepX1;
+				w2 += stepX2;
+			}
+		}
+	}
+}
+
+void OcclusionRasterizer::Finish() {
+	pyramid.Build(depth, width, height);
+}
+
+bool OcclusionRasterizer::IsVisible(const Vector3& centre, const Vector3& halfSize) const {
+	Vector3 minNDC;
+	Vector3 maxNDC;
+	if (!ProjectBox(centre, halfSize, minNDC, maxNDC)) {
+		return true;
+	}
+	if (minNDC.x > 1.0f || minNDC.y > 1.0f || maxNDC.x < -1.0f || maxNDC.y < -1.0f) {
+		return false;
+	}
+
+	const int minPixelX = std::min((int)(std::clamp(minNDC.x * 0.5f + 0.5f, 0.0f, 1.0f) * width), width - 1);
+	const int minPixelY = std::min((int)(std::clamp(minNDC.y * 0.5f + 0.5f, 0.0f, 1.0f) * height), height - 1);
+	const int maxPixelX = std::min((int)(std::clamp(maxNDC.x * 0.5f + 0.5f, 0.0f, 1.0f) * width), width - 1);
+	const int maxPixelY = std::min((int)(std::clamp(maxNDC.y * 0.5f + 0.5f, 0.0f, 1.0f) * height), height - 1);
+
+	// Level n texels cover 2^(n+1) pixels, pick the first level where the box spans at most 2x2 of them
+	const int size = std::max(maxPixelX - minPixelX, maxPixelY - minPixelY) + 1;
+	const int level = std::max(0, (int)std::bit_width((unsigned int)(size - 1)) - 1);
+	if (level >= pyramid.GetLevelCount()) {
+		return true;
+	}
+
+	const int shift = level + 1;
+	const int lastLevelX = pyramid.GetLevelWidth(level) - 1;
+	const int lastLevelY = pyramid.GetLevelHeight(level) - 1;
+	float farthest = 0.0f;
+	for (int y = std::min(minPixelY >> shift, lastLevelY); y <= std::min(maxPixelY >> shift, lastLevelY); ++y) {
+		for (int x = std::min(minPixelX >> shift, lastLevelX); x <= std::min(maxPixelX >> shift, lastLevelX); ++x) {
+			farthest = std::max(farthest, pyramid.GetBounds(level, x, y).farthest);
+		}
+	}
+
+	const float nearest = minNDC.z * 0.5f + 0.5f;
+	return nearest <= farthest;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "DepthPyramid.h"
+#include "Math/Matrix4.h"
+#include "Math/Vector3.h"
+#include "NCLAliases.h"
+
+#include <span>
+#include <vector>
+
+namespace NCL {
+	namespace Rendering {
+		/*
+		* Software occlusion culling for when there's no depth prepass to build a pyramid from, or no GPU at all.
+		* Large occluders are rasterized into a small depth buffer, which is reduced into a DepthPyramid, and boxes
+		* are tested against that the same way occlusionCull.comp tests them against the GpuDepthPyramid.
+		* Depths are window space [0, 1] like the GL depth buffer, so the same DepthPyramid can be compared with either.
+		* Rasterization is conservative, so nothing is hidden that could be seen: a triangle only writes the pixels
+		* it covers completely, with the farthest depth it reaches inside each. Thin occluders can vanish at low
+		* resolutions, which only loses occlusion.
+		*/
+		class OcclusionRasterizer {
+		public:
+			OcclusionRasterizer(int width = 320, int height = 180);
+			~OcclusionRasterizer() = default;
+
+			void Resize(int width, int height);
+
+			// Clears the depth buffer for a new view
+			void Begin(const Maths::Matrix4& viewProj);
+
+			// Sets the view GetScreenCoverage measures with, without clearing what's been drawn
+			void SetViewProjection(const Maths::Matrix4& newViewProj) {
+				viewProj = newViewProj;
+			}
+
+			// Fraction of the depth buffer covered by the screen rect of a world space box, 1 if it crosses the near plane
+			float GetScreenCoverage(const Maths::Vector3& centre, const Maths::Vector3& halfSize) const;
+
+			// Draws an indexed triangle list moved by modelMatrix. Triangles crossing the near plane are skipped,
+			// which only loses occlusion.
+			void RasterizeTriangles(const Maths::Matrix4& modelMatrix, std::span<const Maths::Vector3> positions, std::span<const unsigned int> indices);
+
+			// Builds the pyramid from everything rasterized since Begin, call before IsVisible
+			void Finish();
+
+			// Mirrors occlusionCull.comp. False if the world space box is hidden behind what was rasterized.
+			bool IsVisible(const Maths::Vector3& centre, const Maths::Vector3& halfSize) const;
+
+			int GetWidth() const { return width; }
+			int GetHeight() const { return height; }
+			std::span<const float> GetDepth() const { return depth; }
+			const DepthPyramid& GetPyramid() const { return pyramid; }
+			uint GetTriangleCount() const { return triangleCount; }
+
+		protected:
+			// Screen space bounds of a box, false if any corner is too close to or behind the camera to project
+			bool ProjectBox(const Maths::Vector3& centre, const Maths::Vector3& halfSize, Maths::Vector3& minNDC, Maths::Vector3& maxNDC) const;
+
+			int width;
+			int height;
+			Maths::Matrix4 viewProj;
+			std::vector<float> depth;
+			DepthPyramid pyramid;
+			uint triangleCount = 0;
+		};
+	}
+}
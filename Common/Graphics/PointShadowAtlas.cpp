@@ -0,0 +1,174 @@
+#include "pch.h"
+#include "PointShadowAtlas.h"
+#include "Math/Maths.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace NCL;
+using namespace Maths;
+using namespace Rendering;
+
+namespace {
+	// Same order as the shaders pick faces in, +X, -X, +Y, -Y, +Z, -Z
+	const Vector3 FACE_DIRECTIONS[POINT_SHADOW_FACE_COUNT] = {
+		Vector3(1, 0, 0), Vector3(-1, 0, 0), Vector3(0, 1, 0), Vector3(0, -1, 0), Vector3(0, 0, 1), Vector3(0, 0, -1)
+	};
+	const Vector3 FACE_UPS[POINT_SHADOW_FACE_COUNT] = {
+		Vector3(0, -1, 0), Vector3(0, -1, 0), Vector3(0, 0, 1), Vector3(0, 0, -1), Vector3(0, -1, 0), Vector3(0, -1, 0)
+	};
+}
+
+PointShadowAtlas::PointShadowAtlas(const PointShadowAtlasSettings& settings) : settings(settings) {
+	slotsX = settings.atlasSize / (3 * settings.faceSize);
+	const uint slotsY = settings.atlasSize / (2 * settings.faceSize);
+	slots.resize(slotsX * slotsY);
+}
+
+void PointShadowAtlas::Allocate(std::span<const PointShadowRequest> requests) {
+	++frame;
+
+	previousLights.resize(slots.size());
+	for (size_t i = 0; i < slots.size(); ++i) {
+		previousLights[i] = slots[i].active ? slots[i].light : POINT_SHADOW_NO_SLOT;
+		slots[i].active = false;
+	}
+
+	ranked.clear();
+	for (const PointShadowRequest& request : requests) {
+		if (request.importance <= 0.0f) {
+			continue;
+		}
+		const bool hasSlot = lightSlots.contains(request.lightIndex);
+		ranked.push_back({ request.lightIndex, request.importance * (hasSlot ? settings.retainBias : 1.0f) });
+	}
+
+	const size_t count = std::min({ ranked.size(), (size_t)settings.maxShadowedLights, slots.size() });
+	std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end(), [](const PointShadowRequest& a, const PointShadowRequest& b) {
+		return a.importance != b.importance ? a.importance > b.importance : a.lightIndex < b.lightIndex;
+	});
+
+	// Claim the slots of lights that already have one first, so a new light can't be given one of them
+	for (size_t i = 0; i < count; ++i) {
+		const auto found = lightSlots.find(ranked[i].lightIndex);
+		if (found != lightSlots.end()) {
+			slots[found->second].active = true;
+			slots[found->second].lastUsed = frame;
+		}
+	}
+
+	assignments.clear();
+	for (size_t i = 0; i < count; ++i) {
+		const uint light = ranked[i].lightIndex;
+		const auto found = lightSlots.find(light);
+		uint slot;
+		if (found != lightSlots.end()) {
+			slot = found->second;
+		}
+		else {
+			slot = FindSlot();
+			Slot& s = slots[slot];
+			if (s.light != POINT_SHADOW_NO_SLOT) {
+				lightSlots.erase(s.light);
+			}
+			s.light = light;
+			s.rendered = false;
+			s.active = true;
+			s.lastUsed = frame;
+			lightSlots[light] = slot;
+		}
+		assignments.push_back({ light, slot });
+	}
+
+	activated.clear();
+	deactivated.clear();
+	for (uint i = 0; i < (uint)slots.size(); ++i) {
+		const Slot& s = slots[i];
+		const uint previous = previousLights[i];
+		if (previous != POINT_SHADOW_NO_SLOT && (!s.active || s.light != previous)) {
+			deactivated.push_back(previous);
+		}
+		if (s.active && s.light != previous) {
+			activated.push_back({ s.light, i });
+		}
+	}
+}
+
+uint PointShadowAtlas::FindSlot() {
+	uint best = POINT_SHADOW_NO_SLOT;
+	for (uint i = 0; i < (uint)slots.size(); ++i) {
+		const Slot& s = slots[i];
+		if (s.light == POINT_SHADOW_NO_SLOT) {
+			return i;
+		}
+		if (!s.active && (best == POINT_SHADOW_NO_SLOT || s.lastUsed < slots[best].lastUsed)) {
+			best = i;
+		}
+	}
+	// Allocate never shadows more lights than there are slots, so one is always inactive
+	return best;
+}
+
+bool PointShadowAtlas::NeedsRender(uint slot, uint64_t version) const {
+	return !slots[slot].rendered || slots[slot].version != version;
+}
+
+void PointShadowAtlas::MarkRendered(uint slot, uint64_t version) {
+	slots[slot].rendered = true;
+	slots[slot].version = version;
+}
+
+void PointShadowAtlas::Invalidate() {
+	for (Slot& s : slots) {
+		s.rendered = false;
+	}
+}
+
+uint PointShadowAtlas::GetActiveSlot(uint lightIndex) const {
+	const auto found = lightSlots.find(lightIndex);
+	if (found == lightSlots.end() || !slots[found->second].active) {
+		return POINT_SHADOW_NO_SLOT;
+	}
+	return found->second;
+}
+
+void PointShadowAtlas::GetFaceOrigin(uint slot, uint face, uint& x, uint& y) const {
+	x = ((slot % slotsX) * 3 + face % 3) * settings.faceSize;
+	y = ((slot / slotsX) * 2 + face / 3) * settings.faceSize;
+}
+
+float PointShadowAtlas::GetTexelScale() const {
+	// tan of half the field of view, 90 degrees plus a texel each side
+	const float tanHalfFov = (float)settings.faceSize / (float)(settings.faceSize - 2);
+	return 2.0f * tanHalfFov / settings.faceSize;
+}
+
+void PointShadowAtlas::BuildFaceMatrices(uint slot, const Vector3& lightPos, float radius,
+	Matrix4 faceViewProj[POINT_SHADOW_FACE_COUNT], GLSL::PointShadow& shadow) const {
+	const float tanHalfFov = (float)settings.faceSize / (float)(settings.faceSize - 2);
+	const float fov = RadiansToDegrees(2.0f * std::atan(tanHalfFov));
+	const Matrix4 proj = Matrix4::Perspective(std::max(radius * 0.05f, 0.1f), radius, 1.0f, fov);
+
+	const float faceScale = (float)settings.faceSize / settings.atlasSize;
+	for (uint face = 0; face < POINT_SHADOW_FACE_COUNT; ++face) {
+		faceViewProj[face] = proj * Matrix4::BuildViewMatrix(lightPos, lightPos + FACE_DIRECTIONS[face], FACE_UPS[face]);
+
+		uint x, y;
+		GetFaceOrigin(slot, face, x, y);
+		// Clip space to the face's rectangle of the atlas, and depth to [0, 1]
+		const Vector3 offset((float)x / settings.atlasSize + faceScale * 0.5f, (float)y / settings.atlasSize + faceScale * 0.5f, 0.5f);
+		const Matrix4 toAtlas = Matrix4::Translation(offset) * Matrix4::Scale(Vector3(faceScale * 0.5f, faceScale * 0.5f, 0.5f));
+		shadow.faceMatrices[face] = toAtlas * faceViewProj[face];
+	}
+	shadow.lightPos = Vector4(lightPos, 1.0f);
+}
+
+float PointShadowAtlas::Importance(const Vector3& lightPos, float radius, float intensity, const Vector3& cameraPos, float tanHalfFov) {
+	const float distance = (lightPos - cameraPos).Length();
+	if (distance <= radius) {
+		return intensity;
+	}
+	// Radius over the half height of the view at the light's distance
+	const float size = std::min(radius / (distance * tanHalfFov), 1.0f);
+	return intensity * size * size;
+}
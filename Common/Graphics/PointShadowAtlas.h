@@ -0,0 +1,124 @@
+#pragma once
+#include "Math/Matrix4.h"
+#include "Math/Vector3.h"
+#include "NCLAliases.h"
+#include "../../Assets/Shaders/Shared/PointShadowDefinitions.h"
+
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace NCL {
+	namespace Rendering {
+		struct PointShadowAtlasSettings {
+			// Texels along each side of the atlas
+			uint atlasSize = 4096;
+			// Texels along each side of one cube face, a slot is its 6 faces in a 3 x 2 block
+			uint faceSize = 256;
+			// At most this many lights are shadowed a frame, fewer if the atlas has fewer slots
+			uint maxShadowedLights = 32;
+			// A light that already has a slot ranks as if it were this much more important, so lights of about the
+			// same importance don't keep swapping in and out
+			float retainBias = 1.2f;
+		};
+
+		struct PointShadowRequest {
+			uint lightIndex;
+			// Anything <= 0 is never shadowed
+			float importance;
+		};
+
+		struct PointShadowAssignment {
+			uint lightIndex;
+			uint slot;
+		};
+
+		/*
+		* Decides which point lights get a cube shadow in the atlas each frame, without touching the GPU.
+		* The most important lights are shadowed. Every slot remembers the light it was last drawn for, and what that
+		* light and its casters looked like (a version the renderer picks), so a light that keeps or gets back its
+		* slot is only redrawn if its version changed. A light that needs a slot takes a free one, or else the one
+		* least recently shadowed.
+		*/
+		class PointShadowAtlas {
+		public:
+			PointShadowAtlas(const PointShadowAtlasSettings& settings = {});
+			~PointShadowAtlas() = default;
+
+			// Shadows the most important requests this frame, giving each a slot. At most one request per light.
+			void Allocate(std::span<const PointShadowRequest> requests);
+
+			// The lights shadowed this frame and their slots, most important first
+			const std::vector<PointShadowAssignment>& GetAssignments() const {
+				return assignments;
+			}
+			// Lights shadowed this frame that weren't last frame, or were in another slot
+			const std::vector<PointShadowAssignment>& GetActivated() const {
+				return activated;
+			}
+			// Lights shadowed last frame that aren't this frame
+			const std::vector<uint>& GetDeactivated() const {
+				return deactivated;
+			}
+
+			// True if slot was never drawn for its light, or was drawn with a different version
+			bool NeedsRender(uint slot, uint64_t version) const;
+			void MarkRendered(uint slot, uint64_t version);
+			// Every slot is redrawn the next time its light is shadowed, e.g. after a static caster moved
+			void Invalidate();
+
+			// The slot lightIndex is shadowed with this frame, POINT_SHADOW_NO_SLOT if it isn't
+			uint GetActiveSlot(uint lightIndex) const;
+
+			uint GetSlotCount() const {
+				return (uint)slots.size();
+			}
+			// Texel position of the corner of a face nearest the atlas origin, as glViewport takes it
+			void GetFaceOrigin(uint slot, uint face, uint& x, uint& y) const;
+
+			const PointShadowAtlasSettings& GetSettings() const {
+				return settings;
+			}
+
+			// Each face's view projection for drawing into it, and shadow with the same mapped to the face's place in
+			// the atlas for sampling, along with lightPos. The faces see a texel past 90 degrees each side, so filtering
+			// stays in the face.
+			void BuildFaceMatrices(uint slot, const Maths::Vector3& lightPos, float radius,
+				Maths::Matrix4 faceViewProj[POINT_SHADOW_FACE_COUNT], GLSL::PointShadow& shadow) const;
+			// World size of a face's texel per unit of distance from the light
+			float GetTexelScale() const;
+
+			// How much a light is worth shadowing: its intensity times the fraction of the screen its sphere covers,
+			// approximately. tanHalfFov is of the camera's vertical field of view.
+			static float Importance(const Maths::Vector3& lightPos, float radius, float intensity,
+				const Maths::Vector3& cameraPos, float tanHalfFov);
+
+		protected:
+			struct Slot {
+				uint light = POINT_SHADOW_NO_SLOT;
+				// The Allocate the light was last shadowed in
+				uint64_t lastUsed = 0;
+				uint64_t version = 0;
+				// Set once drawn, and cleared when the slot changes light or is invalidated
+				bool rendered = false;
+				bool active = false;
+			};
+
+			// A slot for a light that hasn't got one, taking it from the least recently used light if none are free
+			uint FindSlot();
+
+			PointShadowAtlasSettings settings;
+			uint slotsX = 0;
+			std::vector<Slot> slots;
+			// Every light with a slot, shadowed this frame or not
+			std::unordered_map<uint, uint> lightSlots;
+			uint64_t frame = 0;
+
+			std::vector<PointShadowRequest> ranked;
+			std::vector<uint> previousLights;
+			std::vector<PointShadowAssignment> assignments;
+			std::vector<PointShadowAssignment> activated;
+			std::vector<uint> deactivated;
+		};
+	}
+}
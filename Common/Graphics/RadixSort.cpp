@@ -0,0 +1,52 @@
+#include "pch.h"
+#include "RadixSort.h"
+
+#include <array>
+#include <utility>
+
+using namespace NCL;
+using namespace Rendering;
+
+void Rendering::RadixSort(std::vector<uint64_t>& keys, std::vector<uint>& values, std::vector<uint64_t>& keyScratch, std::vector<uint>& valueScratch) {
+	constexpr int DIGIT_BITS = 8;
+	constexpr int DIGIT_COUNT = 64 / DIGIT_BITS;
+	constexpr uint64_t DIGIT_MASK = (1 << DIGIT_BITS) - 1;
+
+	const size_t count = keys.size();
+	if (count < 2) {
+		return;
+	}
+	keyScratch.resize(count);
+	valueScratch.resize(count);
+
+	std::array<std::array<uint, 1 << DIGIT_BITS>, DIGIT_COUNT> histograms{};
+	for (uint64_t key : keys) {
+		for (int digit = 0; digit < DIGIT_COUNT; ++digit) {
+			histograms[digit][(key >> (digit * DIGIT_BITS)) & DIGIT_MASK]++;
+		}
+	}
+
+	for (int digit = 0; digit < DIGIT_COUNT; ++digit) {
+		const int shift = digit * DIGIT_BITS;
+		std::array<uint, 1 << DIGIT_BITS>& histogram = histograms[digit];
+		// Every key has the same value here, so this pass wouldn't move anything
+		if (histogram[(keys[0] >> shift) & DIGIT_MASK] == count) {
+			continue;
+		}
+
+		uint offset = 0;
+		for (uint& bucket : histogram) {
+			const uint bucketCount = bucket;
+			bucket = offset;
+			offset += bucketCount;
+		}
+
+		for (size_t i = 0; i < count; ++i) {
+			const uint destination = histogram[(keys[i] >> shift) & DIGIT_MASK]++;
+			keyScratch[destination] = keys[i];
+			valueScratch[destination] = values[i];
+		}
+		keys.swap(keyScratch);
+		values.swap(valueScratch);
+	}
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include "NCLAliases.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace NCL {
+	namespace Rendering {
+		/*
+		* Stable LSD radix sort of 64 bit keys, carrying a uint value (usually an index) along with each key.
+		* Sorts a byte at a time, with the histograms for every byte gathered in one pass over the keys, and skips
+		* any byte that's the same in every key. Draw sort keys tend to have several of those, e.g. when every
+		* object is in the same pass or uses the same shader.
+		* The scratch vectors are resized to fit and can be reused between calls to avoid reallocating.
+		*/
+		void RadixSort(std::vector<uint64_t>& keys, std::vector<uint>& values, std::vector<uint64_t>& keyScratch, std::vector<uint>& valueScratch);
+	}
+}
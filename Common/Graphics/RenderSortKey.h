@@ -0,0 +1,85 @@
+#pragma once
+#include "NCLAliases.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <unordered_map>
+
+namespace NCL {
+	namespace Rendering {
+		enum class SortBlend : uint {
+			Opaque = 0,
+			// Alpha tested, drawn after opaque so early depth rejects as much of it as possible
+			Masked = 1,
+			// Blended, drawn last and back to front
+			Transparent = 2,
+		};
+
+		/*
+		* 64 bit draw sort key, sorted in ascending order. Draws are grouped by pass, then blending, then by the
+		* state they bind, most expensive to change first, so neighbouring draws share as much state as possible.
+		* Opaque and masked:  | pass 2 | blend 2 | shader 10 | material 16 | mesh 14 | depth 20 |
+		* Transparent:        | pass 2 | blend 2 | inverted depth 20 | shader 10 | material 16 | mesh 14 |
+		* Opaque draws are front to back within each run of the same state, transparent ones back to front with
+		* state only breaking ties. IDs wider than their field wrap, which only makes the sort group less well.
+		*/
+		namespace SortKey {
+			constexpr int PASS_BITS = 2;
+			constexpr int BLEND_BITS = 2;
+			constexpr int SHADER_BITS = 10;
+			constexpr int MATERIAL_BITS = 16;
+			constexpr int MESH_BITS = 14;
+			constexpr int DEPTH_BITS = 20;
+			static_assert(PASS_BITS + BLEND_BITS + SHADER_BITS + MATERIAL_BITS + MESH_BITS + DEPTH_BITS == 64);
+
+			constexpr uint64_t Field(uint64_t value, int bits) {
+				return value & ((uint64_t(1) << bits) - 1);
+			}
+
+			// Positive floats order the same as their bit patterns, so the top bits after the sign are a
+			// logarithmic quantisation of depth that needs no far plane. Takes any distance, e.g. squared.
+			inline uint QuantiseDepth(float depth) {
+				return std::bit_cast<uint>(std::max(depth, 0.0f)) >> (31 - DEPTH_BITS);
+			}
+
+			inline uint64_t Make(uint pass, SortBlend blend, uint shader, uint material, uint mesh, float depth) {
+				const uint64_t state = (Field(shader, SHADER_BITS) << (MATERIAL_BITS + MESH_BITS)) |
+					(Field(material, MATERIAL_BITS) << MESH_BITS) | Field(mesh, MESH_BITS);
+				uint64_t key = (Field(pass, PASS_BITS) << (64 - PASS_BITS)) |
+					(Field((uint)blend, BLEND_BITS) << (64 - PASS_BITS - BLEND_BITS));
+
+				const uint64_t quantisedDepth = QuantiseDepth(depth);
+				if (blend == SortBlend::Transparent) {
+					const uint64_t farFirst = Field(~quantisedDepth, DEPTH_BITS);
+					key |= (farFirst << (SHADER_BITS + MATERIAL_BITS + MESH_BITS)) | state;
+				}
+				else {
+					key |= (state << DEPTH_BITS) | quantisedDepth;
+				}
+				return key;
+			}
+		}
+
+		/*
+		* Hands out small dense IDs for the state objects a sort key refers to (shaders, materials, meshes),
+		* in the order they're first seen. 0 is always null.
+		*/
+		class SortKeyIDs {
+		public:
+			uint Get(const void* object) {
+				if (!object) {
+					return 0;
+				}
+				return ids.try_emplace(object, (uint)ids.size() + 1).first->second;
+			}
+
+			void Clear() {
+				ids.clear();
+			}
+
+		protected:
+			std::unordered_map<const void*, uint> ids;
+		};
+	}
+}
@@ -0,0 +1,132 @@
+#include "pch.h"
+#include "ShadowCascades.h"
+#include "Math/Maths.h"
+#include "Math/Vector4.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace NCL;
+using namespace Maths;
+using namespace Rendering;
+
+ShadowCascades::ShadowCascades(const ShadowCascadeSettings& settings) : settings(settings) {
+}
+
+void ShadowCascades::Invalidate() {
+	for (ShadowCascade& cascade : cascades) {
+		cascade.staticDirty = true;
+	}
+}
+
+void ShadowCascades::Update(const Matrix4& cameraView, float fov, float aspect, float cameraNear, float cameraFar,
+	const Vector3& lightDirection, const Vector3& sceneMin, const Vector3& sceneMax) {
+	Vector3 lightDir = lightDirection.Normalised();
+	if (lightDir != lastLightDirection) {
+		Invalidate();
+		lastLightDirection = lightDir;
+	}
+
+	// The light's view only rotates, each cascade's projection moves it onto the cascade
+	Vector3 up = std::abs(lightDir.y) > 0.99f ? Vector3(0, 0, 1) : Vector3(0, 1, 0);
+	Matrix4 lightView = Matrix4::BuildViewMatrix(Vector3(0, 0, 0), lightDir, up);
+	Vector3 lightRight = Vector3::Cross(lightDir, up).Normalised();
+	Vector3 lightUp = Vector3::Cross(lightRight, lightDir).Normalised();
+
+	// Distance along the light to every corner of the scene, the range every cascade needs to hold all the casters
+	float sceneNear = FLT_MAX;
+	float sceneFar = -FLT_MAX;
+	for (int i = 0; i < 8; ++i) {
+		Vector3 corner((i & 1) ? sceneMax.x : sceneMin.x, (i & 2) ? sceneMax.y : sceneMin.y, (i & 4) ? sceneMax.z : sceneMin.z);
+		float depth = Vector3::Dot(corner, lightDir);
+		sceneNear = std::min(sceneNear, depth);
+		sceneFar = std::max(sceneFar, depth);
+	}
+
+	Matrix4 cameraWorld = cameraView.Inverse();
+	Vector3 cameraPos = cameraWorld.GetPositionVector();
+	Vector4 column = cameraWorld.GetColumn(2);
+	Vector3 cameraForward = -Vector3(column.x, column.y, column.z).Normalised();
+
+	float tanHalfFov = std::tan(DegreesToRadians(fov) * 0.5f);
+	// Squared distance from the axis to a corner of the frustum per unit of depth
+	float cornerSq = tanHalfFov * tanHalfFov * (1.0f + aspect * aspect);
+
+	float shadowFar = std::min(cameraFar, settings.maxDistance);
+	float res = (float)settings.resolution;
+	float splitNear = cameraNear;
+
+	for (uint i = 0; i < SHADOW_CASCADE_COUNT; ++i) {
+		ShadowCascade& cascade = cascades[i];
+
+		float t = (float)(i + 1) / SHADOW_CASCADE_COUNT;
+		float logSplit = cameraNear * std::pow(shadowFar / cameraNear, t);
+		float evenSplit = cameraNear + (shadowFar - cameraNear) * t;
+		float splitFar = settings.splitLambda * logSplit + (1.0f - settings.splitLambda) * evenSplit;
+
+		// The sphere around this slice of the frustum. Its centre is where the near and far corners are the same
+		// distance away, unless that's past the far plane, when the far corners alone set it.
+		float centreDepth = 0.5f * (splitFar + splitNear) * (1.0f + cornerSq);
+		float radius;
+		if (centreDepth >= splitFar) {
+			centreDepth = splitFar;
+			radius = splitFar * std::sqrt(cornerSq);
+		}
+		else {
+			float toFar = splitFar - centreDepth;
+			radius = std::sqrt(toFar * toFar + splitFar * splitFar * cornerSq);
+		}
+		Vector3 centre = cameraPos + cameraForward * centreDepth;
+
+		// Grow the map so the sphere still fits once its centre is snapped up to half a step away
+		float halfExtent = radius / (1.0f - (float)settings.cacheStepTexels / res);
+		float texelSize = 2.0f * halfExtent / res;
+		float cellSize = texelSize * settings.cacheStepTexels;
+
+		int cellX = (int)std::floor(Vector3::Dot(centre, lightRight) / cellSize + 0.5f);
+		int cellY = (int)std::floor(Vector3::Dot(centre, lightUp) / cellSize + 0.5f);
+
+		// Only move the depth range when the scene leaves it or has shrunk well inside it, with some margin so
+		// objects moving around the edge don't keep invalidating the cache
+		bool depthOutside = sceneNear < cascade.depthNear || sceneFar > cascade.depthFar;
+		bool depthLoose = (sceneFar - sceneNear) < 0.5f * (cascade.depthFar - cascade.depthNear);
+		if (depthOutside || depthLoose) {
+			float margin = std::max((sceneFar - sceneNear) * 0.1f, 1.0f);
+			cascade.depthNear = sceneNear - margin;
+			cascade.depthFar = sceneFar + margin;
+			cascade.staticDirty = true;
+		}
+
+		if (cellX != cascade.cellX || cellY != cascade.cellY || texelSize != cascade.texelSize) {
+			cascade.cellX = cellX;
+			cascade.cellY = cellY;
+			cascade.staticDirty = true;
+		}
+
+		float centreX = cellX * cellSize;
+		float centreY = cellY * cellSize;
+
+		cascade.splitNear = splitNear;
+		cascade.splitFar = splitFar;
+		cascade.texelSize = texelSize;
+		cascade.viewMatrix = lightView;
+		// The light looks down -z, so depth along the light is distance in front of it
+		cascade.projMatrix = Matrix4::Orthographic(cascade.depthNear, cascade.depthFar,
+			centreX + halfExtent, centreX - halfExtent, centreY + halfExtent, centreY - halfExtent);
+		cascade.viewProjMatrix = cascade.projMatrix * cascade.viewMatrix;
+
+		splitNear = splitFar;
+	}
+}
+
+void ShadowCascades::FillShadowData(GLSL::ShadowData& data) const {
+	// Clip space to [0, 1] texture and depth space
+	static const Matrix4 bias = Matrix4::Translation(Vector3(0.5f, 0.5f, 0.5f)) * Matrix4::Scale(Vector3(0.5f, 0.5f, 0.5f));
+
+	for (uint i = 0; i < SHADOW_CASCADE_COUNT; ++i) {
+		data.cascadeMatrices[i] = bias * cascades[i].viewProjMatrix;
+		data.cascadeSplits[i] = cascades[i].splitFar;
+		data.cascadeTexelSizes[i] = cascades[i].texelSize;
+	}
+}
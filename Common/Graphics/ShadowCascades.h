@@ -0,0 +1,84 @@
+#pragma once
+#include "Math/Matrix4.h"
+#include "Math/Vector3.h"
+#include "NCLAliases.h"
+#include "../../Assets/Shaders/Shared/ShadowDefinitions.h"
+
+#include <array>
+
+namespace NCL {
+	namespace Rendering {
+		struct ShadowCascadeSettings {
+			// Texels along each side of a cascade's map
+			uint resolution = 2048;
+			// Shadows end this far from the camera, or at its far plane if that's nearer
+			float maxDistance = 1000.0f;
+			// Blend between splitting the distance evenly (0) and logarithmically (1)
+			float splitLambda = 0.8f;
+			// A cascade's map only moves in steps of this many texels, and its static casters are only redrawn when it
+			// does. Costs cacheStepTexels / resolution of the map's width as a guard band.
+			uint cacheStepTexels = 64;
+		};
+
+		struct ShadowCascade {
+			Maths::Matrix4 viewMatrix;
+			Maths::Matrix4 projMatrix;
+			Maths::Matrix4 viewProjMatrix;
+			// View space distances the cascade covers
+			float splitNear = 0.0f;
+			float splitFar = 0.0f;
+			// World size of one texel
+			float texelSize = 0.0f;
+			// Set when the map moved or the light changed since the static casters were last drawn into it
+			bool staticDirty = true;
+
+			// What the static casters were drawn with, the map moves when any of these change
+			int cellX = 0;
+			int cellY = 0;
+			float depthNear = 0.0f;
+			float depthFar = 0.0f;
+		};
+
+		/*
+		* Fits SHADOW_CASCADE_COUNT orthographic shadow maps for a directional light to the camera frustum.
+		* Each cascade covers the bounding sphere of its slice of the frustum, so its size only changes with the
+		* camera's projection and not as it turns. Its centre is snapped to a grid of cacheStepTexels texels in light
+		* space, which stops the edges shimmering as the camera moves, and means the static part of the map stays
+		* valid until the camera has moved far enough to cross a grid line. The depth range covers the whole scene
+		* along the light, so casters outside the camera's view still land in the map, and only grows or moves
+		* when the scene's bounds leave it.
+		*/
+		class ShadowCascades {
+		public:
+			ShadowCascades(const ShadowCascadeSettings& settings = {});
+			~ShadowCascades() = default;
+
+			// cameraView is the camera's view matrix, fov its vertical field of view in degrees. lightDirection is the
+			// way the light travels. sceneMin and sceneMax bound every caster.
+			void Update(const Maths::Matrix4& cameraView, float fov, float aspect, float cameraNear, float cameraFar,
+				const Maths::Vector3& lightDirection, const Maths::Vector3& sceneMin, const Maths::Vector3& sceneMax);
+
+			// Redraw every cascade's static casters on the next frame, e.g. after a static object moved
+			void Invalidate();
+			void MarkStaticDrawn(uint cascade) {
+				cascades[cascade].staticDirty = false;
+			}
+
+			const ShadowCascade& GetCascade(uint cascade) const {
+				return cascades[cascade];
+			}
+
+			const ShadowCascadeSettings& GetSettings() const {
+				return settings;
+			}
+
+			// Fills the cascade matrices, splits and texel sizes of data for the shaders
+			void FillShadowData(GLSL::ShadowData& data) const;
+
+		protected:
+			ShadowCascadeSettings settings;
+			std::array<ShadowCascade, SHADOW_CASCADE_COUNT> cascades;
+			Maths::Vector3 lastLightDirection;
+		};
+	}
+}
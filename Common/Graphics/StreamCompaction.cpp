@@ -0,0 +1,59 @@
+#include "pch.h"
+#include "StreamCompaction.h"
+#include "../../Assets/Shaders/Shared/ScanDefinitions.h"
+
+#include <algorithm>
+
+using namespace NCL;
+using namespace Rendering;
+
+uint Rendering::ExclusiveScanBlocks(std::span<const uint> in, std::span<uint> out, bool predicate) {
+	const size_t count = in.size();
+	if (count == 0) {
+		return 0;
+	}
+	const size_t blocks = (count + SCAN_BLOCK_SIZE - 1) / SCAN_BLOCK_SIZE;
+
+	// scanBlocks.comp
+	std::vector<uint> blockSums(blocks);
+	for (size_t block = 0; block < blocks; ++block) {
+		const size_t end = std::min(count, (block + 1) * SCAN_BLOCK_SIZE);
+		uint sum = 0;
+		for (size_t i = block * SCAN_BLOCK_SIZE; i < end; ++i) {
+			const uint value = predicate ? (in[i] != 0 ? 1 : 0) : in[i];
+			out[i] = sum;
+			sum += value;
+		}
+		blockSums[block] = sum;
+	}
+
+	if (blocks == 1) {
+		return blockSums[0];
+	}
+
+	std::vector<uint> blockOffsets(blocks);
+	const uint total = ExclusiveScanBlocks(blockSums, blockOffsets);
+
+	// scanAddOffsets.comp
+	for (size_t block = 1; block < blocks; ++block) {
+		const size_t end = std::min(count, (block + 1) * SCAN_BLOCK_SIZE);
+		for (size_t i = block * SCAN_BLOCK_SIZE; i < end; ++i) {
+			out[i] += blockOffsets[block];
+		}
+	}
+	return total;
+}
+
+GLSL::DispatchIndirectCommand Rendering::CompactIndices(std::span<const uint> flags, std::vector<uint>& out) {
+	std::vector<uint> offsets(flags.size());
+	const uint kept = ExclusiveScanBlocks(flags, offsets, true);
+
+	// compactScatter.comp
+	out.resize(kept);
+	for (size_t i = 0; i < flags.size(); ++i) {
+		if (flags[i]) {
+			out[offsets[i]] = (uint)i;
+		}
+	}
+	return GLSL::DispatchIndirectCommand{ kept, 1, 1 };
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "NCLAliases.h"
+#include "../../Assets/Shaders/Shared/LightGridDefinitions.h"
+
+#include <span>
+#include <vector>
+
+namespace NCL {
+	namespace Rendering {
+		/*
+		* CPU twins of GpuScan and GpuCompact, used to validate them and to benchmark against.
+		* They work in the same SCAN_BLOCK_SIZE blocks, scanning each block, then the block totals, then adding
+		* the totals back on, so their output can be compared with the GPU's element for element.
+		*/
+
+		// Exclusive prefix sum of in into out, which must be at least as long. Returns the sum of every element.
+		// With predicate set, every non-zero input counts as 1.
+		uint ExclusiveScanBlocks(std::span<const uint> in, std::span<uint> out, bool predicate = false);
+
+		// Writes the index of every non-zero flag to out, in ascending order.
+		// Returns the command that launches one work group per kept index, as GpuCompact does.
+		GLSL::DispatchIndirectCommand CompactIndices(std::span<const uint> flags, std::vector<uint>& out);
+	}
+}
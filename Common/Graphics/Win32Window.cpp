@@ -356,9 +356,13 @@ void	Win32Window::SetWindowPosition(int x, int y) {
 void	Win32Window::ShowConsole(bool state)				{
 	HWND consoleWindow = GetConsoleWindow();
 
-	ShowWindow(consoleWindow, state ? SW_RESTORE : SW_HIDE);
+	::ShowWindow(consoleWindow, state ? SW_RESTORE : SW_HIDE);
 
 	SetActiveWindow(windowHandle);
 }
 
+void	Win32Window::ShowWindow(bool state) {
+	::ShowWindow(windowHandle, state ? SW_SHOW : SW_HIDE);
+}
+
 #endif //_WIN32
\ No newline at end of file
@@ -38,6 +38,7 @@ namespace NCL {
 			void	ShowConsole(bool state)				override;
 			void	SetFullScreen(bool state)			override;
 			void	SetWindowPosition(int x, int y)		override;
+			void	ShowWindow(bool state)				override;
 
 			HWND		GetHandle()			const { return windowHandle; }
 			HINSTANCE	GetInstance()		const { return windowInstance; }
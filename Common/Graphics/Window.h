@@ -60,6 +60,7 @@ namespace NCL {
 		virtual void	SetFullScreen(bool state) {};
 		virtual void	SetConsolePosition(int x, int y) {};
 		virtual void	ShowConsole(bool state) {};
+		virtual void	ShowWindow(bool state) {};
 
 		static const Keyboard*	 GetKeyboard() { return keyboard; }
 		static const Mouse*		 GetMouse() { return mouse; }
@@ -26,6 +26,8 @@ namespace NCL {
 
 			void FromMatrix(const Matrix4& mvp);
 			bool IsInsideFrustum(const Vector3& position, float boundingRadius);
+
+			const std::array<Plane, 6>& GetPlanes() const { return planes; }
 		protected:
 			static constexpr size_t PlaneCount = 6;
 			std::array<Plane, PlaneCount> planes;
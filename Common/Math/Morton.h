@@ -0,0 +1,33 @@
+#pragma once
+#include "Vector3.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace NCL::Maths {
+	// Spreads the low 10 bits of v so there are two zero bits between each one.
+	constexpr uint32_t MortonExpandBits(uint32_t v) {
+		v &= 0x3FF;
+		v = (v | (v << 16)) & 0x030000FF;
+		v = (v | (v << 8)) & 0x0300F00F;
+		v = (v | (v << 4)) & 0x030C30C3;
+		v = (v | (v << 2)) & 0x09249249;
+		return v;
+	}
+
+	// 30 bit Morton code from three 10 bit integer coordinates.
+	constexpr uint32_t MortonEncode(uint32_t x, uint32_t y, uint32_t z) {
+		return (MortonExpandBits(x) << 2) | (MortonExpandBits(y) << 1) | MortonExpandBits(z);
+	}
+
+	// 30 bit Morton code for a point, given the bounds it lies in. Points outside the bounds are clamped.
+	inline uint32_t MortonEncode(const Vector3& point, const Vector3& boundsMin, const Vector3& boundsMax) {
+		const Vector3 size = boundsMax - boundsMin;
+		uint32_t cell[3];
+		for (int i = 0; i < 3; ++i) {
+			const float t = size[i] > 0.0f ? (point[i] - boundsMin[i]) / size[i] : 0.0f;
+			cell[i] = (uint32_t)std::clamp(t * 1024.0f, 0.0f, 1023.0f);
+		}
+		return MortonEncode(cell[0], cell[1], cell[2]);
+	}
+}
@@ -0,0 +1,320 @@
+#pragma once
+#include "Graphics/RadixSort.h"
+#include "Morton.h"
+#include "Vector3.h"
+#include "NCLAliases.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace NCL::Maths {
+	// One node's objects, the same range of each of the tree's arrays
+	template <class T>
+	struct OctreeContents {
+		const T* objects;
+		const float* posX;
+		const float* posY;
+		const float* posZ;
+		const float* halfX;
+		const float* halfY;
+		const float* halfZ;
+		uint count;
+	};
+
+	/*
+	* A linear loose octree. Each object is put in one node straight away, the deepest whose cell is at least twice
+	* its size, in the cell its centre is in, so nothing is split or copied into several nodes. Cells are addressed
+	* by Morton code.
+	* The nodes are built on the first query after an Insert: objects are radix sorted by node, in depth first order,
+	* so every node's objects and its whole subtree are each one contiguous range. Nodes go in one array in the same
+	* order, each with the box around everything in its subtree and the index just past its subtree, and a query is
+	* a walk along that array skipping subtrees that miss. Objects are kept as arrays of each component.
+	* Objects outside the bounds are put in the nearest cell, and still found.
+	*/
+	template <class T>
+	class Octree {
+	public:
+		// Morton codes give each axis 10 bits
+		static constexpr int MAX_DEPTH = 10;
+
+		Octree() = default;
+		Octree(const Vector3& boundsMin, const Vector3& boundsMax, int maxDepth = 8) {
+			Reset(boundsMin, boundsMax, maxDepth);
+		}
+		~Octree() = default;
+
+		// Clears the tree and sets the bounds its cells divide. Cells are cubes, the root as big as the longest side.
+		void Reset(const Vector3& boundsMin, const Vector3& boundsMax, int maxDepth = 8) {
+			Clear();
+			this->boundsMin = boundsMin;
+			const Vector3 size = boundsMax - boundsMin;
+			worldSize = std::max(std::max(size.x, size.y), std::max(size.z, FLT_MIN));
+			this->maxDepth = std::clamp(maxDepth, 0, MAX_DEPTH);
+		}
+
+		void Clear() {
+			keys.clear();
+			objects.clear();
+			posX.clear(); posY.clear(); posZ.clear();
+			halfX.clear(); halfY.clear(); halfZ.clear();
+			nodes.clear();
+			built = true;
+		}
+
+		void Insert(T object, const Vector3& pos, const Vector3& halfSize) {
+			keys.push_back(NodeKey(pos, halfSize));
+			objects.push_back(object);
+			posX.push_back(pos.x); posY.push_back(pos.y); posZ.push_back(pos.z);
+			halfX.push_back(halfSize.x); halfY.push_back(halfSize.y); halfZ.push_back(halfSize.z);
+			built = false;
+		}
+
+		// Calls func(const OctreeContents<T>&) for every node with objects in it
+		template <typename Func>
+		void OperateOnContents(Func&& func) {
+			Build();
+			for (const Node& node : nodes) {
+				if (node.count > 0) {
+					func(Contents(node));
+				}
+			}
+		}
+
+		// Calls func(object) for every object whose box overlaps the box from boxMin to boxMax
+		template <typename Func>
+		void QueryBox(const Vector3& boxMin, const Vector3& boxMax, Func&& func) {
+			Build();
+			auto overlaps = [&](const Vector3& min, const Vector3& max) {
+				return min.x <= boxMax.x && boxMin.x <= max.x && min.y <= boxMax.y && boxMin.y <= max.y &&
+					min.z <= boxMax.z && boxMin.z <= max.z;
+			};
+			Walk(overlaps, func);
+		}
+
+		// Every object whose box the ray passes through. Takes anything with GetPosition and GetDirection.
+		template <class RayType>
+		std::vector<T> BuildRayCollisonList(const RayType& r) {
+			Build();
+			const Vector3 origin = r.GetPosition();
+			const Vector3 direction = r.GetDirection();
+			const Vector3 invDir(
+				direction.x != 0.0f ? 1.0f / direction.x : FLT_MAX,
+				direction.y != 0.0f ? 1.0f / direction.y : FLT_MAX,
+				direction.z != 0.0f ? 1.0f / direction.z : FLT_MAX);
+			auto hits = [&](const Vector3& min, const Vector3& max) {
+				float tMin = 0.0f;
+				float tMax = FLT_MAX;
+				for (int i = 0; i < 3; ++i) {
+					float t0 = (min[i] - origin[i]) * invDir[i];
+					float t1 = (max[i] - origin[i]) * invDir[i];
+					if (t0 > t1) {
+						std::swap(t0, t1);
+					}
+					tMin = std::max(tMin, t0);
+					tMax = std::min(tMax, t1);
+				}
+				return tMin <= tMax;
+			};
+
+			std::vector<T> collisions;
+			Walk(hits, [&](const T& object) {
+				collisions.push_back(object);
+			});
+			return collisions;
+		}
+
+		uint GetObjectCount() const {
+			return (uint)objects.size();
+		}
+		// Up to date as of the last query
+		uint GetNodeCount() const {
+			return (uint)nodes.size();
+		}
+
+	protected:
+		struct Node {
+			// Around every object in the node and below it
+			Vector3 boundsMin;
+			Vector3 boundsMax;
+			uint64_t key;
+			uint first;
+			uint count;
+			uint parent;
+			// The first node after this one's subtree
+			uint skip;
+		};
+
+		// Sorts depth first: the cell's Morton code at full depth above the depth, so a node sorts just before
+		// its first child and after everything under its previous sibling
+		static uint64_t MakeKey(uint32_t code, int depth) {
+			return ((uint64_t)(code << (3 * (MAX_DEPTH - depth))) << 4) | (uint64_t)depth;
+		}
+
+		static int KeyDepth(uint64_t key) {
+			return (int)(key & 0xF);
+		}
+
+		// The key of the node depth levels down from the root that holds node key
+		static uint64_t AncestorKey(uint64_t key, int depth) {
+			const uint32_t code = (uint32_t)(key >> 4) >> (3 * (MAX_DEPTH - depth));
+			return MakeKey(code, depth);
+		}
+
+		uint64_t NodeKey(const Vector3& pos, const Vector3& halfSize) const {
+			// The deepest level whose cells are at least twice the size of the object
+			const float size = 2.0f * std::max(std::max(halfSize.x, halfSize.y), halfSize.z);
+			int depth = maxDepth;
+			if (size * (float)(1 << maxDepth) > worldSize) {
+				depth = size >= worldSize ? 0 : std::min(maxDepth, (int)std::ilogb(worldSize / size));
+			}
+
+			const float cells = (float)(1 << depth);
+			const float scale = cells / worldSize;
+			uint32_t cell[3];
+			for (int i = 0; i < 3; ++i) {
+				cell[i] = (uint32_t)std::clamp((pos[i] - boundsMin[i]) * scale, 0.0f, cells - 1.0f);
+			}
+			return MakeKey(MortonEncode(cell[0], cell[1], cell[2]), depth);
+		}
+
+		OctreeContents<T> Contents(const Node& node) const {
+			return { &objects[node.first], &posX[node.first], &posY[node.first], &posZ[node.first],
+				&halfX[node.first], &halfY[node.first], &halfZ[node.first], node.count };
+		}
+
+		// Calls func(object) for every object whose box passes test, skipping subtrees whose box doesn't
+		template <typename Test, typename Func>
+		void Walk(Test& test, Func&& func) const {
+			uint i = 0;
+			while (i < (uint)nodes.size()) {
+				const Node& node = nodes[i];
+				if (!test(node.boundsMin, node.boundsMax)) {
+					i = node.skip;
+					continue;
+				}
+				for (uint e = node.first; e < node.first + node.count; ++e) {
+					const Vector3 half(halfX[e], halfY[e], halfZ[e]);
+					const Vector3 pos(posX[e], posY[e], posZ[e]);
+					if (test(pos - half, pos + half)) {
+						func(objects[e]);
+					}
+				}
+				++i;
+			}
+		}
+
+		void Build() {
+			if (built) {
+				return;
+			}
+			built = true;
+
+			order.resize(keys.size());
+			for (uint i = 0; i < (uint)order.size(); ++i) {
+				order[i] = i;
+			}
+			Rendering::RadixSort(keys, order, keyScratch, orderScratch);
+			Permute(objects, objectScratch);
+			Permute(posX, floatScratch); Permute(posY, floatScratch); Permute(posZ, floatScratch);
+			Permute(halfX, floatScratch); Permute(halfY, floatScratch); Permute(halfZ, floatScratch);
+
+			nodes.clear();
+			path.clear();
+			path.push_back(AddNode(MakeKey(0, 0), 0, ~0u));
+			for (uint e = 0; e < (uint)keys.size(); ++e) {
+				const uint64_t key = keys[e];
+				const int depth = KeyDepth(key);
+				// Back up to the deepest node on the path that holds this one
+				while (true) {
+					Node& top = nodes[path.back()];
+					const int topDepth = KeyDepth(top.key);
+					if (topDepth <= depth && AncestorKey(key, topDepth) == top.key) {
+						break;
+					}
+					top.skip = (uint)nodes.size();
+					path.pop_back();
+				}
+				for (int d = KeyDepth(nodes[path.back()].key) + 1; d <= depth; ++d) {
+					path.push_back(AddNode(AncestorKey(key, d), e, path.back()));
+				}
+				Node& node = nodes[path.back()];
+				if (node.count == 0) {
+					node.first = e;
+				}
+				++node.count;
+			}
+			for (uint n : path) {
+				nodes[n].skip = (uint)nodes.size();
+			}
+
+			// Children come after their parents, so going backwards every node is finished before its parent
+			for (uint n = (uint)nodes.size(); n-- > 0; ) {
+				Node& node = nodes[n];
+				for (uint e = node.first; e < node.first + node.count; ++e) {
+					node.boundsMin.x = std::min(node.boundsMin.x, posX[e] - halfX[e]);
+					node.boundsMin.y = std::min(node.boundsMin.y, posY[e] - halfY[e]);
+					node.boundsMin.z = std::min(node.boundsMin.z, posZ[e] - halfZ[e]);
+					node.boundsMax.x = std::max(node.boundsMax.x, posX[e] + halfX[e]);
+					node.boundsMax.y = std::max(node.boundsMax.y, posY[e] + halfY[e]);
+					node.boundsMax.z = std::max(node.boundsMax.z, posZ[e] + halfZ[e]);
+				}
+				if (node.parent != ~0u) {
+					Node& parent = nodes[node.parent];
+					parent.boundsMin = Vector3(std::min(parent.boundsMin.x, node.boundsMin.x), std::min(parent.boundsMin.y, node.boundsMin.y),
+						std::min(parent.boundsMin.z, node.boundsMin.z));
+					parent.boundsMax = Vector3(std::max(parent.boundsMax.x, node.boundsMax.x), std::max(parent.boundsMax.y, node.boundsMax.y),
+						std::max(parent.boundsMax.z, node.boundsMax.z));
+				}
+			}
+		}
+
+		uint AddNode(uint64_t key, uint first, uint parent) {
+			Node node;
+			node.boundsMin = Vector3(FLT_MAX, FLT_MAX, FLT_MAX);
+			node.boundsMax = Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+			node.key = key;
+			node.first = first;
+			node.count = 0;
+			node.parent = parent;
+			node.skip = 0;
+			nodes.push_back(node);
+			return (uint)nodes.size() - 1;
+		}
+
+		// Puts values in the sorted order, through scratch so neither has to be reallocated next time
+		template <typename U>
+		void Permute(std::vector<U>& values, std::vector<U>& scratch) {
+			scratch.resize(values.size());
+			for (size_t i = 0; i < order.size(); ++i) {
+				scratch[i] = values[order[i]];
+			}
+			values.swap(scratch);
+		}
+
+		Vector3 boundsMin;
+		float worldSize = 1.0f;
+		int maxDepth = 8;
+
+		std::vector<uint64_t> keys;
+		std::vector<T> objects;
+		std::vector<float> posX;
+		std::vector<float> posY;
+		std::vector<float> posZ;
+		std::vector<float> halfX;
+		std::vector<float> halfY;
+		std::vector<float> halfZ;
+
+		std::vector<Node> nodes;
+		bool built = true;
+
+		std::vector<uint> order;
+		std::vector<uint> path;
+		std::vector<uint64_t> keyScratch;
+		std::vector<uint> orderScratch;
+		std::vector<T> objectScratch;
+		std::vector<float> floatScratch;
+	};
+}
@@ -0,0 +1,35 @@
+#pragma once
+// Compile time SIMD detection. MSVC only defines __AVX2__ when building with /arch:AVX2,
+// which Common and Benchmarks do in Release; Debug builds take the SSE2 path, which is always available on x64.
+#if defined(__AVX2__)
+	#define NCL_SIMD_AVX2 1
+	#define NCL_SIMD_SSE 1
+#elif defined(_M_X64) || defined(__SSE2__)
+	#define NCL_SIMD_AVX2 0
+	#define NCL_SIMD_SSE 1
+#else
+	#define NCL_SIMD_AVX2 0
+	#define NCL_SIMD_SSE 0
+#endif
+
+#if NCL_SIMD_SSE
+#include <immintrin.h>
+#endif
+
+#include <cstddef>
+
+namespace NCL::Maths {
+	// Number of floats processed per SIMD instruction on this build.
+#if NCL_SIMD_AVX2
+	constexpr size_t SIMD_WIDTH = 8;
+#elif NCL_SIMD_SSE
+	constexpr size_t SIMD_WIDTH = 4;
+#else
+	constexpr size_t SIMD_WIDTH = 1;
+#endif
+
+	// Rounds count up so SoA arrays can always be processed in whole SIMD batches.
+	constexpr size_t PadToSIMDWidth(size_t count, size_t width = 8) {
+		return (count + width - 1) / width * width;
+	}
+}
@@ -0,0 +1,95 @@
+#include "pch.h"
+#include "Broadphase.h"
+
+#include <algorithm>
+
+using namespace NCL;
+using namespace Maths;
+using namespace Physics;
+
+Broadphase::Broadphase(float margin, float displacementScale) : tree(margin, displacementScale) {
+}
+
+void Broadphase::Clear() {
+	tree.Clear();
+	pairs.clear();
+	pairKeys.clear();
+	moved.clear();
+	isMoved.clear();
+}
+
+int Broadphase::AddProxy(const AABB& box) {
+	const int proxy = tree.CreateProxy(box);
+	MarkMoved(proxy);
+	return proxy;
+}
+
+void Broadphase::RemoveProxy(int proxy) {
+	tree.DestroyProxy(proxy);
+
+	for (size_t i = 0; i < pairs.size(); ) {
+		if (pairs[i].proxyA == proxy || pairs[i].proxyB == proxy) {
+			pairKeys.erase(PairKey(pairs[i].proxyA, pairs[i].proxyB));
+			pairs[i] = pairs.back();
+			pairs.pop_back();
+		}
+		else {
+			++i;
+		}
+	}
+	if (isMoved[proxy]) {
+		moved.erase(std::find(moved.begin(), moved.end(), proxy));
+		isMoved[proxy] = false;
+	}
+}
+
+void Broadphase::MoveProxy(int proxy, const AABB& box, const Vector3& displacement) {
+	if (tree.MoveProxy(proxy, box, displacement)) {
+		MarkMoved(proxy);
+	}
+}
+
+void Broadphase::MarkMoved(int proxy) {
+	if ((size_t)proxy >= isMoved.size()) {
+		isMoved.resize(proxy + 1);
+	}
+	if (!isMoved[proxy]) {
+		isMoved[proxy] = true;
+		moved.push_back(proxy);
+	}
+}
+
+void Broadphase::UpdatePairs() {
+	// Only a moved proxy's fat box changed, so only its pairs can have come apart
+	for (size_t i = 0; i < pairs.size(); ) {
+		const BroadphasePair pair = pairs[i];
+		if ((isMoved[pair.proxyA] || isMoved[pair.proxyB]) && !tree.GetFatAABB(pair.proxyA).Overlaps(tree.GetFatAABB(pair.proxyB))) {
+			pairKeys.erase(PairKey(pair.proxyA, pair.proxyB));
+			pairs[i] = pairs.back();
+			pairs.pop_back();
+		}
+		else {
+			++i;
+		}
+	}
+
+	for (int proxy : moved) {
+		tree.Query(tree.GetFatAABB(proxy), [&](int other) {
+			// Two moved proxies find each other, the lower id's query adds the pair
+			if (other == proxy || (isMoved[other] && other < proxy)) {
+				return true;
+			}
+			const int a = std::min(proxy, other);
+			const int b = std::max(proxy, other);
+			if (pairKeys.insert(PairKey(a, b)).second) {
+				pairs.push_back({ a, b });
+			}
+			return true;
+		});
+	}
+
+	for (int proxy : moved) {
+		isMoved[proxy] = false;
+	}
+	moved.clear();
+}
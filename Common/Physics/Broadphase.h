@@ -0,0 +1,63 @@
+#pragma once
+#include "DynamicAABBTree.h"
+
+#include <unordered_set>
+#include <vector>
+
+namespace NCL {
+	namespace Physics {
+		struct BroadphasePair {
+			// proxyA < proxyB
+			int proxyA;
+			int proxyB;
+		};
+
+		/*
+		* Keeps the pairs of proxies whose fat boxes overlap, in a DynamicAABBTree, from step to step.
+		* Only proxies that were added or left their fat box since the last UpdatePairs look for new pairs, and pairs
+		* are only dropped once their fat boxes stop overlapping, so still proxies cost next to nothing. Pairs are
+		* kept in one flat array with no duplicates, in the same order for the same sequence of calls.
+		*/
+		class Broadphase {
+		public:
+			Broadphase(float margin = 0.2f, float displacementScale = 4.0f);
+			~Broadphase() = default;
+
+			void Clear();
+
+			int AddProxy(const AABB& box);
+			// Also drops every pair the proxy is in, its id may be given to the next AddProxy
+			void RemoveProxy(int proxy);
+			// displacement is how far the proxy is expected to move by next step, e.g. velocity * dt
+			void MoveProxy(int proxy, const AABB& box, const Maths::Vector3& displacement);
+
+			// Drops pairs that stopped overlapping and finds pairs for every proxy that moved
+			void UpdatePairs();
+
+			const std::vector<BroadphasePair>& GetPairs() const {
+				return pairs;
+			}
+			// Proxies added or reinserted since the last UpdatePairs
+			size_t GetMovedCount() const {
+				return moved.size();
+			}
+			const DynamicAABBTree& GetTree() const {
+				return tree;
+			}
+
+		protected:
+			static uint64_t PairKey(int a, int b) {
+				return ((uint64_t)(uint)a << 32) | (uint)b;
+			}
+
+			void MarkMoved(int proxy);
+
+			DynamicAABBTree tree;
+			std::vector<BroadphasePair> pairs;
+			std::unordered_set<uint64_t> pairKeys;
+			std::vector<int> moved;
+			// Per proxy id, whether it's in moved already
+			std::vector<bool> isMoved;
+		};
+	}
+}
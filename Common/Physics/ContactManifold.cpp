@@ -0,0 +1,118 @@
+#include "pch.h"
+#include "ContactManifold.h"
+
+#include <algorithm>
+
+using namespace NCL;
+using namespace Maths;
+using namespace Physics;
+
+void ContactManifold::Refresh(const Vector3& posA, const Quaternion& rotA, const Vector3& posB, const Quaternion& rotB) {
+	const float breakingSquared = BREAKING_DISTANCE * BREAKING_DISTANCE;
+	for (int i = 0; i < pointCount; ) {
+		ManifoldPoint& point = points[i];
+		point.relativeA = rotA * point.anchorA;
+		point.relativeB = rotB * point.anchorB;
+		const Vector3 apart = (posA + point.relativeA) - (posB + point.relativeB);
+		point.penetration = Vector3::Dot(apart, normal);
+
+		const Vector3 sideways = apart - normal * point.penetration;
+		if (point.penetration < -BREAKING_DISTANCE || sideways.LengthSquared() > breakingSquared) {
+			points[i] = points[--pointCount];
+		}
+		else {
+			++i;
+		}
+	}
+}
+
+void ContactManifold::AddPoint(const Vector3& relativeA, const Vector3& relativeB, const Vector3& contactNormal,
+	float penetration, const Quaternion& rotA, const Quaternion& rotB) {
+	// Points found along a different normal belong to a different face
+	if (pointCount > 0 && Vector3::Dot(normal, contactNormal) < 0.95f) {
+		pointCount = 0;
+	}
+	normal = contactNormal;
+
+	ManifoldPoint point;
+	point.anchorA = rotA.Conjugate() * relativeA;
+	point.anchorB = rotB.Conjugate() * relativeB;
+	point.relativeA = relativeA;
+	point.relativeB = relativeB;
+	point.penetration = penetration;
+	point.normalImpulse = 0.0f;
+	point.tangentImpulse[0] = 0.0f;
+	point.tangentImpulse[1] = 0.0f;
+
+	int index = -1;
+	float closest = BREAKING_DISTANCE * BREAKING_DISTANCE;
+	for (int i = 0; i < pointCount; ++i) {
+		const float distance = (points[i].anchorA - point.anchorA).LengthSquared();
+		if (distance < closest) {
+			closest = distance;
+			index = i;
+		}
+	}
+	if (index >= 0) {
+		point.normalImpulse = points[index].normalImpulse;
+		point.tangentImpulse[0] = points[index].tangentImpulse[0];
+		point.tangentImpulse[1] = points[index].tangentImpulse[1];
+	}
+	else if (pointCount < MAX_POINTS) {
+		index = pointCount++;
+	}
+	else {
+		index = ReplacementIndex(point.anchorA, penetration);
+	}
+	points[index] = point;
+}
+
+int ContactManifold::ReplacementIndex(const Vector3& anchorA, float penetration) const {
+	int deepest = -1;
+	float maxPenetration = penetration;
+	for (int i = 0; i < MAX_POINTS; ++i) {
+		if (points[i].penetration > maxPenetration) {
+			maxPenetration = points[i].penetration;
+			deepest = i;
+		}
+	}
+
+	int best = 0;
+	float bestArea = -1.0f;
+	for (int i = 0; i < MAX_POINTS; ++i) {
+		if (i == deepest) {
+			continue;
+		}
+		Vector3 quad[MAX_POINTS];
+		for (int j = 0; j < MAX_POINTS; ++j) {
+			quad[j] = j == i ? anchorA : points[j].anchorA;
+		}
+		// The largest of the three ways of pairing the points into diagonals
+		const float area = std::max({
+			Vector3::Cross(quad[0] - quad[1], quad[2] - quad[3]).LengthSquared(),
+			Vector3::Cross(quad[0] - quad[2], quad[1] - quad[3]).LengthSquared(),
+			Vector3::Cross(quad[0] - quad[3], quad[1] - quad[2]).LengthSquared() });
+		if (area > bestArea) {
+			bestArea = area;
+			best = i;
+		}
+	}
+	return best;
+}
+
+ContactManifold& ContactCache::Find(uint64_t key, uint step) {
+	ContactManifold& manifold = manifolds[key];
+	manifold.lastStep = step;
+	return manifold;
+}
+
+void ContactCache::RemoveStale(uint step) {
+	for (auto i = manifolds.begin(); i != manifolds.end(); ) {
+		if (i->second.lastStep != step) {
+			i = manifolds.erase(i);
+		}
+		else {
+			++i;
+		}
+	}
+}
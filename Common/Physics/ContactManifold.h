@@ -0,0 +1,82 @@
+#pragma once
+#include "Math/Quaternion.h"
+#include "Math/Vector3.h"
+#include "NCLAliases.h"
+
+#include <cstdint>
+#include <unordered_map>
+
+namespace NCL {
+	namespace Physics {
+		struct ManifoldPoint {
+			// Where the point is on each body, in the body's own space, so it can be followed as they move
+			Maths::Vector3 anchorA;
+			Maths::Vector3 anchorB;
+			// From each body's centre to the point, in world space, as of the last Refresh
+			Maths::Vector3 relativeA;
+			Maths::Vector3 relativeB;
+			float penetration;
+
+			// Summed over the steps the point has lasted, to start the solver from
+			float normalImpulse;
+			float tangentImpulse[2];
+		};
+
+		/*
+		* Up to four contact points between a pair of bodies, kept from step to step. Narrowphase tests find one
+		* point at a time, so a box resting on another builds up its corners over a few steps, and the impulses
+		* solved at each point are kept to warm start the next step's solve.
+		* Points are dropped once the bodies have moved them apart or slid them sideways by BREAKING_DISTANCE.
+		*/
+		struct ContactManifold {
+			static constexpr int MAX_POINTS = 4;
+			static constexpr float BREAKING_DISTANCE = 0.05f;
+
+			// From A to B
+			Maths::Vector3 normal;
+			ManifoldPoint points[MAX_POINTS];
+			int pointCount = 0;
+			// The step that last found the bodies touching
+			uint lastStep = 0;
+
+			// Moves every point along with the bodies, dropping the ones that have come apart
+			void Refresh(const Maths::Vector3& posA, const Maths::Quaternion& rotA, const Maths::Vector3& posB, const Maths::Quaternion& rotB);
+
+			// Adds a point given relative to each body's centre in world space, as CollisionDetection gives them.
+			// A point close to one already held replaces it and keeps its impulses.
+			void AddPoint(const Maths::Vector3& relativeA, const Maths::Vector3& relativeB, const Maths::Vector3& contactNormal,
+				float penetration, const Maths::Quaternion& rotA, const Maths::Quaternion& rotB);
+
+		protected:
+			// Which point a new one replaces when there are already four: never the deepest, and whichever
+			// leaves the four spread over the largest area
+			int ReplacementIndex(const Maths::Vector3& anchorA, float penetration) const;
+		};
+
+		// The manifold for every touching pair of bodies, by the pair's ids
+		class ContactCache {
+		public:
+			static uint64_t PairKey(uint idA, uint idB) {
+				return ((uint64_t)idA << 32) | idB;
+			}
+
+			void Clear() {
+				manifolds.clear();
+			}
+
+			// The pair's manifold, a new empty one if they weren't touching last step. Stays valid until
+			// RemoveStale drops it.
+			ContactManifold& Find(uint64_t key, uint step);
+
+			// Drops every manifold not found this step
+			void RemoveStale(uint step);
+
+			size_t GetManifoldCount() const {
+				return manifolds.size();
+			}
+
+		protected:
+			std::unordered_map<uint64_t, ContactManifold> manifolds;
+		};
+	}
+}
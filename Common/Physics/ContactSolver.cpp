@@ -0,0 +1,138 @@
+#include "pch.h"
+#include "ContactSolver.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace NCL;
+using namespace Maths;
+using namespace Physics;
+
+namespace {
+	// Two tangents at right angles to the normal and each other, the same for the same normal every step
+	void TangentBasis(const Vector3& normal, Vector3& t0, Vector3& t1) {
+		if (std::abs(normal.x) >= 0.57735f) {
+			t0 = Vector3(normal.y, -normal.x, 0.0f).Normalised();
+		}
+		else {
+			t0 = Vector3(0.0f, normal.z, -normal.y).Normalised();
+		}
+		t1 = Vector3::Cross(normal, t0);
+	}
+}
+
+void ContactSolver::AddManifold(ContactManifold& manifold, uint bodyA, uint bodyB, float friction, float restitution) {
+	for (int i = 0; i < manifold.pointCount; ++i) {
+		ManifoldPoint& point = manifold.points[i];
+		Contact contact;
+		contact.point = &point;
+		contact.bodyA = bodyA;
+		contact.bodyB = bodyB;
+		contact.normal = manifold.normal;
+		TangentBasis(manifold.normal, contact.tangents[0], contact.tangents[1]);
+		contact.relativeA = point.relativeA;
+		contact.relativeB = point.relativeB;
+		contact.penetration = point.penetration;
+		contact.friction = friction;
+		contact.restitution = restitution;
+		if (settings.warmStart) {
+			contact.normalImpulse = point.normalImpulse;
+			contact.tangentImpulse[0] = point.tangentImpulse[0];
+			contact.tangentImpulse[1] = point.tangentImpulse[1];
+		}
+		else {
+			contact.normalImpulse = 0.0f;
+			contact.tangentImpulse[0] = 0.0f;
+			contact.tangentImpulse[1] = 0.0f;
+		}
+		contacts.push_back(contact);
+	}
+}
+
+float ContactSolver::EffectiveMass(const SolverBody& a, const SolverBody& b, const Vector3& relativeA,
+	const Vector3& relativeB, const Vector3& direction) {
+	const Vector3 angularA = Vector3::Cross(a.inverseInertia * Vector3::Cross(relativeA, direction), relativeA);
+	const Vector3 angularB = Vector3::Cross(b.inverseInertia * Vector3::Cross(relativeB, direction), relativeB);
+	const float inverse = a.inverseMass + b.inverseMass + Vector3::Dot(angularA + angularB, direction);
+	return inverse > 0.0f ? 1.0f / inverse : 0.0f;
+}
+
+Vector3 ContactSolver::RelativeVelocity(const SolverBody& a, const SolverBody& b, const Contact& contact) {
+	return (b.linearVelocity + Vector3::Cross(b.angularVelocity, contact.relativeB))
+		- (a.linearVelocity + Vector3::Cross(a.angularVelocity, contact.relativeA));
+}
+
+void ContactSolver::ApplyImpulse(SolverBody& a, SolverBody& b, const Contact& contact, const Vector3& impulse) {
+	// Bodies that can't move may be shared with contacts being solved elsewhere, so are never written
+	if (a.inverseMass > 0.0f) {
+		a.linearVelocity -= impulse * a.inverseMass;
+		a.angularVelocity -= a.inverseInertia * Vector3::Cross(contact.relativeA, impulse);
+	}
+	if (b.inverseMass > 0.0f) {
+		b.linearVelocity += impulse * b.inverseMass;
+		b.angularVelocity += b.inverseInertia * Vector3::Cross(contact.relativeB, impulse);
+	}
+}
+
+void ContactSolver::Prepare(std::vector<SolverBody>& bodies, uint first, uint last, float dt) {
+	const float biasFactor = dt > 0.0f ? settings.baumgarte / dt : 0.0f;
+	for (uint i = first; i < last; ++i) {
+		Contact& contact = contacts[i];
+		const SolverBody& a = bodies[contact.bodyA];
+		const SolverBody& b = bodies[contact.bodyB];
+
+		contact.normalMass = EffectiveMass(a, b, contact.relativeA, contact.relativeB, contact.normal);
+		contact.tangentMass[0] = EffectiveMass(a, b, contact.relativeA, contact.relativeB, contact.tangents[0]);
+		contact.tangentMass[1] = EffectiveMass(a, b, contact.relativeA, contact.relativeB, contact.tangents[1]);
+
+		contact.velocityBias = biasFactor * std::max(contact.penetration - settings.slop, 0.0f);
+		const float closing = Vector3::Dot(RelativeVelocity(a, b, contact), contact.normal);
+		if (closing < -settings.restitutionThreshold) {
+			contact.velocityBias = std::max(contact.velocityBias, -contact.restitution * closing);
+		}
+	}
+}
+
+void ContactSolver::WarmStart(std::vector<SolverBody>& bodies, uint first, uint last) {
+	if (!settings.warmStart) {
+		return;
+	}
+	for (uint i = first; i < last; ++i) {
+		const Contact& contact = contacts[i];
+		const Vector3 impulse = contact.normal * contact.normalImpulse
+			+ contact.tangents[0] * contact.tangentImpulse[0]
+			+ contact.tangents[1] * contact.tangentImpulse[1];
+		ApplyImpulse(bodies[contact.bodyA], bodies[contact.bodyB], contact, impulse);
+	}
+}
+
+void ContactSolver::Solve(std::vector<SolverBody>& bodies, uint first, uint last) {
+	for (uint i = first; i < last; ++i) {
+		Contact& contact = contacts[i];
+		SolverBody& a = bodies[contact.bodyA];
+		SolverBody& b = bodies[contact.bodyB];
+
+		// Friction can only push back as hard as the contact is being pressed together
+		const float maxFriction = contact.friction * contact.normalImpulse;
+		for (int t = 0; t < 2; ++t) {
+			const float speed = Vector3::Dot(RelativeVelocity(a, b, contact), contact.tangents[t]);
+			const float previous = contact.tangentImpulse[t];
+			contact.tangentImpulse[t] = std::clamp(previous - speed * contact.tangentMass[t], -maxFriction, maxFriction);
+			ApplyImpulse(a, b, contact, contact.tangents[t] * (contact.tangentImpulse[t] - previous));
+		}
+
+		const float speed = Vector3::Dot(RelativeVelocity(a, b, contact), contact.normal);
+		const float previous = contact.normalImpulse;
+		contact.normalImpulse = std::max(previous + (contact.velocityBias - speed) * contact.normalMass, 0.0f);
+		ApplyImpulse(a, b, contact, contact.normal * (contact.normalImpulse - previous));
+	}
+}
+
+void ContactSolver::StoreImpulses(uint first, uint last) {
+	for (uint i = first; i < last; ++i) {
+		const Contact& contact = contacts[i];
+		contact.point->normalImpulse = contact.normalImpulse;
+		contact.point->tangentImpulse[0] = contact.tangentImpulse[0];
+		contact.point->tangentImpulse[1] = contact.tangentImpulse[1];
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include "ContactManifold.h"
+#include "Math/Matrix3.h"
+
+#include <vector>
+
+namespace NCL {
+	namespace Physics {
+		// The parts of a body the solver reads and writes, copied out before solving and back after
+		struct SolverBody {
+			Maths::Vector3 linearVelocity;
+			Maths::Vector3 angularVelocity;
+			// In world space, zero for bodies that can't be spun by contacts
+			Maths::Matrix3 inverseInertia;
+			float inverseMass;
+		};
+
+		/*
+		* Sequential impulse solver over the points of ContactManifolds, with friction and restitution. Impulses
+		* accumulated at each point are clamped as a whole rather than per iteration, and are stored back into the
+		* manifold so the next step can start from them (warm starting): a resting stack then only has to correct
+		* what changed since last step, rather than build its support up again from nothing every step.
+		* Contacts are solved in the order they were added. Each call after Prepare takes a range of them, so ranges
+		* that share no movable bodies, such as separate islands, can be solved at the same time.
+		*/
+		class ContactSolver {
+		public:
+			struct Settings {
+				// How much of the penetration past slop is pushed out per second, as a fraction of 1/dt
+				float baumgarte = 0.2f;
+				float slop = 0.01f;
+				// Bodies closing slower than this don't bounce, so resting contacts don't jitter
+				float restitutionThreshold = 1.0f;
+				bool warmStart = true;
+			};
+
+			ContactSolver() = default;
+			~ContactSolver() = default;
+
+			void SetSettings(const Settings& s) {
+				settings = s;
+			}
+			const Settings& GetSettings() const {
+				return settings;
+			}
+
+			// Bodies are indices into the array given to Prepare and Solve. The manifold has to outlive StoreImpulses.
+			void AddManifold(ContactManifold& manifold, uint bodyA, uint bodyB, float friction, float restitution);
+			void Clear() {
+				contacts.clear();
+			}
+			uint GetContactCount() const {
+				return (uint)contacts.size();
+			}
+
+			// Works out each contact's effective masses and target speeds from the bodies as they are now
+			void Prepare(std::vector<SolverBody>& bodies, uint first, uint last, float dt);
+			// Applies the impulses carried over from last step
+			void WarmStart(std::vector<SolverBody>& bodies, uint first, uint last);
+			// One pass over every contact, friction first then the normal impulse
+			void Solve(std::vector<SolverBody>& bodies, uint first, uint last);
+			// Copies the accumulated impulses back into the manifolds
+			void StoreImpulses(uint first, uint last);
+
+		protected:
+			struct Contact {
+				ManifoldPoint* point;
+				uint bodyA;
+				uint bodyB;
+				Maths::Vector3 normal;
+				Maths::Vector3 tangents[2];
+				Maths::Vector3 relativeA;
+				Maths::Vector3 relativeB;
+				float penetration;
+				float friction;
+				float restitution;
+
+				float normalMass;
+				float tangentMass[2];
+				float velocityBias;
+				float normalImpulse;
+				float tangentImpulse[2];
+			};
+
+			static float EffectiveMass(const SolverBody& a, const SolverBody& b, const Maths::Vector3& relativeA,
+				const Maths::Vector3& relativeB, const Maths::Vector3& direction);
+			static void ApplyImpulse(SolverBody& a, SolverBody& b, const Contact& contact, const Maths::Vector3& impulse);
+			static Maths::Vector3 RelativeVelocity(const SolverBody& a, const SolverBody& b, const Contact& contact);
+
+			Settings settings;
+			std::vector<Contact> contacts;
+		};
+	}
+}
@@ -0,0 +1,253 @@
+#include "pch.h"
+#include "DynamicAABBTree.h"
+
+using namespace NCL;
+using namespace Maths;
+using namespace Physics;
+
+DynamicAABBTree::DynamicAABBTree(float margin, float displacementScale) : margin(margin), displacementScale(displacementScale) {
+}
+
+void DynamicAABBTree::Clear() {
+	nodes.clear();
+	freeList = NULL_NODE;
+	root = NULL_NODE;
+	proxyCount = 0;
+}
+
+int DynamicAABBTree::AllocateNode() {
+	if (freeList == NULL_NODE) {
+		nodes.emplace_back();
+		nodes.back().height = 0;
+		return (int)nodes.size() - 1;
+	}
+	const int node = freeList;
+	freeList = nodes[node].parent;
+	nodes[node] = Node();
+	nodes[node].height = 0;
+	return node;
+}
+
+void DynamicAABBTree::FreeNode(int node) {
+	nodes[node].parent = freeList;
+	nodes[node].height = -1;
+	freeList = node;
+}
+
+int DynamicAABBTree::CreateProxy(const AABB& box) {
+	const int proxy = AllocateNode();
+	const Vector3 grow(margin, margin, margin);
+	nodes[proxy].box = { box.min - grow, box.max + grow };
+	InsertLeaf(proxy);
+	++proxyCount;
+	return proxy;
+}
+
+void DynamicAABBTree::DestroyProxy(int proxy) {
+	RemoveLeaf(proxy);
+	FreeNode(proxy);
+	--proxyCount;
+}
+
+bool DynamicAABBTree::MoveProxy(int proxy, const AABB& box, const Vector3& displacement) {
+	const Vector3 grow(margin, margin, margin);
+	AABB fat = { box.min - grow, box.max + grow };
+	// Stretch it the way the proxy is going, so a steadily moving proxy isn't reinserted every step
+	const Vector3 stretch = displacement * displacementScale;
+	for (int i = 0; i < 3; ++i) {
+		(stretch[i] < 0.0f ? fat.min[i] : fat.max[i]) += stretch[i];
+	}
+
+	const AABB& current = nodes[proxy].box;
+	if (current.Contains(box)) {
+		// Still inside, unless the fat box has grown far bigger than it needs to be, e.g. after a fast move
+		// that's since stopped
+		const Vector3 huge(4.0f * margin, 4.0f * margin, 4.0f * margin);
+		const AABB hugeBox = { fat.min - huge, fat.max + huge };
+		if (hugeBox.Contains(current)) {
+			return false;
+		}
+	}
+
+	RemoveLeaf(proxy);
+	nodes[proxy].box = fat;
+	InsertLeaf(proxy);
+	return true;
+}
+
+void DynamicAABBTree::InsertLeaf(int leaf) {
+	if (root == NULL_NODE) {
+		root = leaf;
+		nodes[root].parent = NULL_NODE;
+		return;
+	}
+
+	// Walk down to the sibling that grows the tree's surface area least, the leaf's own cost plus what every
+	// ancestor grows by
+	const AABB leafBox = nodes[leaf].box;
+	int index = root;
+	while (!nodes[index].IsLeaf()) {
+		const Node& node = nodes[index];
+		const float area = node.box.SurfaceArea();
+		const float combinedArea = AABB::Union(node.box, leafBox).SurfaceArea();
+
+		// Making the leaf and this node siblings under a new parent here
+		const float cost = 2.0f * combinedArea;
+		// What every descendant's choice also pays for this node growing
+		const float inheritanceCost = 2.0f * (combinedArea - area);
+
+		auto descendCost = [&](int child) {
+			const AABB combined = AABB::Union(leafBox, nodes[child].box);
+			if (nodes[child].IsLeaf()) {
+				return combined.SurfaceArea() + inheritanceCost;
+			}
+			return combined.SurfaceArea() - nodes[child].box.SurfaceArea() + inheritanceCost;
+		};
+		const float cost1 = descendCost(node.child1);
+		const float cost2 = descendCost(node.child2);
+
+		if (cost < cost1 && cost < cost2) {
+			break;
+		}
+		index = cost1 < cost2 ? node.child1 : node.child2;
+	}
+
+	const int sibling = index;
+	const int oldParent = nodes[sibling].parent;
+	const int newParent = AllocateNode();
+	nodes[newParent].parent = oldParent;
+	nodes[newParent].box = AABB::Union(leafBox, nodes[sibling].box);
+	nodes[newParent].height = nodes[sibling].height + 1;
+	nodes[newParent].child1 = sibling;
+	nodes[newParent].child2 = leaf;
+	nodes[sibling].parent = newParent;
+	nodes[leaf].parent = newParent;
+
+	if (oldParent != NULL_NODE) {
+		(nodes[oldParent].child1 == sibling ? nodes[oldParent].child1 : nodes[oldParent].child2) = newParent;
+	}
+	else {
+		root = newParent;
+	}
+
+	FixUpwards(nodes[leaf].parent);
+}
+
+void DynamicAABBTree::RemoveLeaf(int leaf) {
+	if (leaf == root) {
+		root = NULL_NODE;
+		return;
+	}
+
+	// The leaf's parent goes too, its sibling takes the parent's place
+	const int parent = nodes[leaf].parent;
+	const int grandParent = nodes[parent].parent;
+	const int sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+	if (grandParent != NULL_NODE) {
+		(nodes[grandParent].child1 == parent ? nodes[grandParent].child1 : nodes[grandParent].child2) = sibling;
+		nodes[sibling].parent = grandParent;
+		FreeNode(parent);
+		FixUpwards(grandParent);
+	}
+	else {
+		root = sibling;
+		nodes[sibling].parent = NULL_NODE;
+		FreeNode(parent);
+	}
+	nodes[leaf].parent = NULL_NODE;
+}
+
+void DynamicAABBTree::FixUpwards(int index) {
+	while (index != NULL_NODE) {
+		index = Balance(index);
+
+		Node& node = nodes[index];
+		node.height = 1 + std::max(nodes[node.child1].height, nodes[node.child2].height);
+		node.box = AABB::Union(nodes[node.child1].box, nodes[node.child2].box);
+
+		index = node.parent;
+	}
+}
+
+int DynamicAABBTree::Balance(int a) {
+	if (nodes[a].IsLeaf() || nodes[a].height < 2) {
+		return a;
+	}
+
+	const int b = nodes[a].child1;
+	const int c = nodes[a].child2;
+	const int balance = nodes[c].height - nodes[b].height;
+	if (balance >= -1 && balance <= 1) {
+		return a;
+	}
+
+	// The taller child, up, takes a's place. a keeps the shorter child plus up's shorter child, up keeps a and its
+	// taller child.
+	const int up = balance > 1 ? c : b;
+	const int stay = balance > 1 ? b : c;
+	const int f = nodes[up].child1;
+	const int g = nodes[up].child2;
+
+	nodes[up].child1 = a;
+	nodes[up].parent = nodes[a].parent;
+	nodes[a].parent = up;
+
+	if (nodes[up].parent != NULL_NODE) {
+		Node& upParent = nodes[nodes[up].parent];
+		(upParent.child1 == a ? upParent.child1 : upParent.child2) = up;
+	}
+	else {
+		root = up;
+	}
+
+	const bool fTaller = nodes[f].height > nodes[g].height;
+	const int keep = fTaller ? f : g;
+	const int give = fTaller ? g : f;
+
+	nodes[up].child2 = keep;
+	nodes[a].child1 = stay;
+	nodes[a].child2 = give;
+	nodes[give].parent = a;
+
+	nodes[a].box = AABB::Union(nodes[stay].box, nodes[give].box);
+	nodes[a].height = 1 + std::max(nodes[stay].height, nodes[give].height);
+	nodes[up].box = AABB::Union(nodes[a].box, nodes[keep].box);
+	nodes[up].height = 1 + std::max(nodes[a].height, nodes[keep].height);
+	return up;
+}
+
+bool DynamicAABBTree::Validate() const {
+	if (root != NULL_NODE && nodes[root].parent != NULL_NODE) {
+		return false;
+	}
+	uint freeCount = 0;
+	for (int node = freeList; node != NULL_NODE; node = nodes[node].parent) {
+		++freeCount;
+	}
+	// Every used node is either a leaf or one of the proxyCount - 1 internal nodes
+	const uint usedCount = proxyCount == 0 ? 0 : 2 * proxyCount - 1;
+	if (freeCount + usedCount != nodes.size()) {
+		return false;
+	}
+	return root == NULL_NODE || ValidateNode(root);
+}
+
+bool DynamicAABBTree::ValidateNode(int index) const {
+	const Node& node = nodes[index];
+	if (node.IsLeaf()) {
+		return node.height == 0 && node.child2 == NULL_NODE;
+	}
+	const Node& child1 = nodes[node.child1];
+	const Node& child2 = nodes[node.child2];
+	if (child1.parent != index || child2.parent != index) {
+		return false;
+	}
+	if (node.height != 1 + std::max(child1.height, child2.height)) {
+		return false;
+	}
+	if (!node.box.Contains(child1.box) || !node.box.Contains(child2.box)) {
+		return false;
+	}
+	return ValidateNode(node.child1) && ValidateNode(node.child2);
+}
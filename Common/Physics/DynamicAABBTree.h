@@ -0,0 +1,191 @@
+#pragma once
+#include "Math/Vector3.h"
+#include "NCLAliases.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+
+namespace NCL {
+	namespace Physics {
+		struct AABB {
+			Maths::Vector3 min;
+			Maths::Vector3 max;
+
+			bool Contains(const AABB& other) const {
+				return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z &&
+					other.max.x <= max.x && other.max.y <= max.y && other.max.z <= max.z;
+			}
+
+			bool Overlaps(const AABB& other) const {
+				return min.x <= other.max.x && other.min.x <= max.x &&
+					min.y <= other.max.y && other.min.y <= max.y &&
+					min.z <= other.max.z && other.min.z <= max.z;
+			}
+
+			float SurfaceArea() const {
+				const Maths::Vector3 size = max - min;
+				return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+			}
+
+			static AABB Union(const AABB& a, const AABB& b) {
+				return {
+					Maths::Vector3(std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z)),
+					Maths::Vector3(std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z))
+				};
+			}
+		};
+
+		/*
+		* A bounding volume hierarchy over boxes that can be added, moved and removed one at a time, so nothing is
+		* rebuilt when a few of them move.
+		* Every leaf (proxy) holds a fat box: the box it was given grown by a margin, and further along its last
+		* displacement. Moving a proxy only touches the tree when its box leaves the fat one, then the leaf is taken
+		* out and put back where it adds the least surface area, with AVL style rotations keeping the tree balanced.
+		* Nodes live in one pool and are found by index, a proxy's id is the index of its leaf.
+		*/
+		class DynamicAABBTree {
+		public:
+			static constexpr int NULL_NODE = -1;
+
+			// margin is how far each fat box reaches past its proxy's box, displacementScale how far it's stretched
+			// along the displacement given to MoveProxy
+			DynamicAABBTree(float margin = 0.2f, float displacementScale = 4.0f);
+			~DynamicAABBTree() = default;
+
+			void Clear();
+
+			int CreateProxy(const AABB& box);
+			void DestroyProxy(int proxy);
+			// Returns true if the proxy left its fat box and was reinserted
+			bool MoveProxy(int proxy, const AABB& box, const Maths::Vector3& displacement);
+
+			const AABB& GetFatAABB(int proxy) const {
+				return nodes[proxy].box;
+			}
+
+			// Calls func(proxy) for every proxy whose fat box overlaps box. func returns false to stop early.
+			template <typename Func>
+			void Query(const AABB& box, Func&& func) const;
+
+			// Calls func(proxy) for every proxy whose fat box the ray enters before maxDistance.
+			// direction needn't be normalised, distances are in multiples of it.
+			template <typename Func>
+			void RayCast(const Maths::Vector3& origin, const Maths::Vector3& direction, float maxDistance, Func&& func) const;
+
+			// 0 for a tree of one leaf
+			int GetHeight() const {
+				return root == NULL_NODE ? 0 : nodes[root].height;
+			}
+			uint GetProxyCount() const {
+				return proxyCount;
+			}
+			// Checks parent links, heights and that every node's box holds its children's. For tests.
+			bool Validate() const;
+
+		protected:
+			struct Node {
+				AABB box;
+				// The free list's next node for free nodes
+				int parent = NULL_NODE;
+				int child1 = NULL_NODE;
+				int child2 = NULL_NODE;
+				// Leaves are 0, free nodes -1
+				int height = -1;
+
+				bool IsLeaf() const {
+					return child1 == NULL_NODE;
+				}
+			};
+
+			int AllocateNode();
+			void FreeNode(int node);
+
+			void InsertLeaf(int leaf);
+			void RemoveLeaf(int leaf);
+			// Rotates the taller grandchild of an unbalanced node up, returning the node now in its place
+			int Balance(int node);
+			void FixUpwards(int node);
+
+			bool ValidateNode(int node) const;
+
+			std::vector<Node> nodes;
+			// Free nodes, linked through parent
+			int freeList = NULL_NODE;
+			int root = NULL_NODE;
+			uint proxyCount = 0;
+
+			float margin;
+			float displacementScale;
+		};
+
+		template <typename Func>
+		void DynamicAABBTree::Query(const AABB& box, Func&& func) const {
+			if (root == NULL_NODE) {
+				return;
+			}
+			int stack[128];
+			int stackSize = 0;
+			stack[stackSize++] = root;
+			while (stackSize > 0) {
+				const Node& node = nodes[stack[--stackSize]];
+				if (!node.box.Overlaps(box)) {
+					continue;
+				}
+				if (node.IsLeaf()) {
+					if (!func((int)(&node - nodes.data()))) {
+						return;
+					}
+				}
+				else {
+					stack[stackSize++] = node.child1;
+					stack[stackSize++] = node.child2;
+				}
+			}
+		}
+
+		template <typename Func>
+		void DynamicAABBTree::RayCast(const Maths::Vector3& origin, const Maths::Vector3& direction, float maxDistance, Func&& func) const {
+			if (root == NULL_NODE) {
+				return;
+			}
+			const Maths::Vector3 invDir(
+				direction.x != 0.0f ? 1.0f / direction.x : FLT_MAX,
+				direction.y != 0.0f ? 1.0f / direction.y : FLT_MAX,
+				direction.z != 0.0f ? 1.0f / direction.z : FLT_MAX);
+
+			auto hitsBox = [&](const AABB& box) {
+				float tMin = 0.0f;
+				float tMax = maxDistance;
+				for (int i = 0; i < 3; ++i) {
+					float t0 = (box.min[i] - origin[i]) * invDir[i];
+					float t1 = (box.max[i] - origin[i]) * invDir[i];
+					if (t0 > t1) {
+						std::swap(t0, t1);
+					}
+					tMin = std::max(tMin, t0);
+					tMax = std::min(tMax, t1);
+				}
+				return tMin <= tMax;
+			};
+
+			int stack[128];
+			int stackSize = 0;
+			stack[stackSize++] = root;
+			while (stackSize > 0) {
+				const int index = stack[--stackSize];
+				const Node& node = nodes[index];
+				if (!hitsBox(node.box)) {
+					continue;
+				}
+				if (node.IsLeaf()) {
+					func(index);
+				}
+				else {
+					stack[stackSize++] = node.child1;
+					stack[stackSize++] = node.child2;
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,319 @@
+#include "pch.h"
+#include "RigidBodyStore.h"
+#include "Math/SIMD.h"
+
+#include <cmath>
+
+using namespace NCL;
+using namespace Maths;
+using namespace Physics;
+
+namespace {
+	/*
+	* The integrators are written once over these, so the SIMD paths do exactly the same arithmetic in the same
+	* order as the scalar one, and give the same results bit for bit.
+	*/
+	struct ScalarLanes {
+		using Reg = float;
+		static constexpr size_t WIDTH = 1;
+
+		static Reg Load(const float* p) { return *p; }
+		static void Store(float* p, Reg a) { *p = a; }
+		static Reg Set(float a) { return a; }
+		static Reg Add(Reg a, Reg b) { return a + b; }
+		static Reg Sub(Reg a, Reg b) { return a - b; }
+		static Reg Mul(Reg a, Reg b) { return a * b; }
+		static Reg Div(Reg a, Reg b) { return a / b; }
+		static Reg Sqrt(Reg a) { return std::sqrt(a); }
+		// a where test > 0, b elsewhere
+		static Reg SelectPositive(Reg test, Reg a, Reg b) { return test > 0.0f ? a : b; }
+	};
+
+#if NCL_SIMD_AVX2
+	struct AVX2Lanes {
+		using Reg = __m256;
+		static constexpr size_t WIDTH = 8;
+
+		static Reg Load(const float* p) { return _mm256_loadu_ps(p); }
+		static void Store(float* p, Reg a) { _mm256_storeu_ps(p, a); }
+		static Reg Set(float a) { return _mm256_set1_ps(a); }
+		static Reg Add(Reg a, Reg b) { return _mm256_add_ps(a, b); }
+		static Reg Sub(Reg a, Reg b) { return _mm256_sub_ps(a, b); }
+		static Reg Mul(Reg a, Reg b) { return _mm256_mul_ps(a, b); }
+		static Reg Div(Reg a, Reg b) { return _mm256_div_ps(a, b); }
+		static Reg Sqrt(Reg a) { return _mm256_sqrt_ps(a); }
+		static Reg SelectPositive(Reg test, Reg a, Reg b) {
+			return _mm256_blendv_ps(b, a, _mm256_cmp_ps(test, _mm256_setzero_ps(), _CMP_GT_OQ));
+		}
+	};
+	using SIMDLanes = AVX2Lanes;
+#elif NCL_SIMD_SSE
+	struct SSELanes {
+		using Reg = __m128;
+		static constexpr size_t WIDTH = 4;
+
+		static Reg Load(const float* p) { return _mm_loadu_ps(p); }
+		static void Store(float* p, Reg a) { _mm_storeu_ps(p, a); }
+		static Reg Set(float a) { return _mm_set1_ps(a); }
+		static Reg Add(Reg a, Reg b) { return _mm_add_ps(a, b); }
+		static Reg Sub(Reg a, Reg b) { return _mm_sub_ps(a, b); }
+		static Reg Mul(Reg a, Reg b) { return _mm_mul_ps(a, b); }
+		static Reg Div(Reg a, Reg b) { return _mm_div_ps(a, b); }
+		static Reg Sqrt(Reg a) { return _mm_sqrt_ps(a); }
+		// SSE2 has no blend
+		static Reg SelectPositive(Reg test, Reg a, Reg b) {
+			const Reg mask = _mm_cmpgt_ps(test, _mm_setzero_ps());
+			return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+		}
+	};
+	using SIMDLanes = SSELanes;
+#else
+	using SIMDLanes = ScalarLanes;
+#endif
+}
+
+void RigidBodyStore::Clear() {
+	Resize(0);
+}
+
+void RigidBodyStore::Resize(uint count) {
+	for (std::vector<float>* component : { &posX, &posY, &posZ, &orientX, &orientY, &orientZ,
+		&linVelX, &linVelY, &linVelZ, &angVelX, &angVelY, &angVelZ,
+		&forceX, &forceY, &forceZ, &torqueX, &torqueY, &torqueZ,
+		&inverseMass, &localInertiaX, &localInertiaY, &localInertiaZ,
+		&inertiaXX, &inertiaXY, &inertiaXZ, &inertiaYY, &inertiaYZ, &inertiaZZ,
+		&linearDamping, &angularDamping, &active }) {
+		component->resize(count, 0.0f);
+	}
+	orientW.resize(count, 1.0f);
+}
+
+void RigidBodyStore::SetBody(uint body, const RigidBody& state) {
+	SetPosition(body, state.position);
+	SetOrientation(body, state.orientation);
+	SetLinearVelocity(body, state.linearVelocity);
+	SetAngularVelocity(body, state.angularVelocity);
+	forceX[body] = state.force.x;
+	forceY[body] = state.force.y;
+	forceZ[body] = state.force.z;
+	torqueX[body] = state.torque.x;
+	torqueY[body] = state.torque.y;
+	torqueZ[body] = state.torque.z;
+
+	inverseMass[body] = state.inverseMass;
+	localInertiaX[body] = state.inverseInertia.x;
+	localInertiaY[body] = state.inverseInertia.y;
+	localInertiaZ[body] = state.inverseInertia.z;
+	linearDamping[body] = state.linearDamping;
+	angularDamping[body] = state.angularDamping;
+	active[body] = state.active ? 1.0f : 0.0f;
+}
+
+RigidBody RigidBodyStore::GetBody(uint body) const {
+	RigidBody state;
+	state.position = GetPosition(body);
+	state.orientation = GetOrientation(body);
+	state.linearVelocity = GetLinearVelocity(body);
+	state.angularVelocity = GetAngularVelocity(body);
+	state.force = Vector3(forceX[body], forceY[body], forceZ[body]);
+	state.torque = Vector3(torqueX[body], torqueY[body], torqueZ[body]);
+	state.inverseInertia = Vector3(localInertiaX[body], localInertiaY[body], localInertiaZ[body]);
+	state.inverseMass = inverseMass[body];
+	state.linearDamping = linearDamping[body];
+	state.angularDamping = angularDamping[body];
+	state.active = IsActive(body);
+	return state;
+}
+
+void RigidBodyStore::SetPosition(uint body, const Vector3& position) {
+	posX[body] = position.x;
+	posY[body] = position.y;
+	posZ[body] = position.z;
+}
+
+void RigidBodyStore::SetOrientation(uint body, const Quaternion& orientation) {
+	orientX[body] = orientation.x;
+	orientY[body] = orientation.y;
+	orientZ[body] = orientation.z;
+	orientW[body] = orientation.w;
+}
+
+void RigidBodyStore::SetLinearVelocity(uint body, const Vector3& v) {
+	linVelX[body] = v.x;
+	linVelY[body] = v.y;
+	linVelZ[body] = v.z;
+}
+
+void RigidBodyStore::SetAngularVelocity(uint body, const Vector3& v) {
+	angVelX[body] = v.x;
+	angVelY[body] = v.y;
+	angVelZ[body] = v.z;
+}
+
+Matrix3 RigidBodyStore::GetInverseInertiaTensor(uint body) const {
+	// Symmetric, so it's the same either way round
+	return Matrix3(
+		Vector3(inertiaXX[body], inertiaXY[body], inertiaXZ[body]),
+		Vector3(inertiaXY[body], inertiaYY[body], inertiaYZ[body]),
+		Vector3(inertiaXZ[body], inertiaYZ[body], inertiaZZ[body]));
+}
+
+void RigidBodyStore::AddForceAtLocalPosition(uint body, const Vector3& force, const Vector3& localPos) {
+	const Vector3 torque = Vector3::Cross(localPos, force);
+	forceX[body] += force.x;
+	forceY[body] += force.y;
+	forceZ[body] += force.z;
+	torqueX[body] += torque.x;
+	torqueY[body] += torque.y;
+	torqueZ[body] += torque.z;
+}
+
+template <typename Lanes>
+size_t RigidBodyStore::IntegrateAccelLanes(float dt, const Vector3& gravity, size_t first, size_t last) {
+	using Reg = typename Lanes::Reg;
+	const Reg dtLanes = Lanes::Set(dt);
+	const Reg gx = Lanes::Set(gravity.x);
+	const Reg gy = Lanes::Set(gravity.y);
+	const Reg gz = Lanes::Set(gravity.z);
+	const Reg zero = Lanes::Set(0.0f);
+	const Reg one = Lanes::Set(1.0f);
+	const Reg two = Lanes::Set(2.0f);
+
+	size_t i = first;
+	for (; i + Lanes::WIDTH <= last; i += Lanes::WIDTH) {
+		// The rotation, as Matrix3(Quaternion) builds it, rows by columns
+		const Reg x = Lanes::Load(&orientX[i]);
+		const Reg y = Lanes::Load(&orientY[i]);
+		const Reg z = Lanes::Load(&orientZ[i]);
+		const Reg w = Lanes::Load(&orientW[i]);
+		const Reg xx = Lanes::Mul(x, x), yy = Lanes::Mul(y, y), zz = Lanes::Mul(z, z);
+		const Reg xy = Lanes::Mul(x, y), xz = Lanes::Mul(x, z), yz = Lanes::Mul(y, z);
+		const Reg xw = Lanes::Mul(x, w), yw = Lanes::Mul(y, w), zw = Lanes::Mul(z, w);
+		const Reg r00 = Lanes::Sub(Lanes::Sub(one, Lanes::Mul(two, yy)), Lanes::Mul(two, zz));
+		const Reg r11 = Lanes::Sub(Lanes::Sub(one, Lanes::Mul(two, xx)), Lanes::Mul(two, zz));
+		const Reg r22 = Lanes::Sub(Lanes::Sub(one, Lanes::Mul(two, xx)), Lanes::Mul(two, yy));
+		const Reg r01 = Lanes::Sub(Lanes::Mul(two, xy), Lanes::Mul(two, zw));
+		const Reg r10 = Lanes::Add(Lanes::Mul(two, xy), Lanes::Mul(two, zw));
+		const Reg r02 = Lanes::Add(Lanes::Mul(two, xz), Lanes::Mul(two, yw));
+		const Reg r20 = Lanes::Sub(Lanes::Mul(two, xz), Lanes::Mul(two, yw));
+		const Reg r12 = Lanes::Sub(Lanes::Mul(two, yz), Lanes::Mul(two, xw));
+		const Reg r21 = Lanes::Add(Lanes::Mul(two, yz), Lanes::Mul(two, xw));
+
+		// R * diagonal * R transposed
+		const Reg d0 = Lanes::Load(&localInertiaX[i]);
+		const Reg d1 = Lanes::Load(&localInertiaY[i]);
+		const Reg d2 = Lanes::Load(&localInertiaZ[i]);
+		auto element = [&](Reg a0, Reg a1, Reg a2, Reg b0, Reg b1, Reg b2) {
+			return Lanes::Add(Lanes::Add(Lanes::Mul(Lanes::Mul(a0, d0), b0), Lanes::Mul(Lanes::Mul(a1, d1), b1)),
+				Lanes::Mul(Lanes::Mul(a2, d2), b2));
+		};
+		const Reg ixx = element(r00, r01, r02, r00, r01, r02);
+		const Reg ixy = element(r00, r01, r02, r10, r11, r12);
+		const Reg ixz = element(r00, r01, r02, r20, r21, r22);
+		const Reg iyy = element(r10, r11, r12, r10, r11, r12);
+		const Reg iyz = element(r10, r11, r12, r20, r21, r22);
+		const Reg izz = element(r20, r21, r22, r20, r21, r22);
+		Lanes::Store(&inertiaXX[i], ixx);
+		Lanes::Store(&inertiaXY[i], ixy);
+		Lanes::Store(&inertiaXZ[i], ixz);
+		Lanes::Store(&inertiaYY[i], iyy);
+		Lanes::Store(&inertiaYZ[i], iyz);
+		Lanes::Store(&inertiaZZ[i], izz);
+
+		const Reg stepDt = Lanes::Mul(dtLanes, Lanes::Load(&active[i]));
+		const Reg invMass = Lanes::Load(&inverseMass[i]);
+		// Infinitely heavy things don't fall
+		const Reg ax = Lanes::Add(Lanes::Mul(Lanes::Load(&forceX[i]), invMass), Lanes::SelectPositive(invMass, gx, zero));
+		const Reg ay = Lanes::Add(Lanes::Mul(Lanes::Load(&forceY[i]), invMass), Lanes::SelectPositive(invMass, gy, zero));
+		const Reg az = Lanes::Add(Lanes::Mul(Lanes::Load(&forceZ[i]), invMass), Lanes::SelectPositive(invMass, gz, zero));
+		Lanes::Store(&linVelX[i], Lanes::Add(Lanes::Load(&linVelX[i]), Lanes::Mul(ax, stepDt)));
+		Lanes::Store(&linVelY[i], Lanes::Add(Lanes::Load(&linVelY[i]), Lanes::Mul(ay, stepDt)));
+		Lanes::Store(&linVelZ[i], Lanes::Add(Lanes::Load(&linVelZ[i]), Lanes::Mul(az, stepDt)));
+
+		const Reg tx = Lanes::Load(&torqueX[i]);
+		const Reg ty = Lanes::Load(&torqueY[i]);
+		const Reg tz = Lanes::Load(&torqueZ[i]);
+		const Reg alphaX = Lanes::Add(Lanes::Add(Lanes::Mul(ixx, tx), Lanes::Mul(ixy, ty)), Lanes::Mul(ixz, tz));
+		const Reg alphaY = Lanes::Add(Lanes::Add(Lanes::Mul(ixy, tx), Lanes::Mul(iyy, ty)), Lanes::Mul(iyz, tz));
+		const Reg alphaZ = Lanes::Add(Lanes::Add(Lanes::Mul(ixz, tx), Lanes::Mul(iyz, ty)), Lanes::Mul(izz, tz));
+		Lanes::Store(&angVelX[i], Lanes::Add(Lanes::Load(&angVelX[i]), Lanes::Mul(alphaX, stepDt)));
+		Lanes::Store(&angVelY[i], Lanes::Add(Lanes::Load(&angVelY[i]), Lanes::Mul(alphaY, stepDt)));
+		Lanes::Store(&angVelZ[i], Lanes::Add(Lanes::Load(&angVelZ[i]), Lanes::Mul(alphaZ, stepDt)));
+	}
+	return i;
+}
+
+template <typename Lanes>
+size_t RigidBodyStore::IntegrateVelocityLanes(float dt, size_t first, size_t last) {
+	using Reg = typename Lanes::Reg;
+	const Reg dtLanes = Lanes::Set(dt);
+	const Reg one = Lanes::Set(1.0f);
+	const Reg half = Lanes::Set(0.5f);
+
+	size_t i = first;
+	for (; i + Lanes::WIDTH <= last; i += Lanes::WIDTH) {
+		const Reg isActive = Lanes::Load(&active[i]);
+		const Reg stepDt = Lanes::Mul(dtLanes, isActive);
+
+		const Reg vx = Lanes::Load(&linVelX[i]);
+		const Reg vy = Lanes::Load(&linVelY[i]);
+		const Reg vz = Lanes::Load(&linVelZ[i]);
+		Lanes::Store(&posX[i], Lanes::Add(Lanes::Load(&posX[i]), Lanes::Mul(vx, stepDt)));
+		Lanes::Store(&posY[i], Lanes::Add(Lanes::Load(&posY[i]), Lanes::Mul(vy, stepDt)));
+		Lanes::Store(&posZ[i], Lanes::Add(Lanes::Load(&posZ[i]), Lanes::Mul(vz, stepDt)));
+		const Reg linearScale = Lanes::Sub(one, Lanes::Mul(Lanes::Load(&linearDamping[i]), stepDt));
+		Lanes::Store(&linVelX[i], Lanes::Mul(vx, linearScale));
+		Lanes::Store(&linVelY[i], Lanes::Mul(vy, linearScale));
+		Lanes::Store(&linVelZ[i], Lanes::Mul(vz, linearScale));
+
+		// orientation + Quaternion(angVel * dt * 0.5f, 0.0f) * orientation
+		const Reg wx = Lanes::Load(&angVelX[i]);
+		const Reg wy = Lanes::Load(&angVelY[i]);
+		const Reg wz = Lanes::Load(&angVelZ[i]);
+		const Reg sx = Lanes::Mul(Lanes::Mul(wx, stepDt), half);
+		const Reg sy = Lanes::Mul(Lanes::Mul(wy, stepDt), half);
+		const Reg sz = Lanes::Mul(Lanes::Mul(wz, stepDt), half);
+		const Reg qx = Lanes::Load(&orientX[i]);
+		const Reg qy = Lanes::Load(&orientY[i]);
+		const Reg qz = Lanes::Load(&orientZ[i]);
+		const Reg qw = Lanes::Load(&orientW[i]);
+		const Reg nx = Lanes::Add(qx, Lanes::Sub(Lanes::Add(Lanes::Mul(sx, qw), Lanes::Mul(sy, qz)), Lanes::Mul(sz, qy)));
+		const Reg ny = Lanes::Add(qy, Lanes::Sub(Lanes::Add(Lanes::Mul(sy, qw), Lanes::Mul(sz, qx)), Lanes::Mul(sx, qz)));
+		const Reg nz = Lanes::Add(qz, Lanes::Sub(Lanes::Add(Lanes::Mul(sz, qw), Lanes::Mul(sx, qy)), Lanes::Mul(sy, qx)));
+		const Reg nw = Lanes::Sub(Lanes::Sub(Lanes::Sub(qw, Lanes::Mul(sx, qx)), Lanes::Mul(sy, qy)), Lanes::Mul(sz, qz));
+		const Reg magnitude = Lanes::Sqrt(Lanes::Add(Lanes::Add(Lanes::Add(Lanes::Mul(nx, nx), Lanes::Mul(ny, ny)),
+			Lanes::Mul(nz, nz)), Lanes::Mul(nw, nw)));
+		const Reg scale = Lanes::Div(one, magnitude);
+		// Inactive bodies keep their orientation exactly, rather than being renormalised every step
+		const Reg normalise = Lanes::Mul(isActive, magnitude);
+		Lanes::Store(&orientX[i], Lanes::SelectPositive(normalise, Lanes::Mul(nx, scale), qx));
+		Lanes::Store(&orientY[i], Lanes::SelectPositive(normalise, Lanes::Mul(ny, scale), qy));
+		Lanes::Store(&orientZ[i], Lanes::SelectPositive(normalise, Lanes::Mul(nz, scale), qz));
+		Lanes::Store(&orientW[i], Lanes::SelectPositive(normalise, Lanes::Mul(nw, scale), qw));
+
+		const Reg angularScale = Lanes::Sub(one, Lanes::Mul(Lanes::Load(&angularDamping[i]), stepDt));
+		Lanes::Store(&angVelX[i], Lanes::Mul(wx, angularScale));
+		Lanes::Store(&angVelY[i], Lanes::Mul(wy, angularScale));
+		Lanes::Store(&angVelZ[i], Lanes::Mul(wz, angularScale));
+	}
+	return i;
+}
+
+void RigidBodyStore::IntegrateAccel(float dt, const Vector3& gravity, uint first, uint last) {
+	const size_t i = IntegrateAccelLanes<SIMDLanes>(dt, gravity, first, last);
+	// Whatever doesn't fill a whole block
+	IntegrateAccelLanes<ScalarLanes>(dt, gravity, i, last);
+}
+
+void RigidBodyStore::IntegrateVelocity(float dt, uint first, uint last) {
+	const size_t i = IntegrateVelocityLanes<SIMDLanes>(dt, first, last);
+	IntegrateVelocityLanes<ScalarLanes>(dt, i, last);
+}
+
+void RigidBodyStore::IntegrateAccelScalar(float dt, const Vector3& gravity, uint first, uint last) {
+	IntegrateAccelLanes<ScalarLanes>(dt, gravity, first, last);
+}
+
+void RigidBodyStore::IntegrateVelocityScalar(float dt, uint first, uint last) {
+	IntegrateVelocityLanes<ScalarLanes>(dt, first, last);
+}
@@ -0,0 +1,138 @@
+#pragma once
+#include "Math/Matrix3.h"
+#include "Math/Quaternion.h"
+#include "Math/Vector3.h"
+#include "NCLAliases.h"
+
+#include <vector>
+
+namespace NCL {
+	namespace Physics {
+		// One body's state, as it's put into and read back out of a RigidBodyStore
+		struct RigidBody {
+			Maths::Vector3 position;
+			Maths::Quaternion orientation;
+			Maths::Vector3 linearVelocity;
+			Maths::Vector3 angularVelocity;
+			Maths::Vector3 force;
+			Maths::Vector3 torque;
+			// The diagonal of the inverse inertia tensor, in the body's own space
+			Maths::Vector3 inverseInertia;
+			float inverseMass = 0.0f;
+			float linearDamping = 0.0f;
+			float angularDamping = 0.0f;
+			// Inactive bodies, asleep or with nothing to integrate, keep their velocities and stay where they are
+			bool active = false;
+		};
+
+		/*
+		* The state integration needs for every body, one array per component, so the integrators can run over
+		* bodies 8 at a time with AVX2 (4 with SSE) when available rather than following pointers to each one.
+		* A body's handle is its index, which the owner keeps alongside whatever the body belongs to.
+		* The SIMD and scalar paths give the same results bit for bit, so a range comes out the same however it's
+		* split up between threads.
+		*/
+		class RigidBodyStore {
+		public:
+			RigidBodyStore() = default;
+			~RigidBodyStore() = default;
+
+			void Clear();
+			// New bodies are left inactive and at rest
+			void Resize(uint count);
+
+			uint GetBodyCount() const {
+				return (uint)posX.size();
+			}
+
+			void SetBody(uint body, const RigidBody& state);
+			RigidBody GetBody(uint body) const;
+
+			Maths::Vector3 GetPosition(uint body) const {
+				return Maths::Vector3(posX[body], posY[body], posZ[body]);
+			}
+			Maths::Quaternion GetOrientation(uint body) const {
+				return Maths::Quaternion(orientX[body], orientY[body], orientZ[body], orientW[body]);
+			}
+			Maths::Vector3 GetLinearVelocity(uint body) const {
+				return Maths::Vector3(linVelX[body], linVelY[body], linVelZ[body]);
+			}
+			Maths::Vector3 GetAngularVelocity(uint body) const {
+				return Maths::Vector3(angVelX[body], angVelY[body], angVelZ[body]);
+			}
+			void SetPosition(uint body, const Maths::Vector3& position);
+			void SetOrientation(uint body, const Maths::Quaternion& orientation);
+			void SetLinearVelocity(uint body, const Maths::Vector3& v);
+			void SetAngularVelocity(uint body, const Maths::Vector3& v);
+
+			float GetInverseMass(uint body) const {
+				return inverseMass[body];
+			}
+			bool IsActive(uint body) const {
+				return active[body] != 0.0f;
+			}
+
+			// The world space inverse inertia tensor, as of the last IntegrateAccel
+			Maths::Matrix3 GetInverseInertiaTensor(uint body) const;
+
+			// localPos is relative to the body's centre, in world space
+			void AddForceAtLocalPosition(uint body, const Maths::Vector3& force, const Maths::Vector3& localPos);
+
+			// Adds force, torque and gravity (for bodies that can move) to the velocities of the active bodies,
+			// first updating every body's world space inertia tensor from its orientation
+			void IntegrateAccel(float dt, const Maths::Vector3& gravity, uint first, uint last);
+			// Moves the active bodies by their velocities, then damps the velocities
+			void IntegrateVelocity(float dt, uint first, uint last);
+
+			// The same without SIMD, the reference the SIMD path is checked against
+			void IntegrateAccelScalar(float dt, const Maths::Vector3& gravity, uint first, uint last);
+			void IntegrateVelocityScalar(float dt, uint first, uint last);
+
+		protected:
+			// Integrate whole blocks of Lanes::WIDTH bodies from first, returning where they stopped
+			template <typename Lanes>
+			size_t IntegrateAccelLanes(float dt, const Maths::Vector3& gravity, size_t first, size_t last);
+			template <typename Lanes>
+			size_t IntegrateVelocityLanes(float dt, size_t first, size_t last);
+
+			std::vector<float> posX;
+			std::vector<float> posY;
+			std::vector<float> posZ;
+			std::vector<float> orientX;
+			std::vector<float> orientY;
+			std::vector<float> orientZ;
+			std::vector<float> orientW;
+
+			std::vector<float> linVelX;
+			std::vector<float> linVelY;
+			std::vector<float> linVelZ;
+			std::vector<float> angVelX;
+			std::vector<float> angVelY;
+			std::vector<float> angVelZ;
+
+			std::vector<float> forceX;
+			std::vector<float> forceY;
+			std::vector<float> forceZ;
+			std::vector<float> torqueX;
+			std::vector<float> torqueY;
+			std::vector<float> torqueZ;
+
+			std::vector<float> inverseMass;
+			std::vector<float> localInertiaX;
+			std::vector<float> localInertiaY;
+			std::vector<float> localInertiaZ;
+			// The world space tensor is symmetric, so only 6 of its elements are kept
+			std::vector<float> inertiaXX;
+			std::vector<float> inertiaXY;
+			std::vector<float> inertiaXZ;
+			std::vector<float> inertiaYY;
+			std::vector<float> inertiaYZ;
+			std::vector<float> inertiaZZ;
+
+			std::vector<float> linearDamping;
+			std::vector<float> angularDamping;
+			// 1 or 0, so the integrators can scale by it rather than branch
+			std::vector<float> active;
+		};
+	}
+}
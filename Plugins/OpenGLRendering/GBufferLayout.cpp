@@ -0,0 +1,79 @@
+#include "GBufferLayout.h"
+
+#include <cstdio>
+
+using namespace NCL;
+using namespace Rendering;
+
+namespace {
+	constexpr ScreenTextureFormat DEPTH24 = { GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, 4 };
+	constexpr ScreenTextureFormat RGBA8 = { GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 4 };
+	constexpr ScreenTextureFormat RG16 = { GL_RG16, GL_RG, GL_UNSIGNED_SHORT, 4 };
+	constexpr ScreenTextureFormat RGB10_A2 = { GL_RGB10_A2, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV, 4 };
+	constexpr ScreenTextureFormat R11F_G11F_B10F = { GL_R11F_G11F_B10F, GL_RGB, GL_UNSIGNED_INT_10F_11F_11F_REV, 4 };
+	constexpr ScreenTextureFormat NO_TARGET = { GL_NONE, GL_NONE, GL_NONE, 0 };
+
+	// Indexed by GBufferLayout
+	const GBufferFormats LAYOUTS[GBUFFER_LAYOUT_COUNT] = {
+		{ DEPTH24, RGBA8, RGBA8, RGBA8, RGBA8, false },
+		{ DEPTH24, RGBA8, RG16, RGB10_A2, NO_TARGET, true },
+		{ DEPTH24, RGBA8, RG16, R11F_G11F_B10F, NO_TARGET, true },
+	};
+
+	const char* LAYOUT_NAMES[GBUFFER_LAYOUT_COUNT] = { "rgba8", "compact", "compact-hdr" };
+}
+
+int GBufferFormats::BytesPerPixel() const {
+	return depth.bytesPerPixel + albedo.bytesPerPixel + normal.bytesPerPixel + lightDiffuse.bytesPerPixel + lightSpecular.bytesPerPixel;
+}
+
+int GBufferFormats::TrafficPerPixel() const {
+	const int lighting = lightDiffuse.bytesPerPixel + lightSpecular.bytesPerPixel;
+	const int fill = depth.bytesPerPixel + albedo.bytesPerPixel + normal.bytesPerPixel;
+	// Compact lighting reads albedo for the specular intensity and to premultiply the diffuse
+	const int light = depth.bytesPerPixel + normal.bytesPerPixel + (compact ? albedo.bytesPerPixel : 0) + lighting;
+	const int combine = albedo.bytesPerPixel + lighting;
+	return fill + light + combine;
+}
+
+const GBufferFormats& Rendering::GetGBufferFormats(GBufferLayout layout) {
+	return LAYOUTS[(int)layout];
+}
+
+ScreenTextureFormat Rendering::GetScreenTextureFormat(GLenum internalFormat) {
+	for (const ScreenTextureFormat& format : { DEPTH24, RGBA8, RG16, RGB10_A2, R11F_G11F_B10F }) {
+		if (format.internalFormat == internalFormat) {
+			return format;
+		}
+	}
+	return RGBA8;
+}
+
+const char* Rendering::GBufferLayoutName(GBufferLayout layout) {
+	return LAYOUT_NAMES[(int)layout];
+}
+
+bool Rendering::ParseGBufferLayout(std::string_view name, GBufferLayout& layout) {
+	for (int i = 0; i < GBUFFER_LAYOUT_COUNT; ++i) {
+		if (name == LAYOUT_NAMES[i]) {
+			layout = (GBufferLayout)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+void Rendering::PrintGBufferReport(int width, int height) {
+	const double pixels = (double)width * (double)height;
+	const int baseTraffic = LAYOUTS[0].TrafficPerPixel();
+
+	std::printf("G-buffer layouts at %dx%d\n", width, height);
+	std::printf("  %-12s %6s %10s %14s %16s %8s\n", "layout", "bytes", "size MB", "traffic bytes", "traffic MB/frame", "vs rgba8");
+	for (int i = 0; i < GBUFFER_LAYOUT_COUNT; ++i) {
+		const GBufferFormats& formats = LAYOUTS[i];
+		const int traffic = formats.TrafficPerPixel();
+		std::printf("  %-12s %6d %10.2f %14d %16.2f %7.0f%%\n", LAYOUT_NAMES[i], formats.BytesPerPixel(),
+			formats.BytesPerPixel() * pixels / (1024.0 * 1024.0), traffic, traffic * pixels / (1024.0 * 1024.0),
+			100.0 * traffic / baseTraffic);
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "glad\glad.h"
+
+#include <string_view>
+
+namespace NCL {
+	namespace Rendering {
+		// How the deferred path stores its G-buffer and the lighting it accumulates. Position is never stored,
+		// the lighting passes rebuild it from depth.
+		enum class GBufferLayout {
+			// Every colour target RGBA8, normals stored as xyz * 0.5 + 0.5
+			RGBA8,
+			// Octahedral normals in RG16, and one RGB10A2 lighting target holding diffuse light already multiplied
+			// by albedo plus specular, instead of separate diffuse and specular targets
+			Compact,
+			// As Compact, but lighting in R11G11B10F so it isn't clamped to 1 before combining
+			CompactHDR,
+		};
+		constexpr int GBUFFER_LAYOUT_COUNT = 3;
+
+		// Everything glTexImage2D needs to allocate one screen sized target
+		struct ScreenTextureFormat {
+			GLenum internalFormat;
+			GLenum format;
+			GLenum type;
+			int bytesPerPixel;
+		};
+
+		// The targets of one layout
+		struct GBufferFormats {
+			ScreenTextureFormat depth;
+			// RGB albedo, specular intensity in alpha
+			ScreenTextureFormat albedo;
+			ScreenTextureFormat normal;
+			ScreenTextureFormat lightDiffuse;
+			// GL_NONE with 0 bytes when compact, the specular goes in lightDiffuse
+			ScreenTextureFormat lightSpecular;
+			// Octahedral normals, and lighting premultiplied by albedo into lightDiffuse alone. Specular intensity is in
+			// albedo's alpha when compact, the normal's alpha otherwise.
+			bool compact;
+
+			// Size of the G-buffer and lighting targets together
+			int BytesPerPixel() const;
+			// Bytes written and read per lit pixel by the G-buffer fill, the lighting compute pass and the combine,
+			// ignoring overdraw in the fill and the light list reads
+			int TrafficPerPixel() const;
+		};
+
+		const GBufferFormats& GetGBufferFormats(GBufferLayout layout);
+		// The format of any screen texture from its internal format, for reallocating on resize
+		ScreenTextureFormat GetScreenTextureFormat(GLenum internalFormat);
+
+		const char* GBufferLayoutName(GBufferLayout layout);
+		// Accepts the names GBufferLayoutName returns
+		bool ParseGBufferLayout(std::string_view name, GBufferLayout& layout);
+
+		// Prints a table of every layout's bytes per pixel and per frame traffic at width x height to stdout
+		void PrintGBufferReport(int width, int height);
+	}
+}
@@ -0,0 +1,71 @@
+#include "GpuDepthPyramid.h"
+
+#include "Assets/Shaders/Shared/DepthPyramidDefinitions.h"
+
+#include <algorithm>
+
+using namespace NCL;
+using namespace Rendering;
+
+GpuDepthPyramid::GpuDepthPyramid(int width, int height) : buildShader("depthPyramid.comp") {
+	Resize(width, height);
+}
+
+GpuDepthPyramid::~GpuDepthPyramid() {
+	glDeleteTextures(1, &texture);
+}
+
+void GpuDepthPyramid::Resize(int width, int height) {
+	depthWidth = width;
+	depthHeight = height;
+
+	// Usual mip sizes, starting at half the depth buffer and ending at 1x1
+	levelSizes.clear();
+	LevelSize size = { std::max(1, width / 2), std::max(1, height / 2) };
+	levelSizes.push_back(size);
+	while (size.x > 1 || size.y > 1) {
+		size = { std::max(1, size.x / 2), std::max(1, size.y / 2) };
+		levelSizes.push_back(size);
+	}
+
+	// Storage is immutable, so resizing needs a new texture
+	glDeleteTextures(1, &texture);
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexStorage2D(GL_TEXTURE_2D, GetLevelCount(), GL_RGBA32F, levelSizes[0].x, levelSizes[0].y);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void GpuDepthPyramid::Build(GLuint depthTex) {
+	const GLuint program = buildShader.GetProgramID();
+	buildShader.Bind();
+	glUniform1i(glGetUniformLocation(program, "sourceTex"), 0);
+	glActiveTexture(GL_TEXTURE0);
+
+	for (int level = 0; level < GetLevelCount(); ++level) {
+		const bool fromDepth = level == 0;
+		const LevelSize source = fromDepth ? LevelSize{ depthWidth, depthHeight } : levelSizes[level - 1];
+		const LevelSize dest = levelSizes[level];
+
+		glBindTexture(GL_TEXTURE_2D, fromDepth ? depthTex : texture);
+		glUniform1i(glGetUniformLocation(program, "sourceLevel"), fromDepth ? 0 : level - 1);
+		glUniform1i(glGetUniformLocation(program, "sourceIsDepth"), fromDepth);
+		glUniform2i(glGetUniformLocation(program, "sourceSize"), source.x, source.y);
+		glUniform2i(glGetUniformLocation(program, "destSize"), dest.x, dest.y);
+		glBindImageTexture(IMAGE_BINDING_DEPTH_PYRAMID, texture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+
+		buildShader.Execute((dest.x + DEPTH_PYRAMID_GROUP_SIZE - 1) / DEPTH_PYRAMID_GROUP_SIZE,
+			(dest.y + DEPTH_PYRAMID_GROUP_SIZE - 1) / DEPTH_PYRAMID_GROUP_SIZE);
+		// The next level reads this one through the sampler
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+	}
+
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	glBindImageTexture(IMAGE_BINDING_DEPTH_PYRAMID, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	buildShader.Unbind();
+}
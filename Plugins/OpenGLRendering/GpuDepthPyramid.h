@@ -0,0 +1,48 @@
+#pragma once
+#include "OGLComputeShader.h"
+#include "glad\glad.h"
+
+#include <vector>
+
+namespace NCL {
+	namespace Rendering {
+		/*
+		* Hierarchical min/max depth built from a depth buffer, stored as the mip chain of one RGBA32F texture.
+		* Each level is a dispatch of depthPyramid.comp reducing the level above it, so building the whole chain
+		* at 1080p is 10 small dispatches. The layout of each texel is described in DepthPyramidDefinitions.h.
+		* Matches DepthPyramid on the CPU.
+		*/
+		class GpuDepthPyramid {
+		public:
+			// width and height are the size of the depth buffer the pyramid is built from
+			GpuDepthPyramid(int width, int height);
+			~GpuDepthPyramid();
+
+			GpuDepthPyramid(const GpuDepthPyramid&) = delete;
+			GpuDepthPyramid& operator=(const GpuDepthPyramid&) = delete;
+
+			// Reallocates the texture, the contents are lost until the next Build
+			void Resize(int width, int height);
+
+			// depthTex must be width x height. Ends with the barriers needed to sample or image load the result.
+			void Build(GLuint depthTex);
+
+			GLuint GetTexture() const { return texture; }
+			int GetLevelCount() const { return (int)levelSizes.size(); }
+			int GetLevelWidth(int level) const { return levelSizes[level].x; }
+			int GetLevelHeight(int level) const { return levelSizes[level].y; }
+
+		protected:
+			struct LevelSize {
+				int x;
+				int y;
+			};
+
+			OGLComputeShader buildShader;
+			GLuint texture = 0;
+			int depthWidth = 0;
+			int depthHeight = 0;
+			std::vector<LevelSize> levelSizes;
+		};
+	}
+}
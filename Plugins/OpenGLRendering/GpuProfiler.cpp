@@ -0,0 +1,206 @@
+#include "GpuProfiler.h"
+#include "Common/Core/Log/Logging.h"
+
+#include <fstream>
+
+using namespace NCL;
+using namespace Rendering;
+
+namespace {
+	double ToMs(GLuint64 ns) {
+		return (double)ns / 1e6;
+	}
+
+	double ToMs(Timepoint from, Timepoint to) {
+		return std::chrono::duration<double, std::milli>(to - from).count();
+	}
+}
+
+double GpuProfiler::FrameResult::GetGpuMs(std::string_view name) const {
+	double total = 0.0;
+	for (const ScopeResult& scope : scopes) {
+		if (name == scope.name) {
+			total += scope.gpuMs;
+		}
+	}
+	return total;
+}
+
+double GpuProfiler::FrameResult::GetCpuMs(std::string_view name) const {
+	double total = 0.0;
+	for (const ScopeResult& scope : scopes) {
+		if (name == scope.name) {
+			total += scope.cpuMs;
+		}
+	}
+	return total;
+}
+
+GpuProfiler::GpuProfiler() {
+	for (FrameQueries& frame : frames) {
+		glGenQueries(MAX_SCOPES_PER_FRAME * 2, frame.queries);
+		frame.scopes.reserve(MAX_SCOPES_PER_FRAME);
+	}
+	openScopes.reserve(16);
+	ResetFrame(frames[currentFrame]);
+}
+
+GpuProfiler::~GpuProfiler() {
+	for (FrameQueries& frame : frames) {
+		glDeleteQueries(MAX_SCOPES_PER_FRAME * 2, frame.queries);
+	}
+}
+
+void GpuProfiler::BeginScope(const char* name) {
+	FrameQueries& frame = frames[currentFrame];
+	if (!enabled || frame.scopes.size() >= MAX_SCOPES_PER_FRAME) {
+		openScopes.push_back(-1);
+		return;
+	}
+
+	const int index = (int)frame.scopes.size();
+	glQueryCounter(frame.queries[index * 2], GL_TIMESTAMP);
+	frame.lastQuery = frame.queries[index * 2];
+	frame.scopes.push_back({ name, (int)openScopes.size(), Clock::now(), Timepoint() });
+	openScopes.push_back(index);
+}
+
+void GpuProfiler::EndScope() {
+	if (openScopes.empty()) {
+		LOG_WARN("{} called without a matching BeginScope", __FUNCTION__);
+		return;
+	}
+
+	const int index = openScopes.back();
+	openScopes.pop_back();
+	if (index < 0) {
+		return;
+	}
+
+	FrameQueries& frame = frames[currentFrame];
+	glQueryCounter(frame.queries[index * 2 + 1], GL_TIMESTAMP);
+	frame.lastQuery = frame.queries[index * 2 + 1];
+	frame.scopes[index].cpuEnd = Clock::now();
+}
+
+void GpuProfiler::EndFrame() {
+	CLOG_WARN(!openScopes.empty(), "{} {} scopes still open at the end of the frame", __FUNCTION__, openScopes.size());
+	while (!openScopes.empty()) {
+		EndScope();
+	}
+
+	frames[currentFrame].inFlight = !frames[currentFrame].scopes.empty();
+	currentFrame = (currentFrame + 1) % FRAMES_IN_FLIGHT;
+	++frameCounter;
+
+	FrameQueries& next = frames[currentFrame];
+	if (next.inFlight && !ReadBack(next, waitForResults)) {
+		++droppedFrames;
+	}
+	ResetFrame(next);
+}
+
+void GpuProfiler::Flush() {
+	// Oldest first, so latest ends up as the most recent frame
+	for (int i = 1; i <= FRAMES_IN_FLIGHT; ++i) {
+		FrameQueries& frame = frames[(currentFrame + i) % FRAMES_IN_FLIGHT];
+		if (frame.inFlight) {
+			ReadBack(frame, true);
+		}
+	}
+}
+
+void GpuProfiler::ResetFrame(FrameQueries& frame) {
+	frame.scopes.clear();
+	frame.frame = frameCounter;
+	frame.cpuStart = Clock::now();
+	frame.inFlight = false;
+}
+
+bool GpuProfiler::ReadBack(FrameQueries& frame, bool wait) {
+	const int count = (int)frame.scopes.size();
+	if (!wait) {
+		// Timestamps complete in order, so the last one issued being ready means all of them are
+		GLint available = 0;
+		glGetQueryObjectiv(frame.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) {
+			frame.inFlight = false;
+			return false;
+		}
+	}
+
+	latest.frame = frame.frame;
+	latest.cpuStart = frame.cpuStart;
+	latest.scopes.resize(count);
+
+	for (int i = 0; i < count; ++i) {
+		const PendingScope& pending = frame.scopes[i];
+		GLuint64 begin = 0;
+		GLuint64 end = 0;
+		glGetQueryObjectui64v(frame.queries[i * 2], GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(frame.queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+		if (i == 0) {
+			latest.gpuStart = begin;
+		}
+
+		ScopeResult& result = latest.scopes[i];
+		result.name = pending.name;
+		result.depth = pending.depth;
+		result.cpuStartMs = ToMs(frame.cpuStart, pending.cpuBegin);
+		result.cpuMs = ToMs(pending.cpuBegin, pending.cpuEnd);
+		result.gpuStartMs = ToMs(begin - latest.gpuStart);
+		result.gpuMs = ToMs(end - begin);
+	}
+
+	frame.inFlight = false;
+	if (capturing) {
+		captured.push_back(latest);
+	}
+	return true;
+}
+
+void GpuProfiler::StartCapture() {
+	captured.clear();
+	// Pairs a GPU timestamp with a CPU time so both can be put on the same timeline.
+	// Drift between the clocks is negligible over the length of a capture.
+	glGetInteger64v(GL_TIMESTAMP, &captureGpuStart);
+	captureCpuStart = Clock::now();
+	capturing = true;
+}
+
+void GpuProfiler::StopCapture() {
+	capturing = false;
+}
+
+bool GpuProfiler::WriteChromeTrace(const std::string& filename) const {
+	std::ofstream file(filename);
+	if (!file) {
+		LOG_ERROR("{} couldn't open {}", __FUNCTION__, filename);
+		return false;
+	}
+
+	constexpr int CPU_THREAD = 1;
+	constexpr int GPU_THREAD = 2;
+
+	file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+	file << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << CPU_THREAD << ", \"args\": {\"name\": \"CPU\"}},\n";
+	file << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << GPU_THREAD << ", \"args\": {\"name\": \"GPU\"}}";
+
+	for (const FrameResult& frame : captured) {
+		const double cpuFrameUs = ToMs(captureCpuStart, frame.cpuStart) * 1000.0;
+		const double gpuFrameUs = (double)((GLint64)frame.gpuStart - captureGpuStart) / 1000.0;
+
+		for (const ScopeResult& scope : frame.scopes) {
+			file << ",\n{\"name\": \"" << scope.name << "\", \"cat\": \"cpu\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << CPU_THREAD
+				<< ", \"ts\": " << cpuFrameUs + scope.cpuStartMs * 1000.0 << ", \"dur\": " << scope.cpuMs * 1000.0
+				<< ", \"args\": {\"frame\": " << frame.frame << "}}";
+			file << ",\n{\"name\": \"" << scope.name << "\", \"cat\": \"gpu\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << GPU_THREAD
+				<< ", \"ts\": " << gpuFrameUs + scope.gpuStartMs * 1000.0 << ", \"dur\": " << scope.gpuMs * 1000.0
+				<< ", \"args\": {\"frame\": " << frame.frame << "}}";
+		}
+	}
+	file << "\n]}\n";
+
+	LOG_INFO("{} wrote {} frames to {}", __FUNCTION__, captured.size(), filename);
+	return true;
+}
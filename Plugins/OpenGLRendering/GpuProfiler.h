@@ -0,0 +1,167 @@
+#pragma once
+#include "glad\glad.h"
+#include "Common/Core/GameTimer.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Set to 0 to compile out every NCL_GPU_SCOPE
+#define NCL_GPU_PROFILING 1
+
+namespace NCL {
+	namespace Rendering {
+		/*
+		* Named, nestable timing scopes for the CPU and GPU side of each pass.
+		* GPU times come from GL_TIMESTAMP queries, with a separate query pool for each of FRAMES_IN_FLIGHT frames.
+		* A frame's pool is only read back when it is about to be reused, by which point the GPU has normally finished
+		* with it, so profiling never waits on the GPU. Frames whose queries still aren't ready are dropped instead,
+		* unless SetWaitForResults is on.
+		* CPU times use the same Clock as ScopedTimer, so both sides line up in the Chrome trace.
+		*/
+		class GpuProfiler {
+		public:
+			static constexpr int FRAMES_IN_FLIGHT = 3;
+			static constexpr int MAX_SCOPES_PER_FRAME = 64;
+
+			struct ScopeResult {
+				const char* name = nullptr;
+				int depth = 0;
+				// Start times are relative to the start of the frame on the CPU, and to the first GPU timestamp of the frame
+				double cpuStartMs = 0.0;
+				double cpuMs = 0.0;
+				double gpuStartMs = 0.0;
+				double gpuMs = 0.0;
+			};
+
+			struct FrameResult {
+				uint64_t frame = 0;
+				Timepoint cpuStart;
+				GLuint64 gpuStart = 0;
+				std::vector<ScopeResult> scopes;
+
+				// Sum of every scope with this name, 0 if it wasn't recorded this frame
+				double GetGpuMs(std::string_view name) const;
+				double GetCpuMs(std::string_view name) const;
+			};
+
+			GpuProfiler();
+			~GpuProfiler();
+
+			// Names must outlive the profiler, string literals are expected.
+			void BeginScope(const char* name);
+			void EndScope();
+
+			// Closes the current frame and moves on to the next query pool, reading it back first if it's still in flight.
+			void EndFrame();
+
+			// Blocks until every frame in flight has been read back. Only for use outside anything being measured.
+			void Flush();
+
+			void SetEnabled(bool state) {
+				enabled = state;
+			}
+
+			bool IsEnabled() const {
+				return enabled;
+			}
+
+			// Waits for late query results rather than dropping the frame. For benchmarks that need every frame.
+			void SetWaitForResults(bool state) {
+				waitForResults = state;
+			}
+
+			// Number of the frame scopes are currently being recorded into
+			uint64_t GetFrameIndex() const {
+				return frameCounter;
+			}
+
+			// Most recently read back frame, frame is 0 until the first one arrives
+			const FrameResult& GetLatestResult() const {
+				return latest;
+			}
+
+			uint64_t GetDroppedFrames() const {
+				return droppedFrames;
+			}
+
+			// Keeps every read back frame between StartCapture and StopCapture for WriteChromeTrace
+			void StartCapture();
+			void StopCapture();
+			bool IsCapturing() const {
+				return capturing;
+			}
+
+			const std::vector<FrameResult>& GetCapturedFrames() const {
+				return captured;
+			}
+
+			// Writes captured frames in the Chrome trace event format, viewable in chrome://tracing or Perfetto
+			bool WriteChromeTrace(const std::string& filename) const;
+
+		protected:
+			struct PendingScope {
+				const char* name;
+				int depth;
+				Timepoint cpuBegin;
+				Timepoint cpuEnd;
+			};
+
+			struct FrameQueries {
+				GLuint queries[MAX_SCOPES_PER_FRAME * 2];
+				std::vector<PendingScope> scopes;
+				GLuint lastQuery = 0;
+				uint64_t frame = 0;
+				Timepoint cpuStart;
+				bool inFlight = false;
+			};
+
+			void ResetFrame(FrameQueries& frame);
+			// Returns false without reading anything if wait is false and the results aren't ready
+			bool ReadBack(FrameQueries& frame, bool wait);
+
+			FrameQueries frames[FRAMES_IN_FLIGHT];
+			int currentFrame = 0;
+			uint64_t frameCounter = 0;
+			// Indices into the current frame's scopes, -1 for scopes that didn't fit in the pool
+			std::vector<int> openScopes;
+
+			FrameResult latest;
+			uint64_t droppedFrames = 0;
+			bool enabled = true;
+			bool waitForResults = false;
+
+			bool capturing = false;
+			std::vector<FrameResult> captured;
+			Timepoint captureCpuStart;
+			GLint64 captureGpuStart = 0;
+		};
+
+		// Times the enclosing block on the CPU and GPU
+		class GpuProfileScope {
+		public:
+			GpuProfileScope(GpuProfiler& profiler, const char* name) : profiler(profiler) {
+				profiler.BeginScope(name);
+			}
+
+			~GpuProfileScope() {
+				profiler.EndScope();
+			}
+
+			GpuProfileScope(const GpuProfileScope&) = delete;
+			GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+		private:
+			GpuProfiler& profiler;
+		};
+	}
+}
+
+#if NCL_GPU_PROFILING
+#define NCL_GPU_SCOPE_CONCAT_INNER(a, b) a##b
+#define NCL_GPU_SCOPE_CONCAT(a, b) NCL_GPU_SCOPE_CONCAT_INNER(a, b)
+#define NCL_GPU_SCOPE(profiler, name) const ::NCL::Rendering::GpuProfileScope NCL_GPU_SCOPE_CONCAT(_nclGpuScope, __LINE__)(profiler, name)
+#else
+#define NCL_GPU_SCOPE(profiler, name) (void)0
+#endif
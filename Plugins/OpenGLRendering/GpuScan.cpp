@@ -0,0 +1,118 @@
+#include "GpuScan.h"
+#include "Common/Core/Log/Logging.h"
+
+#include "Assets/Shaders/Shared/ComputeBindings.h"
+#include "Assets/Shaders/Shared/LightGridDefinitions.h"
+#include "Assets/Shaders/Shared/ScanDefinitions.h"
+
+using namespace NCL;
+using namespace Rendering;
+
+namespace {
+	GLuint BlockCount(GLuint count) {
+		return (count + SCAN_BLOCK_SIZE - 1) / SCAN_BLOCK_SIZE;
+	}
+
+	// Grows buffer to hold at least count uints, discarding what was in it
+	void ReserveBuffer(GLuint& buffer, GLuint& capacity, GLuint count) {
+		if (buffer && count <= capacity) {
+			return;
+		}
+		if (!buffer) {
+			glGenBuffers(1, &buffer);
+		}
+		capacity = count;
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+}
+
+GpuScan::GpuScan() : blockShader("scanBlocks.comp"), addShader("scanAddOffsets.comp") {
+}
+
+GpuScan::~GpuScan() {
+	for (Level& level : levels) {
+		glDeleteBuffers(1, &level.totals);
+		glDeleteBuffers(1, &level.offsets);
+	}
+}
+
+void GpuScan::Scan(GLuint input, GLuint output, GLuint count, bool predicate) {
+	if (count == 0) {
+		return;
+	}
+	CLOG_WARN(BlockCount(count) > 65535, "{} {} elements is more than a single dispatch can scan", __FUNCTION__, count);
+	ScanLevel(input, output, count, predicate, 0);
+	addShader.Unbind();
+}
+
+void GpuScan::ScanLevel(GLuint input, GLuint output, GLuint count, bool predicate, size_t level) {
+	const GLuint blocks = BlockCount(count);
+	// Copied, the recursion below can reallocate levels
+	const Level scratch = ReserveLevel(level, blocks);
+
+	blockShader.Bind();
+	glUniform1ui(glGetUniformLocation(blockShader.GetProgramID(), "count"), count);
+	glUniform1i(glGetUniformLocation(blockShader.GetProgramID(), "predicate"), predicate);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMPUTE_BINDING_SCAN_INPUT, input);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMPUTE_BINDING_SCAN_OUTPUT, output);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMPUTE_BINDING_SCAN_BLOCK_SUMS, scratch.totals);
+	blockShader.Execute(blocks);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	// A single block is already fully scanned
+	if (blocks == 1) {
+		return;
+	}
+
+	ScanLevel(scratch.totals, scratch.offsets, blocks, false, level + 1);
+
+	addShader.Bind();
+	glUniform1ui(glGetUniformLocation(addShader.GetProgramID(), "count"), count);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMPUTE_BINDING_SCAN_OUTPUT, output);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMPUTE_BINDING_SCAN_BLOCK_SUMS, scratch.offsets);
+	addShader.Execute(blocks);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+const GpuScan::Level& GpuScan::ReserveLevel(size_t level, GLuint blocks) {
+	if (level >= levels.size()) {
+		levels.resize(level + 1);
+	}
+	Level& scratch = levels[level];
+	GLuint offsetsCapacity = scratch.capacity;
+	ReserveBuffer(scratch.totals, scratch.capacity, blocks);
+	ReserveBuffer(scratch.offsets, offsetsCapacity, blocks);
+	return scratch;
+}
+
+GpuCompact::GpuCompact() : scatterShader("compactScatter.comp") {
+}
+
+GpuCompact::~GpuCompact() {
+	glDeleteBuffers(1, &offsets);
+}
+
+void GpuCompact::Compact(GLuint flags, GLuint output, GLuint dispatch, GLuint count) {
+	if (count == 0) {
+		const GLSL::DispatchIndirectCommand empty = { 0, 1, 1 };
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, dispatch);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(empty), &empty);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		return;
+	}
+
+	ReserveBuffer(offsets, capacity, count);
+	scan.Scan(flags, offsets, count, true);
+
+	scatterShader.Bind();
+	glUniform1ui(glGetUniformLocation(scatterShader.GetProgramID(), "count"), count);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMPUTE_BINDING_SCAN_INPUT, flags);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMPUTE_BINDING_SCAN_OUTPUT, offsets);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMPUTE_BINDING_COMPACT_OUTPUT, output);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMPUTE_BINDING_COMPACT_DISPATCH, dispatch);
+	scatterShader.Execute(BlockCount(count));
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+	scatterShader.Unbind();
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "OGLComputeShader.h"
+#include "glad\glad.h"
+
+#include <vector>
+
+namespace NCL {
+	namespace Rendering {
+		/*
+		* Exclusive prefix sum over a buffer of uints. Each work group of scanBlocks.comp scans SCAN_BLOCK_SIZE
+		* elements and writes the block's total, the totals are scanned the same way, and scanAddOffsets.comp adds
+		* them back onto every element. The result doesn't depend on scheduling, so it's identical every run and
+		* matches ExclusiveScanBlocks on the CPU.
+		* Handles up to 65535 * SCAN_BLOCK_SIZE elements, the dispatch limit for the first level.
+		* Uses the COMPUTE_BINDING_SCAN_* binding points, and leaves them bound to whatever it last scanned.
+		*/
+		class GpuScan {
+		public:
+			GpuScan();
+			~GpuScan();
+
+			GpuScan(const GpuScan&) = delete;
+			GpuScan& operator=(const GpuScan&) = delete;
+
+			// Both buffers must hold at least count uints, and mustn't be the same buffer.
+			// With predicate set, every non-zero input counts as 1.
+			// Ends with a shader storage barrier, so output can be read by the next dispatch.
+			void Scan(GLuint input, GLuint output, GLuint count, bool predicate = false);
+
+		protected:
+			// Scratch for one level of the recursion: the block totals, and the scan of them
+			struct Level {
+				GLuint totals = 0;
+				GLuint offsets = 0;
+				GLuint capacity = 0;
+			};
+
+			void ScanLevel(GLuint input, GLuint output, GLuint count, bool predicate, size_t level);
+			// Grows the level's buffers to hold at least blocks uints
+			const Level& ReserveLevel(size_t level, GLuint blocks);
+
+			OGLComputeShader blockShader;
+			OGLComputeShader addShader;
+			std::vector<Level> levels;
+		};
+
+		/*
+		* Stream compaction: writes the index of every non-zero flag to an output list, in ascending order.
+		* Built on GpuScan, the scan of the flags gives each kept element its slot, so there is no atomic
+		* contention and the order never changes between runs. Matches CompactIndices on the CPU.
+		*/
+		class GpuCompact {
+		public:
+			GpuCompact();
+			~GpuCompact();
+
+			GpuCompact(const GpuCompact&) = delete;
+			GpuCompact& operator=(const GpuCompact&) = delete;
+
+			// flags holds count uints, output room for count indices. dispatch receives a DispatchIndirectCommand
+			// of { kept, 1, 1 }, for launching one work group per kept element with glDispatchComputeIndirect.
+			// Ends with shader storage and command barriers, so the list and the dispatch are ready to use.
+			void Compact(GLuint flags, GLuint output, GLuint dispatch, GLuint count);
+
+		protected:
+			GpuScan scan;
+			OGLComputeShader scatterShader;
+			GLuint offsets = 0;
+			GLuint capacity = 0;
+		};
+	}
+}
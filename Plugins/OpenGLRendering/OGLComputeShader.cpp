@@ -9,7 +9,9 @@ https://research.ncl.ac.uk/game/
 #include "OGLComputeShader.h"
 #include "../../Plugins/OpenGLRendering/OGLShader.h"
 #include "Common/Resources/Assets.h"
+#include "Common/stb/stb_include.h"
 #include <iostream>
+#include <memory>
 
 using namespace NCL;
 using namespace Rendering;
@@ -19,6 +21,17 @@ OGLComputeShader::OGLComputeShader(const std::string& s)	{
 	string fileContents = "";
 	Assets::ReadTextFile(Assets::SHADERDIR + s, fileContents);
 
+	// Same #include handling as OGLShader, so compute shaders can share the headers in Shaders/Shared
+	char error[256]{};
+	auto processed = std::unique_ptr<char, decltype([](char* p) {free(p); })>(
+		stb_include_string(fileContents.c_str(), nullptr, Assets::SHADERDIR.c_str(), nullptr, error));
+	if (!processed) {
+		LOG_ERROR("Failed to process includes for file {}. Error: {}", s, error);
+	}
+	else {
+		fileContents = processed.get();
+	}
+
 	programID	= glCreateProgram();
 	shaderID	= glCreateShader(GL_COMPUTE_SHADER);
 
@@ -0,0 +1,193 @@
+#include "OGLMeshArena.h"
+#include "Common/Math/Maths.h"
+#include "Assets/Shaders/Shared/IndirectDrawDefinitions.h"
+
+#include <algorithm>
+#include <numeric>
+
+using namespace NCL;
+using namespace NCL::Rendering;
+using namespace NCL::Maths;
+
+namespace {
+	struct AttributeFormat {
+		GLint elementCount;
+		GLsizei elementSize;
+	};
+
+	constexpr AttributeFormat ATTRIBUTE_FORMATS[] = {
+		{ 3, sizeof(Vector3) },	// Positions
+		{ 4, sizeof(Vector4) },	// Colours
+		{ 2, sizeof(Vector2) },	// TextureCoords
+		{ 3, sizeof(Vector3) },	// Normals
+		{ 4, sizeof(Vector4) },	// Tangents
+		{ 4, sizeof(Vector4) },	// Bitangents
+	};
+
+	constexpr GLuint INITIAL_VERTEX_CAPACITY = 1 << 16;
+	constexpr GLuint INITIAL_INDEX_CAPACITY = 1 << 18;
+	constexpr GLuint INITIAL_OBJECT_CAPACITY = 1 << 12;
+
+	// Replaces buffer with a larger one holding the first usedBytes of its contents
+	void GrowBuffer(GLuint& buffer, GLsizeiptr usedBytes, GLsizeiptr newBytes) {
+		GLuint grown = 0;
+		glGenBuffers(1, &grown);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+		glBufferData(GL_COPY_WRITE_BUFFER, newBytes, nullptr, GL_STATIC_DRAW);
+		if (buffer && usedBytes > 0) {
+			glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, usedBytes);
+			glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		glDeleteBuffers(1, &buffer);
+		buffer = grown;
+	}
+
+	GLuint GrowCapacity(GLuint capacity, GLuint required) {
+		while (capacity < required) {
+			capacity *= 2;
+		}
+		return capacity;
+	}
+
+	const void* AttributeData(const MeshGeometry& mesh, int attribute) {
+		const GLuint count = mesh.GetVertexCount();
+		switch (attribute) {
+		case VertexAttribute::Positions:		return mesh.GetPositionData().data();
+		case VertexAttribute::Colours:			return mesh.GetColourData().size() == count ? mesh.GetColourData().data() : nullptr;
+		case VertexAttribute::TextureCoords:	return mesh.GetTextureCoordData().size() == count ? mesh.GetTextureCoordData().data() : nullptr;
+		case VertexAttribute::Normals:			return mesh.GetNormalData().size() == count ? mesh.GetNormalData().data() : nullptr;
+		case VertexAttribute::Tangents:			return mesh.GetTangentData().size() == count ? mesh.GetTangentData().data() : nullptr;
+		case VertexAttribute::Bitangents:		return mesh.GetBiTangentData().size() == count ? mesh.GetBiTangentData().data() : nullptr;
+		}
+		return nullptr;
+	}
+}
+
+OGLMeshArena::OGLMeshArena() {
+	glGenVertexArrays(1, &vao);
+	ReserveVertices(INITIAL_VERTEX_CAPACITY);
+	ReserveIndices(INITIAL_INDEX_CAPACITY);
+	ReserveObjects(INITIAL_OBJECT_CAPACITY);
+
+	glBindVertexArray(vao);
+	for (int i = 0; i < ATTRIBUTE_COUNT; ++i) {
+		glEnableVertexAttribArray(i);
+		glVertexAttribFormat(i, ATTRIBUTE_FORMATS[i].elementCount, GL_FLOAT, false, 0);
+		glVertexAttribBinding(i, i);
+	}
+	glEnableVertexAttribArray(VERTEX_ATTRIBUTE_OBJECT_INDEX);
+	glVertexAttribIFormat(VERTEX_ATTRIBUTE_OBJECT_INDEX, 1, GL_UNSIGNED_INT, 0);
+	glVertexAttribBinding(VERTEX_ATTRIBUTE_OBJECT_INDEX, VERTEX_ATTRIBUTE_OBJECT_INDEX);
+	glVertexBindingDivisor(VERTEX_ATTRIBUTE_OBJECT_INDEX, 1);
+	glBindVertexArray(0);
+}
+
+OGLMeshArena::~OGLMeshArena() {
+	glDeleteVertexArrays(1, &vao);
+	glDeleteBuffers(ATTRIBUTE_COUNT, attributeBuffers);
+	glDeleteBuffers(1, &indexBuffer);
+	glDeleteBuffers(1, &objectIndexBuffer);
+}
+
+const OGLMeshArena::Entry* OGLMeshArena::Add(const MeshGeometry& mesh) {
+	auto found = entries.find(&mesh);
+	if (found != entries.end()) {
+		return &found->second;
+	}
+	if (mesh.GetPrimitiveType() != GeometryPrimitive::Triangles || mesh.GetVertexCount() == 0) {
+		return nullptr;
+	}
+
+	const GLuint meshVertices = mesh.GetVertexCount();
+	// Unindexed meshes get 0..n-1, so every arena draw can be an elements draw
+	std::vector<GLuint> generatedIndices;
+	if (mesh.GetIndexCount() == 0) {
+		generatedIndices.resize(meshVertices);
+		std::iota(generatedIndices.begin(), generatedIndices.end(), 0u);
+	}
+	const std::vector<GLuint>& meshIndices = generatedIndices.empty() ? mesh.GetIndexData() : generatedIndices;
+
+	ReserveVertices(vertexCount + meshVertices);
+	ReserveIndices(indexCount + (GLuint)meshIndices.size());
+
+	std::vector<char> zeros;
+	for (int i = 0; i < ATTRIBUTE_COUNT; ++i) {
+		const GLsizeiptr bytes = (GLsizeiptr)meshVertices * ATTRIBUTE_FORMATS[i].elementSize;
+		const void* data = AttributeData(mesh, i);
+		if (!data) {
+			zeros.resize(std::max<size_t>(zeros.size(), bytes));
+			data = zeros.data();
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, attributeBuffers[i]);
+		glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)vertexCount * ATTRIBUTE_FORMATS[i].elementSize, bytes, data);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)indexCount * sizeof(GLuint), meshIndices.size() * sizeof(GLuint), meshIndices.data());
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	Entry entry;
+	entry.baseVertex = (GLint)vertexCount;
+	for (unsigned int i = 0; i < mesh.GetSubMeshCount(); ++i) {
+		const SubMesh* subMesh = mesh.GetSubMesh(i);
+		entry.subMeshes.push_back({ indexCount + (GLuint)subMesh->start, (GLuint)subMesh->count });
+	}
+
+	vertexCount += meshVertices;
+	indexCount += (GLuint)meshIndices.size();
+
+	return &entries.emplace(&mesh, std::move(entry)).first->second;
+}
+
+void OGLMeshArena::ReserveVertices(GLuint count) {
+	if (count <= vertexCapacity) {
+		return;
+	}
+	const GLuint newCapacity = GrowCapacity(std::max(vertexCapacity, INITIAL_VERTEX_CAPACITY), count);
+
+	glBindVertexArray(vao);
+	for (int i = 0; i < ATTRIBUTE_COUNT; ++i) {
+		const GLsizei elementSize = ATTRIBUTE_FORMATS[i].elementSize;
+		GrowBuffer(attributeBuffers[i], (GLsizeiptr)vertexCount * elementSize, (GLsizeiptr)newCapacity * elementSize);
+		glBindVertexBuffer(i, attributeBuffers[i], 0, elementSize);
+	}
+	glBindVertexArray(0);
+	vertexCapacity = newCapacity;
+}
+
+void OGLMeshArena::ReserveIndices(GLuint count) {
+	if (count <= indexCapacity) {
+		return;
+	}
+	const GLuint newCapacity = GrowCapacity(std::max(indexCapacity, INITIAL_INDEX_CAPACITY), count);
+
+	GrowBuffer(indexBuffer, (GLsizeiptr)indexCount * sizeof(GLuint), (GLsizeiptr)newCapacity * sizeof(GLuint));
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glBindVertexArray(0);
+	indexCapacity = newCapacity;
+}
+
+void OGLMeshArena::ReserveObjects(GLuint count) {
+	if (count <= objectCapacity) {
+		return;
+	}
+	const GLuint newCapacity = GrowCapacity(std::max(objectCapacity, INITIAL_OBJECT_CAPACITY), count);
+
+	std::vector<GLuint> objectIndices(newCapacity);
+	std::iota(objectIndices.begin(), objectIndices.end(), 0u);
+
+	glDeleteBuffers(1, &objectIndexBuffer);
+	glGenBuffers(1, &objectIndexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, objectIndexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, newCapacity * sizeof(GLuint), objectIndices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindVertexArray(vao);
+	glBindVertexBuffer(VERTEX_ATTRIBUTE_OBJECT_INDEX, objectIndexBuffer, 0, sizeof(GLuint));
+	glBindVertexArray(0);
+	objectCapacity = newCapacity;
+}
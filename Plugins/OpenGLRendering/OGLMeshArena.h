@@ -0,0 +1,68 @@
+#pragma once
+#include "Common/Graphics/MeshGeometry.h"
+#include "glad\glad.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace NCL {
+	namespace Rendering {
+		/*
+		* Vertex and index data of many meshes packed into shared buffers behind one VAO, so anything drawn from it
+		* can be submitted with a single glMultiDrawElementsIndirect. Uses the same attribute slots as OGLMesh, with
+		* zeros for any attribute a mesh doesn't have, plus an object index at VERTEX_ATTRIBUTE_OBJECT_INDEX that
+		* steps once per instance: a command's baseInstance selects which object it draws.
+		* Meshes are copied in the first time they're added and aren't expected to change afterwards.
+		*/
+		class OGLMeshArena {
+		public:
+			struct SubMeshRange {
+				GLuint firstIndex;
+				GLuint indexCount;
+			};
+
+			struct Entry {
+				GLint baseVertex;
+				// One per submesh of the source mesh, a mesh without submeshes has no ranges
+				std::vector<SubMeshRange> subMeshes;
+			};
+
+			OGLMeshArena();
+			~OGLMeshArena();
+
+			OGLMeshArena(const OGLMeshArena&) = delete;
+			OGLMeshArena& operator=(const OGLMeshArena&) = delete;
+
+			// Copies the mesh in if it isn't already. Returns nullptr for meshes that aren't triangle lists.
+			const Entry* Add(const MeshGeometry& mesh);
+
+			// Makes sure object indices up to count can be used as a baseInstance
+			void ReserveObjects(GLuint count);
+
+			void Bind() const { glBindVertexArray(vao); }
+
+			GLuint GetVertexCount() const { return vertexCount; }
+			GLuint GetIndexCount() const { return indexCount; }
+
+		protected:
+			// Positions up to Bitangents, the skinning attributes aren't stored
+			static constexpr int ATTRIBUTE_COUNT = VertexAttribute::JointWeights;
+
+			void ReserveVertices(GLuint count);
+			void ReserveIndices(GLuint count);
+
+			GLuint vao = 0;
+			GLuint attributeBuffers[ATTRIBUTE_COUNT] = {};
+			GLuint indexBuffer = 0;
+			GLuint objectIndexBuffer = 0;
+
+			GLuint vertexCount = 0;
+			GLuint vertexCapacity = 0;
+			GLuint indexCount = 0;
+			GLuint indexCapacity = 0;
+			GLuint objectCapacity = 0;
+
+			std::unordered_map<const MeshGeometry*, Entry> entries;
+		};
+	}
+}
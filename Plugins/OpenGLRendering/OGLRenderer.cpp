@@ -10,12 +10,14 @@ https://research.ncl.ac.uk/game/
 #include "OGLShader.h"
 #include "OGLMesh.h"
 #include "OGLTexture.h"
+#include "OGLShaderStorageBuffer.h"
 
 #include "Common/Math/Maths.h"
 #include "Common/Graphics/SimpleFont.h"
 #include "Common/Graphics/TextureLoader.h"
 #include "Common/Graphics/MeshGeometry.h"
 
+#include <cstddef>
 
 #ifdef _WIN32
 #include "Common/Graphics/Win32Window.h"
@@ -39,6 +41,16 @@ extern "C"
 using namespace NCL;
 using namespace NCL::Rendering;
 
+namespace {
+	struct DebugLineVertex {
+		Vector3 position;
+		Vector4 colour;
+	};
+
+	// Lines drawn from one allocation, more than this are split across several draws
+	constexpr size_t MAX_DEBUG_LINES_PER_DRAW = 8192;
+}
+
 #ifdef OPENGL_DEBUGGING
 static void APIENTRY DebugCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar *message, const void *userParam);
 #endif;
@@ -72,26 +84,33 @@ OGLRenderer::OGLRenderer(Window& w) : RendererBase(w)	{
 
 	forceValidDebugState = false;
 
-	debugLinesMesh		= new OGLMesh();
 	debugTextMesh		= new OGLMesh();
 
-
-	debugLinesMesh->SetVertexPositions(std::vector<Vector3>(5000, Vector3()));
-	debugLinesMesh->SetVertexColours(std::vector<Vector4>(5000, Vector3()));
+	// Debug lines are rewritten every frame, so they're streamed rather than kept in a mesh
+	debugLineStream = std::make_unique<StreamingBuffer>(MAX_DEBUG_LINES_PER_DRAW * 2 * sizeof(DebugLineVertex));
+	glGenVertexArrays(1, &debugLineVAO);
+	glBindVertexArray(debugLineVAO);
+	glEnableVertexAttribArray(VertexAttribute::Positions);
+	glVertexAttribFormat(VertexAttribute::Positions, 3, GL_FLOAT, false, offsetof(DebugLineVertex, position));
+	glVertexAttribBinding(VertexAttribute::Positions, 0);
+	glEnableVertexAttribArray(VertexAttribute::Colours);
+	glVertexAttribFormat(VertexAttribute::Colours, 4, GL_FLOAT, false, offsetof(DebugLineVertex, colour));
+	glVertexAttribBinding(VertexAttribute::Colours, 0);
+	glBindVertexArray(0);
 
 	debugTextMesh->SetVertexPositions(std::vector<Vector3>(5000, Vector3()));
 	debugTextMesh->SetVertexColours(std::vector<Vector4>(5000, Vector3()));
 	debugTextMesh->SetVertexTextureCoords(std::vector<Vector2>(5000, Vector3()));
 
 	debugTextMesh->UploadToGPU();
-	debugLinesMesh->UploadToGPU();
-
-	debugLinesMesh->SetPrimitiveType(GeometryPrimitive::Lines);
 }
 
 OGLRenderer::~OGLRenderer()	{
 	delete font;
 	delete debugShader;
+	glDeleteVertexArrays(1, &debugLineVAO);
+	// Its destructor deletes GL objects, so it has to go while the context still exists
+	debugLineStream.reset();
 
 #ifdef _WIN32
 	DestroyWithWin32();
@@ -117,6 +136,8 @@ void OGLRenderer::RenderFrame()		{
 
 void OGLRenderer::EndFrame()		{
 	DrawDebugData();
+	lastFrameCounters = frameCounters;
+	frameCounters = {};
 }
 
 void OGLRenderer::SwapBuffers()   {
@@ -130,6 +151,7 @@ void OGLRenderer::BindShader(ShaderBase*s) {
 	}
 	else if (OGLShader* oglShader = dynamic_cast<OGLShader*>(s)) {
 		glUseProgram(oglShader->programID);
+		frameCounters.shaderChanges += oglShader != boundShader ? 1 : 0;
 		boundShader = oglShader;
 		// TODO: Should we ever need to do this?
 		//oglShader->ClearCache();
@@ -150,6 +172,7 @@ void OGLRenderer::BindMesh(MeshGeometry*m) {
 			LOG_ERROR("{} has recieved invalid mesh!?", __FUNCTION__);
 		}
 		glBindVertexArray(oglMesh->GetVAO());
+		frameCounters.meshChanges += oglMesh != boundMesh ? 1 : 0;
 		boundMesh = oglMesh;
 	}
 	else {
@@ -195,36 +218,33 @@ void OGLRenderer::DrawBoundMesh(int subLayer, int numInstances) {
 		case GeometryPrimitive::LineStrip:   mode = GL_LINE_STRIP;       break;
 	}
 
+	frameCounters.drawCalls++;
 	if (boundMesh->GetIndexCount() > 0) {
-		glDrawElements(mode, count, GL_UNSIGNED_INT, (const GLvoid*)(offset * sizeof(unsigned int)));
+		glDrawElementsInstanced(mode, count, GL_UNSIGNED_INT, (const GLvoid*)(offset * sizeof(unsigned int)), numInstances);
 	}
 	else {
-		glDrawArrays(mode, 0, count);
+		glDrawArraysInstanced(mode, 0, count, numInstances);
 	}
 }
 
-void OGLRenderer::BindTextureToShader(const TextureBase*t, const std::string& uniform, int texUnit) const{
+void OGLRenderer::BindTextureToShader(const TextureBase*t, UniformID uniform, int texUnit) const{
 	GLint texID = 0;
 
 	if (!boundShader) {
 		LOG_WARN("{} has been called without a bound shader!", __FUNCTION__);
 		return;//Debug message time!
 	}
-	
-	GLuint slot = glGetUniformLocation(boundShader->programID, uniform.c_str());
-
-	if (slot < 0) {
-		return;
-	}
 
 	if (const OGLTexture* oglTexture = dynamic_cast<const OGLTexture*>(t)) {
 		texID = oglTexture->GetObjectID();
 	}
 
 	Cmds::BindTexture(texUnit, texID);
+	frameCounters.textureBinds++;
 
 #ifndef GL_VERSION_4_5
-	glUniform1i(slot, texUnit);
+	// From 4.5 the samplers' units are set with layout(binding), so there's no uniform to look up
+	glUniform1i(boundShader->GetUniformLocation(uniform), texUnit);
 #endif
 }
 
@@ -313,24 +333,27 @@ void OGLRenderer::DrawDebugStrings() {
 }
 
 void OGLRenderer::DrawDebugLines() {
-	vector<Vector3> vertPos;
-	vector<Vector4> vertCol;
-
-	for (DebugLine&s : debugLines) {
-		vertPos.emplace_back(s.start);
-		vertPos.emplace_back(s.end);
+	glBindVertexArray(debugLineVAO);
 
-		vertCol.emplace_back(s.colour);
-		vertCol.emplace_back(s.colour);
-	}
+	for (size_t first = 0; first < debugLines.size(); first += MAX_DEBUG_LINES_PER_DRAW) {
+		const size_t lineCount = std::min(debugLines.size() - first, MAX_DEBUG_LINES_PER_DRAW);
+		const StreamingBuffer::Allocation allocation = debugLineStream->Allocate(lineCount * 2 * sizeof(DebugLineVertex));
+		if (!allocation.data) {
+			break;
+		}
 
-	debugLinesMesh->SetVertexPositions(vertPos);
-	debugLinesMesh->SetVertexColours(vertCol);
-	debugLinesMesh->UpdateGPUBuffers(0, vertPos.size());
+		DebugLineVertex* vertices = (DebugLineVertex*)allocation.data;
+		for (size_t i = 0; i < lineCount; ++i) {
+			const DebugLine& line = debugLines[first + i];
+			vertices[i * 2] = { line.start, line.colour };
+			vertices[i * 2 + 1] = { line.end, line.colour };
+		}
 
-	BindMesh(debugLinesMesh);
-	DrawBoundMesh();
+		glBindVertexBuffer(0, debugLineStream->GetID(), allocation.offset, sizeof(DebugLineVertex));
+		glDrawArrays(GL_LINES, 0, (GLsizei)(lineCount * 2));
+	}
 
+	BindMesh(nullptr);
 	debugLines.clear();
 }
 
@@ -11,10 +11,12 @@ https://research.ncl.ac.uk/game/
 #include "Common/Graphics/RendererBase.h"
 #include "Common/Math/Maths.h"
 #include "Common/NCLAliases.h"
+#include "UniformID.h"
 #include <string>
 #include <vector>
 #include <span>
 #include <functional>
+#include <memory>
 
 #ifdef _DEBUG
 #define OPENGL_DEBUGGING
@@ -34,6 +36,7 @@ namespace NCL {
 		class OGLMesh;
 		class OGLShader;
 		class OGLTexture;
+		class StreamingBuffer;
 
 		class SimpleFont;
 
@@ -46,6 +49,16 @@ namespace NCL {
 			std::reference_wrapper<const OGLTexture> texture;
 		};
 
+		// State changes and draws issued through OGLRenderer over a frame
+		struct RenderStateCounters {
+			uint shaderChanges = 0;
+			uint meshChanges = 0;
+			uint textureBinds = 0;
+			uint drawCalls = 0;
+
+			uint StateChanges() const { return shaderChanges + meshChanges + textureBinds; }
+		};
+
 		struct RenderInfo {
 			std::string_view name;
 			std::span<const RenderColourAttachment> colorAttachments;
@@ -80,6 +93,9 @@ namespace NCL {
 			virtual Matrix4 SetupDebugLineMatrix()	const;
 			virtual Matrix4 SetupDebugStringMatrix()const;
 
+			// Counted from the end of one frame to the end of the next, so this includes debug drawing
+			const RenderStateCounters& GetLastFrameCounters() const { return lastFrameCounters; }
+
 		protected:			
 			void BeginFrame()	override;
 			void RenderFrame()	override;
@@ -91,7 +107,7 @@ namespace NCL {
 			void DrawDebugLines();
 
 			void BindShader(ShaderBase*s);
-			void BindTextureToShader(const TextureBase*t, const std::string& uniform, int texUnit) const;
+			void BindTextureToShader(const TextureBase*t, UniformID uniform, int texUnit) const;
 			void BindMesh(MeshGeometry*m);
 			void DrawBoundMesh(int subLayer = 0, int numInstances = 1);
 #ifdef _WIN32
@@ -103,6 +119,9 @@ namespace NCL {
 		protected:
 			OGLMesh* boundMesh;
 			OGLShader* boundShader;
+			// Shaders and meshes only count when they differ from the last bound, draws made outside DrawBoundMesh are added by hand
+			mutable RenderStateCounters frameCounters;
+			RenderStateCounters lastFrameCounters;
 		private:
 			struct DebugString {
 				Maths::Vector4 colour;
@@ -117,7 +136,8 @@ namespace NCL {
 				Maths::Vector4 colour;
 			};
 
-			OGLMesh* debugLinesMesh;
+			std::unique_ptr<StreamingBuffer> debugLineStream;
+			uint debugLineVAO;
 			OGLMesh* debugTextMesh;
 
 			OGLShader*  debugShader;
@@ -9,6 +9,7 @@ https://research.ncl.ac.uk/game/
 #include "OGLShader.h"
 #include "Common/Resources/Assets.h"
 #include "Common/Math/Maths.h"
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <type_traits>
@@ -173,43 +174,50 @@ void OGLShader::PrintLinkLog(GLuint program) {
 
 void OGLShader::PrintUniformCache() {
 	LOG_INFO("Uniform Log:\n{}");
-	for (auto& [name, entry] : uniformCache) {
-		LOG_INFO("Name: {}", name);
-		LOG_INFO("\tLocation: {}", entry.location);
-		LOG_INFO("\tCount: {}", entry.count);
+	for (const CachedUniform& uniform : uniformCache) {
+		LOG_INFO("Name: {}", uniform.name);
+		LOG_INFO("\tLocation: {}", uniform.entry.location);
+		LOG_INFO("\tCount: {}", uniform.entry.count);
 	}
 }
 
-GLint OGLShader::GetUniformLocation(const std::string& name) const {
-	auto it = uniformCache.find(name);
-	if (uniformCache.find(name) != uniformCache.end()) {
-		return it->second.location;
+std::vector<CachedUniform>::iterator OGLShader::FindUniform(UniformID name) const {
+	return std::lower_bound(uniformCache.begin(), uniformCache.end(), name.hash,
+		[](const CachedUniform& uniform, uint32_t hash) { return uniform.hash < hash; });
+}
+
+GLint OGLShader::GetUniformLocation(UniformID name) const {
+	auto it = FindUniform(name);
+	if (it != uniformCache.end() && it->hash == name.hash) {
+		return it->entry.location;
 	}
 
 	// Fallback, if the requested uniform is not in the cache.
-	GLint location = glGetUniformLocation(programID, name.c_str());
+	const std::string nameString(name.name);
+	GLint location = glGetUniformLocation(programID, nameString.c_str());
 
 	// Changing value of location because if glUniformXX is called with -1, the uniform is silently ignored.
 	// I'd rather know that an invalid uniform is trying to be used.
 	if (location == GL_INVALID_UNIFORM_LOCATION) {	
 		location = NCL_INVALID_UNIFORM_LOCATION;
-		LOG_ERROR("Uniform {} does not exist on shader {}:{}", name, programID, shaderFiles);
+		LOG_ERROR("Uniform {} does not exist on shader {}:{}", nameString, programID, shaderFiles);
 	}
 
-	uniformCache[name].location = location;
+	uniformCache.insert(it, { name.hash, nameString, { location, 1 } });
 	return location;
 }
 
-std::optional<UniformEntry> OGLShader::GetUniformEntry(const std::string& name) const {
-	auto it = uniformCache.find(name);
-	if (uniformCache.find(name) != uniformCache.end()) {
-		return { it->second };
+std::optional<UniformEntry> OGLShader::GetUniformEntry(UniformID name) const {
+	auto it = FindUniform(name);
+	if (it != uniformCache.end() && it->hash == name.hash) {
+		return { it->entry };
 	}
 	return {};
 }
 
-bool OGLShader::HasUniformEntry(const std::string& name) const {
-	return uniformCache.contains(name);
+bool OGLShader::HasUniformEntry(UniformID name) const {
+	auto it = FindUniform(name);
+	return it != uniformCache.end() && it->hash == name.hash;
 }
 // From Guide to Modern OpenGL
 void OGLShader::CacheUniforms() {
@@ -232,8 +240,27 @@ void OGLShader::CacheUniforms() {
 			UniformEntry uniform_info = {};
 			uniform_info.location = glGetUniformLocation(programID, uniform_name.get());
 			uniform_info.count = count;
+			// Members of uniform blocks have no location, they're set through the block's buffer
+			if (uniform_info.location == GL_INVALID_UNIFORM_LOCATION) {
+				continue;
+			}
+
+			std::string name(uniform_name.get(), length);
+			// Arrays are reported as name[0], but set by their plain name
+			if (name.ends_with("[0]")) {
+				name.resize(name.size() - 3);
+			}
+			const uint32_t hash = HashUniformName(name);
+			uniformCache.push_back({ hash, std::move(name), uniform_info });
+		}
+	}
 
-			uniformCache.emplace(std::make_pair(std::string(uniform_name.get(), length), uniform_info));
+	std::sort(uniformCache.begin(), uniformCache.end(),
+		[](const CachedUniform& a, const CachedUniform& b) { return a.hash < b.hash; });
+	for (size_t i = 1; i < uniformCache.size(); ++i) {
+		if (uniformCache[i].hash == uniformCache[i - 1].hash) {
+			LOG_ERROR("Uniforms {} and {} have the same hash on shader {}:{}, rename one of them",
+				uniformCache[i - 1].name, uniformCache[i].name, programID, shaderFiles);
 		}
 	}
 }
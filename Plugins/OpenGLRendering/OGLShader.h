@@ -1,9 +1,10 @@
 #pragma once
 #include "Common/Graphics/ShaderBase.h"
+#include "UniformID.h"
 #include <Common.h>
 #include "glad\glad.h"
-#include <unordered_map>
 #include <string>
+#include <vector>
 #include <variant>
 #include <utility>
 #include <type_traits>
@@ -23,6 +24,13 @@ namespace NCL {
 			GLint count;
 		};
 
+		// A uniform cache entry, keyed by the hash of its name
+		struct CachedUniform {
+			uint32_t hash;
+			std::string name;
+			UniformEntry entry;
+		};
+
 #define GL_INVALID_UNIFORM_LOCATION -1
 #define	NCL_INVALID_UNIFORM_LOCATION -1 // Set to lower than GL (-1) if you want invalid location errors to be raised when setting uniforms
 
@@ -71,7 +79,7 @@ namespace NCL {
 			}	
 
 			template <typename T>
-			std::enable_if_t<std::is_arithmetic_v<T>, void> SetUniform(const std::string& name, const T& value) const
+			std::enable_if_t<std::is_arithmetic_v<T>, void> SetUniform(UniformID name, const T& value) const
 			{
 				if constexpr (std::is_integral_v<T>) {
 					glUniform1i(GetUniformLocation(name), value);
@@ -83,7 +91,7 @@ namespace NCL {
 
 			//template <typename T, typename = std::enable_if_t<IsVector<T>::value>>
 			template< typename VecType>
-			std::enable_if_t<NCL::Maths::IsVector<VecType>::value, void> SetUniform(const std::string& name, const VecType& value) const {
+			std::enable_if_t<NCL::Maths::IsVector<VecType>::value, void> SetUniform(UniformID name, const VecType& value) const {
 				constexpr int VecSize = sizeof(VecType) / sizeof(float);
 				static_assert(VecSize >= 2 && VecSize <= 4, "Unsupported vector size");
 
@@ -101,7 +109,7 @@ namespace NCL {
 			}
 
 			template <typename MatType>
-			std::enable_if_t<std::is_same_v<MatType, NCL::Maths::Matrix4>, void> SetUniform(const std::string& name, const MatType& value) const {
+			std::enable_if_t<std::is_same_v<MatType, NCL::Maths::Matrix4>, void> SetUniform(UniformID name, const MatType& value) const {
 				constexpr int MatSize = sizeof(MatType) / sizeof(float);
 
 				if constexpr (MatSize == 16) {
@@ -118,9 +126,9 @@ namespace NCL {
 			}
 
 			/* Apply multiple uniforms without having to repeatedly call SetUniform.
-			args: Takes a sequence of strings and uniform values e.g.
-			"tilePxX", clusterX,
-			"tilePxY", clusterY 
+			args: Takes a sequence of strings or UniformIDs and uniform values e.g.
+			"tilePxX"_u, clusterX,
+			"tilePxY"_u, clusterY 
 			Precondition: args must have an even number of arguments*/
 			template <typename... Args>
 			static void SetUniforms(OGLShader* shader, Args&&... args) {
@@ -140,6 +148,10 @@ namespace NCL {
 			static void	PrintLinkLog(GLuint program);
 			void PrintUniformCache();
 
+			// Looks the location up in the table built when the program linked. Uniforms that weren't active then are
+			// queried from GL once, and an error is logged if they don't exist.
+			GLint GetUniformLocation(UniformID name) const;
+
 		protected:
 			OGLShader();
 
@@ -152,17 +164,18 @@ namespace NCL {
 			int		shaderValid[(int)ShaderStages::SHADER_MAX];
 			int		programValid;
 
-			//mutable std::unordered_map<std::string, GLint> uniformCache;
-			mutable std::unordered_map<std::string, UniformEntry> uniformCache;
+			// Sorted by hash, a program only has a few dozen uniforms so a binary search beats hashing into a map
+			mutable std::vector<CachedUniform> uniformCache;
 
-			GLint GetUniformLocation(const std::string& name) const;
+			// @return The first entry whose hash isn't less than name's, so either name's entry or where it would go
+			std::vector<CachedUniform>::iterator FindUniform(UniformID name) const;
 
 			// @return If found, a uniform entry struct containing the location and size of the uniform.
-			std::optional<UniformEntry> GetUniformEntry(const std::string& name) const;
+			std::optional<UniformEntry> GetUniformEntry(UniformID name) const;
 
 			// Returns true, if a uniform with name exists in the shader
 			// Call GetUniformEntry is you actually want to retrieve info about the uniform.
-			bool HasUniformEntry(const std::string& name) const;
+			bool HasUniformEntry(UniformID name) const;
 			
 			void CacheUniforms();
 
@@ -1 +1,191 @@
 #include "OGLShaderStorageBuffer.h"
+#include "Common/Core/Log/Logging.h"
+
+#include <algorithm>
+
+using namespace NCL;
+using namespace Rendering;
+
+namespace {
+    // A second at a time, so a hung GPU still gets logged
+    constexpr GLuint64 FENCE_TIMEOUT_NS = 1000000000;
+
+    GLsizeiptr AlignUp(GLsizeiptr size, GLsizeiptr alignment) {
+        return (size + alignment - 1) / alignment * alignment;
+    }
+}
+
+StreamingBuffer::StreamingBuffer(GLsizeiptr size, GLuint segmentCount) : fences(std::max(segmentCount, 1u), nullptr) {
+    // Allocations may be bound as uniform or storage ranges, so start them on the stricter of the two alignments
+    GLint uniformAlignment = 0;
+    GLint storageAlignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+    alignment = std::max<GLsizeiptr>({ uniformAlignment, storageAlignment, 16 });
+    segmentSize = AlignUp(size, alignment);
+
+    if (!GLAD_GL_VERSION_4_4 && !GLAD_GL_ARB_buffer_storage) {
+        LOG_ERROR("{} needs GL 4.4 or ARB_buffer_storage for persistent mapping", __FUNCTION__);
+        return;
+    }
+
+    const GLsizeiptr totalSize = segmentSize * (GLsizeiptr)fences.size();
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &id);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, id);
+    glBufferStorage(GL_COPY_WRITE_BUFFER, totalSize, nullptr, flags);
+    mapped = (char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, totalSize, flags);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+StreamingBuffer::~StreamingBuffer() {
+    for (GLsync fence : fences) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+    if (id) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, id);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glDeleteBuffers(1, &id);
+    }
+}
+
+StreamingBuffer::Allocation StreamingBuffer::Allocate(GLsizeiptr size) {
+    if (!mapped || size > segmentSize) {
+        LOG_ERROR("{} can't allocate {} bytes from {} byte segments", __FUNCTION__, size, segmentSize);
+        return {};
+    }
+
+    if (segmentUsed + size > segmentSize) {
+        NextSegment();
+    }
+
+    Allocation allocation;
+    allocation.offset = currentSegment * segmentSize + segmentUsed;
+    allocation.data = mapped + allocation.offset;
+    allocation.size = size;
+    segmentUsed = std::min(AlignUp(segmentUsed + size, alignment), segmentSize);
+    return allocation;
+}
+
+void StreamingBuffer::CopyTo(GLuint destination, GLintptr destinationOffset, const Allocation& allocation) const {
+    glBindBuffer(GL_COPY_READ_BUFFER, id);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, destination);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, allocation.offset, destinationOffset, allocation.size);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void StreamingBuffer::NextSegment() {
+    fences[currentSegment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    currentSegment = (currentSegment + 1) % (GLuint)fences.size();
+    segmentUsed = 0;
+
+    GLsync& fence = fences[currentSegment];
+    if (!fence) {
+        return;
+    }
+
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        ++stallCount;
+        // Flush so the fence is guaranteed to be reached
+        while ((result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS)) == GL_TIMEOUT_EXPIRED) {
+            LOG_WARN("{} still waiting for the GPU to finish with segment {}", __FUNCTION__, currentSegment);
+        }
+    }
+    CLOG_WARN(result == GL_WAIT_FAILED, "{} glClientWaitSync failed", __FUNCTION__);
+
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+ReadbackBuffer::ReadbackBuffer(GLsizeiptr size, GLuint slotCount) : slotSize(AlignUp(size, 16)), slots(std::max(slotCount, 2u)) {
+    if (!GLAD_GL_VERSION_4_4 && !GLAD_GL_ARB_buffer_storage) {
+        LOG_ERROR("{} needs GL 4.4 or ARB_buffer_storage for persistent mapping", __FUNCTION__);
+        return;
+    }
+
+    const GLsizeiptr totalSize = slotSize * (GLsizeiptr)slots.size();
+    const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &id);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, id);
+    glBufferStorage(GL_COPY_WRITE_BUFFER, totalSize, nullptr, flags);
+    mapped = (const char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, totalSize, flags);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+ReadbackBuffer::~ReadbackBuffer() {
+    for (Slot& slot : slots) {
+        if (slot.fence) {
+            glDeleteSync(slot.fence);
+        }
+    }
+    if (id) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, id);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glDeleteBuffers(1, &id);
+    }
+}
+
+uint64_t ReadbackBuffer::Enqueue(GLuint source, GLintptr sourceOffset, GLsizeiptr size) {
+    if (!mapped || size > slotSize) {
+        LOG_ERROR("{} can't read back {} bytes into {} byte slots", __FUNCTION__, size, slotSize);
+        return 0;
+    }
+
+    Slot& slot = slots[nextSlot];
+    if (slot.fence) {
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+    }
+    if (latestSlot == (int)nextSlot) {
+        latestSlot = -1;
+    }
+
+    // Shader writes to source have to land before the copy reads them, and the copy before the CPU does
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT | GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+    glBindBuffer(GL_COPY_READ_BUFFER, source);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, id);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, sourceOffset, nextSlot * slotSize, size);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.size = size;
+    slot.sequence = nextSequence++;
+    nextSlot = (nextSlot + 1) % (GLuint)slots.size();
+    return slot.sequence;
+}
+
+ReadbackBuffer::Result ReadbackBuffer::Latest() {
+    // Copies finish in order, so the newest one that's done means every older one is too
+    for (GLuint i = 1; i <= (GLuint)slots.size(); ++i) {
+        const GLuint index = (nextSlot + (GLuint)slots.size() - i) % (GLuint)slots.size();
+        Slot& slot = slots[index];
+        if (!slot.fence) {
+            continue;
+        }
+        const GLenum result = glClientWaitSync(slot.fence, 0, 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+            continue;
+        }
+        for (Slot& older : slots) {
+            if (older.fence && older.sequence <= slot.sequence) {
+                glDeleteSync(older.fence);
+                older.fence = nullptr;
+            }
+        }
+        latestSlot = (int)index;
+        break;
+    }
+
+    if (latestSlot < 0) {
+        return {};
+    }
+    const Slot& latest = slots[latestSlot];
+    return { mapped + latestSlot * slotSize, latest.size, latest.sequence };
+}
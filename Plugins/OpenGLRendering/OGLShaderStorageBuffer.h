@@ -1,7 +1,10 @@
 #pragma once
 
 #include "glad\glad.h"
+#include <cstdint>
 #include <memory>
+#include <utility>
+#include <vector>
 
 /* Thin wrapper around an OpenGL SSBO. Should only be created via the factory down below.*/
 namespace NCL {
@@ -86,5 +89,110 @@ namespace NCL {
                 return OGLShaderStorageBuffer(bufferID);
             }
         };
+
+        /*
+        * Ring of buffer segments, persistently mapped, for data the CPU rewrites every frame.
+        * Allocations are carved out of the current segment until it's full, then the segment is fenced and the
+        * ring moves on. The CPU only waits if it laps the GPU, which with 3 segments means being 2 full segments
+        * ahead of it.
+        * The commands that read an allocation must be submitted before the next Allocate, since that may fence its
+        * segment. Needs GL 4.4 or ARB_buffer_storage.
+        */
+        class StreamingBuffer {
+        public:
+            static constexpr GLuint DEFAULT_SEGMENT_COUNT = 3;
+
+            struct Allocation {
+                void* data = nullptr;
+                GLintptr offset = 0;
+                GLsizeiptr size = 0;
+            };
+
+            StreamingBuffer(GLsizeiptr segmentSize, GLuint segmentCount = DEFAULT_SEGMENT_COUNT);
+            ~StreamingBuffer();
+
+            StreamingBuffer(const StreamingBuffer&) = delete;
+            StreamingBuffer& operator=(const StreamingBuffer&) = delete;
+
+            // Returns write-only memory, offset is from the start of the buffer. size must fit in a segment,
+            // larger requests log an error and return an empty Allocation.
+            Allocation Allocate(GLsizeiptr size);
+
+            void BindRange(GLenum target, GLuint bindingPoint, const Allocation& allocation) const {
+                glBindBufferRange(target, bindingPoint, id, allocation.offset, allocation.size);
+            }
+
+            // Copies an allocation into another buffer on the GPU, for data that lives in a regular buffer
+            void CopyTo(GLuint destination, GLintptr destinationOffset, const Allocation& allocation) const;
+
+            inline GLuint GetID() const { return id; }
+            inline GLsizeiptr GetSegmentSize() const { return segmentSize; }
+            // Allocations start on a multiple of this, so sub-ranges padded to it can be bound as buffer ranges too
+            inline GLsizeiptr GetAlignment() const { return alignment; }
+
+            // Times Allocate had to wait for the GPU to finish with a segment. Should stay at 0.
+            inline uint64_t GetStallCount() const { return stallCount; }
+
+        private:
+            // Fences the current segment and waits until the next one is free
+            void NextSegment();
+
+            GLuint id = 0;
+            char* mapped = nullptr;
+            GLsizeiptr segmentSize = 0;
+            GLsizeiptr alignment = 0;
+            GLsizeiptr segmentUsed = 0;
+            GLuint currentSegment = 0;
+            std::vector<GLsync> fences;
+            uint64_t stallCount = 0;
+        };
+
+        /*
+        * Ring of persistently mapped buffers for results the CPU reads back from the GPU without waiting for it.
+        * Enqueue copies part of a buffer into the next slot and fences it. Latest returns the newest copy the GPU
+        * has finished, which is normally from a frame or two before, and never waits.
+        * If every slot is still in flight, Enqueue reuses the oldest and that copy's result is lost.
+        * Needs GL 4.4 or ARB_buffer_storage.
+        */
+        class ReadbackBuffer {
+        public:
+            static constexpr GLuint DEFAULT_SLOT_COUNT = 3;
+
+            struct Result {
+                const void* data = nullptr;
+                GLsizeiptr size = 0;
+                // Returned by the Enqueue that made the copy, 0 if no copy has finished yet
+                uint64_t sequence = 0;
+            };
+
+            ReadbackBuffer(GLsizeiptr slotSize, GLuint slotCount = DEFAULT_SLOT_COUNT);
+            ~ReadbackBuffer();
+
+            ReadbackBuffer(const ReadbackBuffer&) = delete;
+            ReadbackBuffer& operator=(const ReadbackBuffer&) = delete;
+
+            // Copies size bytes of source from sourceOffset. Returns the copy's sequence number, or 0 if it didn't fit.
+            uint64_t Enqueue(GLuint source, GLintptr sourceOffset, GLsizeiptr size);
+            // data stays valid until the slot is reused, at least SlotCount - 1 Enqueues later
+            Result Latest();
+
+            inline GLsizeiptr GetSlotSize() const { return slotSize; }
+
+        private:
+            struct Slot {
+                GLsync fence = nullptr;
+                GLsizeiptr size = 0;
+                uint64_t sequence = 0;
+            };
+
+            GLuint id = 0;
+            const char* mapped = nullptr;
+            GLsizeiptr slotSize = 0;
+            std::vector<Slot> slots;
+            GLuint nextSlot = 0;
+            uint64_t nextSequence = 1;
+            // Slot of the newest finished copy, or -1
+            int latestSlot = -1;
+        };
     }
 }
\ No newline at end of file
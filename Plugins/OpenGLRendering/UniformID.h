@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace NCL {
+	namespace Rendering {
+		// 32 bit FNV-1a, constexpr so names written as "name"_u are hashed by the compiler
+		constexpr uint32_t HashUniformName(std::string_view name) {
+			uint32_t hash = 2166136261u;
+			for (char c : name) {
+				hash = (hash ^ (uint8_t)c) * 16777619u;
+			}
+			return hash;
+		}
+
+		/*
+		* Names a shader uniform by the hash of its name, which is what OGLShader looks locations up by.
+		* Plain strings are hashed where they're passed in, "name"_u literals at compile time.
+		* The name is only kept for error messages and for uniforms that weren't active when the program linked.
+		*/
+		struct UniformID {
+			uint32_t hash;
+			std::string_view name;
+
+			constexpr UniformID(std::string_view uniformName) : hash(HashUniformName(uniformName)), name(uniformName) {}
+			constexpr UniformID(const char* uniformName) : UniformID(std::string_view(uniformName)) {}
+			UniformID(const std::string& uniformName) : UniformID(std::string_view(uniformName)) {}
+		};
+
+		consteval UniformID operator""_u(const char* name, size_t length) {
+			return UniformID(std::string_view(name, length));
+		}
+	}
+}